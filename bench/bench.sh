@@ -0,0 +1,68 @@
+#!/bin/sh
+#
+# Generate synthetic corpora and run all the benchmark phases on each of
+# them. The results are printed to the standard output, one line of
+# key=value pairs per run.
+#
+#   BENCH_SCALE  - multiplies the number of records of each corpus (default: 1)
+#   BENCH_DIR    - where to store the corpora (default: ./corpus)
+#   BENCH_PHASES - phases to run (default: all)
+#
+FASTAGEN="${FASTAGEN:-../tests/fastagen}"
+FASTABENCH="${FASTABENCH:-./fastabench}"
+
+BENCH_SCALE="${BENCH_SCALE:-1}"
+BENCH_DIR="${BENCH_DIR:-corpus}"
+BENCH_PHASES="${BENCH_PHASES:-open-scan open-index read-seq read-rand fetch-rand apply}"
+
+mkdir -p "${BENCH_DIR}" || exit 1
+
+#
+# name numseq seqlen seqlen-variability linew linew-variability
+#
+corpora() {
+    cat <<CORPORA
+many-short $((200000 * BENCH_SCALE)) 100 50 60 0
+few-long $((20 * BENCH_SCALE)) 1000000 100000 60 0
+medium $((20000 * BENCH_SCALE)) 1000 500 80 0
+variable-width $((20000 * BENCH_SCALE)) 1000 500 60 20
+single-line $((20000 * BENCH_SCALE)) 1000 500 100000 0
+CORPORA
+}
+
+corpora | while read name numseq seqlen seqlenv linew linewv; do
+    file="${BENCH_DIR}/${name}-${BENCH_SCALE}.fa"
+
+    if [ ! -f "${file}" ]; then
+        "${FASTAGEN}" 1 2 ${numseq} ${seqlen} ${seqlenv} ${linew} ${linewv} > "${file}" 2> /dev/null || exit 1
+    fi
+
+    rm -f "${file}.index"
+
+    for phase in ${BENCH_PHASES}; do
+        case "${phase}" in
+            open-*)
+                modes="plain"
+                ;;
+            read-rand)
+                modes="plain keepopen"
+                ;;
+            fetch-rand)
+                modes="plain trans cds"
+                ;;
+            *)
+                modes="plain keepopen keepopen,trans keepopen,cds"
+                ;;
+        esac
+
+        for mode in ${modes}; do
+            if [ "${mode}" = plain ]; then
+                args=""
+            else
+                args="$(echo ${mode} | tr ',' ' ')"
+            fi
+
+            "${FASTABENCH}" "${file}" ${phase} ${args} | sed "s/^/corpus=${name} scale=${BENCH_SCALE} /" || exit 1
+        done
+    done
+done
@@ -0,0 +1,296 @@
+#define _DEFAULT_SOURCE
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <libgen.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <fasta.h>
+
+#define BENCH_RANDOM_SEED 1618
+
+/*
+ * I/O counters of the process from /proc/self/io
+ */
+typedef struct {
+	int64_t syscr;
+	int64_t syscw;
+	int64_t rchar;
+} iostat_t;
+
+static void iostat_get(iostat_t *io)
+{
+	FILE *fp;
+	char  key[32];
+	int64_t val;
+
+	io->syscr = io->syscw = io->rchar = -1;
+
+	if ((fp = fopen("/proc/self/io", "r")) == NULL)
+		return;
+
+	while (fscanf(fp, "%31[^:]: %"SCNd64"\n", key, &val) == 2) {
+		if (strcmp(key, "syscr") == 0)
+			io->syscr = val;
+		else if (strcmp(key, "syscw") == 0)
+			io->syscw = val;
+		else if (strcmp(key, "rchar") == 0)
+			io->rchar = val;
+	}
+
+	fclose(fp);
+}
+
+static uint64_t time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+typedef struct {
+	uint64_t start;
+	iostat_t io;
+} bench_t;
+
+static void bench_start(bench_t *b)
+{
+	iostat_get(&b->io);
+	b->start = time_ns();
+}
+
+/*
+ * Print the results as a single line of key=value pairs
+ */
+static void bench_report(bench_t *b, const char *phase, const char *path, const char *mode,
+			 uint64_t bytes, uint64_t records)
+{
+	uint64_t ns = time_ns() - b->start;
+	double   s  = ns / 1e9;
+	iostat_t io;
+	struct rusage ru;
+
+	iostat_get(&io);
+	getrusage(RUSAGE_SELF, &ru);
+
+	printf("phase=%s file=%s mode=%s"
+	       " ns=%"PRIu64" bytes=%"PRIu64" records=%"PRIu64
+	       " mb_s=%.2f records_s=%.0f"
+	       " maxrss_kb=%ld syscr=%"PRId64" syscw=%"PRId64" rchar=%"PRId64"\n",
+	       phase, basename((char *)path), mode,
+	       ns, bytes, records,
+	       s > 0 ? bytes / s / (1024 * 1024) : 0.0, s > 0 ? records / s : 0.0,
+	       ru.ru_maxrss,
+	       io.syscr >= 0 ? io.syscr - b->io.syscr : -1,
+	       io.syscw >= 0 ? io.syscw - b->io.syscw : -1,
+	       io.rchar >= 0 ? io.rchar - b->io.rchar : -1);
+}
+
+static void *apply_sum(FASTA_rec_t *farec, void *arg)
+{
+	uint64_t *sum = arg;
+
+	if (farec != NULL)
+		*sum += farec->seq_len;
+
+	return (NULL);
+}
+
+static int fetch_sum(FASTA_rec_t *farec, uint32_t index, void *arg)
+{
+	uint64_t *sum = arg;
+
+	(void)index;
+
+	if (farec != NULL)
+		*sum += farec->seq_len;
+
+	return (0);
+}
+
+static atrans_t *trans_new(void)
+{
+	atrans_t *tr = atrans_new(8, 8, 0, 0);
+
+	tr->tr_letter_s2d['A'] = tr->tr_letter_s2d['a'] = '1';
+	tr->tr_letter_s2d['T'] = tr->tr_letter_s2d['t'] = '2';
+	tr->tr_letter_s2d['C'] = tr->tr_letter_s2d['c'] = '3';
+	tr->tr_letter_s2d['G'] = tr->tr_letter_s2d['g'] = '4';
+
+	return (tr);
+}
+
+int main(int argc, char *argv[])
+{
+	FASTA       *fa;
+	FASTA_rec_t *farec;
+	atrans_t    *tr = NULL;
+	uint32_t     open_opts, read_opts, i, n;
+	uint64_t     bytes, records;
+	const char  *path, *phase;
+	char         mode[64];
+	struct stat  st;
+	bench_t      b;
+	int          a;
+
+	if (argc < 3) {
+		fprintf(stderr,
+			"Usage: %s <fasta-file> <open-scan|open-index|read-seq|read-rand|fetch-rand|apply> [trans] [cds] [keepopen]\n",
+			basename(argv[0]));
+		return (1);
+	}
+
+	path  = argv[1];
+	phase = argv[2];
+
+	open_opts = FASTA_READ|FASTA_ONDEMSEQ|FASTA_USEINDEX|FASTA_GENINDEX|FASTA_CHKINDEX;
+	read_opts = FASTA_INMEMSEQ;
+	mode[0]   = '\0';
+
+	for (a = 3; a < argc; ++a) {
+		if (strcmp(argv[a], "trans") == 0)
+			tr = trans_new();
+		else if (strcmp(argv[a], "cds") == 0) {
+			open_opts |= FASTA_NASEQ;
+			read_opts |= FASTA_MAPCDSEG;
+		} else if (strcmp(argv[a], "keepopen") == 0)
+			open_opts |= FASTA_KEEPOPEN;
+		else {
+			fprintf(stderr, "Unknown option: %s\n", argv[a]);
+			return (1);
+		}
+
+		if (mode[0] != '\0')
+			strncat(mode, ",", sizeof mode - strlen(mode) - 1);
+		strncat(mode, argv[a], sizeof mode - strlen(mode) - 1);
+	}
+
+	if (mode[0] == '\0')
+		strcpy(mode, "plain");
+
+	if (stat(path, &st) != 0) {
+		fprintf(stderr, "Can't stat %s\n", path);
+		return (1);
+	}
+
+	bytes   = st.st_size;
+	records = 0;
+
+	if (strcmp(phase, "open-scan") == 0) {
+		bench_start(&b);
+		fa = fasta_open(path, open_opts & ~(FASTA_USEINDEX|FASTA_GENINDEX|FASTA_CHKINDEX), tr);
+
+		if (fa == NULL)
+			goto fail;
+
+		bench_report(&b, phase, path, mode, bytes, fasta_count(fa));
+		fasta_close(fa);
+	} else if (strcmp(phase, "open-index") == 0) {
+		/*
+		 * Make sure the index exists
+		 */
+		if ((fa = fasta_open(path, open_opts, tr)) == NULL)
+			goto fail;
+
+		fasta_close(fa);
+
+		bench_start(&b);
+		fa = fasta_open(path, open_opts, tr);
+
+		if (fa == NULL)
+			goto fail;
+
+		bench_report(&b, phase, path, mode, bytes, fasta_count(fa));
+		fasta_close(fa);
+	} else if (strcmp(phase, "read-seq") == 0 || strcmp(phase, "read-rand") == 0) {
+		bool random_order = strcmp(phase, "read-rand") == 0;
+
+		if ((fa = fasta_open(path, open_opts, tr)) == NULL)
+			goto fail;
+
+		n     = fasta_count(fa);
+		bytes = 0;
+
+		srandom(BENCH_RANDOM_SEED);
+		bench_start(&b);
+
+		for (i = 0; i < n; ++i) {
+			if (random_order && fasta_seeko(fa, random() % n, SEEK_SET) != 0)
+				goto fail;
+
+			if ((farec = fasta_read(fa, NULL, read_opts, NULL)) == NULL)
+				goto fail;
+
+			bytes += farec->seq_len;
+			++records;
+
+			fasta_rec_free(farec);
+		}
+
+		bench_report(&b, phase, path, mode, bytes, records);
+		fasta_close(fa);
+	} else if (strcmp(phase, "fetch-rand") == 0) {
+		const char **ids;
+
+		if ((fa = fasta_open(path, open_opts, tr)) == NULL)
+			goto fail;
+
+		n     = fasta_count(fa);
+		bytes = 0;
+
+		/*
+		 * The same requests as in read-rand, by ID. Building the ID index
+		 * is a part of the measurement.
+		 */
+		if ((ids = malloc(sizeof(char *) * (n > 0 ? n : 1))) == NULL)
+			goto fail;
+
+		srandom(BENCH_RANDOM_SEED);
+
+		for (i = 0; i < n; ++i)
+			ids[i] = fa->fa_record[random() % n].rec_id;
+
+		bench_start(&b);
+
+		if (fasta_fetch_ids(fa, ids, n, read_opts & FASTA_MAPCDSEG, fetch_sum, &bytes) != 0)
+			goto fail;
+
+		bench_report(&b, phase, path, mode, bytes, n);
+
+		free(ids);
+		fasta_close(fa);
+	} else if (strcmp(phase, "apply") == 0) {
+		void *res;
+
+		if ((fa = fasta_open(path, open_opts, tr)) == NULL)
+			goto fail;
+
+		bytes = 0;
+
+		bench_start(&b);
+		res = fasta_apply(fa, apply_sum, 0, &bytes);
+		bench_report(&b, phase, path, mode, bytes, fasta_count(fa));
+
+		free(res);
+		fasta_close(fa);
+	} else {
+		fprintf(stderr, "Unknown phase: %s\n", phase);
+		return (1);
+	}
+
+	if (tr != NULL)
+		atrans_free(tr);
+
+	return (0);
+fail:
+	fprintf(stderr, "%s: %s failed\n", phase, path);
+	return (2);
+}
@@ -0,0 +1,423 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#define _DEFAULT_SOURCE
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "helpers.h"
+#include "fasta.h"
+#include "fasta_impl.h"
+
+/*
+ * Scheduler of the parallel fasta_apply() and fasta_mapreduce(). The cost of a record is
+ * estimated by its length. The large records, i.e. the ones costing more
+ * than 1/(APPLY_LARGE_SHARE * threads) of the total, are handed out first,
+ * from the largest one, using a shared counter. The rest is split into
+ * contiguous runs of records of about the same total cost, one per worker,
+ * which the workers take in the file order. A worker whose run is empty
+ * steals the upper half of the run of another worker.
+ */
+#define APPLY_LARGE_SHARE 4
+#define APPLY_REC_COST    64 /* per-record overhead, in letters */
+#define APPLY_CACHELINE   64
+
+typedef struct {
+	pthread_mutex_t lock;
+	uint32_t        head; /* [head, tail) of apply_t.order */
+	uint32_t        tail;
+} apply_run_t;
+
+typedef struct {
+	FASTA        *fa;
+	uint32_t      flags;  /* passed to __fasta_read_record() */
+	/* fasta_apply() */
+	void       * (*func)(FASTA_rec_t *, void *);
+	void         *funcarg;
+	void        **result;
+	/* fasta_mapreduce() */
+	int         (*map)(void *, FASTA_rec_t *, void *);
+	uint8_t      *acc;    /* accumulators of the workers, `stride' bytes apart */
+	size_t        stride;
+	/* the schedule */
+	uint32_t     *order;  /* the large records by cost, then the small ones by recno */
+	uint32_t      large;  /* number of the large records */
+	uint32_t      next;   /* next large record */
+	apply_run_t  *run;
+	uint32_t      threads;
+	int           error;
+} apply_t;
+
+typedef struct {
+	apply_t  *ap;
+	uint32_t  id;
+} apply_worker_t;
+
+typedef struct {
+	uint64_t cost;
+	uint32_t recno;
+} apply_ent_t;
+
+static inline uint64_t apply_cost(const FASTA_rec_t *rec)
+{
+	return (rec->seq_len + APPLY_REC_COST);
+}
+
+static int apply_entcmp(const void *a, const void *b)
+{
+	const apply_ent_t *x = a, *y = b;
+
+	if (x->cost != y->cost)
+		return (x->cost < y->cost) - (x->cost > y->cost);
+
+	return (x->recno > y->recno) - (x->recno < y->recno);
+}
+
+static bool apply_pop(apply_run_t *run, uint32_t *idx)
+{
+	bool r = false;
+
+	pthread_mutex_lock(&run->lock);
+
+	if (run->head < run->tail) {
+		*idx = run->head++;
+		r = true;
+	}
+
+	pthread_mutex_unlock(&run->lock);
+
+	return (r);
+}
+
+/*
+ * Move the upper half of the run of some other worker to the run of the
+ * worker `id'. Returns false if there's nothing left to steal.
+ */
+static bool apply_steal(apply_t *ap, uint32_t id)
+{
+	apply_run_t *victim;
+	uint32_t     i, n, head = 0, tail = 0;
+
+	for (i = 1; i < ap->threads && head == tail; ++i) {
+		victim = ap->run + (id + i) % ap->threads;
+
+		pthread_mutex_lock(&victim->lock);
+
+		if ((n = victim->tail - victim->head) > 0) {
+			tail = victim->tail;
+			head = tail - (n + 1) / 2;
+			victim->tail = head;
+		}
+
+		pthread_mutex_unlock(&victim->lock);
+	}
+
+	if (head == tail)
+		return (false);
+
+	pthread_mutex_lock(&ap->run[id].lock);
+	ap->run[id].head = head;
+	ap->run[id].tail = tail;
+	pthread_mutex_unlock(&ap->run[id].lock);
+
+	return (true);
+}
+
+static void *apply_worker(void *arg)
+{
+	apply_worker_t *w  = arg;
+	apply_t        *ap = w->ap;
+	FASTA          *fa = ap->fa;
+	FASTA_rec_t     rec, *farec;
+	FILE           *fp = NULL;
+	uint32_t        i, recno;
+
+	/*
+	 * Without FASTA_INMEMSEQ, only the record table is used
+	 */
+	if (ap->flags & FASTA_INMEMSEQ) {
+		if ((fp = fopen(fa->fa_path, "r")) == NULL) {
+			__atomic_store_n(&ap->error, -1, __ATOMIC_RELAXED);
+			return (NULL);
+		}
+
+		setbuf(fp, NULL);
+		flockfile(fp);
+	}
+
+	while (__atomic_load_n(&ap->error, __ATOMIC_RELAXED) == 0) {
+		if ((i = __atomic_fetch_add(&ap->next, 1, __ATOMIC_RELAXED)) < ap->large)
+			recno = ap->order[i];
+		else if (apply_pop(ap->run + w->id, &i) || (apply_steal(ap, w->id) && apply_pop(ap->run + w->id, &i)))
+			recno = ap->order[i];
+		else
+			break;
+
+		if (ap->map != NULL) {
+			farec = fp != NULL ? __fasta_read_record(fa, fp, recno, &rec, ap->flags, fa->fa_atr) : fa->fa_record + recno;
+		} else
+			farec = __fasta_read_record(fa, fp, recno, NULL, ap->flags, fa->fa_atr);
+
+		if (farec == NULL) {
+			dP("Failed to read record #%u\n", recno);
+			__atomic_store_n(&ap->error, -1, __ATOMIC_RELAXED);
+			break;
+		}
+
+		if (ap->map != NULL) {
+			if (ap->map(ap->acc + w->id * ap->stride, farec, ap->funcarg) != 0)
+				__atomic_store_n(&ap->error, -1, __ATOMIC_RELAXED);
+			if (farec == &rec)
+				fasta_rec_free(farec);
+		} else {
+			ap->result[recno] = ap->func(farec, ap->funcarg);
+			fasta_rec_free(farec);
+		}
+	}
+
+	if (fp != NULL) {
+		funlockfile(fp);
+		fclose(fp);
+	}
+
+	return (NULL);
+}
+
+/*
+ * Sort the large records by cost and split the small ones into the runs
+ * of the workers.
+ */
+static int apply_plan(apply_t *ap)
+{
+	FASTA       *fa = ap->fa;
+	apply_ent_t *ent;
+	uint64_t     total = 0, small = 0, limit, sum;
+	uint32_t     i, n, t;
+
+	for (i = 0; i < fa->fa_rcount; ++i)
+		total += apply_cost(fa->fa_record + i);
+
+	/* a single worker takes the records in the file order */
+	limit = ap->threads > 1 ? total / ((uint64_t)APPLY_LARGE_SHARE * ap->threads) : UINT64_MAX;
+
+	for (i = 0, n = 0; i < fa->fa_rcount; ++i)
+		if (apply_cost(fa->fa_record + i) > limit)
+			++n;
+
+	if ((ent = alloc_array(apply_ent_t, n > 0 ? n : 1)) == NULL)
+		return (-1);
+
+	for (i = 0, n = 0; i < fa->fa_rcount; ++i) {
+		uint64_t cost = apply_cost(fa->fa_record + i);
+
+		if (cost > limit) {
+			ent[n].cost  = cost;
+			ent[n].recno = i;
+			++n;
+		} else
+			small += cost;
+	}
+
+	qsort(ent, n, sizeof(apply_ent_t), apply_entcmp);
+
+	for (i = 0; i < n; ++i)
+		ap->order[i] = ent[i].recno;
+
+	free(ent);
+
+	ap->large = n;
+	ap->next  = 0;
+
+	ap->run[0].head = n;
+	ap->run[0].tail = n;
+
+	/*
+	 * Worker `t' gets the small records up to (t + 1)/threads of their
+	 * total cost
+	 */
+	for (i = 0, t = 0, sum = 0; i < fa->fa_rcount; ++i) {
+		uint64_t cost = apply_cost(fa->fa_record + i);
+
+		if (cost > limit)
+			continue;
+
+		while (t + 1 < ap->threads && sum >= small / ap->threads * (t + 1)) {
+			ap->run[++t].head = n;
+			ap->run[t].tail   = n;
+		}
+
+		ap->order[n++] = i;
+		ap->run[t].tail = n;
+		sum += cost;
+	}
+
+	while (t + 1 < ap->threads) {
+		ap->run[++t].head = n;
+		ap->run[t].tail   = n;
+	}
+
+	return (0);
+}
+
+/*
+ * Run the workers. With a single worker, it runs in the calling thread.
+ */
+static int apply_run(apply_t *ap)
+{
+	apply_worker_t *worker;
+	uint32_t        i;
+	int             r = 0;
+
+	ap->error = 0;
+	ap->order = alloc_array(uint32_t, ap->fa->fa_rcount);
+	ap->run   = alloc_array(apply_run_t, ap->threads);
+	worker    = alloc_array(apply_worker_t, ap->threads);
+
+	if (ap->order == NULL || ap->run == NULL || worker == NULL) {
+		r = -1;
+		goto finish;
+	}
+
+	if (apply_plan(ap) != 0) {
+		r = -1;
+		goto finish;
+	}
+
+	for (i = 0; i < ap->threads; ++i) {
+		pthread_mutex_init(&ap->run[i].lock, NULL);
+		worker[i].ap = ap;
+		worker[i].id = i;
+	}
+
+	if (ap->threads == 1)
+		apply_worker(worker);
+	else if (thread_pool_run(apply_worker, worker, sizeof(apply_worker_t), ap->threads) == 0)
+		r = -1;
+
+	for (i = 0; i < ap->threads; ++i)
+		pthread_mutex_destroy(&ap->run[i].lock);
+
+	if (ap->error != 0)
+		r = -1;
+finish:
+	free(ap->order);
+	free(ap->run);
+	free(worker);
+
+	return (r);
+}
+
+static uint32_t apply_threads(FASTA *fa, uint32_t options)
+{
+	uint32_t threads = (options & FASTA_PARALLEL) ? cpu_count() : 1;
+
+	if (threads > fa->fa_rcount)
+		threads = fa->fa_rcount;
+
+	return (threads > 0 ? threads : 1);
+}
+
+int __fasta_apply_parallel(FASTA *fa, void * (*func)(FASTA_rec_t *, void *), void *funcarg, void **result)
+{
+	apply_t ap;
+
+	assert(fa != NULL);
+	assert(func != NULL);
+
+	memset(&ap, 0, sizeof ap);
+
+	ap.fa      = fa;
+	ap.flags   = FASTA_INMEMSEQ|FASTA_CSTRSEQ;
+	ap.func    = func;
+	ap.funcarg = funcarg;
+	ap.result  = result;
+	ap.threads = apply_threads(fa, FASTA_PARALLEL);
+
+	return (apply_run(&ap));
+}
+
+int fasta_mapreduce(FASTA *fa, void *acc, size_t size,
+		    void (*init)(void *),
+		    int (*map)(void *, FASTA_rec_t *, void *),
+		    void (*combine)(void *, const void *),
+		    uint32_t options, void *funcarg)
+{
+	apply_t  ap;
+	uint32_t i;
+	int      r;
+
+	assert(fa != NULL);
+	assert(acc != NULL);
+	assert(init != NULL);
+	assert(map != NULL);
+	assert(combine != NULL);
+
+	init(acc);
+
+	if (fa->fa_rcount == 0)
+		return (0);
+
+	memset(&ap, 0, sizeof ap);
+
+	ap.fa      = fa;
+	ap.flags   = options & (FASTA_INMEMSEQ|FASTA_CSTRSEQ);
+	ap.map     = map;
+	ap.funcarg = funcarg;
+	ap.threads = apply_threads(fa, options);
+
+	/*
+	 * Each worker folds into its own accumulator, aligned to a cache line
+	 * so that the workers don't share any
+	 */
+	ap.stride = (size + APPLY_CACHELINE - 1) / APPLY_CACHELINE * APPLY_CACHELINE;
+
+	if (ap.stride == 0)
+		ap.stride = APPLY_CACHELINE;
+
+	if (posix_memalign((void **)&ap.acc, APPLY_CACHELINE, ap.stride * ap.threads) != 0)
+		return (-1);
+
+	for (i = 0; i < ap.threads; ++i)
+		init(ap.acc + i * ap.stride);
+
+	r = apply_run(&ap);
+
+	if (r == 0)
+		for (i = 0; i < ap.threads; ++i)
+			combine(acc, ap.acc + i * ap.stride);
+
+	free(ap.acc);
+
+	return (r);
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#include <config.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include "helpers.h"
+#include "arena.h"
+
+void arena_init(arena_t *a, size_t chunk_size)
+{
+	a->head  = NULL;
+	a->chunk = chunk_size > 0 ? chunk_size : ARENA_CHUNK_SIZE;
+	a->last  = 0;
+	a->nchunks = 0;
+}
+
+static arena_chunk_t *arena_chunk_new(arena_t *a, size_t size)
+{
+	arena_chunk_t *c;
+
+	if (size < a->chunk)
+		size = a->chunk;
+
+	c = malloc(sizeof(arena_chunk_t) + size);
+
+	if (c == NULL)
+		return (NULL);
+
+	c->next = a->head;
+	c->size = size;
+	c->used = 0;
+
+	a->head = c;
+	++a->nchunks;
+
+	return (c);
+}
+
+/*
+ * Return the first offset >= `off' in the chunk data area that is
+ * aligned to `align' bytes.
+ */
+static size_t arena_align(arena_chunk_t *c, size_t off, size_t align)
+{
+	uintptr_t p = (uintptr_t)(c->data + off);
+
+	return (off + ((align - (p & (align - 1))) & (align - 1)));
+}
+
+void *arena_alloc(arena_t *a, size_t size, size_t align)
+{
+	arena_chunk_t *c = a->head;
+	size_t off;
+
+	assert(align > 0 && (align & (align - 1)) == 0);
+
+	if (c != NULL) {
+		off = arena_align(c, c->used, align);
+
+		if (off + size <= c->size)
+			goto done;
+	}
+
+	if ((c = arena_chunk_new(a, size + align)) == NULL)
+		return (NULL);
+
+	off = arena_align(c, 0, align);
+done:
+	c->used = off + size;
+	a->last = off;
+
+	return (c->data + off);
+}
+
+void *arena_grow(arena_t *a, void *ptr, size_t oldsize, size_t newsize)
+{
+	arena_chunk_t *c = a->head;
+	void *nptr;
+
+	if (ptr == NULL)
+		return (arena_alloc(a, newsize, 1));
+
+	if (c != NULL && (uint8_t *)ptr == c->data + a->last && a->last + newsize <= c->size) {
+		c->used = a->last + newsize;
+		return (ptr);
+	}
+
+	if ((nptr = arena_alloc(a, newsize, 1)) == NULL)
+		return (NULL);
+
+	memcpy(nptr, ptr, oldsize < newsize ? oldsize : newsize);
+
+	return (nptr);
+}
+
+void arena_free(arena_t *a)
+{
+	arena_chunk_t *c, *n;
+
+	for (c = a->head; c != NULL; c = n) {
+		n = c->next;
+		free(c);
+	}
+
+	a->head = NULL;
+	a->last = 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A simple chunked arena allocator. Allocations can't be freed one by one,
+ * all the memory is released at once by arena_free() in O(chunks).
+ */
+#define ARENA_CHUNK_SIZE (1024 * 1024)
+
+typedef struct arena_chunk {
+        struct arena_chunk *next;
+        size_t   size; /* size of the data area */
+        size_t   used; /* used bytes of the data area */
+        uint8_t  data[];
+} arena_chunk_t;
+
+typedef struct fasta_arena {
+        arena_chunk_t *head;  /* current chunk, the other ones are linked using `next' */
+        size_t         chunk; /* default chunk size */
+        size_t         last;  /* offset of the last allocation in the head chunk */
+        uint64_t       nchunks; /* number of allocated chunks */
+} arena_t;
+
+/**
+ * Initialize an empty arena.
+ */
+void arena_init(arena_t *a, size_t chunk_size);
+
+/**
+ * Allocate `size' bytes aligned to `align' (a power of 2) bytes.
+ */
+void *arena_alloc(arena_t *a, size_t size, size_t align);
+
+/**
+ * Resize the block `ptr' of `oldsize' bytes to `newsize' bytes. The block
+ * is extended in place if it's the last allocation and there's enough
+ * space left in the chunk, otherwise a new block is allocated and the
+ * content is copied. The old block isn't reclaimed until arena_free().
+ */
+void *arena_grow(arena_t *a, void *ptr, size_t oldsize, size_t newsize);
+
+/**
+ * Release all the memory held by the arena.
+ */
+void arena_free(arena_t *a);
+
+#endif /* ARENA_H */
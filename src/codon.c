@@ -0,0 +1,323 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "helpers.h"
+#include "fasta.h"
+#include "codon.h"
+
+#define CODON_OTHER 4 /* code of a letter other than A, C, G, T and U */
+
+/*
+ * NCBI genetic codes, the codons are ordered by their letters as TCAG
+ */
+static const struct {
+	uint32_t    code;
+	const char *aas;
+	const char *starts;
+} __codon_ncbi[] = {
+	{  1, "FFLLSSSSYY**CC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG",
+	      "---M---------------M---------------M----------------------------" },
+	{  2, "FFLLSSSSYY**CCWWLLLLPPPPHHQQRRRRIIMMTTTTNNKKSS**VVVVAAAADDEEGGGG",
+	      "--------------------------------MMMM---------------M------------" },
+	{  3, "FFLLSSSSYY**CCWWTTTTPPPPHHQQRRRRIIMMTTTTNNKKSSRRVVVVAAAADDEEGGGG",
+	      "----------------------------------MM---------------M------------" },
+	{  4, "FFLLSSSSYY**CCWWLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG",
+	      "--MM---------------M------------MMMM---------------M------------" },
+	{  5, "FFLLSSSSYY**CCWWLLLLPPPPHHQQRRRRIIMMTTTTNNKKSSSSVVVVAAAADDEEGGGG",
+	      "---M----------------------------MMMM---------------M------------" },
+	{  6, "FFLLSSSSYYQQCC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG",
+	      "-----------------------------------M----------------------------" },
+	{  9, "FFLLSSSSYY**CCWWLLLLPPPPHHQQRRRRIIIMTTTTNNNKSSSSVVVVAAAADDEEGGGG",
+	      "-----------------------------------M---------------M------------" },
+	{ 10, "FFLLSSSSYY**CCCWLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG",
+	      "-----------------------------------M----------------------------" },
+	{ 11, "FFLLSSSSYY**CC*WLLLLPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG",
+	      "---M---------------M------------MMMM---------------M------------" },
+	{ 12, "FFLLSSSSYY**CC*WLLLSPPPPHHQQRRRRIIIMTTTTNNKKSSRRVVVVAAAADDEEGGGG",
+	      "-------------------M---------------M----------------------------" },
+	{ 13, "FFLLSSSSYY**CCWWLLLLPPPPHHQQRRRRIIMMTTTTNNKKSSGGVVVVAAAADDEEGGGG",
+	      "---M------------------------------MM---------------M------------" },
+	{ 14, "FFLLSSSSYYY*CCWWLLLLPPPPHHQQRRRRIIIMTTTTNNNKSSSSVVVVAAAADDEEGGGG",
+	      "-----------------------------------M----------------------------" },
+};
+
+static void __codon_init_nt(FASTA_codon_t *ct)
+{
+	memset(ct->nt, CODON_OTHER, sizeof ct->nt);
+
+	ct->nt['T'] = ct->nt['t'] = 0;
+	ct->nt['U'] = ct->nt['u'] = 0;
+	ct->nt['C'] = ct->nt['c'] = 1;
+	ct->nt['A'] = ct->nt['a'] = 2;
+	ct->nt['G'] = ct->nt['g'] = 3;
+}
+
+/*
+ * Resolve the amino acid of the codon c1c2c3 by trying all the nucleotides
+ * in place of the other letters. Sets `*start' if all of the codons are
+ * start codons.
+ */
+static uint8_t __codon_resolve(const char *aas, const char *starts, uint32_t c1, uint32_t c2, uint32_t c3, uint8_t *start)
+{
+	uint32_t n1, n2, n3;
+	uint8_t aa = 0, st = 1;
+
+	for (n1 = 0; n1 < 4; ++n1) {
+		if (c1 != CODON_OTHER && n1 != c1)
+			continue;
+		for (n2 = 0; n2 < 4; ++n2) {
+			if (c2 != CODON_OTHER && n2 != c2)
+				continue;
+			for (n3 = 0; n3 < 4; ++n3) {
+				uint32_t i = n1 * 16 + n2 * 4 + n3;
+
+				if (c3 != CODON_OTHER && n3 != c3)
+					continue;
+				if (aa != 0 && aa != (uint8_t)aas[i])
+					aa = FASTA_CODON_UNKNOWN;
+				else if (aa == 0)
+					aa = (uint8_t)aas[i];
+				if (starts == NULL || starts[i] != 'M')
+					st = 0;
+			}
+		}
+	}
+
+	*start = st;
+	return (aa);
+}
+
+/*
+ * The complement of a code, T <-> A and C <-> G
+ */
+#define CODON_COMP(c) ((c) == CODON_OTHER ? CODON_OTHER : (c) ^ 2)
+
+FASTA_codon_t *fasta_codon_custom(const char *aas, const char *starts)
+{
+	FASTA_codon_t *ct;
+	uint32_t c1, c2, c3;
+
+	if (aas == NULL || strlen(aas) != 64 || (starts != NULL && strlen(starts) != 64)) {
+		errno = EINVAL;
+		return (NULL);
+	}
+
+	ct = alloc_type(FASTA_codon_t);
+	ct->code = 0;
+
+	__codon_init_nt(ct);
+
+	for (c1 = 0; c1 < 5; ++c1)
+		for (c2 = 0; c2 < 5; ++c2)
+			for (c3 = 0; c3 < 5; ++c3) {
+				uint32_t i = c1 * 25 + c2 * 5 + c3;
+
+				ct->aa[i]    = __codon_resolve(aas, starts, c1, c2, c3, ct->start + i);
+				ct->aa_rc[i] = __codon_resolve(aas, starts, CODON_COMP(c3), CODON_COMP(c2), CODON_COMP(c1),
+							       ct->start_rc + i);
+			}
+
+	return (ct);
+}
+
+FASTA_codon_t *fasta_codon_new(uint32_t code)
+{
+	FASTA_codon_t *ct;
+	size_t i;
+
+	for (i = 0; i < sizeof __codon_ncbi / sizeof __codon_ncbi[0]; ++i) {
+		if (__codon_ncbi[i].code == code) {
+			if ((ct = fasta_codon_custom(__codon_ncbi[i].aas, __codon_ncbi[i].starts)) != NULL)
+				ct->code = code;
+			return (ct);
+		}
+	}
+
+	errno = ENOENT;
+	return (NULL);
+}
+
+void fasta_codon_free(FASTA_codon_t *ct)
+{
+	free(ct);
+}
+
+static inline size_t __frame_len(size_t len, uint32_t frame)
+{
+	uint32_t skip = frame % 3;
+	return (len > skip ? (len - skip) / 3 : 0);
+}
+
+/*
+ * Translate `n' codons, the kernels are unrolled by 4 codons so that the
+ * independent lookups of neighbouring codons can overlap.
+ */
+static size_t __translate_fwd(const FASTA_codon_t *ct, const uint8_t *seq, size_t n, uint8_t *dst)
+{
+	const uint8_t *nt = ct->nt, *aa = ct->aa;
+	size_t k;
+
+	for (k = 0; k + 4 <= n; k += 4, seq += 12) {
+		dst[k]     = aa[nt[seq[0]] * 25 + nt[seq[1]]  * 5 + nt[seq[2]]];
+		dst[k + 1] = aa[nt[seq[3]] * 25 + nt[seq[4]]  * 5 + nt[seq[5]]];
+		dst[k + 2] = aa[nt[seq[6]] * 25 + nt[seq[7]]  * 5 + nt[seq[8]]];
+		dst[k + 3] = aa[nt[seq[9]] * 25 + nt[seq[10]] * 5 + nt[seq[11]]];
+	}
+
+	for (; k < n; ++k, seq += 3)
+		dst[k] = aa[nt[seq[0]] * 25 + nt[seq[1]] * 5 + nt[seq[2]]];
+
+	return (n);
+}
+
+/*
+ * Translate `n' codons of the reverse complement of the sequence ending
+ * just before `end'.
+ */
+static size_t __translate_rev(const FASTA_codon_t *ct, const uint8_t *end, size_t n, uint8_t *dst)
+{
+	const uint8_t *nt = ct->nt, *aa = ct->aa_rc;
+	const uint8_t *seq = end - 3;
+	size_t k;
+
+	for (k = 0; k + 4 <= n; k += 4, seq -= 12) {
+		dst[k]     = aa[nt[seq[0]]  * 25 + nt[seq[1]]  * 5 + nt[seq[2]]];
+		dst[k + 1] = aa[nt[seq[-3]] * 25 + nt[seq[-2]] * 5 + nt[seq[-1]]];
+		dst[k + 2] = aa[nt[seq[-6]] * 25 + nt[seq[-5]] * 5 + nt[seq[-4]]];
+		dst[k + 3] = aa[nt[seq[-9]] * 25 + nt[seq[-8]] * 5 + nt[seq[-7]]];
+	}
+
+	for (; k < n; ++k, seq -= 3)
+		dst[k] = aa[nt[seq[0]] * 25 + nt[seq[1]] * 5 + nt[seq[2]]];
+
+	return (n);
+}
+
+size_t fasta_translate(const FASTA_codon_t *ct, const uint8_t *seq, size_t len, uint32_t frame, uint8_t *dst)
+{
+	size_t n;
+
+	assert(ct != NULL);
+
+	if (frame >= FASTA_FRAMES) {
+		errno = EINVAL;
+		return ((size_t)-1);
+	}
+
+	if ((n = __frame_len(len, frame)) == 0)
+		return (0);
+
+	if (frame < 3)
+		return __translate_fwd(ct, seq + frame, n, dst);
+	else
+		return __translate_rev(ct, seq + len - (frame - 3), n, dst);
+}
+
+size_t fasta_translate_rec(const FASTA_codon_t *ct, const FASTA_rec_t *farec, uint32_t frame, uint8_t *dst)
+{
+	if (farec->seq_mem == NULL) {
+		errno = ENOENT;
+		return ((size_t)-1);
+	}
+
+	return fasta_translate(ct, farec->seq_mem, farec->seq_len, frame, dst);
+}
+
+size_t fasta_translate_CDS(const FASTA_codon_t *ct, const FASTA_CDS_t *cds, uint32_t frame, uint8_t *dst)
+{
+	return fasta_translate(ct, cds->seg_mem, cds->seg_len, frame, dst);
+}
+
+int fasta_translate6(const FASTA_codon_t *ct, const uint8_t *seq, size_t len,
+		     uint8_t *dst[FASTA_FRAMES], size_t count[FASTA_FRAMES])
+{
+	const uint8_t *nt = ct->nt, *aa = ct->aa, *aa_rc = ct->aa_rc;
+	uint8_t *fwd0, *fwd1, *fwd2;
+	uint32_t f, r, c1, c2, c3;
+	size_t i, q, k;
+
+	for (f = 0; f < FASTA_FRAMES; ++f)
+		count[f] = __frame_len(len, f);
+
+	if (len < 3)
+		return (0);
+
+	/*
+	 * The codon starting at `i' is the q-th codon of the forward frame
+	 * i % 3 and the k-th codon of the reverse frame r, where the reverse
+	 * frames count from the end of the sequence.
+	 */
+	fwd0 = dst[0];
+	fwd1 = dst[1];
+	fwd2 = dst[2];
+	r  = (uint32_t)((len - 3) % 3);
+	k  = (len - 3) / 3;
+	c2 = nt[seq[0]];
+	c3 = nt[seq[1]];
+
+	for (i = 0, q = 0; i + 5 <= len; i += 3, ++q) {
+		uint32_t x0, x1, x2;
+
+		c1 = c2; c2 = c3; c3 = nt[seq[i + 2]];
+		x0 = c1 * 25 + c2 * 5 + c3;
+		c1 = c2; c2 = c3; c3 = nt[seq[i + 3]];
+		x1 = c1 * 25 + c2 * 5 + c3;
+		c1 = c2; c2 = c3; c3 = nt[seq[i + 4]];
+		x2 = c1 * 25 + c2 * 5 + c3;
+
+		fwd0[q] = aa[x0];
+		fwd1[q] = aa[x1];
+		fwd2[q] = aa[x2];
+
+		/*
+		 * The three codons belong to the reverse frames r, r - 1 and
+		 * r - 2 (mod 3), the codon index decreases on the wrap
+		 */
+		dst[3 + r][k] = aa_rc[x0];
+		if (r == 0) { r = 2; --k; } else --r;
+		dst[3 + r][k] = aa_rc[x1];
+		if (r == 0) { r = 2; --k; } else --r;
+		dst[3 + r][k] = aa_rc[x2];
+		if (r == 0) { r = 2; --k; } else --r;
+	}
+
+	for (f = 0; i + 2 < len; ++i, ++f) {
+		c1 = c2; c2 = c3; c3 = nt[seq[i + 2]];
+
+		dst[f][q] = aa[c1 * 25 + c2 * 5 + c3];
+		dst[3 + r][k] = aa_rc[c1 * 25 + c2 * 5 + c3];
+		if (r == 0) { r = 2; --k; } else --r;
+	}
+
+	return (0);
+}
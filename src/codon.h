@@ -0,0 +1,169 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#ifndef CODON_H
+#define CODON_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "fasta.h"
+
+#define FASTA_FRAMES       6  /**< reading frames: 0-2 on the forward strand, 3-5 on the reverse one */
+#define FASTA_CODON_SPACE  125 /**< codon indexes: 3 letters out of A, C, G, T/U and "other" */
+#define FASTA_CODON_UNKNOWN 'X' /**< amino acid of a codon that can't be resolved */
+
+/**
+ * Maximal number of amino acids translated from `len' nucleotides
+ */
+#define FASTA_TRANSLATE_SIZE(len) ((len) / 3)
+
+        /**
+         * Codon translation table. The codons are indexed by the codes
+         * of their letters (T/U = 0, C = 1, A = 2, G = 3, other = 4) as
+         * c1 * 25 + c2 * 5 + c3. Codons containing other letters translate
+         * to an amino acid only if all the possible nucleotides at those
+         * positions give the same one (e.g. GCN -> A), otherwise to
+         * FASTA_CODON_UNKNOWN. The table is read-only after it's created.
+         */
+        typedef struct {
+                uint32_t code;                       /**< NCBI genetic code number, 0 for a custom table */
+                uint8_t  nt[256];                    /**< letter -> code */
+                uint8_t  aa[FASTA_CODON_SPACE];      /**< codon -> amino acid */
+                uint8_t  aa_rc[FASTA_CODON_SPACE];   /**< codon -> amino acid of its reverse complement */
+                uint8_t  start[FASTA_CODON_SPACE];   /**< 1 if the codon is a start codon */
+                uint8_t  start_rc[FASTA_CODON_SPACE]; /**< 1 if the reverse complement is a start codon */
+        } FASTA_codon_t;
+
+        /**
+         * Create a translation table for the NCBI genetic code `code' (1-6,
+         * 9-14). Returns NULL and sets errno to ENOENT if the code isn't
+         * known.
+         */
+        FASTA_codon_t *fasta_codon_new(uint32_t code);
+
+        /**
+         * Create a translation table from the amino acids and start codons
+         * of the 64 codons given in the NCBI order (TTT, TTC, TTA, TTG,
+         * TCT, ..., GGG). A start codon is marked by 'M' in `starts', which
+         * may be NULL.
+         */
+        FASTA_codon_t *fasta_codon_custom(const char *aas, const char *starts);
+
+        /**
+         * Free a translation table.
+         */
+        void fasta_codon_free(FASTA_codon_t *ct);
+
+        /**
+         * Index of the codon starting at `seq'.
+         */
+        static inline uint32_t fasta_codon_index(const FASTA_codon_t *ct, const uint8_t *seq)
+        {
+                return (ct->nt[seq[0]] * 25 + ct->nt[seq[1]] * 5 + ct->nt[seq[2]]);
+        }
+
+        /**
+         * Translate the reading frame `frame' (0 - FASTA_FRAMES-1) of the
+         * `len' nucleotides at `seq' into `dst', which has to have space
+         * for FASTA_TRANSLATE_SIZE(len) amino acids. The reverse frames 3,
+         * 4 and 5 translate the reverse complement, skipping 0, 1 and 2
+         * nucleotides at the end of `seq'. Returns the number of amino
+         * acids written, or (size_t)-1 and sets errno to EINVAL if the
+         * frame is out of range.
+         */
+        size_t fasta_translate(const FASTA_codon_t *ct, const uint8_t *seq, size_t len, uint32_t frame, uint8_t *dst);
+
+        /**
+         * Translate the reading frame `frame' of a record read into memory.
+         * Returns (size_t)-1 and sets errno to ENOENT if the sequence isn't
+         * in memory.
+         */
+        size_t fasta_translate_rec(const FASTA_codon_t *ct, const FASTA_rec_t *farec, uint32_t frame, uint8_t *dst);
+
+        /**
+         * Translate the reading frame `frame' of a coding segment returned
+         * by fasta_read_CDS().
+         */
+        size_t fasta_translate_CDS(const FASTA_codon_t *ct, const FASTA_CDS_t *cds, uint32_t frame, uint8_t *dst);
+
+        /**
+         * Translate all six reading frames in a single pass over the
+         * sequence. `dst[f]' has to have space for FASTA_TRANSLATE_SIZE(len)
+         * amino acids, the number of amino acids written is stored into
+         * `count[f]'.
+         */
+        int fasta_translate6(const FASTA_codon_t *ct, const uint8_t *seq, size_t len,
+                             uint8_t *dst[FASTA_FRAMES], size_t count[FASTA_FRAMES]);
+
+#define FASTA_ORF_NOSTART 0x00000001 /**< An ORF starts right after the previous stop codon, not at a start codon */
+#define FASTA_ORF_PARTIAL 0x00000002 /**< Report the ORFs cut by the ends of the sequence */
+
+        /**
+         * Open reading frames of each frame. An ORF is given by the
+         * positions [a, b] of its first and last nucleotide on the forward
+         * strand, including the stop codon, i.e. the ORFs of the reverse
+         * frames are read from b to a. The ORFs are sorted by `a'.
+         */
+        typedef struct {
+                FASTA_u64p *orf[FASTA_FRAMES];   /**< ORFs of each frame, NULL if there are none */
+                size_t      count[FASTA_FRAMES]; /**< number of ORFs of each frame */
+        } FASTA_orfs_t;
+
+        /**
+         * Find the ORFs of at least `minlen' nucleotides in all six frames
+         * of the `len' nucleotides at `seq' (e.g. a record or a coding
+         * segment returned by fasta_read_CDS()). An ORF runs from a start
+         * codon to the first following stop codon. Long sequences are
+         * split into chunks scanned by up to `threads' workers (0 means
+         * one worker per online processor). The result has to be freed
+         * using fasta_orfs_free().
+         */
+        int fasta_map_orfs(const FASTA_codon_t *ct, const uint8_t *seq, uint64_t len,
+                           uint64_t minlen, uint32_t options, uint32_t threads, FASTA_orfs_t *dst);
+
+        /**
+         * Find the ORFs of all the records of the db `fa' using up to
+         * `threads' workers. Returns an array of fasta_count(fa) results,
+         * each of which has to be freed using fasta_orfs_free() before the
+         * array is freed.
+         */
+        FASTA_orfs_t *fasta_find_orfs(FASTA *fa, const FASTA_codon_t *ct, uint64_t minlen, uint32_t options, uint32_t threads);
+
+        /**
+         * Free the ORFs stored in `orfs' (but not `orfs' itself).
+         */
+        void fasta_orfs_free(FASTA_orfs_t *orfs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CODON_H */
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#define _DEFAULT_SOURCE
+#include <config.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "helpers.h"
+#include "fasta.h"
+#include "fasta_impl.h"
+
+#define EXPORT_BUFFER_SIZE FASTA_SCANBUFFER_SIZE
+
+#define issequence(ch) (__SQ_mask[(ch) / 32] & (UINT32_C(1) << ((ch) % 32)))
+
+typedef struct {
+	int      fd;
+	uint8_t *in;    /* input buffer */
+	uint8_t *out;
+	size_t   len;   /* bytes in the output buffer */
+	uint32_t width; /* 0 - no wrapping */
+	uint32_t col;   /* letters on the current output line, non-zero if any when not wrapping */
+} export_t;
+
+static int export_write(int fd, const uint8_t *buf, size_t len)
+{
+	ssize_t w;
+
+	while (len > 0) {
+		w = write(fd, buf, len);
+
+		if (w < 0) {
+			if (errno == EINTR)
+				continue;
+			return (-1);
+		}
+
+		buf += w;
+		len -= (size_t)w;
+	}
+
+	return (0);
+}
+
+static int export_flush(export_t *ex)
+{
+	if (ex->len > 0 && export_write(ex->fd, ex->out, ex->len) != 0)
+		return (-1);
+
+	ex->len = 0;
+
+	return (0);
+}
+
+/*
+ * Append the `len' letters at `src' to the output, breaking the lines
+ * every ex->width letters.
+ */
+static int export_put(export_t *ex, const uint8_t *src, size_t len)
+{
+	size_t n;
+
+	while (len > 0) {
+		if (EXPORT_BUFFER_SIZE - ex->len < 2 && export_flush(ex) != 0)
+			return (-1);
+
+		n = EXPORT_BUFFER_SIZE - ex->len - 1;
+
+		if (n > len)
+			n = len;
+		if (ex->width > 0 && n > ex->width - ex->col)
+			n = ex->width - ex->col;
+
+		memcpy(ex->out + ex->len, src, n);
+
+		ex->len += n;
+		src     += n;
+		len     -= n;
+
+		if (ex->width == 0)
+			ex->col = 1; /* only a line in progress matters */
+		else if ((ex->col += (uint32_t)n) == ex->width) {
+			ex->out[ex->len++] = '\n';
+			ex->col = 0;
+		}
+	}
+
+	return (0);
+}
+
+static int export_newline(export_t *ex)
+{
+	if (EXPORT_BUFFER_SIZE - ex->len < 1 && export_flush(ex) != 0)
+		return (-1);
+
+	ex->out[ex->len++] = '\n';
+	ex->col = 0;
+
+	return (0);
+}
+
+/*
+ * Read the raw sequence data and write out the `seq_len' letters. The
+ * new-lines of the source are copied if `keep' is set.
+ */
+static int export_stream(const FASTA_rec_t *rec, int in_fd, export_t *ex, bool keep)
+{
+	uint8_t *in = ex->in;
+	uint64_t off  = rec->seq_start;
+	uint64_t left = rec->seq_len;
+	ssize_t  r;
+	size_t   i, run;
+
+	while (left > 0) {
+		do {
+			r = pread(in_fd, in, EXPORT_BUFFER_SIZE, (off_t)off);
+		} while (r < 0 && errno == EINTR);
+
+		if (r <= 0) {
+			if (r == 0)
+				errno = EIO;
+			return (-1);
+		}
+
+		off += (uint64_t)r;
+
+		for (i = 0; i < (size_t)r && left > 0; ) {
+			for (run = 0; i + run < (size_t)r && run < left && issequence(in[i + run]); ++run);
+
+			if (run > 0) {
+				if (export_put(ex, in + i, run) != 0)
+					return (-1);
+				i    += run;
+				left -= run;
+			} else {
+				if (keep && in[i] == '\n' && ex->col > 0 && export_newline(ex) != 0)
+					return (-1);
+				++i;
+			}
+		}
+	}
+
+	return (0);
+}
+
+int fasta_export_fd(FASTA *fa, uint32_t recno, int fd, uint32_t flags, uint32_t width)
+{
+	const FASTA_rec_t *rec;
+	export_t ex;
+	uint64_t lastw, span;
+	bool regular, newline;
+	int in_fd, r = -1;
+
+	assert(fa != NULL);
+
+	if (recno >= fa->fa_rcount) {
+		errno = ERANGE;
+		return (-1);
+	}
+
+	rec = fa->fa_record + recno;
+
+	/*
+	 * The data are read using pread, so the stream of the db may be
+	 * used if it's open
+	 */
+	if (fa->fa_seqFP != NULL)
+		in_fd = fileno(fa->fa_seqFP);
+	else if ((in_fd = open(fa->fa_path, O_RDONLY)) < 0)
+		return (-1);
+
+	/*
+	 * The header line including its new-line
+	 */
+	if (flags & FASTA_EXPORT_HEADER) {
+		if (export_write(fd, (const uint8_t *)">", 1) != 0 ||
+		    file_copy_range(in_fd, rec->hdr_start, rec->hdr_len, fd) != 0)
+			goto finish;
+	}
+
+	/*
+	 * All the lines but the last one are of the same width, so the
+	 * position of each letter in the file is known
+	 */
+	lastw   = rec->seq_lastw > 0 ? rec->seq_lastw : rec->seq_linew;
+	regular = rec->seq_linew > 0 && rec->seq_lines > 0 &&
+		(uint64_t)(rec->seq_lines - 1) * rec->seq_linew + lastw == rec->seq_len;
+
+	if (flags & FASTA_EXPORT_KEEPWRAP)
+		width = regular ? rec->seq_linew : 0;
+
+	newline = rec->seq_len > 0 && (width > 0 || (flags & (FASTA_EXPORT_HEADER|FASTA_EXPORT_KEEPWRAP)));
+
+	if (regular && (width == rec->seq_linew || (rec->seq_lines == 1 && (width == 0 || width >= rec->seq_len)))) {
+		/*
+		 * The lines of the file are the requested ones, let the kernel
+		 * copy them
+		 */
+		span = (uint64_t)(rec->seq_lines - 1) * (rec->seq_linew + 1) + lastw;
+
+		if (file_copy_range(in_fd, rec->seq_start, span, fd) == 0)
+			r = newline ? export_write(fd, (const uint8_t *)"\n", 1) : 0;
+
+		goto finish;
+	}
+
+	/*
+	 * The buffers are allocated by each call, the records of a db may be
+	 * exported by several threads at once
+	 */
+	if ((ex.in = alloc_array(uint8_t, 2 * EXPORT_BUFFER_SIZE)) == NULL)
+		goto finish;
+
+	ex.fd    = fd;
+	ex.out   = ex.in + EXPORT_BUFFER_SIZE;
+	ex.len   = 0;
+	ex.width = width;
+	ex.col   = 0;
+
+	if (export_stream(rec, in_fd, &ex, (flags & FASTA_EXPORT_KEEPWRAP) != 0) == 0 &&
+	    (!newline || ex.col == 0 || export_newline(&ex) == 0))
+		r = export_flush(&ex);
+
+	free(ex.in);
+finish:
+	if (fa->fa_seqFP == NULL || in_fd != fileno(fa->fa_seqFP))
+		close(in_fd);
+
+	return (r);
+}
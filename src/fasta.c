@@ -38,16 +38,33 @@
 #include <limits.h>
 #include <errno.h>
 #include <assert.h>
+#include <unistd.h>
 
 #include "helpers.h"
 #include "fasta.h"
 #include "trans.h"
 #include "crc32.h"
+#include "fasta_impl.h"
+#include "arena.h"
+#include "scan.h"
+#include "hash.h"
+#include "ival.h"
+#include "metrics.h"
 
 #ifndef PATH_MAX
 # define PATH_MAX 4096
 #endif
 
+/*
+ * Optional per-record data stored in the index (FASTA_idxhdr_t.ext)
+ */
+#define FASTA_IDXEXT_STATS   0x00000001 /* composition statistics, "S" lines */
+#define FASTA_IDXEXT_LASTSUM 0x00000002 /* checksum of the last record, required for FASTA_UPDINDEX */
+#define FASTA_IDXEXT_HASH    0x00000004 /* content hashes, "H" lines */
+#define FASTA_IDXEXT_HASHFOLD 0x00000008 /* the content hashes ignore the case */
+#define FASTA_IDXEXT_IVALS   0x00000010 /* letter class intervals, "I" lines */
+#define FASTA_IDXEXT_FASTQ   0x00000020 /* FASTQ file, quality strings in "Q" lines */
+
 /*
  * Nucleic Acid letter bitmask
  */
@@ -104,10 +121,134 @@ static bool iscodingseq(FASTA *fa, int ch)
 		return (false);
 }
 
-static int __index_write(FASTA *fa, const char *idxpath)
+/**
+ * Compute the CRC-32 checksum of the bytes [start, end) of a file.
+ */
+static int __file_sum(int fd, uint64_t start, uint64_t end, uint32_t *sum)
+{
+	uint8_t buffer[65536];
+	ssize_t r;
+
+	*sum = 0;
+
+	while (start < end) {
+		r = pread(fd, buffer, (end - start < sizeof buffer ? end - start : sizeof buffer), start);
+
+		if (r <= 0)
+			return (-1);
+
+		*sum   = crc32(*sum, buffer, r);
+		start += r;
+	}
+
+	return (0);
+}
+
+int __index_lastsum(FASTA *fa, uint64_t filesize, uint32_t *sum)
+{
+	if (fa->fa_rcount == 0) {
+		*sum = 0;
+		return (0);
+	}
+
+	return __file_sum(fileno(fa->fa_seqFP), fa->fa_record[fa->fa_rcount - 1].hdr_start - 1, filesize, sum);
+}
+
+/**
+ * Write the index header. The numbers are written using a fixed width so
+ * that the header can be rewritten in place by __index_append(). The
+ * checksum of the last record is omitted if `lastsum' is NULL.
+ */
+static void __index_write_header(FASTA *fa, FILE *fp, uint64_t filesize, uint32_t rcount, const uint32_t *lastsum)
+{
+	fprintf(fp,
+		";filesize=%020"PRIu64"\n"
+		";chksum=0x%08x\n"
+		";rcount=%010u\n",
+		filesize, 0x0 /* TODO */, rcount);
+
+	if (fa->fa_stats != NULL)
+		fprintf(fp, ";stats=1\n");
+
+	if (fa->fa_hash != NULL)
+		fprintf(fp, ";hash=%u\n", fa->fa_options & FASTA_HASHFOLD ? 2 : 1);
+
+	if (fa->fa_ivals != NULL)
+		fprintf(fp, ";ivals=1\n");
+
+	if (fa->fa_options & FASTA_FASTQ)
+		fprintf(fp, ";fastq=1\n");
+
+	if (lastsum != NULL)
+		fprintf(fp, ";lastsum=0x%08x\n", *lastsum);
+}
+
+/**
+ * Write the index line(s) of the record `i'.
+ */
+static void __index_write_record(FASTA *fa, FILE *fp, uint32_t i)
+{
+	fprintf(fp,
+		"%"PRIu64" "
+		"%"PRIu32" "
+		"%"PRIu64" "
+		"%"PRIu64" "
+		"%"PRIu64" "
+		"%"PRIu32" "
+		"%"PRIu32" "
+		"%"PRIu32"\n",
+		fa->fa_record[i].hdr_start,
+		fa->fa_record[i].hdr_len,
+		fa->fa_record[i].seq_start,
+		fa->fa_record[i].seq_rawlen,
+		fa->fa_record[i].seq_len,
+		fa->fa_record[i].seq_lines,
+		fa->fa_record[i].seq_linew,
+		fa->fa_record[i].seq_lastw);
+
+	if (fa->fa_options & FASTA_FASTQ)
+		fprintf(fp, "Q %"PRIu64" %"PRIu64"\n", fa->fa_record[i].qual_start, fa->fa_record[i].qual_rawlen);
+
+	if (fa->fa_stats != NULL) {
+		register uint32_t l;
+		FASTA_stats_t *rs = fa->fa_stats + i;
+
+		fputc('S', fp);
+
+		for (l = 0; l < 26; ++l)
+			fprintf(fp, " %"PRIu64, rs->residue[l]);
+
+		fprintf(fp,
+			" %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64"\n",
+			rs->gap, rs->gc, rs->n, rs->lower, rs->n_run);
+	}
+
+	if (fa->fa_hash != NULL)
+		fprintf(fp, "H %016"PRIx64" %016"PRIx64"\n", fa->fa_hash[i].h[0], fa->fa_hash[i].h[1]);
+
+	if (fa->fa_ivals != NULL) {
+		register uint32_t k, l;
+		FASTA_ivals_t *iv = fa->fa_ivals + i;
+
+		for (k = 0; k < FASTA_IVAL_CLASSES; ++k) {
+			if (iv->count[k] == 0)
+				continue;
+
+			fprintf(fp, "I %u %u", k, iv->count[k]);
+
+			for (l = 0; l < iv->count[k]; ++l)
+				fprintf(fp, " %"PRIu64" %"PRIu64, iv->ival[k][l].a, iv->ival[k][l].b);
+
+			fputc('\n', fp);
+		}
+	}
+}
+
+int __index_write(FASTA *fa, const char *idxpath)
 {
 	register uint32_t i;
 	struct stat st;
+	uint32_t lastsum;
 
 	assert(fa != NULL);
 	assert(idxpath != NULL);
@@ -119,47 +260,143 @@ static int __index_write(FASTA *fa, const char *idxpath)
 		return (-1);
 	}
 
-	if (file_get_stat(fa->fa_seqFP, &st) != 0) {
+	if (file_get_stat(fa->fa_seqFP, &st) != 0 ||
+	    __index_lastsum(fa, st.st_size, &lastsum) != 0)
+	{
 		fclose(fa->fa_idxFP);
 		fa->fa_idxFP = NULL;
 		return (-1);
 	}
 
-	fprintf(fa->fa_idxFP,
-		";filesize=%"PRIu64"\n"
-		";chksum=0x%08x\n"
-		";rcount=%u\n",
-		st.st_size, 0x0 /* TODO */, fa->fa_rcount);
+	__index_write_header(fa, fa->fa_idxFP, st.st_size, fa->fa_rcount, &lastsum);
 
-	for (i = 0; i < fa->fa_rcount; ++i) {
-		fprintf(fa->fa_idxFP,
-			"%"PRIu64" "
-			"%"PRIu32" "
-			"%"PRIu64" "
-			"%"PRIu64" "
-			"%"PRIu64" "
-			"%"PRIu32" "
-			"%"PRIu32" "
-			"%"PRIu32"\n",
-			fa->fa_record[i].hdr_start,
-			fa->fa_record[i].hdr_len,
-			fa->fa_record[i].seq_start,
-			fa->fa_record[i].seq_rawlen,
-			fa->fa_record[i].seq_len,
-			fa->fa_record[i].seq_lines,
-			fa->fa_record[i].seq_linew,
-			fa->fa_record[i].seq_lastw);
+	for (i = 0; i < fa->fa_rcount; ++i)
+		__index_write_record(fa, fa->fa_idxFP, i);
+
+	if (!(fa->fa_options & FASTA_KEEPOPEN)) {
+		fclose(fa->fa_idxFP);
+		fa->fa_idxFP = NULL;
+	}
+
+	return (0);
+}
+
+int __index_write_slice(FASTA *fa, FILE *fp, uint32_t from, uint32_t count)
+{
+	register uint32_t i;
+	struct stat st;
+
+	assert(fa != NULL);
+	assert(from + count <= fa->fa_rcount);
+
+	if (stat(fa->fa_path, &st) != 0)
+		return (-1);
+
+	/*
+	 * Without the checksum of the last record, the slice can't be
+	 * mistaken for an index that may be updated
+	 */
+	__index_write_header(fa, fp, st.st_size, count, NULL);
+
+	for (i = from; i < from + count; ++i)
+		__index_write_record(fa, fp, i);
+
+	return (ferror(fp) ? -1 : 0);
+}
+
+/**
+ * Update an existing index after new records were appended to the
+ * sequence file. The header is rewritten in place and the records are
+ * written starting from the record `from', which starts at the offset
+ * `off' in the index file.
+ */
+static int __index_append(FASTA *fa, const char *idxpath, uint32_t from, off_t off)
+{
+	register uint32_t i;
+	struct stat st;
+	uint32_t lastsum;
+
+	assert(fa != NULL);
+	assert(idxpath != NULL);
+
+	fa->fa_idxFP = fopen(idxpath, "r+");
+
+	if (fa->fa_idxFP == NULL) {
+		dP("Unable to open \"%s\" for writing\n", idxpath);
+		return (-1);
 	}
 
+	if (file_get_stat(fa->fa_seqFP, &st) != 0 ||
+	    __index_lastsum(fa, st.st_size, &lastsum) != 0)
+		goto fail;
+
+	__index_write_header(fa, fa->fa_idxFP, st.st_size, fa->fa_rcount, &lastsum);
+
+	if (fseeko(fa->fa_idxFP, off, SEEK_SET) != 0)
+		goto fail;
+
+	for (i = from; i < fa->fa_rcount; ++i)
+		__index_write_record(fa, fa->fa_idxFP, i);
+
+	/*
+	 * The rewritten record lines may be shorter
+	 */
+	if (fflush(fa->fa_idxFP) != 0 ||
+	    ftruncate(fileno(fa->fa_idxFP), ftello(fa->fa_idxFP)) != 0)
+		goto fail;
+
 	if (!(fa->fa_options & FASTA_KEEPOPEN)) {
 		fclose(fa->fa_idxFP);
 		fa->fa_idxFP = NULL;
 	}
 
+	return (0);
+fail:
+	fclose(fa->fa_idxFP);
+	fa->fa_idxFP = NULL;
+
+	return (-1);
+}
+
+/**
+ * Check whether the sequence file was only appended to since the index
+ * was written: the last indexed record has to be unchanged and a new
+ * record has to start at the beginning of the appended data.
+ */
+static int __index_appended(FASTA *fa, FASTA_idxhdr_t *ihdr)
+{
+	FASTA_rec_t *last;
+	uint32_t sum;
+	uint8_t  ch[2];
+	int      fd;
+
+	if (fa->fa_rcount == 0)
+		return (-1);
+
+	last = fa->fa_record + fa->fa_rcount - 1;
+	fd   = fileno(fa->fa_seqFP);
+
+	if (last->hdr_start == 0 || last->hdr_start > ihdr->filesize)
+		return (-1);
+
+	if (pread(fd, ch, sizeof ch, ihdr->filesize - 1) != sizeof ch ||
+	    ch[0] != '\n' || ch[1] != (fa->fa_options & FASTA_FASTQ ? '@' : '>'))
+	{
+		dP("The appended data don't start with a new record\n");
+		return (-1);
+	}
+
+	if (__file_sum(fd, last->hdr_start - 1, ihdr->filesize, &sum) != 0 ||
+	    sum != ihdr->lastsum)
+	{
+		dP("Checksum of the last record doesn't match: 0x%08x != 0x%08x\n", sum, ihdr->lastsum);
+		return (-1);
+	}
+
 	return (0);
 }
 
-static int __fahdr_read0(FILE *fp, FASTA_rec_t *dst)
+static int __fahdr_read0(scanbuf_t *sb, FASTA_rec_t *dst, arena_t *arena, FASTA_metrics_t *m)
 {
 	register int ch;
 	register uint32_t i;
@@ -167,55 +404,86 @@ static int __fahdr_read0(FILE *fp, FASTA_rec_t *dst)
 	char    *buffer;
 	uint32_t buflen;
 	char    *buftok;
+	uint8_t *nl;
+	size_t   n;
+	uint64_t t;
 
-	ch = getc_unlocked(fp);
+	t  = metrics_start(m);
+	ch = scan_getc(sb);
 
-	if (ch != '>')
+	/*
+	 * '@' starts the records of FASTQ files
+	 */
+	if (ch != '>' && ch != '@')
 		return (-1);
 
 	/*
 	 * Read all headers
 	 */
-	dst->hdr_start = file_get_offset(fp);
+	dst->hdr_start = scan_tell(sb);
 	dst->hdr_len   = 0;
 	dst->hdr_cnt   = 1;
+	dst->hdr       = NULL;
+	dst->hdr_mem   = NULL;
 
         dst->cdseg = NULL;
         dst->cdseg_count = 0;
         dst->cdseg_index = 0;
 
-	buflen = 1024;
-	buffer = alloc_array(char, buflen);
+	/*
+	 * Copy the header line directly from the scan buffer into the arena.
+	 * The arena block is extended in place if the line spans more buffers.
+	 */
+	buffer = NULL;
+	buflen = 0;
 
 	do {
-		if (dst->hdr_len >= buflen) {
-			buflen += 1024;
-			buffer  = realloc_array(buffer, char, buflen);
+		if (scan_fill(sb) <= 0) {
+			dP("Unexpected EOF: header line not terminated\n");
+			return (-1);
 		}
 
-		buffer[dst->hdr_len++] = ch = getc_unlocked(fp);
+		nl = memchr(sb->buf + sb->pos, '\n', sb->len - sb->pos);
+		n  = (nl != NULL ? (size_t)(nl - (sb->buf + sb->pos)) + 1 : sb->len - sb->pos);
+
+		buffer = arena_grow(arena, buffer, buflen, buflen + n);
+
+		if (buffer == NULL)
+			return (-1);
 
-		if (ch == 0x01) /* ^A server as a header separator in the FASTA format */
-			++dst->hdr_cnt;
+		memcpy(buffer + buflen, sb->buf + sb->pos, n);
 
-	} while(ch != '\n');
+		buflen  += n;
+		sb->pos += n;
+	} while (nl == NULL);
 
+	dst->hdr_len = buflen;
 	buffer[dst->hdr_len - 1] = '\0';
-	buffer = realloc_array(buffer, char, dst->hdr_len);
 	dst->hdr_mem = buffer;
 
+	/*
+	 * ^A serves as a header separator in the FASTA format
+	 */
+	for (buftok = buffer; (buftok = memchr(buftok, 0x01, buflen - (buftok - buffer))) != NULL; ++buftok)
+		++dst->hdr_cnt;
+
 	dP(" Read header: \"%s\"\n", buffer);
 	dP("Header count: %u\n", dst->hdr_cnt);
 
 	/*
 	 * Parse headers
 	 */
-	dst->hdr    = alloc_array(FASTA_rechdr_t, dst->hdr_cnt);
-	dst->flags |= FASTA_REC_FREEHDR;
+	dst->hdr = arena_alloc(arena, sizeof(FASTA_rechdr_t) * dst->hdr_cnt, sizeof(void *));
+
+	if (dst->hdr == NULL)
+		return (-1);
 
-	i = 0;
+	/*
+	 * The length of the header line without the terminating NUL
+	 */
+	--buflen;
 
-	while ((buftok = strsep(&buffer, "\x01")) != NULL) {
+	for (i = 0; buffer != NULL; ++i) {
 		/*
 		 * Sanity check
 		 */
@@ -224,28 +492,37 @@ static int __fahdr_read0(FILE *fp, FASTA_rec_t *dst)
 			goto fail;
 		}
 
+		buftok = buffer;
+		buffer = memchr(buftok, 0x01, buflen);
+		n      = (buffer != NULL ? (size_t)(buffer - buftok) : buflen);
+
+		if (buffer != NULL) {
+			*buffer++ = '\0';
+			buflen   -= n + 1;
+		}
+
 		/*
 		 * Parse the header using the SeqID parser
 		 */
-		if ((dst->hdr[i].seqid_fmt = SeqID_parse(buftok, strlen(buftok),
-							 &dst->hdr[i].seqid)) == SEQID_ERROR)
+		if ((dst->hdr[i].seqid_fmt = SeqID_parse(buftok, n, &dst->hdr[i].seqid)) == SEQID_ERROR)
 		{
-			dP("SeqID returned an error: h=\"%s\" l=%zu\n", buftok, strlen(buftok));
+			dP("SeqID returned an error: h=\"%s\" l=%zu\n", buftok, n);
 			goto fail;
 		}
-
-		++i;
 	}
 
 	if (dst->hdr_cnt > 0)
 		dst->rec_id = dst->hdr[0].seqid.common.id;
 
+	metrics_phase(m, FASTA_PHASE_HEADER, t);
+
 	return (0);
 fail:
-	if (dst->hdr != NULL)
-		free(dst->hdr);
-	if (dst->hdr_mem != NULL)
-		free(dst->hdr_mem);
+	/*
+	 * The memory is owned by the arena
+	 */
+	dst->hdr     = NULL;
+	dst->hdr_mem = NULL;
 
 	return (-1);
 }
@@ -311,13 +588,110 @@ static int __idxhdr_read0(FASTA *fa, FASTA_idxhdr_t *ihdr)
 
 			if (errno == ERANGE || errno == EINVAL)
 				return (FASTA_EINVAL);
+		} else if (strcmp(buftok, "stats") == 0) {
+			if (strtol(bufptr, NULL, 10) != 0)
+				ihdr->ext |= FASTA_IDXEXT_STATS;
+		} else if (strcmp(buftok, "hash") == 0) {
+			switch (strtol(bufptr, NULL, 10)) {
+			case 2:
+				ihdr->ext |= FASTA_IDXEXT_HASHFOLD;
+				/* fall through */
+			case 1:
+				ihdr->ext |= FASTA_IDXEXT_HASH;
+			}
+		} else if (strcmp(buftok, "ivals") == 0) {
+			if (strtol(bufptr, NULL, 10) != 0)
+				ihdr->ext |= FASTA_IDXEXT_IVALS;
+		} else if (strcmp(buftok, "fastq") == 0) {
+			if (strtol(bufptr, NULL, 10) != 0)
+				ihdr->ext |= FASTA_IDXEXT_FASTQ;
+		} else if (strcmp(buftok, "lastsum") == 0) {
+			ihdr->lastsum = strtoul(bufptr, NULL, 16);
+			ihdr->ext    |= FASTA_IDXEXT_LASTSUM;
+
+			dP("lastsum=0x%08x\n", ihdr->lastsum);
 		}
 	}
 
 	return (FASTA_EUNEXPEOF);
 }
 
-static int __index_read0(FILE *idxFP, FILE *seqFP, FASTA_rec_t *dst)
+/**
+ * Read the optional lines following an index record. Each one of them
+ * starts with a tag letter; lines with unknown tags are skipped.
+ */
+static int __index_ext_read0(FILE *idxFP, FASTA_rec_t *dst, FASTA_stats_t *st, FASTA_hash_t *hash, FASTA_ivals_t *iv)
+{
+	register int ch;
+	register uint32_t l;
+
+	while ((ch = getc_unlocked(idxFP)) != EOF) {
+		switch (ch) {
+		case '\n':
+			continue;
+		case 'Q':
+			if (fscanf(idxFP, "%"SCNu64" %"SCNu64, &dst->qual_start, &dst->qual_rawlen) != 2)
+				return (-1);
+			continue;
+		case 'S':
+			if (st != NULL) {
+				uint64_t *field[] = { &st->gap, &st->gc, &st->n, &st->lower, &st->n_run };
+
+				for (l = 0; l < 26; ++l)
+					if (fscanf(idxFP, "%"SCNu64, st->residue + l) != 1)
+						return (-1);
+
+				for (l = 0; l < sizeof field / sizeof field[0]; ++l)
+					if (fscanf(idxFP, "%"SCNu64, field[l]) != 1)
+						return (-1);
+				continue;
+			}
+			break;
+		case 'H':
+			if (hash != NULL) {
+				if (fscanf(idxFP, "%"SCNx64" %"SCNx64, hash->h, hash->h + 1) != 2)
+					return (-1);
+				continue;
+			}
+			break;
+		case 'I':
+			if (iv != NULL) {
+				uint32_t k, count;
+
+				if (fscanf(idxFP, "%"SCNu32" %"SCNu32, &k, &count) != 2 ||
+				    k >= FASTA_IVAL_CLASSES || iv->ival[k] != NULL || count == 0)
+					return (-1);
+
+				iv->ival[k] = alloc_array(FASTA_u64p, count);
+
+				if (iv->ival[k] == NULL)
+					return (-1);
+
+				for (l = 0; l < count; ++l)
+					if (fscanf(idxFP, "%"SCNu64" %"SCNu64, &iv->ival[k][l].a, &iv->ival[k][l].b) != 2)
+						return (-1);
+
+				iv->count[k] = count;
+				continue;
+			}
+			break;
+		default:
+			if (isdigit(ch)) {
+				ungetc(ch, idxFP);
+				return (0);
+			}
+			break;
+		}
+
+		/* skip the rest of the line */
+		while ((ch = getc_unlocked(idxFP)) != EOF && ch != '\n');
+	}
+
+	return (0);
+}
+
+static int __index_read0(FILE *idxFP, scanbuf_t *sb, FASTA_rec_t *dst, FASTA_stats_t *st, FASTA_hash_t *hash,
+			 FASTA_ivals_t *iv, arena_t *arena, FASTA_metrics_t *m)
 {
 	int r;
 
@@ -326,6 +700,9 @@ static int __index_read0(FILE *idxFP, FILE *seqFP, FASTA_rec_t *dst)
 	dst->hdr     = NULL;
 	dst->hdr_mem = NULL;
 	dst->seq_mem = NULL;
+	dst->qual_start  = 0;
+	dst->qual_rawlen = 0;
+	dst->qual_mem    = NULL;
 
 	if (!feof_unlocked(idxFP)) {
 		switch (r = fscanf(idxFP,
@@ -368,15 +745,26 @@ static int __index_read0(FILE *idxFP, FILE *seqFP, FASTA_rec_t *dst)
 			dst->flags   = 0;
 			dst->seq_mem = NULL;
 
+			if (st != NULL)
+				memset(st, 0, sizeof(FASTA_stats_t));
+
+			if (iv != NULL)
+				memset(iv, 0, sizeof(FASTA_ivals_t));
+
+			if (__index_ext_read0(idxFP, dst, st, hash, iv) != 0) {
+				dP("Failed to read the optional index record data\n");
+
+				if (iv != NULL)
+					fasta_ivals_free(iv);
+				return (-1);
+			}
+
 			/*
 			 * Seek to hdr_start - 1, because __fahdr_read0 expects the '>'
 			 */
-                        if (file_set_offset(seqFP, dst->hdr_start - 1) != 0) {
-				dP("Failed to seek to position %zu in %p\n", dst->hdr_start, seqFP);
-				return (-1);
-			}
+			scan_seek(sb, dst->hdr_start - 1);
 
-			return __fahdr_read0(seqFP, dst);
+			return __fahdr_read0(sb, dst, arena, m);
 		case EOF:
 			return (1);
 #ifndef NDEBUG
@@ -407,6 +795,7 @@ static inline void __fasta_cdseg_process(FASTA *fa, FASTA_rec_t *dst, uint8_t ch
                          * => create a new coding segment entry
                          */
                         dst->cdseg = realloc_array(dst->cdseg, FASTA_u64p, ++dst->cdseg_count);
+                        metrics_add(fa->fa_metrics, allocs, 1);
 
                         dst->cdseg[dst->cdseg_count - 1].a = i;
                         dst->cdseg[dst->cdseg_count - 1].b = i;
@@ -429,23 +818,213 @@ static inline void __fasta_cdseg_process(FASTA *fa, FASTA_rec_t *dst, uint8_t ch
         }
 }
 
+/*
+ * Decoding kernels
+ *
+ * The sequence letters are copied or translated into the destination
+ * buffer, optionally mapping the coding segments. Instead of testing the
+ * translation table and the record flags for each letter, every
+ * combination is instantiated from the templates below as a separate
+ * kernel and the kernel is selected once per record.
+ */
+typedef struct {
+	FASTA       *fa;
+	FASTA_rec_t *dst;
+	atrans_t    *atr;
+	uint8_t     *out;    /* destination buffer */
+	uint64_t     i;      /* letters decoded so far */
+	uint32_t     lines;  /* lines left to decode (ragged kernels) */
+	bool         in_cds;
+} fasta_decode_t;
+
+typedef int  (*fasta_ragged_fn)(fasta_decode_t *, const uint8_t *, size_t);
+typedef void (*fasta_uniform_fn)(fasta_decode_t *, const uint8_t *, size_t);
+
+#define DECODE_PUT_NONE(dc, ch, i)  do { } while (0)
+#define DECODE_PUT_COPY(dc, ch, i)  ((dc)->out[i] = (ch))
+#define DECODE_PUT_TRANS(dc, ch, i) atrans_letter_s2d((dc)->atr, (ch), (uint32_t)(i), (dc)->out)
+#define DECODE_CDS_NONE(dc, ch, i)  do { } while (0)
+#define DECODE_CDS_MAP(dc, ch, i)   __fasta_cdseg_process((dc)->fa, (dc)->dst, (ch), &(dc)->in_cds, (i))
+
+/*
+ * Ragged kernel: decode the lines found in `buf', skipping the spaces.
+ * Returns 1 once the last line of the record was decoded, 0 if more data
+ * is needed and -1 if an unexpected character was found. Runs of letters
+ * are copied at once when BULK is set.
+ */
+#define FASTA_RAGGED_KERNEL(name, PUT, CDS, BULK)				\
+static int name(fasta_decode_t *dc, const uint8_t *buf, size_t len)		\
+{										\
+	register uint64_t i = dc->i;						\
+	register size_t   n = 0, a;						\
+										\
+	if (dc->lines == 0)							\
+		return (1);							\
+										\
+	while (n < len) {							\
+		for (a = n; n < len && issequence(buf[n]); ++n);		\
+										\
+		if (BULK) {							\
+			memcpy(dc->out + i, buf + a, n - a);			\
+			i += n - a;						\
+		} else {							\
+			for (; a < n; ++a, ++i) {				\
+				CDS(dc, buf[a], i);				\
+				PUT(dc, buf[a], i);				\
+			}							\
+		}								\
+										\
+		if (n == len)							\
+			break;							\
+										\
+		if (buf[n] == '\n') {						\
+			if (--dc->lines == 0) {					\
+				dc->i = i;					\
+				return (1);					\
+			}							\
+		} else if (buf[n] != ' ') {					\
+			dP("Unexpected character: %c (%u)\n", (char)buf[n], buf[n]); \
+			dc->i = i;						\
+			return (-1);						\
+		}								\
+										\
+		++n;								\
+	}									\
+										\
+	dc->i = i;								\
+	return (0);								\
+}
+
+/*
+ * Uniform kernel: decode one line of a record whose lines are all of the
+ * same length. The lines are read directly into the destination buffer
+ * when they aren't translated, the copying kernels only map the coding
+ * segments, if at all.
+ */
+#define FASTA_UNIFORM_KERNEL(name, PUT, CDS)					\
+static void name(fasta_decode_t *dc, const uint8_t *line, size_t len)		\
+{										\
+	register uint64_t i = dc->i;						\
+	register size_t   n;							\
+										\
+	(void)line;								\
+										\
+	for (n = 0; n < len; ++n, ++i) {					\
+		CDS(dc, line[n], i);						\
+		PUT(dc, line[n], i);						\
+	}									\
+										\
+	dc->i = i;								\
+}
+
+FASTA_RAGGED_KERNEL(__fasta_ragged_copy,      DECODE_PUT_COPY,  DECODE_CDS_NONE, 1)
+FASTA_RAGGED_KERNEL(__fasta_ragged_copy_cds,  DECODE_PUT_COPY,  DECODE_CDS_MAP,  0)
+FASTA_RAGGED_KERNEL(__fasta_ragged_trans,     DECODE_PUT_TRANS, DECODE_CDS_NONE, 0)
+FASTA_RAGGED_KERNEL(__fasta_ragged_trans_cds, DECODE_PUT_TRANS, DECODE_CDS_MAP,  0)
+
+FASTA_UNIFORM_KERNEL(__fasta_uniform_copy,      DECODE_PUT_NONE,  DECODE_CDS_NONE)
+FASTA_UNIFORM_KERNEL(__fasta_uniform_copy_cds,  DECODE_PUT_NONE,  DECODE_CDS_MAP)
+FASTA_UNIFORM_KERNEL(__fasta_uniform_trans,     DECODE_PUT_TRANS, DECODE_CDS_NONE)
+FASTA_UNIFORM_KERNEL(__fasta_uniform_trans_cds, DECODE_PUT_TRANS, DECODE_CDS_MAP)
+
+/*
+ * Kernel tables indexed by __fasta_kernel()
+ */
+static const fasta_ragged_fn __fasta_ragged_kernel[4] = {
+	__fasta_ragged_copy,  __fasta_ragged_copy_cds,
+	__fasta_ragged_trans, __fasta_ragged_trans_cds
+};
+
+static const fasta_uniform_fn __fasta_uniform_kernel[4] = {
+	__fasta_uniform_copy,  __fasta_uniform_copy_cds,
+	__fasta_uniform_trans, __fasta_uniform_trans_cds
+};
+
+/**
+ * Initialize the decoding state of a record and return the index of the
+ * kernel matching the translation table and the record flags.
+ */
+static inline unsigned int __fasta_kernel(fasta_decode_t *dc, FASTA *fa, FASTA_rec_t *dst, atrans_t *atr)
+{
+	dc->fa     = fa;
+	dc->dst    = dst;
+	dc->atr    = atr;
+	dc->out    = (uint8_t *)dst->seq_mem;
+	dc->i      = 0;
+	dc->lines  = dst->seq_lines;
+	dc->in_cds = false;
+
+	dst->cdseg       = NULL;
+	dst->cdseg_count = 0;
+	dst->cdseg_index = 0;
+
+	return ((atr != NULL) << 1 | ((dst->flags & FASTA_MAPCDSEG) != 0));
+}
+
+/**
+ * Finalize the coding segment open at the end of the sequence, if any.
+ */
+static inline void __fasta_kernel_finish(fasta_decode_t *dc)
+{
+	if (dc->dst->flags & FASTA_MAPCDSEG)
+		__fasta_cdseg_process(dc->fa, dc->dst, 0, &dc->in_cds, dc->i);
+}
+
+/**
+ * Update the composition statistics with a sequence letter.
+ */
+static inline void __fasta_stats_process(FASTA_stats_t *st, int ch, uint64_t *n_run)
+{
+	if (ch == '-') {
+		++st->gap;
+		*n_run = 0;
+		return;
+	}
+
+	if (ch >= 'a') {
+		++st->lower;
+		ch -= 'a' - 'A';
+	}
+
+	++st->residue[ch - 'A'];
+
+	switch (ch) {
+	case 'G':
+	case 'C':
+		++st->gc;
+		break;
+	case 'N':
+		++st->n;
+
+		if (++*n_run > st->n_run)
+			st->n_run = *n_run;
+		return;
+	}
+
+	*n_run = 0;
+}
+
 /**
- * Read a variable line length sequence record into memory.
+ * Read a variable line length sequence record into memory. The raw data
+ * is read in chunks of at most FASTA_LINEBUFFER_SIZE bytes, never past the
+ * end of the record.
  */
-static int __fasta_read2(FASTA *fa, FASTA_rec_t *dst, atrans_t *atr)
+static int __fasta_read2(FASTA *fa, FILE *fp, FASTA_rec_t *dst, atrans_t *atr)
 {
 	size_t   alloc_size;
         uint8_t *buffer;
 	size_t   buflen;
-
-	register uint32_t n;
-	register uint64_t i;
-        bool in_cds = false;
+	uint64_t left;
+	fasta_decode_t dc;
+	fasta_ragged_fn kernel;
+	int r = 0;
 
         dP("read2\n");
 
-	if (file_set_offset(fa->fa_seqFP, dst->seq_start) != 0) {
-		dP("Failed to seek to position %zu in %p\n", dst->seq_start, fa->fa_seqFP);
+	metrics_add(fa->fa_metrics, syscalls, 1);
+
+	if (file_set_offset(fp, dst->seq_start) != 0) {
+		dP("Failed to seek to position %zu in %p\n", dst->seq_start, fp);
 		return (-1);
 	}
 
@@ -461,145 +1040,172 @@ static int __fasta_read2(FASTA *fa, FASTA_rec_t *dst, atrans_t *atr)
 
 	dP("alloc_size=%zu\n", alloc_size);
 
-	i = 0;
 	dst->seq_mem = malloc(alloc_size);
 	bzero(dst->seq_mem, alloc_size);
 
-	buffer = alloc_array(uint8_t, FASTA_LINEBUFFER_SIZE);
-	buflen = FASTA_LINEBUFFER_SIZE;
+	left   = dst->seq_rawlen;
+	buflen = left < FASTA_LINEBUFFER_SIZE ? (size_t)left : FASTA_LINEBUFFER_SIZE;
+	buffer = alloc_array(uint8_t, buflen);
 
-        dst->cdseg   = NULL;
-        dst->cdseg_count = 0;
-        dst->cdseg_index = 0;
+	metrics_add(fa->fa_metrics, allocs, 2);
+
+	kernel = __fasta_ragged_kernel[__fasta_kernel(&dc, fa, dst, atr)];
 
-	for (; dst->seq_lines > 0;) {
+	while (r == 0 && left > 0) {
 		/*
-		 * Read a line into buffer
+		 * Read the next chunk of the sequence into buffer
 		 */
-		buflen = fread(buffer, 1, buflen, fa->fa_seqFP);
-
-		if (buflen == 0) {
-			if (feof(fa->fa_seqFP) && dst->seq_lines < 2)
-				break;
-			else {
-				dP("An error occured during fread(%p, 1, %zu, %p): errno=%d, %s.\n",
-				   buffer, buflen, fa->fa_seqFP, errno, strerror(errno));
+		if (buflen > left)
+			buflen = (size_t)left;
 
-				free(buffer);
-				free(dst->seq_mem);
-				dst->seq_mem = NULL;
+		metrics_add(fa->fa_metrics, syscalls, 1);
 
-				return (-1);
-			}
+		if (fread(buffer, 1, buflen, fp) != buflen) {
+			dP("An error occured during fread(%p, 1, %zu, %p): errno=%d, %s.\n",
+			   buffer, buflen, fp, errno, strerror(errno));
+			r = -1;
+			break;
 		}
 
-		if (atr != NULL) {
-                        /*
-                         * Read and translate the sequence
-                         */
-			for (n = 0; n < buflen; ++n) {
-				if (issequence(buffer[n])) {
-                                        /*
-                                         * Update CDS state
-                                         */
-                                        if (dst->flags & FASTA_MAPCDSEG)
-                                                __fasta_cdseg_process(fa, dst, buffer[n], &in_cds, i);
-
-                                        /*
-                                         * Translate the buffer
-                                         */
-					atrans_letter_s2d(atr, buffer[n], i++, (uint8_t *)dst->seq_mem);
-				} else {
-					if (buffer[n] == '\n') {
-						assert(dst->seq_lines > 0);
-						--dst->seq_lines;
-
-						if (dst->seq_lines == 0)
-							goto __A_finish;
-					} else {
-						switch (buffer[n]) {
-						case ' ':
-							/* ignore */
-							break;
-						default:
-							dP("Unexpected character: %c (%u)\n", (char)buffer[n], buffer[n]);
-
-							free(buffer);
-							free(dst->seq_mem);
-							dst->seq_mem = NULL;
-
-							return (-1);
-						}
-					}
-				}
-			}
-		} else {
-                        /*
-                         * Read without translation
-                         */
-			for (n = 0; n < buflen; ++n) {
-				if (issequence(buffer[n])) {
-                                        if (dst->flags & FASTA_MAPCDSEG)
-                                                __fasta_cdseg_process(fa, dst, buffer[n], &in_cds, i);
+		metrics_add(fa->fa_metrics, bytes_read, buflen);
+		left -= buflen;
 
-					((uint8_t *)(dst->seq_mem))[i++] = buffer[n];
-				} else {
-					if (buffer[n] == '\n') {
-						assert(dst->seq_lines > 0);
-						--dst->seq_lines;
+		r = kernel(&dc, buffer, buflen);
+	}
 
-						if (dst->seq_lines == 0)
-							goto __A_finish;
-					} else {
-						switch (buffer[n]) {
-						case ' ':
-							/* ignore */
-							break;
-						default:
-							dP("Unexpected character: %c (%u)\n", (char)buffer[n], buffer[n]);
-
-							free(buffer);
-							free(dst->seq_mem);
-							dst->seq_mem = NULL;
-
-							return (-1);
-						}
-					}
-				}
-			}
-		}
+	/*
+	 * The last line doesn't have to end with a new-line
+	 */
+	if (r == 0 && dc.lines > 1) {
+		dP("Unexpected end of the record data: %u lines left\n", dc.lines);
+		r = -1;
 	}
-	__A_finish:
+
 	free(buffer);
-	dst->seq_len = i;
 
-        if (dst->flags & FASTA_MAPCDSEG)
-                __fasta_cdseg_process(fa, dst, 0, &in_cds, i);
+	if (r < 0) {
+		free(dst->cdseg);
+		free(dst->seq_mem);
+		dst->seq_mem     = NULL;
+		dst->cdseg       = NULL;
+		dst->cdseg_count = 0;
 
-	if (dst->flags & FASTA_CSTRSEQ) {
-		dst->seq_mem[i] = '\0';
+		return (-1);
+	}
+
+	dst->seq_len = dc.i;
+
+	__fasta_kernel_finish(&dc);
+
+	if (dst->flags & FASTA_CSTRSEQ) {
+		dst->seq_mem[dc.i] = '\0';
 		dst->seq_mem = realloc_array(dst->seq_mem, uint8_t, dst->seq_len + 1);
 	} else
 		dst->seq_mem = realloc_array(dst->seq_mem, uint8_t, dst->seq_len);
 
+	metrics_add(fa->fa_metrics, allocs, 1);
+
+	return (0);
+}
+
+int __fastq_decode_qual(const uint8_t *raw, uint64_t rawlen, FASTA_rec_t *dst)
+{
+	register uint64_t n, i = 0;
+
+	for (n = 0; n < rawlen && i < dst->seq_len; ++n) {
+		if (raw[n] != '\n')
+			dst->qual_mem[i++] = raw[n];
+	}
+
+	if (i != dst->seq_len) {
+		dP("The quality string is shorter than the sequence: %"PRIu64" < %"PRIu64"\n", i, dst->seq_len);
+		return (-1);
+	}
+
+	if (dst->flags & FASTA_CSTRSEQ)
+		dst->qual_mem[i] = '\0';
+
+	return (0);
+}
+
+/**
+ * Read the quality string of a FASTQ record into memory. The string is
+ * read into its final buffer and the new-lines are removed in place.
+ */
+static int __fastq_read_qual(FASTA *fa, FILE *fp, FASTA_rec_t *dst)
+{
+	metrics_add(fa->fa_metrics, syscalls, 1);
+
+	if (file_set_offset(fp, dst->qual_start) != 0) {
+		dP("Failed to seek to position %"PRIu64" in %p\n", dst->qual_start, fp);
+		return (-1);
+	}
+
+	dst->qual_mem = alloc_array(uint8_t, dst->qual_rawlen + 1);
+
+	if (dst->qual_mem == NULL)
+		return (-1);
+
+	metrics_add(fa->fa_metrics, allocs, 1);
+	metrics_add(fa->fa_metrics, syscalls, 1);
+
+	if (fread(dst->qual_mem, 1, dst->qual_rawlen, fp) != dst->qual_rawlen ||
+	    __fastq_decode_qual(dst->qual_mem, dst->qual_rawlen, dst) != 0)
+	{
+		free(dst->qual_mem);
+		dst->qual_mem = NULL;
+		return (-1);
+	}
+
+	metrics_add(fa->fa_metrics, bytes_read, dst->qual_rawlen);
+
+	return (0);
+}
+
+int __fasta_decode(FASTA *fa, const uint8_t *raw, uint64_t rawlen, FASTA_rec_t *dst, atrans_t *atr)
+{
+	fasta_decode_t dc;
+
+	/*
+	 * The last line doesn't have to end with a new-line
+	 */
+	if (__fasta_ragged_kernel[__fasta_kernel(&dc, fa, dst, atr)](&dc, raw, rawlen) < 0 || dc.lines > 1) {
+		dP("Unexpected end of the record data: %u lines left\n", dc.lines);
+		free(dst->cdseg);
+		dst->cdseg       = NULL;
+		dst->cdseg_count = 0;
+		return (-1);
+	}
+
+	dst->seq_len = dc.i;
+
+	__fasta_kernel_finish(&dc);
+
+	if (dst->flags & FASTA_CSTRSEQ)
+		((uint8_t *)(dst->seq_mem))[dc.i] = '\0';
+
 	return (0);
 }
 
 /**
- * Read a equal line length sequence record into memory.
+ * Read a equal line length sequence record into memory. The lines are
+ * read at once: directly into seq_mem, where they are moved together,
+ * or into a buffer if they have to be translated.
  */
-static int __fasta_read1(FASTA *fa, FASTA_rec_t *dst, atrans_t *atr)
+static int __fasta_read1(FASTA *fa, FILE *fp, FASTA_rec_t *dst, atrans_t *atr)
 {
 	size_t   alloc_size;
-	uint8_t *buffer;
-	size_t   buflen;
+	uint8_t *raw, *line;
+	size_t   rawlen, buflen;
+	fasta_decode_t dc;
+	fasta_uniform_fn kernel;
 
-	register uint32_t l, n;
-	register uint64_t i;
-        bool in_cds = false;
+	register uint32_t l;
 
-	if (file_set_offset(fa->fa_seqFP, dst->seq_start) != 0) {
-		dP("Failed to seek to position %zu in %p\n", dst->seq_start, fa->fa_seqFP);
+	metrics_add(fa->fa_metrics, syscalls, 1);
+
+	if (file_set_offset(fp, dst->seq_start) != 0) {
+		dP("Failed to seek to position %zu in %p\n", dst->seq_start, fp);
 		return (-1);
 	}
 
@@ -615,136 +1221,134 @@ static int __fasta_read1(FASTA *fa, FASTA_rec_t *dst, atrans_t *atr)
 
 	dP("alloc_size=%zu\n", alloc_size);
 
-	i = 0;
-	dst->seq_mem = malloc(alloc_size);
-        dst->cdseg   = NULL;
-        dst->cdseg_count = 0;
-        dst->cdseg_index = 0;
+	/*
+	 * The lines followed by a new-line, except the last one
+	 */
+	rawlen = (size_t)(dst->seq_lines - 1) * (dst->seq_linew + 1) +
+		(dst->seq_lastw > 0 ? dst->seq_lastw : dst->seq_linew);
 
 	if (atr != NULL) {
 		/*
 		 * An alphabet translation table was defined
-		 * => Read & Translate
+		 * => Read the lines into a buffer & Translate
 		 */
-		bzero(dst->seq_mem, alloc_size);
-
-		buffer = alloc_array(uint8_t, dst->seq_linew);
-		buflen = dst->seq_linew;
+		dst->seq_mem = malloc(alloc_size);
+		raw = alloc_array(uint8_t, rawlen);
+		metrics_add(fa->fa_metrics, allocs, 2);
 
-		for (l = dst->seq_lines - 1; l > 0; --l) {
-			/*
-			 * Read line into buffer
-			 */
-			if (fread(buffer, 1, buflen, fa->fa_seqFP) != buflen) {
-				/* fail */
-				free(buffer);
-				free(dst->seq_mem);
-				dst->seq_mem = NULL;
-
-				return (-1);
-			}
+		if (dst->seq_mem != NULL)
+			bzero(dst->seq_mem, alloc_size);
+	} else {
+		/*
+		 * No alphabet translation defined
+		 * => Read the lines directly into seq_mem
+		 */
+		dst->seq_mem = malloc(rawlen > alloc_size ? rawlen : alloc_size);
+		raw = dst->seq_mem;
+		metrics_add(fa->fa_metrics, allocs, 1);
+	}
 
-			/*
-			 * Copy/Translate the buffer into seq_mem and/or map coding segments
-			 */
-			for (n = 0; n < buflen; ++n) {
-                                /*
-                                 * Update CDS state
-                                 */
-                                if (dst->flags & FASTA_MAPCDSEG)
-                                        __fasta_cdseg_process(fa, dst, buffer[n], &in_cds, i);
+	kernel = __fasta_uniform_kernel[__fasta_kernel(&dc, fa, dst, atr)];
+	metrics_add(fa->fa_metrics, syscalls, 1);
 
-                                /* translate the letter */
-				atrans_letter_s2d(atr, buffer[n], i++, (uint8_t *)dst->seq_mem);
-                        }
+	if (dst->seq_mem == NULL || raw == NULL || fread(raw, 1, rawlen, fp) != rawlen) {
+		/* fail */
+		if (raw != dst->seq_mem)
+			free(raw);
+		free(dst->seq_mem);
+		dst->seq_mem = NULL;
 
-			getc_unlocked(fa->fa_seqFP); /* skip the new-line */
-		}
+		return (-1);
+	}
 
-		buflen = dst->seq_lastw > 0 ? dst->seq_lastw : dst->seq_linew;
-		/* no need to reallocate the buffer since lastw < linew */
+	metrics_add(fa->fa_metrics, bytes_read, rawlen);
+	buflen = dst->seq_linew;
 
-		if (fread(buffer, 1, buflen, fa->fa_seqFP) != buflen) {
-			/* fail */
-			free(buffer);
-			free(dst->seq_mem);
-			dst->seq_mem = NULL;
+	for (l = dst->seq_lines, line = raw; l > 0; --l, line += buflen + 1) {
+		if (l == 1 && dst->seq_lastw > 0)
+			buflen = dst->seq_lastw;
 
-			return (-1);
-		}
+		/* seq_mem + i never follows the line, moving it forward is safe */
+		if (atr == NULL) {
+			memmove(dc.out + dc.i, line, buflen);
+			kernel(&dc, dc.out + dc.i, buflen);
+		} else
+			kernel(&dc, line, buflen);
+	}
 
-		for (n = 0; n < buflen; ++n) {
-                        /* Update CDS state */
-                        if (dst->flags & FASTA_MAPCDSEG)
-                                __fasta_cdseg_process(fa, dst, buffer[n], &in_cds, i);
+	if (atr != NULL)
+		free(raw);
+	else if (rawlen > alloc_size) {
+		dst->seq_mem = realloc_array(dst->seq_mem, uint8_t, alloc_size);
+		metrics_add(fa->fa_metrics, allocs, 1);
+	}
 
-                        /* translate the letter */
-			atrans_letter_s2d(atr, buffer[n], i++, (uint8_t *)dst->seq_mem);
-                }
+	/*
+	 * If there is an open coding segment, this call will finalize it.
+	 */
+	__fasta_kernel_finish(&dc);
 
-                /*
-                 * If there is an open coding segment, this call will finalize it.
-                 */
-                if (dst->flags & FASTA_MAPCDSEG)
-                        __fasta_cdseg_process(fa, dst, 0, &in_cds, i);
+        /* Add an extra \0 byte since a C string is requested */
+	if (dst->flags & FASTA_CSTRSEQ)
+		dst->seq_mem[alloc_size - 1] = '\0';
 
-		free(buffer);
-	} else {
-		/*
-		 * No alphabet translation defined
-		 * => Read
-		 */
-		buflen = dst->seq_linew;
+	return (0);
+}
 
-		for (l = dst->seq_lines - 1; l > 0; --l) {
-			/*
-			 * Read line into buffer
-			 */
-                        dP("l = %u, i=%"PRIu64", buflen=%"PRIu64"\n", l, i, buflen);
+/**
+ * Read the quality string of a FASTQ record following the '+' character
+ * of the separator line. The quality string has to be as long as the
+ * sequence and may span several lines. Returns 1 if the end of the file
+ * follows the record, 0 if another record follows and -1 on error.
+ */
+static int __fastq_qual_read0(scanbuf_t *sb, FASTA_rec_t *dst)
+{
+	register int ch;
+	uint64_t n = 0;
 
-			if (fread(dst->seq_mem + i, 1, buflen, fa->fa_seqFP) != buflen) {
-				/* fail */
-				free(dst->seq_mem);
-				dst->seq_mem = NULL;
+	/*
+	 * The rest of the separator line may repeat the header
+	 */
+	while ((ch = scan_getc(sb)) != '\n')
+		if (ch == EOF)
+			return (-1);
 
-				return (-1);
-			}
+	dst->qual_start  = scan_tell(sb);
+	dst->qual_rawlen = 0;
 
-                        if (dst->flags & FASTA_MAPCDSEG) {
-                                for (n = 0; n < buflen; ++n, ++i)
-                                        __fasta_cdseg_process(fa, dst, dst->seq_mem[i], &in_cds, i);
-                        } else
-                                i += buflen;
+	while (n < dst->seq_len) {
+		ch = scan_getc(sb);
 
-			getc_unlocked(fa->fa_seqFP); /* skip the new-line */
+		if (ch == EOF) {
+			dP("Unexpected EOF: the quality string is shorter than the sequence\n");
+			return (-1);
 		}
 
-		buflen = dst->seq_lastw > 0 ? dst->seq_lastw : dst->seq_linew;
-
-		if (fread(dst->seq_mem + i, 1, buflen, fa->fa_seqFP) != buflen) {
-			/* fail */
-			free(dst->seq_mem);
-			dst->seq_mem = NULL;
+		++dst->qual_rawlen;
 
+		if (ch >= '!' && ch <= '~')
+			++n;
+		else if (ch != '\n') {
+			dP("Unexpected character in the quality string: %u\n", ch);
 			return (-1);
 		}
+	}
 
-                if (dst->flags & FASTA_MAPCDSEG) {
-                        for (n = 0; n < buflen; ++n, ++i)
-                                __fasta_cdseg_process(fa, dst, dst->seq_mem[i], &in_cds, i);
-                } else
-                        i += buflen;
-
-                /*
-                 * If there is an open coding segment, this call will finalize it.
-                 */
-                if (dst->flags & FASTA_MAPCDSEG)
-                        __fasta_cdseg_process(fa, dst, 0, &in_cds, i);
+	switch (ch = scan_getc(sb)) {
+	case EOF:
+		return (1);
+	case '\n':
+		++dst->qual_rawlen;
+		break;
+	default:
+		dP("The quality string is longer than the sequence\n");
+		return (-1);
 	}
 
-        /* Add an extra \0 byte since a C string is requested */
-	if (dst->flags & FASTA_CSTRSEQ)
-		dst->seq_mem[alloc_size - 1] = '\0';
+	if ((ch = scan_getc(sb)) == EOF)
+		return (1);
+
+	scan_ungetc(sb);
 
 	return (0);
 }
@@ -752,17 +1356,22 @@ static int __fasta_read1(FASTA *fa, FASTA_rec_t *dst, atrans_t *atr)
 /**
  * Analyze a sequence record.
  */
-static int __fasta_read0(FILE *fp, FASTA_rec_t *dst, uint32_t options, atrans_t *atr)
+static int __fasta_read0(scanbuf_t *sb, FASTA_rec_t *dst, uint32_t options, atrans_t *atr, FASTA_stats_t *st,
+			  FASTA_hash_t *hash, FASTA_ivals_t *iv, arena_t *arena, FASTA_metrics_t *m)
 {
 	int      ch;
+	bool     eof = false;
 	uint32_t plinew; /* previous line width */
 	uint32_t clinew; /* current line width */
+	uint64_t n_run = 0;
+	hash128_t hs;
+	ival_map_t mp;
 
         (void)atr;
 
         dP("read0\n");
 
-	assert(fp  != NULL);
+	assert(sb  != NULL);
 	assert(dst != NULL);
 
 	dst->flags   = 0;
@@ -773,15 +1382,27 @@ static int __fasta_read0(FILE *fp, FASTA_rec_t *dst, uint32_t options, atrans_t
         dst->cdseg   = NULL;
         dst->cdseg_count = 0;
         dst->cdseg_index = 0;
+	dst->qual_start  = 0;
+	dst->qual_rawlen = 0;
+	dst->qual_mem    = NULL;
+
+	if (st != NULL)
+		memset(st, 0, sizeof(FASTA_stats_t));
+
+	if (hash != NULL)
+		hash128_init(&hs, 0);
+
+	if (iv != NULL)
+		__ival_init(&mp, iv, FASTA_IVAL_ALL);
 
 	plinew = 0;
 	clinew = 0;
 
-	while (!feof_unlocked(fp)) {
+	while (!eof) {
 		/*
 		 * Read & Parse FASTA header(s)
 		 */
-		if (__fahdr_read0(fp, dst) != 0)
+		if (__fahdr_read0(sb, dst, arena, m) != 0)
 			return (-1);
 
 		/*
@@ -801,7 +1422,7 @@ static int __fasta_read0(FILE *fp, FASTA_rec_t *dst, uint32_t options, atrans_t
 			plinew = 0;
 			clinew = 0;
 
-			dst->seq_start  = file_get_offset(fp);
+			dst->seq_start  = scan_tell(sb);
 
 			dst->seq_len    = 0;
 			dst->seq_rawlen = 0;
@@ -814,12 +1435,17 @@ static int __fasta_read0(FILE *fp, FASTA_rec_t *dst, uint32_t options, atrans_t
 			 * Read in the first line of the sequence.
 			 */
 			for (;;) {
-				ch = getc_unlocked(fp);
+				ch = scan_getc(sb);
+
+				if (ch == EOF) {
+					eof = true;
 
-				if (feof_unlocked(fp)) {
 					if (dst->seq_len == 0) {
 						dP("Unexpected EOF: got header, but no sequence data\n");
 						goto fail;
+					} else if (options & FASTA_FASTQ) {
+						dP("Unexpected EOF: got sequence, but no quality string\n");
+						goto fail;
 					} else {
 						++dst->seq_lines;
 						goto finalize_seq;
@@ -832,10 +1458,20 @@ static int __fasta_read0(FILE *fp, FASTA_rec_t *dst, uint32_t options, atrans_t
 				if (issequence(ch)) {
 					++plinew;
 					++dst->seq_len;
+
+					if (st != NULL)
+						__fasta_stats_process(st, ch, &n_run);
+					if (hash != NULL)
+						hash128_byte(&hs, (options & FASTA_HASHFOLD) ? toupper(ch) : ch);
+					if (iv != NULL)
+						__ival_byte(&mp, ch, dst->seq_len - 1);
 				} else {
 					if (ch == '\n' && dst->seq_len > 0) {
 						++dst->seq_lines;
 						break;
+					} else if (ch == '+' && (options & FASTA_FASTQ)) {
+						dP("Unexpected '+': the sequence is empty or not terminated by a new-line\n");
+						goto fail;
 					} else if (isspace(ch) && dst->seq_len == 0) {
 						dst->seq_start += dst->seq_rawlen;
 						dst->seq_rawlen = 0;
@@ -847,9 +1483,16 @@ static int __fasta_read0(FILE *fp, FASTA_rec_t *dst, uint32_t options, atrans_t
 			 * Read the rest of the sequence lines.
 			 */
 			for (;;) {
-				ch = getc_unlocked(fp);
+				ch = scan_getc(sb);
+
+				if (ch == EOF) {
+					eof = true;
+
+					if (options & FASTA_FASTQ) {
+						dP("Unexpected EOF: got sequence, but no quality string\n");
+						goto fail;
+					}
 
-				if (feof_unlocked(fp)) {
 					if (clinew > 0 && !linew_diff)
 						++dst->seq_lines;
 					break;
@@ -872,6 +1515,13 @@ static int __fasta_read0(FILE *fp, FASTA_rec_t *dst, uint32_t options, atrans_t
 					}
 
 					++dst->seq_len;
+
+					if (st != NULL)
+						__fasta_stats_process(st, ch, &n_run);
+					if (hash != NULL)
+						hash128_byte(&hs, (options & FASTA_HASHFOLD) ? toupper(ch) : ch);
+					if (iv != NULL)
+						__ival_byte(&mp, ch, dst->seq_len - 1);
 				} else {
 					switch (ch) {
 					case '\n':
@@ -880,9 +1530,10 @@ static int __fasta_read0(FILE *fp, FASTA_rec_t *dst, uint32_t options, atrans_t
                                                                 /*
                                                                  * Current and previous line width. Set line_diff flag
                                                                  * and continue. This may be the last line of the sequence
-                                                                 * and it is usually shorter.
+                                                                 * and it is usually shorter. A longer line can't be the
+                                                                 * last one of an equal line length record.
                                                                  */
-								if (linew_diff == true || clinew == 0) {
+								if (linew_diff == true || clinew == 0 || clinew > plinew) {
 									linew_update = false;
 									plinew = 0;
                                                                         clinew = 0;
@@ -900,13 +1551,34 @@ static int __fasta_read0(FILE *fp, FASTA_rec_t *dst, uint32_t options, atrans_t
 						break;
 					case  '>':
 						if (clinew == 0 || linew_diff == true) {
-							ungetc('>', fp);
+							scan_ungetc(sb);
 							goto finalize_seq;
 						} else {
 							dP("Unexpected '>': allowed only at the beginning of a line\n");
 							goto fail;
 						}
 						break;
+					case '+':
+						if ((options & FASTA_FASTQ) && (clinew == 0 || linew_diff == true)) {
+							/*
+							 * The separator line isn't a part of the sequence
+							 */
+							--dst->seq_rawlen;
+
+							switch (__fastq_qual_read0(sb, dst)) {
+							case 0:
+								goto finalize_seq;
+							case 1:
+								eof = true;
+								goto finalize_seq;
+							default:
+								goto fail;
+							}
+						} else {
+							dP("Unexpected '+'\n");
+							goto fail;
+						}
+						break;
 					case ' ': /* ignore */
 						if (linew_update) {
 							clinew = 0;
@@ -927,6 +1599,11 @@ static int __fasta_read0(FILE *fp, FASTA_rec_t *dst, uint32_t options, atrans_t
 finalize_seq:
 	dst->seq_linew = plinew;
 	dst->seq_lastw = clinew;
+
+	if (hash != NULL)
+		hash128_final(&hs, hash->h);
+	if (iv != NULL && __ival_finish(&mp, dst->seq_len) != 0)
+		goto fail;
 	dst->flags    |= FASTA_REC_MAGICFL;
 
 	/*
@@ -934,26 +1611,164 @@ finalize_seq:
 	 * ret>0 - EOF (ret=1)
 	 * ret<0 - error
 	 */
-	return (feof_unlocked(fp) ? 1 : 0);
+	return (eof ? 1 : 0);
 fail:
-	if (dst->hdr != NULL)
-		free(dst->hdr);
-	if (dst->hdr_mem != NULL)
-		free(dst->hdr_mem);
+	/*
+	 * The headers are owned by the arena
+	 */
 	if (dst->seq_mem != NULL)
 		free(dst->seq_mem);
+	if (iv != NULL)
+		fasta_ivals_free(iv);
 
 	return (-1);
 }
 
+/**
+ * Make sure there's space for the record `i' in the record array (and
+ * in the statistics and hash arrays, if used).
+ */
+static int __fasta_reserve(FASTA *fa, uint32_t i)
+{
+	uint32_t prev = i == 0 ? 0 : fa->fa_rcount;
+
+	if (i < fa->fa_rcount)
+		return (0);
+
+	dP("=> pre-alloc: fa_rcount=%u\n", fa->fa_rcount);
+
+	if (i == 0)
+		fa->fa_rcount = 8;
+	else if (i < 65535)
+		fa->fa_rcount <<= 1;
+	else
+		fa->fa_rcount += 1024;
+
+	fa->fa_record = realloc_array(fa->fa_record, FASTA_rec_t, fa->fa_rcount);
+	metrics_add(fa->fa_metrics, allocs, 1);
+
+	if (fa->fa_options & FASTA_STATS) {
+		fa->fa_stats = realloc_array(fa->fa_stats, FASTA_stats_t, fa->fa_rcount);
+		metrics_add(fa->fa_metrics, allocs, 1);
+	}
+
+	if (fa->fa_options & FASTA_HASH) {
+		fa->fa_hash = realloc_array(fa->fa_hash, FASTA_hash_t, fa->fa_rcount);
+		metrics_add(fa->fa_metrics, allocs, 1);
+	}
+
+	if (fa->fa_options & FASTA_IVALS) {
+		/*
+		 * The intervals are freed on errors, including those of records
+		 * that weren't loaded yet
+		 */
+		fa->fa_ivals = realloc_array(fa->fa_ivals, FASTA_ivals_t, fa->fa_rcount);
+		memset(fa->fa_ivals + prev, 0, sizeof(FASTA_ivals_t) * (fa->fa_rcount - prev));
+		metrics_add(fa->fa_metrics, allocs, 1);
+	}
+
+	dP("<= pre-alloc: fa_rcount=%u\n", fa->fa_rcount);
+
+	return (0);
+}
+
+/**
+ * Shrink the record array (and the statistics, hash and interval arrays) to `count' records.
+ */
+static void __fasta_shrink(FASTA *fa, uint32_t count)
+{
+	fa->fa_rcount = count;
+	fa->fa_record = realloc_array(fa->fa_record, FASTA_rec_t, fa->fa_rcount);
+
+	if (fa->fa_stats != NULL)
+		fa->fa_stats = realloc_array(fa->fa_stats, FASTA_stats_t, fa->fa_rcount);
+	if (fa->fa_hash != NULL)
+		fa->fa_hash = realloc_array(fa->fa_hash, FASTA_hash_t, fa->fa_rcount);
+	if (fa->fa_ivals != NULL)
+		fa->fa_ivals = realloc_array(fa->fa_ivals, FASTA_ivals_t, fa->fa_rcount);
+}
+
+/**
+ * Free the intervals of all the records.
+ */
+static void __fasta_ivals_free(FASTA *fa)
+{
+	register uint32_t i;
+
+	if (fa->fa_ivals == NULL)
+		return;
+
+	for (i = 0; i < fa->fa_rcount; ++i)
+		fasta_ivals_free(fa->fa_ivals + i);
+
+	free(fa->fa_ivals);
+	fa->fa_ivals = NULL;
+}
+
+/**
+ * Scan the sequence file from the current position of `sb' up to the end
+ * of the file and store the records starting at the index `i'.
+ */
+static int __fasta_scan(FASTA *fa, scanbuf_t *sb, uint32_t i, uint32_t options)
+{
+	int r;
+
+	for (;;) {
+		__fasta_reserve(fa, i);
+		dP("Reading sequence #%u\n", i);
+
+		r = __fasta_read0(sb, fa->fa_record + i, options | (fa->fa_options & (FASTA_HASHFOLD|FASTA_FASTQ)), fa->fa_atr,
+				  fa->fa_stats != NULL ? fa->fa_stats + i : NULL,
+				  fa->fa_hash  != NULL ? fa->fa_hash  + i : NULL,
+				  fa->fa_ivals != NULL ? fa->fa_ivals + i : NULL, fa->fa_arena, fa->fa_metrics);
+		++i;
+
+		if (r != 0)
+			break;
+	}
+
+	if (r < 0) {
+		dP("An error ocured while reading the file \"%s\"\n", fa->fa_path);
+
+		/*
+		 * Decrease `i' to prevent double-free. __fasta_read0 ensures that in
+		 * case of an error the requested fasta record will not be initialized
+		 * and therefore will not need to be freed.
+		 */
+		fa->fa_rcount = --i;
+
+		return (-1);
+	}
+
+	__fasta_shrink(fa, i);
+
+	return (0);
+}
+
 FASTA *fasta_open(const char *path, uint32_t options, atrans_t *atr)
+{
+	return __fasta_open(path, NULL, options, atr);
+}
+
+FASTA *__fasta_open(const char *path, FILE *idxFP, uint32_t options, atrans_t *atr)
 {
 	char   idx_path[PATH_MAX + 1];
 	FASTA *fa;
 	struct stat st;
+	scanbuf_t sb;
+	bool   append = false;
+	bool   slice  = idxFP != NULL;
+	uint64_t t_open, t;
 
 	assert(path != NULL);
 
+	if (options & FASTA_HASHFOLD)
+		options |= FASTA_HASH;
+
+	if (slice)
+		options = (options | FASTA_USEINDEX | FASTA_CHKINDEX_FAST | FASTA_CHKINDEX_FAIL)
+			& ~(FASTA_GENINDEX | FASTA_UPDINDEX | FASTA_CHKINDEX_SLOW | FASTA_SECIDX);
+
 	fa             = alloc_type(FASTA);
 	fa->fa_options = options;
 	fa->fa_path    = strdup(path);
@@ -964,6 +1779,25 @@ FASTA *fasta_open(const char *path, uint32_t options, atrans_t *atr)
 	fa->fa_rcount  = 0;
 	fa->fa_atr     = atr;
         fa->fa_CDSmask = (uint32_t *)__SQ_mask;
+	fa->fa_stats   = NULL;
+	fa->fa_hash    = NULL;
+	fa->fa_ivals   = NULL;
+	fa->fa_arena   = alloc_type(arena_t);
+	fa->fa_metrics = NULL;
+	fa->fa_idindex = NULL;
+	fa->fa_idcount = 0;
+	fa->fa_seqlen  = NULL;
+	fa->fa_secidx  = NULL;
+
+	if (options & FASTA_METRICS) {
+		fa->fa_metrics = alloc_type(FASTA_metrics_t);
+		memset(fa->fa_metrics, 0, sizeof(FASTA_metrics_t));
+	}
+
+	t_open = metrics_start(fa->fa_metrics);
+
+	arena_init(fa->fa_arena, ARENA_CHUNK_SIZE);
+	sb.buf = NULL;
 
         fasta_setCDS(fa, options);
 
@@ -977,6 +1811,25 @@ FASTA *fasta_open(const char *path, uint32_t options, atrans_t *atr)
         setbuf(fa->fa_seqFP, NULL);
 	flockfile(fa->fa_seqFP);
 
+	/*
+	 * The stream is unbuffered because of the random access done by
+	 * fasta_read(). Use a separate read buffer for the scan.
+	 */
+	if (scan_init(&sb, fileno(fa->fa_seqFP), FASTA_SCANBUFFER_SIZE) != 0) {
+		dP("Failed to allocate the scan buffer\n");
+		goto fail;
+	}
+
+	/*
+	 * FASTQ files are recognized by the first character
+	 */
+	if (scan_getc(&sb) == '@') {
+		options        |= FASTA_FASTQ;
+		fa->fa_options |= FASTA_FASTQ;
+	}
+
+	scan_seek(&sb, 0);
+
 	if (file_get_stat(fa->fa_seqFP, &st) != 0) {
 #ifndef NDEBUG
 		int e = errno;
@@ -1006,13 +1859,17 @@ FASTA *fasta_open(const char *path, uint32_t options, atrans_t *atr)
                 /*
                  * Try to open the index file
                  */
-		fa->fa_idxFP = fopen(idx_path,
-				     (options & FASTA_GENINDEX ? "r" : "r+"));
+		if (slice) {
+			fa->fa_idxFP = idxFP;
+			idxFP = NULL;
+		} else
+			fa->fa_idxFP = fopen(idx_path,
+					     (options & FASTA_GENINDEX ? "r" : "r+"));
 
 		if (fa->fa_idxFP == NULL)
 			goto regen;
 
-		flockfile(fa->fa_seqFP);
+		flockfile(fa->fa_idxFP);
 
                 /*
                  * Read the index header and perform simple integrity check
@@ -1024,12 +1881,8 @@ FASTA *fasta_open(const char *path, uint32_t options, atrans_t *atr)
 		default:
 			if (fa->fa_options & FASTA_CHKINDEX_FAIL)
 				goto fail;
-			else {
-				funlockfile(fa->fa_idxFP);
-				fclose(fa->fa_idxFP);
-				fa->fa_idxFP = NULL;
-				goto regen;
-			}
+			else
+				goto stale;
 		}
 
 		dP("Read index header\n"
@@ -1039,51 +1892,112 @@ FASTA *fasta_open(const char *path, uint32_t options, atrans_t *atr)
 
 		if ((uint64_t)st.st_size != idxhdr.filesize) {
 			dP("Recorded (%zu) and actual (%zu) filesizes differ!\n", idxhdr.filesize, st.st_size);
-			funlockfile(fa->fa_idxFP);
-			fclose(fa->fa_idxFP);
-			fa->fa_idxFP = NULL;
-			goto regen;
+
+			if (slice)
+				goto fail;
+
+			/*
+			 * If the file grew, try to index only the appended records. This
+			 * is verified after the indexed records are loaded.
+			 */
+			if ((options & FASTA_UPDINDEX) &&
+			    (uint64_t)st.st_size > idxhdr.filesize &&
+			    (idxhdr.ext & FASTA_IDXEXT_LASTSUM))
+			{
+				append = true;
+
+				/*
+				 * Keep the statistics in the updated index
+				 */
+				if (idxhdr.ext & FASTA_IDXEXT_STATS)
+					fa->fa_options |= FASTA_STATS;
+
+				if (idxhdr.ext & FASTA_IDXEXT_HASH) {
+					fa->fa_options &= ~FASTA_HASHFOLD;
+					fa->fa_options |= FASTA_HASH;
+
+					if (idxhdr.ext & FASTA_IDXEXT_HASHFOLD)
+						fa->fa_options |= FASTA_HASHFOLD;
+				}
+
+				if (idxhdr.ext & FASTA_IDXEXT_IVALS)
+					fa->fa_options |= FASTA_IVALS;
+			} else
+				goto stale;
+		}
+
+		if ((options & FASTA_STATS) && !(idxhdr.ext & FASTA_IDXEXT_STATS)) {
+			dP("The index doesn't contain the requested statistics\n");
+			goto stale;
+		}
+
+		if ((options & FASTA_HASH) &&
+		    (!(idxhdr.ext & FASTA_IDXEXT_HASH) ||
+		     !(idxhdr.ext & FASTA_IDXEXT_HASHFOLD) != !(options & FASTA_HASHFOLD)))
+		{
+			dP("The index doesn't contain the requested hashes\n");
+			goto stale;
+		}
+
+		if (!(options & FASTA_FASTQ) != !(idxhdr.ext & FASTA_IDXEXT_FASTQ)) {
+			dP("The index describes a file of a different format\n");
+			goto stale;
+		}
+
+		if ((options & FASTA_IVALS) && !(idxhdr.ext & FASTA_IDXEXT_IVALS)) {
+			dP("The index doesn't contain the requested intervals\n");
+			goto stale;
 		}
 
 		if (options & FASTA_CHKINDEX_SLOW) {
 			/* slow check */
-		} else if (options & FASTA_CHKINDEX_FAST) {
+		} else if ((options & FASTA_CHKINDEX_FAST) || append) {
                         /*
                          * Perform only check that don't take too much time and load
                          * metadata for the records.
                          */
 			register uint32_t i;
 			int r;
+			off_t idxoff = 0, lastoff = 0;
 
 			i = 0;
 			fa->fa_rcount = 0;
 			fa->fa_record = NULL;
 
-			do {
-				if (i >= fa->fa_rcount) {
-					dP("=> pre-alloc: fa_rcount=%u\n", fa->fa_rcount);
+			t = metrics_start(fa->fa_metrics);
+
+			for (;;) {
+				__fasta_reserve(fa, i);
+				dP("Reading index record #%u\n", i);
 
-					if (i == 0)
-						fa->fa_rcount = 8;
-					else if (i < 65535)
-						fa->fa_rcount <<= 1;
-					else
-						fa->fa_rcount += 1024;
+				/*
+				 * Remember where the last record starts in the index file
+				 */
+				lastoff = idxoff;
+				idxoff  = ftello(fa->fa_idxFP);
 
-					fa->fa_record = realloc_array(fa->fa_record, FASTA_rec_t, fa->fa_rcount);
+				r = __index_read0(fa->fa_idxFP, &sb, fa->fa_record + i,
+						  fa->fa_stats != NULL ? fa->fa_stats + i : NULL,
+						  fa->fa_hash  != NULL ? fa->fa_hash  + i : NULL,
+						  fa->fa_ivals != NULL ? fa->fa_ivals + i : NULL,
+						  fa->fa_arena, fa->fa_metrics);
+				++i;
 
-					dP("<= pre-alloc: fa_rcount=%u\n", fa->fa_rcount);
-				}
+				if (r != 0)
+					break;
+			}
 
-				dP("Reading index record #%u\n", i);
-			} while ((r = __index_read0(fa->fa_idxFP, fa->fa_seqFP, fa->fa_record + i++)) == 0);
 			if (r < 0) {
 				dP("An error ocured while reading the file \"%s\"\n", idx_path);
+				/*
+				 * Don't free the record that failed to load
+				 */
+				__fasta_shrink(fa, i - 1);
 				goto prefail;
 			}
 
-			fa->fa_rcount = --i;
-			fa->fa_record = realloc_array(fa->fa_record, FASTA_rec_t, fa->fa_rcount);
+			__fasta_shrink(fa, --i);
+			metrics_phase(fa->fa_metrics, FASTA_PHASE_INDEX, t);
 
 			if (fa->fa_rcount != idxhdr.rcount) {
 				dP("fa->fa_rcount (%u) != idxhdr.rcount (%u)\n", fa->fa_rcount, idxhdr.rcount);
@@ -1091,71 +2005,85 @@ FASTA *fasta_open(const char *path, uint32_t options, atrans_t *atr)
 				if (fa->fa_options & FASTA_CHKINDEX_FAIL)
 					goto fail;
 				else {
+				stale:
+					/*
+					 * Drop the index and everything loaded from it. A
+					 * slice can't be regenerated on its own.
+					 */
+					if (slice)
+						goto fail;
+
 					funlockfile(fa->fa_idxFP);
 					fclose(fa->fa_idxFP);
 					fa->fa_idxFP = NULL;
 
-					if (fa->fa_rcount > 0) {
-						for (i = 0; i < fa->fa_rcount; ++i)
-							fasta_rec_free(fa->fa_record + i);
+					for (i = 0; i < fa->fa_rcount; ++i)
+						fasta_rec_free(fa->fa_record + i);
 
-						free(fa->fa_record);
+					__fasta_ivals_free(fa);
+					free(fa->fa_record);
+					free(fa->fa_stats);
+					free(fa->fa_hash);
 
-						fa->fa_record = NULL;
-						fa->fa_rcount = 0;
-					}
+					fa->fa_record = NULL;
+					fa->fa_stats  = NULL;
+					fa->fa_hash   = NULL;
+					fa->fa_rcount = 0;
+
+					arena_free(fa->fa_arena);
 
 					goto regen;
 				}
 			}
-		}
-	} else {
-		register uint32_t i;
-		int r;
 
-	regen:
-		/*
-		 * generate headers from the sequence file
-		 */
-		i = 0;
-		fa->fa_rcount = 0;
+			if (append) {
+				uint32_t last = fa->fa_rcount - 1;
 
-		rewind(fa->fa_seqFP);
+				if (__index_appended(fa, &idxhdr) != 0) {
+					dP("The sequence file wasn't only appended to, regenerating the index\n");
+					goto stale;
+				}
 
-		do {
-			if (i >= fa->fa_rcount) {
-				dP("=> pre-alloc: fa_rcount=%u\n", fa->fa_rcount);
+				scan_seek(&sb, idxhdr.filesize);
+				t = metrics_start(fa->fa_metrics);
 
-				if (i == 0)
-					fa->fa_rcount = 8;
-				else if (i < 65535)
-					fa->fa_rcount <<= 1;
-				else
-					fa->fa_rcount += 1024;
+				if (__fasta_scan(fa, &sb, fa->fa_rcount, options) != 0)
+					goto fail;
 
-				fa->fa_record = realloc_array(fa->fa_record, FASTA_rec_t, fa->fa_rcount);
+				metrics_phase(fa->fa_metrics, FASTA_PHASE_SCAN, t);
 
-				dP("<= pre-alloc: fa_rcount=%u\n", fa->fa_rcount);
-			}
+				/*
+				 * The raw length of a record followed by another one includes
+				 * the '>' character of the next record
+				 */
+				if (!(fa->fa_options & FASTA_FASTQ))
+					++fa->fa_record[last].seq_rawlen;
 
-			dP("Reading sequence #%u\n", i);
-		} while ((r = __fasta_read0(fa->fa_seqFP, fa->fa_record + i++, options, fa->fa_atr)) == 0);
+				funlockfile(fa->fa_idxFP);
+				fclose(fa->fa_idxFP);
+				fa->fa_idxFP = NULL;
 
-		if (r < 0) {
-			dP("An error ocured while reading the file \"%s\"\n", fa->fa_path);
+				/*
+				 * Rewrite the index starting from the previously last record
+				 */
+				if (__index_append(fa, idx_path, last, lastoff) != 0)
+					dP("Failed to update the index \"%s\"\n", idx_path);
+			}
+		}
+	} else {
+	regen:
+		/*
+		 * generate headers from the sequence file
+		 */
+		fa->fa_rcount = 0;
 
-			/*
-			 * Decrease `i' to prevent double-free. __fasta_read0 ensures that in
-			 * case of an error the requested fasta record will not be initialized
-			 * and therefore will not need to be freed.
-			 */
-			fa->fa_rcount = --i;
+		scan_seek(&sb, 0);
+		t = metrics_start(fa->fa_metrics);
 
+		if (__fasta_scan(fa, &sb, 0, options) != 0)
 			goto fail;
-		}
 
-		fa->fa_rcount = i;
-		fa->fa_record = realloc_array(fa->fa_record, FASTA_rec_t, fa->fa_rcount);
+		metrics_phase(fa->fa_metrics, FASTA_PHASE_SCAN, t);
 
                 /*
                  * Save the index if the GENINDEX flag is set. This will create non-exising and
@@ -1165,6 +2093,17 @@ FASTA *fasta_open(const char *path, uint32_t options, atrans_t *atr)
 			__index_write(fa, idx_path);
 	}
 
+	if ((options & FASTA_SECIDX) && __secidx_open(fa, options) != 0) {
+		dP("Failed to load or build the secondary indexes\n");
+		goto fail;
+	}
+
+	metrics_add(fa->fa_metrics, syscalls, sb.nreads);
+	metrics_add(fa->fa_metrics, bytes_read, sb.nbytes);
+	metrics_add(fa->fa_metrics, cache_hits, sb.nhits);
+	metrics_add(fa->fa_metrics, allocs, fa->fa_arena->nchunks);
+
+	scan_free(&sb);
 	funlockfile(fa->fa_seqFP);
 
 	if (fa->fa_idxFP != NULL)
@@ -1178,8 +2117,14 @@ FASTA *fasta_open(const char *path, uint32_t options, atrans_t *atr)
 
 		fa->fa_seqFP = NULL;
 		fa->fa_idxFP = NULL;
+	} else if (slice && fa->fa_idxFP != NULL) {
+		/* the slice stream is of no use after the index was loaded */
+		fclose(fa->fa_idxFP);
+		fa->fa_idxFP = NULL;
 	}
 
+	metrics_phase(fa->fa_metrics, FASTA_PHASE_OPEN, t_open);
+
 	return (fa);
 fail:
 	for (; fa->fa_rcount > 0; --fa->fa_rcount)
@@ -1195,6 +2140,19 @@ fail:
 		fclose(fa->fa_idxFP);
 	}
 
+	if (idxFP != NULL)
+		fclose(idxFP);
+
+	scan_free(&sb);
+	arena_free(fa->fa_arena);
+
+	__fasta_ivals_free(fa);
+	free(fa->fa_record);
+	free(fa->fa_stats);
+	free(fa->fa_hash);
+	free(fa->fa_arena);
+	free(fa->fa_metrics);
+	free(fa->fa_path);
 	free(fa);
 
 	return (NULL);
@@ -1205,6 +2163,244 @@ uint32_t fasta_count(FASTA *fa)
 	return (fa->fa_rcount);
 }
 
+const FASTA_stats_t *fasta_stats(FASTA *fa, uint32_t recno)
+{
+	assert(fa != NULL);
+
+	if (fa->fa_stats == NULL) {
+		errno = ENOENT;
+		return (NULL);
+	}
+
+	if (recno >= fa->fa_rcount) {
+		errno = ERANGE;
+		return (NULL);
+	}
+
+	return (fa->fa_stats + recno);
+}
+
+const FASTA_hash_t *fasta_hash(FASTA *fa, uint32_t recno)
+{
+	assert(fa != NULL);
+
+	if (fa->fa_hash == NULL) {
+		errno = ENOENT;
+		return (NULL);
+	}
+
+	if (recno >= fa->fa_rcount) {
+		errno = ERANGE;
+		return (NULL);
+	}
+
+	return (fa->fa_hash + recno);
+}
+
+const FASTA_ivals_t *fasta_intervals(FASTA *fa, uint32_t recno)
+{
+	assert(fa != NULL);
+
+	if (fa->fa_ivals == NULL) {
+		errno = ENOENT;
+		return (NULL);
+	}
+
+	if (recno >= fa->fa_rcount) {
+		errno = ERANGE;
+		return (NULL);
+	}
+
+	return (fa->fa_ivals + recno);
+}
+
+uint32_t *fasta_duplicates(FASTA *fa, uint32_t *unique)
+{
+	uint32_t *dup, *slot, i, cnt = 0;
+	uint64_t  mask;
+
+	assert(fa != NULL);
+
+	if (fa->fa_hash == NULL) {
+		errno = ENOENT;
+		return (NULL);
+	}
+
+	dup = alloc_array(uint32_t, fa->fa_rcount > 0 ? fa->fa_rcount : 1);
+
+	if (dup == NULL)
+		return (NULL);
+
+	/*
+	 * Open addressing table of the first records of each group, at most
+	 * half full. The hash itself is used to pick the bucket.
+	 */
+	for (mask = 1; mask < 2 * (uint64_t)fa->fa_rcount; mask <<= 1);
+
+	if (mask > SIZE_MAX / sizeof(uint32_t)) {
+		free(dup);
+		errno = ENOMEM;
+		return (NULL);
+	}
+
+	slot = alloc_array(uint32_t, mask);
+
+	if (slot == NULL) {
+		free(dup);
+		return (NULL);
+	}
+
+	memset(slot, 0xff, sizeof(uint32_t) * (size_t)mask);
+	--mask;
+
+	for (i = 0; i < fa->fa_rcount; ++i) {
+		const FASTA_hash_t *h = fa->fa_hash + i;
+		uint64_t b = h->h[0] & mask;
+
+		while (slot[b] != UINT32_MAX) {
+			const FASTA_hash_t *o = fa->fa_hash + slot[b];
+
+			if (o->h[0] == h->h[0] && o->h[1] == h->h[1] &&
+			    fa->fa_record[slot[b]].seq_len == fa->fa_record[i].seq_len)
+				break;
+
+			b = (b + 1) & mask;
+		}
+
+		if (slot[b] == UINT32_MAX) {
+			slot[b] = i;
+			++cnt;
+		}
+
+		dup[i] = slot[b];
+	}
+
+	free(slot);
+
+	if (unique != NULL)
+		*unique = cnt;
+
+	return (dup);
+}
+
+int fasta_get_metrics(FASTA *fa, FASTA_metrics_t *m)
+{
+	assert(fa != NULL);
+	assert(m  != NULL);
+
+	if (fa->fa_metrics == NULL) {
+		errno = ENOENT;
+		return (-1);
+	}
+
+	memcpy(m, fa->fa_metrics, sizeof(FASTA_metrics_t));
+
+	return (0);
+}
+
+const char *fasta_metrics_phase_name(FASTA_phase_t phase)
+{
+	static const char *names[FASTA_PHASE_COUNT] = {
+		[FASTA_PHASE_OPEN]   = "open",
+		[FASTA_PHASE_SCAN]   = "scan",
+		[FASTA_PHASE_INDEX]  = "index",
+		[FASTA_PHASE_HEADER] = "header",
+		[FASTA_PHASE_READ]   = "read",
+		[FASTA_PHASE_DECODE] = "decode"
+	};
+
+	if ((unsigned int)phase >= FASTA_PHASE_COUNT)
+		return (NULL);
+
+	return (names[phase]);
+}
+
+typedef struct {
+	const char *id;
+	uint32_t    recno;
+} __idpair_t;
+
+static int __idcmp(const void *a, const void *b)
+{
+	const __idpair_t *x = a, *y = b;
+	int r = strcmp(x->id, y->id);
+
+	if (r != 0)
+		return (r);
+
+	return (x->recno > y->recno) - (x->recno < y->recno);
+}
+
+/**
+ * Build the array of record numbers sorted by the record IDs.
+ */
+static int __idindex_build(FASTA *fa)
+{
+	__idpair_t  *pair;
+	FASTA_rec_t *rec;
+	uint32_t     i, n;
+
+	pair = alloc_array(__idpair_t, fa->fa_rcount > 0 ? fa->fa_rcount : 1);
+	fa->fa_idindex = alloc_array(uint32_t, fa->fa_rcount > 0 ? fa->fa_rcount : 1);
+
+	if (pair == NULL || fa->fa_idindex == NULL) {
+		free(pair);
+		free(fa->fa_idindex);
+		fa->fa_idindex = NULL;
+		return (-1);
+	}
+
+	for (i = 0, n = 0; i < fa->fa_rcount; ++i) {
+		rec = fa->fa_record + i;
+
+		if (rec->hdr_cnt == 0 || rec->hdr[0].seqid_fmt == SEQID_EMPTY || rec->rec_id == NULL)
+			continue;
+
+		pair[n].id    = rec->rec_id;
+		pair[n].recno = i;
+		++n;
+	}
+
+	qsort(pair, n, sizeof(__idpair_t), __idcmp);
+
+	for (i = 0; i < n; ++i)
+		fa->fa_idindex[i] = pair[i].recno;
+
+	fa->fa_idcount = n;
+	free(pair);
+
+	return (0);
+}
+
+int fasta_lookup_id(FASTA *fa, const char *id, uint32_t *recno)
+{
+	uint32_t l, h, m;
+
+	assert(fa != NULL);
+	assert(id != NULL);
+
+	if (fa->fa_idindex == NULL && __idindex_build(fa) != 0)
+		return (-1);
+
+	/* lower bound */
+	for (l = 0, h = fa->fa_idcount; l < h;) {
+		m = l + (h - l) / 2;
+
+		if (strcmp(fa->fa_record[fa->fa_idindex[m]].rec_id, id) < 0)
+			l = m + 1;
+		else
+			h = m;
+	}
+
+	if (l == fa->fa_idcount || strcmp(fa->fa_record[fa->fa_idindex[l]].rec_id, id) != 0)
+		return (1);
+
+	if (recno != NULL)
+		*recno = fa->fa_idindex[l];
+
+	return (0);
+}
+
 int fasta_setCDS(FASTA *fa, uint32_t cds_flags)
 {
         assert(fa != NULL);
@@ -1245,40 +2441,27 @@ int fasta_setCDS_string(FASTA *fa, const char *letters)
 }
 
 
-FASTA_rec_t *fasta_read(FASTA *fa, FASTA_rec_t *dst, uint32_t flags, atrans_t *atr)
+FASTA_rec_t *__fasta_read_record(FASTA *fa, FILE *fp, uint32_t recno, FASTA_rec_t *dst, uint32_t flags, atrans_t *atr)
 {
 	FASTA_rec_t *farec;
 
 	assert(fa != NULL);
-
-	if (fa->fa_rindex >= fa->fa_rcount)
-		return (NULL);
-
-	if (atr == NULL)
-		atr = fa->fa_atr;
-
-	if (fa->fa_seqFP == NULL) {
-		fa->fa_seqFP = fopen(fa->fa_path, "r");
-
-		if (fa->fa_seqFP == NULL) {
-			dP("Can't re-open the sequence file: %s\n", fa->fa_path);
-			return (NULL);
-		}
-
-		flockfile(fa->fa_seqFP);
-	}
+	assert(fp != NULL);
+	assert(recno < fa->fa_rcount);
 
 	if (dst == NULL) {
 		if (flags & FASTA_RAWREC)
-			farec = fa->fa_record + fa->fa_rindex;
+			farec = fa->fa_record + recno;
 		else {
 			farec = alloc_type(FASTA_rec_t);
-			memcpy(farec, fa->fa_record + fa->fa_rindex, sizeof(FASTA_rec_t));
+			memcpy(farec, fa->fa_record + recno, sizeof(FASTA_rec_t));
 			farec->flags = FASTA_REC_MAGICFL | FASTA_REC_FREEREC;
+
+			metrics_add(fa->fa_metrics, allocs, 1);
 		}
 	} else {
 		farec = dst;
-		memcpy(farec, fa->fa_record + fa->fa_rindex, sizeof(FASTA_rec_t));
+		memcpy(farec, fa->fa_record + recno, sizeof(FASTA_rec_t));
 		farec->flags = FASTA_REC_MAGICFL;
 	}
 
@@ -1289,41 +2472,231 @@ FASTA_rec_t *fasta_read(FASTA *fa, FASTA_rec_t *dst, uint32_t flags, atrans_t *a
 		farec->flags |= FASTA_CSTRSEQ;
 
 	if ((flags & FASTA_INMEMSEQ) && farec->seq_mem == NULL) {
+		int r;
+		uint64_t t = metrics_start(fa->fa_metrics);
+
 		farec->flags |= FASTA_REC_FREESEQ;
 
 		if (farec->seq_linew != 0) {
 			/*
 			 * all the lines that form the sequence are of equal length
 			 */
-			if (__fasta_read1(fa, farec, atr) != 0) {
-				/* fail */
-				fasta_rec_free(farec);
-				farec = NULL;
-			} else
-				++fa->fa_rindex;
+			r = __fasta_read1(fa, fp, farec, atr);
 		} else {
 			/*
 			 * the lines have variable length, we have to look for new-lines
 			 */
-			if (__fasta_read2(fa, farec, atr) != 0) {
-				/* fail */
-				fasta_rec_free(farec);
-				farec = NULL;
-			} else
-				++fa->fa_rindex;
+			r = __fasta_read2(fa, fp, farec, atr);
+		}
+
+		/*
+		 * The quality string of a FASTQ record is never translated
+		 */
+		if (r == 0 && farec->qual_rawlen > 0)
+			r = __fastq_read_qual(fa, fp, farec);
+
+		if (r != 0) {
+			/* fail */
+			fasta_rec_free(farec);
+			farec = NULL;
+		} else if (fa->fa_metrics != NULL) {
+			metrics_phase(fa->fa_metrics, FASTA_PHASE_DECODE, t);
+			metrics_add(fa->fa_metrics, records, 1);
+			metrics_add(fa->fa_metrics, cdsegs, farec->cdseg_count);
+
+			if (atr != NULL)
+				metrics_add(fa->fa_metrics, translated, 1);
+		}
+	} else if (flags & FASTA_INMEMSEQ)
+		metrics_add(fa->fa_metrics, cache_hits, 1);
+
+	return (farec);
+}
+
+/**
+ * Re-open the sequence file if it was closed after the previous read.
+ */
+static int __fasta_seqFP_open(FASTA *fa)
+{
+	if (fa->fa_seqFP == NULL) {
+		fa->fa_seqFP = fopen(fa->fa_path, "r");
+		metrics_add(fa->fa_metrics, syscalls, 1);
+
+		if (fa->fa_seqFP == NULL) {
+			dP("Can't re-open the sequence file: %s\n", fa->fa_path);
+			return (-1);
 		}
+
+		/* see fasta_open() */
+		setbuf(fa->fa_seqFP, NULL);
+		flockfile(fa->fa_seqFP);
 	}
 
+	return (0);
+}
+
+/**
+ * Close the sequence file unless it has to be kept open.
+ */
+static void __fasta_seqFP_release(FASTA *fa, uint32_t flags)
+{
 	funlockfile(fa->fa_seqFP);
 
 	if (!((fa->fa_options | flags) & FASTA_KEEPOPEN)) {
 		fclose(fa->fa_seqFP);
 		fa->fa_seqFP = NULL;
+		metrics_add(fa->fa_metrics, syscalls, 1);
 	}
+}
+
+FASTA_rec_t *fasta_read(FASTA *fa, FASTA_rec_t *dst, uint32_t flags, atrans_t *atr)
+{
+	FASTA_rec_t *farec;
+	uint64_t     t;
+
+	assert(fa != NULL);
+
+	if (fa->fa_rindex >= fa->fa_rcount)
+		return (NULL);
+
+	if (atr == NULL)
+		atr = fa->fa_atr;
+
+	t = metrics_start(fa->fa_metrics);
+
+	if (__fasta_seqFP_open(fa) != 0)
+		return (NULL);
+
+	farec = __fasta_read_record(fa, fa->fa_seqFP, fa->fa_rindex, dst, flags, atr);
+
+	if (farec != NULL && (flags & FASTA_INMEMSEQ))
+		++fa->fa_rindex;
+
+	__fasta_seqFP_release(fa, flags);
+	metrics_phase(fa->fa_metrics, FASTA_PHASE_READ, t);
 
 	return (farec);
 }
 
+/**
+ * Read `len' bytes at `off' of the sequence file into `buf'.
+ */
+static int __fasta_read_raw(FASTA *fa, uint8_t *buf, uint64_t len, uint64_t off)
+{
+	metrics_add(fa->fa_metrics, syscalls, 1);
+
+	if (file_set_offset(fa->fa_seqFP, off) != 0) {
+		dP("Failed to seek to position %"PRIu64" in %p\n", off, fa->fa_seqFP);
+		return (-1);
+	}
+
+	metrics_add(fa->fa_metrics, syscalls, 1);
+
+	if (fread(buf, 1, len, fa->fa_seqFP) != len)
+		return (-1);
+
+	metrics_add(fa->fa_metrics, bytes_read, len);
+
+	return (0);
+}
+
+int fasta_read_buf(FASTA *fa, FASTA_rec_t *dst, uint8_t **buf, size_t *size, uint32_t flags, atrans_t *atr)
+{
+	const FASTA_rec_t *rec;
+	uint64_t seq_size, qual_size, need, t, d;
+	uint8_t *raw;
+	int r = -1;
+
+	assert(fa   != NULL);
+	assert(dst  != NULL);
+	assert(buf  != NULL);
+	assert(size != NULL);
+
+	if (fa->fa_rindex >= fa->fa_rcount)
+		return (1);
+
+	if (atr == NULL)
+		atr = fa->fa_atr;
+
+	t   = metrics_start(fa->fa_metrics);
+	rec = fa->fa_record + fa->fa_rindex;
+
+	/*
+	 * The buffer holds the decoded sequence, the quality string and the
+	 * raw data of the longer of the two, which are decoded from there
+	 */
+	seq_size  = (atr != NULL ? atrans_s2d_size(atr, rec->seq_len) : rec->seq_len) + 1;
+	qual_size = rec->qual_rawlen > 0 ? rec->seq_len + 1 : 0;
+	need      = seq_size + qual_size + (rec->seq_rawlen > rec->qual_rawlen ? rec->seq_rawlen : rec->qual_rawlen);
+
+	if (need > *size) {
+		uint8_t *tmp = realloc_array(*buf, uint8_t, need);
+
+		if (tmp == NULL)
+			return (-1);
+
+		*buf  = tmp;
+		*size = need;
+		metrics_add(fa->fa_metrics, allocs, 1);
+	}
+
+	if (__fasta_seqFP_open(fa) != 0)
+		return (-1);
+
+	/*
+	 * The coding segments of the previous record read into `dst'
+	 */
+	free(dst->cdseg);
+
+	memcpy(dst, rec, sizeof(FASTA_rec_t));
+	dst->flags    = FASTA_REC_MAGICFL | (flags & (FASTA_CSTRSEQ|FASTA_MAPCDSEG));
+	dst->seq_mem  = *buf;
+	dst->qual_mem = qual_size > 0 ? *buf + seq_size : NULL;
+	raw = *buf + seq_size + qual_size;
+
+	if (atr != NULL)
+		memset(dst->seq_mem, 0, seq_size);
+
+	d = metrics_start(fa->fa_metrics);
+
+	if (__fasta_read_raw(fa, raw, rec->seq_rawlen, rec->seq_start) != 0 ||
+	    __fasta_decode(fa, raw, rec->seq_rawlen, dst, atr) != 0)
+		goto finish;
+
+	/*
+	 * The quality string of a FASTQ record is never translated
+	 */
+	if (qual_size > 0 &&
+	    (__fasta_read_raw(fa, raw, rec->qual_rawlen, rec->qual_start) != 0 ||
+	     __fastq_decode_qual(raw, rec->qual_rawlen, dst) != 0))
+	{
+		free(dst->cdseg);
+		dst->cdseg       = NULL;
+		dst->cdseg_count = 0;
+		goto finish;
+	}
+
+	++fa->fa_rindex;
+	r = 0;
+
+	metrics_phase(fa->fa_metrics, FASTA_PHASE_DECODE, d);
+	metrics_add(fa->fa_metrics, records, 1);
+	metrics_add(fa->fa_metrics, cdsegs, dst->cdseg_count);
+
+	if (atr != NULL)
+		metrics_add(fa->fa_metrics, translated, 1);
+finish:
+	if (r != 0) {
+		dst->seq_mem  = NULL;
+		dst->qual_mem = NULL;
+	}
+
+	__fasta_seqFP_release(fa, flags);
+	metrics_phase(fa->fa_metrics, FASTA_PHASE_READ, t);
+
+	return (r);
+}
+
 int fasta_write(FASTA *fa, FASTA_rec_t *farec)
 {
         (void)fa;
@@ -1336,22 +2709,19 @@ int fasta_write(FASTA *fa, FASTA_rec_t *farec)
 
 void fasta_rec_free(FASTA_rec_t *farec)
 {
-	if (farec->flags & FASTA_REC_FREEHDR) {
-		free(farec->hdr_mem);
-		free(farec->hdr);
-		farec->hdr     = NULL;
-		farec->hdr_cnt = 0;
-		farec->flags  &= ~(FASTA_REC_FREEHDR);
-	}
-
 	if (farec->flags & FASTA_REC_FREESEQ) {
 		free(farec->seq_mem);
-		farec->seq_mem = NULL;
+		free(farec->qual_mem);
+		farec->seq_mem  = NULL;
+		farec->qual_mem = NULL;
 		farec->flags  &= ~(FASTA_REC_FREESEQ);
 	}
 
-        if (farec->cdseg != NULL)
+        if (farec->cdseg != NULL) {
                 free(farec->cdseg);
+                farec->cdseg       = NULL;
+                farec->cdseg_count = 0;
+        }
 
 	if (farec->flags & FASTA_REC_FREEREC) {
 		farec->flags = 0;
@@ -1506,8 +2876,6 @@ void *fasta_apply(FASTA *fa, void * (*func)(FASTA_rec_t *, void *), uint32_t opt
 	uint32_t      resnum, i;
 	FASTA_rec_t  *farec;
 
-        (void)options;
-
 	resnum = fasta_count(fa);
 
 	if (resnum == 0 || fasta_rewind(fa) != 0)
@@ -1515,6 +2883,18 @@ void *fasta_apply(FASTA *fa, void * (*func)(FASTA_rec_t *, void *), uint32_t opt
 
 	result = (void **) alloc_array(void *, resnum);
 
+	if (result == NULL)
+		return (NULL);
+
+	if ((options & FASTA_PARALLEL) && resnum > 1) {
+		if (__fasta_apply_parallel(fa, func, funcarg, result) != 0) {
+			free(result);
+			return (NULL);
+		}
+
+		return (result);
+	}
+
 	for (i = 0; i < resnum; ++i) {
 		farec     = fasta_read(fa, NULL, FASTA_INMEMSEQ|FASTA_CSTRSEQ, NULL);
 		result[i] = func(farec, funcarg);
@@ -1526,6 +2906,8 @@ void *fasta_apply(FASTA *fa, void * (*func)(FASTA_rec_t *, void *), uint32_t opt
 
 void fasta_close(FASTA *fa)
 {
+	__fasta_ivals_free(fa);
+
 	if (fa->fa_record != NULL) {
 		for (; fa->fa_rcount > 0; --fa->fa_rcount)
 			fasta_rec_free(fa->fa_record + fa->fa_rcount - 1);
@@ -1533,6 +2915,15 @@ void fasta_close(FASTA *fa)
 	}
 
 	free(fa->fa_path);
+	free(fa->fa_stats);
+	free(fa->fa_hash);
+	free(fa->fa_idindex);
+	free(fa->fa_seqlen);
+	__secidx_free(fa);
+
+	arena_free(fa->fa_arena);
+	free(fa->fa_arena);
+	free(fa->fa_metrics);
 
         if (fa->fa_options & FASTA_CDSFREEMASK)
                 free(fa->fa_CDSmask);
@@ -55,19 +55,43 @@ extern "C" {
 #define FASTA_NASEQ         0x00008000 /**< Prepare to read an NA sequence */
 #define FASTA_AASEQ         0x00010000 /**< Prepere to read an AA sequence */
 #define FASTA_CDSFREEMASK   0x00020000 /**< Free the fa_CDSmask pointer */
+#define FASTA_STATS         0x00040000 /**< Gather per-record composition statistics (see fasta_stats()) */
+#define FASTA_UPDINDEX      0x00080000 /**< Update the index in place if records were only appended to the sequence file */
+#define FASTA_METRICS       0x00100000 /**< Collect runtime metrics (see fasta_get_metrics()) */
+#define FASTA_HASH          0x00200000 /**< Compute a content hash of each sequence (see fasta_hash()) */
+#define FASTA_HASHFOLD      0x00400000 /**< Ignore the case of the letters when hashing, implies FASTA_HASH */
+#define FASTA_IVALS         0x00800000 /**< Map the soft-masked, gap and IUPAC intervals of each record (see fasta_intervals()) */
+#define FASTA_FASTQ         0x01000000 /**< The file is in the FASTQ format (set automatically if the file starts with '@') */
+#define FASTA_SECIDX        0x02000000 /**< Load or build the secondary indexes of the record table (see fasta_index_length()) */
 
 #define FASTA_INDEX_EXT ".index" /**< filename.fa.index */
+#define FASTA_SECIDX_EXT ".sindex" /**< filename.fa.sindex, secondary indexes */
+
+#define FASTA_IVAL_LOWER   0x01 /**< Runs of lowercase (soft-masked) letters */
+#define FASTA_IVAL_GAP     0x02 /**< Runs of N letters and gaps ('-') */
+#define FASTA_IVAL_IUPAC   0x04 /**< Runs of IUPAC ambiguity codes other than N (B, D, H, K, M, R, S, V, W, Y) */
+#define FASTA_IVAL_ALL     0x07
+#define FASTA_IVAL_CLASSES 3    /**< ival[k] holds the intervals of the class (1 << k) */
+
+#define FASTA_FETCH_GAP   65536   /**< Max. gap between records read at once by fasta_fetch_ids() */
+#define FASTA_FETCH_BLOCK 4194304 /**< Max. size of a merged read done by fasta_fetch_ids() */
+
+#define FASTA_EXPORT_HEADER   0x00000001 /**< fasta_export_fd(): write the header line before the sequence */
+#define FASTA_EXPORT_KEEPWRAP 0x00000002 /**< fasta_export_fd(): keep the line breaks of the source file */
 
 #define FASTA_EUNEXPEOF 1
 #define FASTA_EINVAL    2
 #define FASTA_ENOBUF    3
 
 #define FASTA_LINEBUFFER_SIZE 4096
+#define FASTA_SCANBUFFER_SIZE 262144 /**< read buffer size used when scanning the sequence file */
 
         typedef struct {
                 uint64_t filesize; /**< filesize of the sequence file */
                 uint32_t chksum; /**< checksum (CRC-32) of the sequence file */
                 uint32_t rcount; /**< expected count of FASTA records */
+                uint32_t ext;    /**< optional per-record data stored in the index */
+                uint32_t lastsum; /**< checksum (CRC-32) of the last indexed record */
         } FASTA_idxhdr_t;
 
 #include "seqid.h"
@@ -88,7 +112,7 @@ extern "C" {
 
 #define FASTA_REC_MAGICFL 0xf0fa0000
 #define FASTA_REC_FREESEQ 0x00000001 /**< Allowed to free the sequence memory */
-#define FASTA_REC_FREEHDR 0x00000002 /**< Allowed to free the headers */
+#define FASTA_REC_FREEHDR 0x00000002 /**< Unused, the headers are owned by the database (kept for compatibility) */
 #define FASTA_REC_FREEREC 0x00000004 /**< Allowed to free the memory holding the FASTA record (FASTA_rec_t *) */
 
         typedef struct {
@@ -113,11 +137,93 @@ extern "C" {
 
                 uint8_t  *seq_mem;  /**< in-memory sequence data */
 
+                uint64_t  qual_start;  /**< quality string file offset (FASTQ) */
+                uint64_t  qual_rawlen; /**< raw quality string length (FASTQ, 0 for FASTA records) */
+                uint8_t  *qual_mem;    /**< in-memory quality string of seq_len letters (FASTQ) */
+
                 FASTA_u64p *cdseg;  /**< coding segment boundaries */
                 size_t      cdseg_count; /**< number of coding segments in this record */
                 size_t      cdseg_index; /**< index of the next cdseg that will be returned by read_CDS */
         } FASTA_rec_t;
 
+        /**
+         * Composition statistics of a record, gathered while scanning the
+         * file if the FASTA_STATS option is used.
+         */
+        typedef struct {
+                uint64_t residue[26]; /**< histogram of the letters A-Z (case insensitive) */
+                uint64_t gap;         /**< number of '-' characters */
+                uint64_t gc;          /**< number of G and C letters */
+                uint64_t n;           /**< number of N letters */
+                uint64_t lower;       /**< number of lowercase letters */
+                uint64_t n_run;       /**< length of the longest run of N letters */
+        } FASTA_stats_t;
+
+        /**
+         * 128-bit hash of the residues of a record (without new-lines and
+         * spaces), computed while scanning the file if the FASTA_HASH option
+         * is used.
+         */
+        typedef struct {
+                uint64_t h[2];
+        } FASTA_hash_t;
+
+        /**
+         * Intervals of the letter classes FASTA_IVAL_* of a record. The
+         * intervals are sorted and use the same inclusive residue positions
+         * as the coding segments.
+         */
+        typedef struct {
+                FASTA_u64p *ival[FASTA_IVAL_CLASSES];  /**< intervals of each class, NULL if there are none */
+                uint32_t    count[FASTA_IVAL_CLASSES]; /**< number of intervals of each class */
+        } FASTA_ivals_t;
+
+        /**
+         * Predicates evaluated by fasta_select() on the record table, without
+         * reading any sequence data. A record is selected if it satisfies all
+         * of them; the zero-initialized structure selects every record.
+         */
+        typedef struct {
+                uint64_t    len_min;   /**< minimum sequence length */
+                uint64_t    len_max;   /**< maximum sequence length, 0 for no limit */
+                uint32_t    seqid_fmt; /**< accepted SeqID formats of the first header, FASTA_FILTER_SEQID(SEQID_*) ORed together, 0 for any */
+                const char *id_glob;   /**< fnmatch(3) pattern the record ID has to match, NULL for any */
+        } FASTA_filter_t;
+
+#define FASTA_FILTER_SEQID(fmt) (UINT32_C(1) << (fmt))
+
+        /**
+         * Phases of the processing measured if the FASTA_METRICS option is used.
+         */
+        typedef enum {
+                FASTA_PHASE_OPEN,   /**< fasta_open() */
+                FASTA_PHASE_SCAN,   /**< scanning of the sequence file */
+                FASTA_PHASE_INDEX,  /**< loading of the index */
+                FASTA_PHASE_HEADER, /**< reading and parsing of a record header */
+                FASTA_PHASE_READ,   /**< fasta_read() */
+                FASTA_PHASE_DECODE, /**< reading of a sequence into memory, including translation and CDS mapping */
+                FASTA_PHASE_COUNT
+        } FASTA_phase_t;
+
+#define FASTA_METRICS_BUCKETS 64 /**< bucket `i' of a histogram counts durations in the range [2^i, 2^(i+1)) ns */
+
+        /**
+         * Runtime metrics of a FASTA db. All the values are monotonic counters.
+         */
+        typedef struct {
+                uint64_t bytes_read;  /**< bytes read from the sequence file */
+                uint64_t syscalls;    /**< open, close, read and seek calls issued on the sequence file */
+                uint64_t allocs;      /**< heap allocations and reallocations */
+                uint64_t records;     /**< records read into memory */
+                uint64_t translated;  /**< records translated using an alphabet translation table */
+                uint64_t cdsegs;      /**< mapped coding segments */
+                uint64_t cache_hits;  /**< requests served from memory without I/O */
+
+                uint64_t phase_ns[FASTA_PHASE_COUNT];    /**< time spent in each phase */
+                uint64_t phase_count[FASTA_PHASE_COUNT]; /**< number of measurements of each phase */
+                uint64_t phase_hist[FASTA_PHASE_COUNT][FASTA_METRICS_BUCKETS]; /**< log2 histograms of the durations */
+        } FASTA_metrics_t;
+
         typedef struct {
                 uint32_t     flags;
                 FASTA_rec_t *farec;   /**< pointer to the associated FASTA record */
@@ -140,6 +246,16 @@ extern "C" {
                 uint32_t     fa_rcount; /**< Number of records */
 
                 uint32_t    *fa_CDSmask; /**< A bitmap defining which letter are considered as coding */
+
+                FASTA_stats_t *fa_stats; /**< Per-record statistics (FASTA_STATS), NULL if not gathered */
+                FASTA_hash_t  *fa_hash;  /**< Per-record content hashes (FASTA_HASH), NULL if not computed */
+                FASTA_ivals_t *fa_ivals; /**< Per-record letter class intervals (FASTA_IVALS), NULL if not mapped */
+                struct fasta_arena *fa_arena; /**< Storage of the record headers */
+                FASTA_metrics_t *fa_metrics; /**< Runtime metrics (FASTA_METRICS), NULL if not collected */
+                uint32_t        *fa_idindex; /**< Record numbers sorted by the record IDs, built by fasta_lookup_id() */
+                uint32_t         fa_idcount; /**< Number of records with an ID */
+                uint64_t        *fa_seqlen;  /**< Sequence lengths of the records, built by fasta_select() */
+                struct fasta_secidx *fa_secidx; /**< Secondary indexes (FASTA_SECIDX), built on demand otherwise */
         } FASTA;
 
         /**
@@ -153,6 +269,62 @@ extern "C" {
          */
         uint32_t fasta_count(FASTA *fa);
 
+        /**
+         * Return the composition statistics of the record `recno'. The db has
+         * to be opened with the FASTA_STATS option, otherwise NULL is returned.
+         */
+        const FASTA_stats_t *fasta_stats(FASTA *fa, uint32_t recno);
+
+        /**
+         * Return the content hash of the record `recno'. The db has to be
+         * opened with the FASTA_HASH option, otherwise NULL is returned.
+         */
+        const FASTA_hash_t *fasta_hash(FASTA *fa, uint32_t recno);
+
+        /**
+         * Group the records with identical sequences (equal hashes and
+         * lengths). Returns an array with an element for each record
+         * containing the number of the first record with the same sequence
+         * (i.e. its own number for the first one in a group), or NULL if the
+         * db wasn't opened with the FASTA_HASH option. The number of distinct
+         * sequences is stored into `unique', if not NULL. The array has to
+         * be freed by the caller.
+         */
+        uint32_t *fasta_duplicates(FASTA *fa, uint32_t *unique);
+
+        /**
+         * Return the letter class intervals of the record `recno'. The db has
+         * to be opened with the FASTA_IVALS option, otherwise NULL is returned.
+         * All the classes are mapped in a single pass while scanning the file
+         * and stored in the index.
+         */
+        const FASTA_ivals_t *fasta_intervals(FASTA *fa, uint32_t recno);
+
+        /**
+         * Map the intervals of the letter `classes' (FASTA_IVAL_*) of a record
+         * read into memory (FASTA_INMEMSEQ) into `dst'. If the sequence was
+         * translated, the translated letters are classified. Returns 0 on
+         * success, -1 otherwise. The intervals have to be freed using
+         * fasta_ivals_free().
+         */
+        int fasta_map_intervals(const FASTA_rec_t *farec, uint32_t classes, FASTA_ivals_t *dst);
+
+        /**
+         * Free the intervals stored in `iv' (but not `iv' itself).
+         */
+        void fasta_ivals_free(FASTA_ivals_t *iv);
+
+        /**
+         * Copy the current runtime metrics of the db into `m'. The db has to be
+         * opened with the FASTA_METRICS option, otherwise -1 is returned.
+         */
+        int fasta_get_metrics(FASTA *fa, FASTA_metrics_t *m);
+
+        /**
+         * Return a short name of the phase, e.g. for use as a metric label.
+         */
+        const char *fasta_metrics_phase_name(FASTA_phase_t phase);
+
         /**
          * Set a default CDS mask.
          */
@@ -169,6 +341,20 @@ extern "C" {
          */
         FASTA_rec_t *fasta_read(FASTA *fa, FASTA_rec_t *dst, uint32_t flags, atrans_t *atr);
 
+        /**
+         * Read the next record into `dst' like fasta_read() with FASTA_INMEMSEQ,
+         * decoding the sequence and the quality string into the caller's buffer
+         * `*buf' of `*size' bytes. The buffer is reallocated only if it's too
+         * small, so reading all the records into one buffer doesn't allocate
+         * memory once the buffer fits the largest record (except for the coding
+         * segments mapped with FASTA_MAPCDSEG). `dst' has to be zeroed before
+         * it's read into the first time, the coding segments of the record read
+         * into it previously are freed. The buffer isn't freed by
+         * fasta_rec_free(). Returns 0 on success, 1 after the last record and -1
+         * on error.
+         */
+        int fasta_read_buf(FASTA *fa, FASTA_rec_t *dst, uint8_t **buf, size_t *size, uint32_t flags, atrans_t *atr);
+
         /**
          * Write the db to a file.
          * XXX: not implemented yet
@@ -216,10 +402,118 @@ extern "C" {
         off_t fasta_tello(FASTA *fa);
 
         /**
-         * Apply a function to all record in the given db.
+         * Find the record with the ID `id' and store its number into `recno'.
+         * The index of the IDs is built on the first call. If there are more
+         * records with the same ID, the lowest number is returned. Returns 0
+         * on success, 1 if the ID wasn't found and -1 on error.
+         */
+        int fasta_lookup_id(FASTA *fa, const char *id, uint32_t *recno);
+
+        /**
+         * Retrieve the records with the IDs `ids[0]', ..., `ids[n - 1]'. The
+         * records are read in the order of their position in the file; the
+         * reads of records less than FASTA_FETCH_GAP bytes apart are merged
+         * into reads of up to FASTA_FETCH_BLOCK bytes. The function `func' is
+         * called for each request with the record and the index of its ID in
+         * `ids', in the file order. The IDs that weren't found are reported
+         * last, with a NULL record. The record and its sequence are valid only
+         * during the call. Supported flags: FASTA_CSTRSEQ, FASTA_MAPCDSEG.
+         * Returns 0 on success, -1 on error or the non-zero value returned by
+         * `func', which stops the retrieval.
+         */
+        int fasta_fetch_ids(FASTA *fa, const char * const *ids, uint32_t n, uint32_t flags,
+                            int (*func)(FASTA_rec_t *, uint32_t, void *), void *funcarg);
+
+        /**
+         * Evaluate the filter `flt' on the record table and return the numbers
+         * of the matching records in ascending order, storing their count into
+         * `count'. No sequence data is read. The length predicate is tested
+         * first, over a column of the sequence lengths cached in the db (or
+         * looked up in the secondary indexes if the db was opened with
+         * FASTA_SECIDX and the range is narrow), and the more expensive ones
+         * only on the records that passed it. Returns
+         * a newly allocated array (to be freed by the caller) or NULL on error.
+         */
+        uint32_t *fasta_select(FASTA *fa, const FASTA_filter_t *flt, uint32_t *count);
+
+        /**
+         * Same as fasta_fetch_ids() for the records selected by the filter
+         * `flt' (see fasta_select()): only these records are read from the
+         * file. The function `func' is called with the record and its number.
+         */
+        int fasta_fetch_filter(FASTA *fa, const FASTA_filter_t *flt, uint32_t flags,
+                               int (*func)(FASTA_rec_t *, uint32_t, void *), void *funcarg);
+
+        /**
+         * Find the records with a sequence of `min' to `max' letters using
+         * the secondary indexes, in O(log n). Returns a pointer to the
+         * `count' record numbers, sorted by the sequence length (and the
+         * record number), or NULL on error. The array belongs to the db and
+         * is valid until fasta_close(). The secondary indexes are loaded or
+         * saved with the index if the db was opened with FASTA_SECIDX,
+         * otherwise they are built in memory on the first query.
+         */
+        const uint32_t *fasta_index_length(FASTA *fa, uint64_t min, uint64_t max, uint32_t *count);
+
+        /**
+         * Same as fasta_index_length() for the records whose first header
+         * is a SeqID of the format `fmt'. The records are in the file order.
+         */
+        const uint32_t *fasta_index_seqid(FASTA *fa, SeqID_fmt_t fmt, uint32_t *count);
+
+        /**
+         * Same as fasta_index_length() for the records whose first header
+         * names the database `db', i.e. the database of a "gnl|db|id" SeqID
+         * or the country of a patent. The records are in the file order.
+         */
+        const uint32_t *fasta_index_database(FASTA *fa, const char *db, uint32_t *count);
+
+        /**
+         * Write the sequence of the record `recno' into the descriptor `fd'
+         * without reading it into memory. The residues are written in lines
+         * of `width' letters, or, if `width' is 0, unwrapped and without the
+         * final new-line unless the FASTA_EXPORT_HEADER flag is set. With
+         * FASTA_EXPORT_KEEPWRAP, the lines of the source file are kept and
+         * `width' is ignored. If the line geometry of the record allows it,
+         * the data are copied by the kernel (copy_file_range, sendfile),
+         * otherwise they're streamed through a buffer allocated by the call.
+         * Records of the same db may be exported by several threads at once.
+         * Returns 0 on success, -1 on error (errno is set to ERANGE if
+         * there's no such record).
+         */
+        int fasta_export_fd(FASTA *fa, uint32_t recno, int fd, uint32_t flags, uint32_t width);
+
+        /**
+         * Apply a function to all record in the given db. Returns an array
+         * of the values returned by `func', indexed by the record number.
+         * With the FASTA_PARALLEL option, the records are processed by a
+         * pool of threads, in no particular order. The workers are given
+         * the longest records first and share the rest by stealing from
+         * each other, so that a few huge records don't hold up the whole
+         * run.
          */
         void *fasta_apply(FASTA *fa, void * (*func)(FASTA_rec_t *, void *), uint32_t options, void *funcarg);
 
+        /**
+         * Fold all the records of the db into the accumulator `acc' of
+         * `size' bytes without keeping a result per record. The accumulator
+         * is set up by `init', then `map' is called for each record with
+         * the accumulator of the calling worker and `funcarg' and finally
+         * the accumulators of the workers are merged into `acc' using
+         * `combine'. With the FASTA_PARALLEL option, the records are
+         * processed by a pool of threads (see fasta_apply()), each one
+         * with its own accumulator, in no particular order. The sequences
+         * are read only with the FASTA_INMEMSEQ option (and terminated with
+         * FASTA_CSTRSEQ), otherwise `map' gets the records from the index
+         * which mustn't be modified. Returns 0 on success, -1 if some
+         * record couldn't be read or `map' returned non-zero.
+         */
+        int fasta_mapreduce(FASTA *fa, void *acc, size_t size,
+                            void (*init)(void *),
+                            int (*map)(void *, FASTA_rec_t *, void *),
+                            void (*combine)(void *, const void *),
+                            uint32_t options, void *funcarg);
+
         /**
          * Close the given db, freeing all memory used to store information
          * about it.
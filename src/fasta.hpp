@@ -0,0 +1,838 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#ifndef FASTA_HPP
+#define FASTA_HPP
+
+/*
+ * Header-only C++17 interface to libfasta. The database and the records
+ * are move-only owners of the underlying C objects, the sequence data
+ * are accessed without copies and the iteration reuses a single record.
+ * With C++20 coroutines, the records can also be streamed through a
+ * generator and composed with the filter(), translate() and batch()
+ * stages.
+ */
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#if __cplusplus >= 202002L
+# include <span>
+#endif
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+# define FASTA_HPP_COROUTINES 1
+# include <coroutine>
+# include <exception>
+# include <memory>
+# include <type_traits>
+# include <vector>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+#include "fasta.h"
+
+namespace fasta {
+
+	class Database;
+
+	/**
+	 * A record read from a Database. The headers are owned by the
+	 * database, so a record mustn't outlive the database it was read
+	 * from. The sequence data are stored in a buffer owned by the record
+	 * and reused by the following reads into it.
+	 */
+	class Record {
+	public:
+		Record() noexcept
+		{
+			std::memset(&m_rec, 0, sizeof m_rec);
+		}
+
+		Record(Record &&other) noexcept
+			: m_rec(other.m_rec), m_valid(other.m_valid),
+			  m_buf(std::exchange(other.m_buf, nullptr)), m_size(std::exchange(other.m_size, 0))
+		{
+			other.forget();
+		}
+
+		/*
+		 * The buffers are swapped, the moved-from record can be read
+		 * into without allocating a new one
+		 */
+		Record &operator=(Record &&other) noexcept
+		{
+			if (this != &other) {
+				reset();
+				m_rec   = other.m_rec;
+				m_valid = other.m_valid;
+				std::swap(m_buf, other.m_buf);
+				std::swap(m_size, other.m_size);
+				other.forget();
+			}
+
+			return (*this);
+		}
+
+		Record(const Record &) = delete;
+		Record &operator=(const Record &) = delete;
+
+		~Record()
+		{
+			reset();
+			std::free(m_buf);
+		}
+
+		/**
+		 * Release the record data. The sequence buffer is kept, the
+		 * record may be read into again.
+		 */
+		void reset() noexcept
+		{
+			if (m_valid) {
+				fasta_rec_free(&m_rec);
+				forget();
+			}
+		}
+
+		explicit operator bool() const noexcept
+		{
+			return (m_valid);
+		}
+
+		/**
+		 * ID guessed from the header information, empty if none.
+		 */
+		std::string_view id() const noexcept
+		{
+			return (m_rec.rec_id != nullptr ? std::string_view(m_rec.rec_id) : std::string_view());
+		}
+
+		/**
+		 * Number of the headers of the record (separated by ^A).
+		 */
+		std::size_t header_count() const noexcept
+		{
+			return (m_rec.hdr_cnt);
+		}
+
+		/**
+		 * The header `i' without the leading '>'. The headers are
+		 * split in place by the SeqID parser, the text is rebuilt
+		 * from the parsed fields.
+		 */
+		std::string header(std::size_t i = 0) const
+		{
+			const char *h = static_cast<const char *>(m_rec.hdr_mem), *e;
+			std::size_t k;
+			std::string s;
+
+			if (h == nullptr || i >= m_rec.hdr_cnt)
+				return (s);
+
+			/*
+			 * The ^A separating the headers was replaced by a NUL too
+			 */
+			for (k = 0; k < i; ++k) {
+				for (unsigned int n = separators(m_rec.hdr[k]); n > 0; --n)
+					h += std::strlen(h) + 1;
+
+				h += std::strlen(h) + 1;
+			}
+
+			const SeqID_fmt_t fmt = m_rec.hdr[i].seqid_fmt;
+			unsigned int      n   = separators(m_rec.hdr[i]);
+
+			for (k = 0; ; ++k) {
+				e = h + std::strlen(h);
+				s.append(h, e);
+
+				if (k == n)
+					break;
+
+				/*
+				 * The NULs are found in this order: the ':' of the
+				 * entry:chain format, the '|'s and the space
+				 * preceding the rest of the header
+				 */
+				if (fmt == SEQID_PDB2 && k == 0)
+					s.push_back(':');
+				else if (m_rec.hdr[i].seqid.common.rest != nullptr && k == n - 1)
+					s.push_back(' ');
+				else
+					s.push_back('|');
+
+				h = e + 1;
+			}
+
+			return (s);
+		}
+
+		/**
+		 * The sequence data, empty unless the record was read with
+		 * FASTA_INMEMSEQ.
+		 */
+		std::string_view sequence() const noexcept
+		{
+			return (m_rec.seq_mem != nullptr ?
+				std::string_view(reinterpret_cast<const char *>(m_rec.seq_mem), m_rec.seq_len) :
+				std::string_view());
+		}
+
+		/**
+		 * The quality string of a FASTQ record, empty otherwise.
+		 */
+		std::string_view quality() const noexcept
+		{
+			return (m_rec.qual_mem != nullptr ?
+				std::string_view(reinterpret_cast<const char *>(m_rec.qual_mem), m_rec.seq_len) :
+				std::string_view());
+		}
+
+#if __cplusplus >= 202002L
+		std::span<const std::uint8_t> bytes() const noexcept
+		{
+			return (m_rec.seq_mem != nullptr ?
+				std::span<const std::uint8_t>(m_rec.seq_mem, m_rec.seq_len) :
+				std::span<const std::uint8_t>());
+		}
+#endif
+		std::uint64_t length() const noexcept
+		{
+			return (m_rec.seq_len);
+		}
+
+		const FASTA_rec_t *get() const noexcept
+		{
+			return (&m_rec);
+		}
+
+		FASTA_rec_t *get() noexcept
+		{
+			return (&m_rec);
+		}
+
+	private:
+		friend class Database;
+
+		/*
+		 * Number of the separators that SeqID_parse() replaced with a
+		 * NUL in the header
+		 */
+		static unsigned int separators(const FASTA_rechdr_t &h) noexcept
+		{
+			unsigned int n;
+
+			switch (h.seqid_fmt) {
+			case SEQID_GENBANK:
+			case SEQID_EMBL:
+			case SEQID_DDBJ:
+				n = 4;
+				break;
+			case SEQID_PDB2:
+				n = 4; /* ':' and 3 x '|' */
+				break;
+			case SEQID_BBS:
+			case SEQID_LOCAL:
+				n = 1;
+				break;
+			case SEQID_NBRFPIR:
+			case SEQID_PRF:
+			case SEQID_SWISSPROT:
+			case SEQID_PDB1:
+			case SEQID_PATENTS:
+			case SEQID_GNL:
+			case SEQID_NCBIREF:
+				n = 2;
+				break;
+			case SEQID_UNKNOWN:
+				n = 0;
+				break;
+			default:
+				return (0);
+			}
+
+			return (h.seqid.common.rest != nullptr ? n + 1 : n);
+		}
+
+		/*
+		 * Drop the references to the record data without freeing them
+		 */
+		void forget() noexcept
+		{
+			m_rec.seq_mem  = nullptr;
+			m_rec.qual_mem = nullptr;
+			m_rec.cdseg    = nullptr;
+			m_valid = false;
+		}
+
+		FASTA_rec_t   m_rec;
+		bool          m_valid = false;
+		std::uint8_t *m_buf   = nullptr; /* see fasta_read_buf() */
+		std::size_t   m_size  = 0;
+	};
+
+	/**
+	 * Marks the end of the records of a Database.
+	 */
+	struct Sentinel {};
+
+	/**
+	 * An open FASTA (or FASTQ) file.
+	 */
+	class Database {
+	public:
+		/**
+		 * Input iterator over the records. All the records are read into
+		 * the same Record object, i.e. a reference obtained from the
+		 * iterator is valid only until it's incremented.
+		 */
+		class Iterator {
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type        = Record;
+			using difference_type   = std::ptrdiff_t;
+			using pointer           = const Record *;
+			using reference         = const Record &;
+
+			Iterator() noexcept = default;
+
+			Iterator(Database *db, std::uint32_t flags)
+				: m_db(db), m_flags(flags)
+			{
+				++*this;
+			}
+
+			Iterator(Iterator &&) noexcept = default;
+			Iterator &operator=(Iterator &&) noexcept = default;
+
+			reference operator*() const noexcept
+			{
+				return (m_rec);
+			}
+
+			pointer operator->() const noexcept
+			{
+				return (&m_rec);
+			}
+
+			Iterator &operator++()
+			{
+				if (m_db != nullptr && !m_db->read(m_rec, m_flags))
+					m_db = nullptr;
+
+				return (*this);
+			}
+
+			void operator++(int)
+			{
+				++*this;
+			}
+
+			friend bool operator==(const Iterator &it, Sentinel) noexcept
+			{
+				return (it.m_db == nullptr);
+			}
+
+			friend bool operator!=(const Iterator &it, Sentinel s) noexcept
+			{
+				return (!(it == s));
+			}
+
+			friend bool operator==(Sentinel s, const Iterator &it) noexcept
+			{
+				return (it == s);
+			}
+
+			friend bool operator!=(Sentinel s, const Iterator &it) noexcept
+			{
+				return (!(it == s));
+			}
+
+		private:
+			Database     *m_db = nullptr;
+			std::uint32_t m_flags = 0;
+			Record        m_rec;
+		};
+
+		/**
+		 * The records read with the given flags, see Database::records().
+		 */
+		class Range {
+		public:
+			Range(Database *db, std::uint32_t flags) noexcept
+				: m_db(db), m_flags(flags)
+			{}
+
+			Iterator begin()
+			{
+				m_db->rewind();
+				return (Iterator(m_db, m_flags));
+			}
+
+			Sentinel end() const noexcept
+			{
+				return (Sentinel());
+			}
+
+		private:
+			Database     *m_db;
+			std::uint32_t m_flags;
+		};
+
+		Database() noexcept = default;
+
+		/**
+		 * Open the file `path', see fasta_open(). Throws std::system_error
+		 * on failure.
+		 */
+		explicit Database(const std::string &path, std::uint32_t options = FASTA_READ, atrans_t *atr = nullptr)
+			: m_fa(fasta_open(path.c_str(), options, atr))
+		{
+			if (m_fa == nullptr)
+				throw std::system_error(errno != 0 ? errno : EINVAL, std::generic_category(),
+							"fasta_open: " + path);
+		}
+
+		Database(Database &&other) noexcept
+			: m_fa(std::exchange(other.m_fa, nullptr))
+		{}
+
+		Database &operator=(Database &&other) noexcept
+		{
+			if (this != &other) {
+				close();
+				m_fa = std::exchange(other.m_fa, nullptr);
+			}
+
+			return (*this);
+		}
+
+		Database(const Database &) = delete;
+		Database &operator=(const Database &) = delete;
+
+		~Database()
+		{
+			close();
+		}
+
+		void close() noexcept
+		{
+			if (m_fa != nullptr) {
+				fasta_close(m_fa);
+				m_fa = nullptr;
+			}
+		}
+
+		explicit operator bool() const noexcept
+		{
+			return (m_fa != nullptr);
+		}
+
+		/**
+		 * Number of records.
+		 */
+		std::uint32_t size() const noexcept
+		{
+			return (fasta_count(m_fa));
+		}
+
+		/**
+		 * Read the next record into `rec', replacing its previous data.
+		 * The sequence is decoded into the buffer of the record, which is
+		 * reallocated only if it's too small, and translated using `atr',
+		 * or the table the db was opened with. The sequence file is kept
+		 * open between the reads. Returns false after the last record,
+		 * throws std::system_error if the record can't be read.
+		 */
+		bool read(Record &rec, std::uint32_t flags = FASTA_INMEMSEQ, atrans_t *atr = nullptr)
+		{
+			rec.reset();
+
+			if (m_fa->fa_rindex >= m_fa->fa_rcount)
+				return (false);
+
+			if (flags & FASTA_INMEMSEQ) {
+				if (fasta_read_buf(m_fa, &rec.m_rec, &rec.m_buf, &rec.m_size, flags | FASTA_KEEPOPEN, atr) != 0)
+					throw std::system_error(errno != 0 ? errno : EIO, std::generic_category(), "fasta_read_buf");
+			} else if (fasta_read(m_fa, &rec.m_rec, flags, atr) == nullptr)
+				throw std::system_error(errno != 0 ? errno : EIO, std::generic_category(), "fasta_read");
+
+			rec.m_valid = true;
+
+			/*
+			 * Without FASTA_INMEMSEQ, fasta_read() doesn't move to
+			 * the next record
+			 */
+			if (!(flags & FASTA_INMEMSEQ))
+				++m_fa->fa_rindex;
+
+			return (true);
+		}
+
+		/**
+		 * Read the record `recno' into `rec'.
+		 */
+		bool read(std::uint32_t recno, Record &rec, std::uint32_t flags = FASTA_INMEMSEQ, atrans_t *atr = nullptr)
+		{
+			if (fasta_seeko(m_fa, recno, SEEK_SET) != 0) {
+				rec.reset();
+				return (false);
+			}
+
+			return (read(rec, flags, atr));
+		}
+
+		void rewind() noexcept
+		{
+			fasta_rewind(m_fa);
+		}
+
+		/**
+		 * Iterate over all the records, starting with the first one.
+		 */
+		Range records(std::uint32_t flags = FASTA_INMEMSEQ) noexcept
+		{
+			return (Range(this, flags));
+		}
+
+		Iterator begin()
+		{
+			return (records().begin());
+		}
+
+		Sentinel end() const noexcept
+		{
+			return (Sentinel());
+		}
+
+		FASTA *get() const noexcept
+		{
+			return (m_fa);
+		}
+
+	private:
+		FASTA *m_fa = nullptr;
+	};
+
+#ifdef FASTA_HPP_COROUTINES
+	/**
+	 * Lazily evaluated sequence of values produced by a coroutine. The
+	 * values are yielded by reference, i.e. a value obtained from the
+	 * iterator is valid only until it's incremented. Exceptions thrown
+	 * by the coroutine are rethrown by the iterator.
+	 */
+	template <typename T>
+	class Generator {
+	public:
+		using value_type = std::remove_cvref_t<T>;
+		using reference  = T &;
+
+		struct promise_type {
+			std::add_pointer_t<T> m_value = nullptr;
+			std::exception_ptr    m_error;
+
+			Generator get_return_object() noexcept
+			{
+				return (Generator(std::coroutine_handle<promise_type>::from_promise(*this)));
+			}
+
+			std::suspend_always initial_suspend() const noexcept { return {}; }
+			std::suspend_always final_suspend() const noexcept { return {}; }
+
+			std::suspend_always yield_value(T &value) noexcept
+			{
+				m_value = std::addressof(value);
+				return {};
+			}
+
+			/*
+			 * The temporary lives until the coroutine is resumed
+			 */
+			std::suspend_always yield_value(T &&value) noexcept
+			{
+				m_value = std::addressof(value);
+				return {};
+			}
+
+			void return_void() const noexcept {}
+
+			void unhandled_exception() noexcept
+			{
+				m_error = std::current_exception();
+			}
+
+			void rethrow()
+			{
+				if (m_error)
+					std::rethrow_exception(std::exchange(m_error, nullptr));
+			}
+
+			template <typename U>
+			void await_transform(U &&) = delete;
+		};
+
+		class Iterator {
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type        = Generator::value_type;
+			using difference_type   = std::ptrdiff_t;
+			using reference         = T &;
+
+			Iterator() noexcept = default;
+
+			explicit Iterator(std::coroutine_handle<promise_type> h) noexcept
+				: m_h(h)
+			{}
+
+			reference operator*() const noexcept
+			{
+				return (*m_h.promise().m_value);
+			}
+
+			Iterator &operator++()
+			{
+				m_h.resume();
+				m_h.promise().rethrow();
+				return (*this);
+			}
+
+			void operator++(int)
+			{
+				++*this;
+			}
+
+			friend bool operator==(const Iterator &it, Sentinel) noexcept
+			{
+				return (it.m_h == nullptr || it.m_h.done());
+			}
+
+		private:
+			std::coroutine_handle<promise_type> m_h;
+		};
+
+		Generator(Generator &&other) noexcept
+			: m_h(std::exchange(other.m_h, nullptr))
+		{}
+
+		Generator &operator=(Generator &&other) noexcept
+		{
+			if (this != &other) {
+				if (m_h)
+					m_h.destroy();
+				m_h = std::exchange(other.m_h, nullptr);
+			}
+
+			return (*this);
+		}
+
+		Generator(const Generator &) = delete;
+		Generator &operator=(const Generator &) = delete;
+
+		~Generator()
+		{
+			if (m_h)
+				m_h.destroy();
+		}
+
+		/**
+		 * Start the coroutine. A generator may be iterated only once.
+		 */
+		Iterator begin()
+		{
+			m_h.resume();
+			m_h.promise().rethrow();
+			return (Iterator(m_h));
+		}
+
+		Sentinel end() const noexcept
+		{
+			return (Sentinel());
+		}
+
+	private:
+		explicit Generator(std::coroutine_handle<promise_type> h) noexcept
+			: m_h(h)
+		{}
+
+		std::coroutine_handle<promise_type> m_h;
+	};
+
+	namespace detail {
+		/**
+		 * Asks the kernel to start reading the data of the records that
+		 * will be read next, so that the I/O overlaps with the processing
+		 * of the current record.
+		 */
+		class Prefetcher {
+		public:
+			Prefetcher(FASTA *fa, std::uint32_t depth) noexcept
+				: m_fa(fa), m_depth(depth), m_next(0)
+			{
+				m_fd = depth > 0 ? ::open(fa->fa_path, O_RDONLY) : -1;
+			}
+
+			Prefetcher(const Prefetcher &) = delete;
+			Prefetcher &operator=(const Prefetcher &) = delete;
+
+			~Prefetcher()
+			{
+				if (m_fd >= 0)
+					::close(m_fd);
+			}
+
+			/**
+			 * Prefetch the records following the record `recno'.
+			 */
+			void advance(std::uint32_t recno) noexcept
+			{
+				if (m_next <= recno)
+					m_next = recno + 1;
+
+				for (; m_fd >= 0 && m_next < m_fa->fa_rcount && m_next <= recno + m_depth; ++m_next) {
+#ifdef POSIX_FADV_WILLNEED
+					const FASTA_rec_t *r = m_fa->fa_record + m_next;
+					std::uint64_t end = r->qual_rawlen > 0 ?
+						r->qual_start + r->qual_rawlen : r->seq_start + r->seq_rawlen;
+
+					::posix_fadvise(m_fd, static_cast<off_t>(r->hdr_start - 1),
+							static_cast<off_t>(end - (r->hdr_start - 1)), POSIX_FADV_WILLNEED);
+#endif
+				}
+			}
+
+		private:
+			FASTA        *m_fa;
+			std::uint32_t m_depth;
+			std::uint32_t m_next;
+			int           m_fd;
+		};
+	}
+
+	/**
+	 * Stream all the records of `db', starting with the first one. The
+	 * data of the following `prefetch' records are requested from the
+	 * kernel before a record is yielded. The yielded record may be moved
+	 * from, the next one is read into it.
+	 */
+	inline Generator<Record> stream(Database &db, std::uint32_t flags = FASTA_INMEMSEQ,
+					atrans_t *atr = nullptr, std::uint32_t prefetch = 4)
+	{
+		Record rec;
+		detail::Prefetcher pf(db.get(), prefetch);
+
+		db.rewind();
+
+		for (;;) {
+			std::uint32_t recno = static_cast<std::uint32_t>(fasta_tello(db.get()));
+
+			if (!db.read(rec, flags, atr))
+				break;
+
+			pf.advance(recno);
+			co_yield rec;
+		}
+	}
+
+	/**
+	 * Pass only the values for which `pred' returns true.
+	 */
+	template <typename T, typename Pred>
+	Generator<T> filter(Generator<T> src, Pred pred)
+	{
+		for (T &value : src) {
+			if (pred(std::as_const(value)))
+				co_yield value;
+		}
+	}
+
+	/**
+	 * A record along with its sequence translated by an atrans_t table.
+	 */
+	struct Translated {
+		Record                        &record;
+		std::span<const std::uint8_t>  sequence; /**< letters packed by the dst_width of the table */
+	};
+
+	/**
+	 * Translate the sequences of the records read into memory using the
+	 * table `atr'. The translated sequences are stored into a buffer
+	 * reused for all the records.
+	 */
+	inline Generator<Translated> translate(Generator<Record> src, atrans_t *atr)
+	{
+		std::vector<std::uint8_t> buf;
+
+		for (Record &rec : src) {
+			std::string_view seq = rec.sequence();
+			std::size_t size = atrans_s2d_size(atr, seq.size());
+
+			if (buf.size() < size)
+				buf.resize(size);
+
+			std::memset(buf.data(), 0, size);
+
+			for (std::size_t i = 0; i < seq.size(); ++i)
+				atrans_letter_s2d(atr, static_cast<std::uint8_t>(seq[i]), static_cast<std::uint32_t>(i), buf.data());
+
+			co_yield Translated{rec, std::span<const std::uint8_t>(buf.data(), size)};
+		}
+	}
+
+	/**
+	 * Group the records into batches of `n' (the last one may be smaller).
+	 * The records are moved into a set of `n' records reused for all the
+	 * batches.
+	 */
+	inline Generator<std::span<Record>> batch(Generator<Record> src, std::size_t n)
+	{
+		std::vector<Record> buf(n > 0 ? n : 1);
+		std::size_t k = 0;
+
+		for (Record &rec : src) {
+			buf[k++] = std::move(rec);
+
+			if (k == buf.size()) {
+				co_yield std::span<Record>(buf.data(), k);
+				k = 0;
+			}
+		}
+
+		if (k > 0)
+			co_yield std::span<Record>(buf.data(), k);
+	}
+#endif
+}
+
+#endif /* FASTA_HPP */
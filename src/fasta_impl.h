@@ -0,0 +1,126 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#ifndef FASTA_IMPL_H
+#define FASTA_IMPL_H
+
+/*
+ * Library internal interfaces shared between the source files
+ * of libfasta. Nothing declared here is exported.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include "fasta.h"
+
+/**
+ * Bitmask of the letters that are part of a sequence
+ */
+extern const uint32_t __SQ_mask[];
+
+/**
+ * Load the record `recno' into `dst' (or into a newly allocated record
+ * if `dst' is NULL) reading the sequence data using the stream `fp'.
+ * Unlike fasta_read(), this function doesn't touch the shared stream or
+ * the record index of the db and may therefore be used by several threads
+ * at once, provided that each one of them uses its own stream.
+ */
+FASTA_rec_t *__fasta_read_record(FASTA *fa, FILE *fp, uint32_t recno, FASTA_rec_t *dst, uint32_t flags, atrans_t *atr);
+
+/**
+ * Call `func' for each record of the db using a pool of worker threads
+ * (see apply.c), storing the returned values into `result' indexed by
+ * the record number. Returns 0 on success, -1 if some record couldn't
+ * be read.
+ */
+int __fasta_apply_parallel(FASTA *fa, void * (*func)(FASTA_rec_t *, void *), void *funcarg, void **result);
+
+/**
+ * Compute the checksum of the last record, i.e. of all the bytes from its
+ * '>' character up to the end of the file open as fa->fa_seqFP.
+ */
+int __index_lastsum(FASTA *fa, uint64_t filesize, uint32_t *sum);
+
+/**
+ * Load the secondary indexes of the db (see secidx.c) from the file next
+ * to the index if FASTA_USEINDEX is set and the file matches the sequence
+ * file, otherwise build them, and save them if FASTA_GENINDEX is set too.
+ * The sequence file has to be open as fa->fa_seqFP.
+ */
+int __secidx_open(FASTA *fa, uint32_t options);
+
+/**
+ * Free the secondary indexes of the db.
+ */
+void __secidx_free(FASTA *fa);
+
+/**
+ * Write the index of the db `fa' into the file `idxpath'. The index header
+ * describes the file open as fa->fa_seqFP.
+ */
+int __index_write(FASTA *fa, const char *idxpath);
+
+/**
+ * Write an index of the `count' records starting with the record `from'
+ * into the stream `fp'. The record offsets aren't changed, i.e. the slice
+ * describes a part of the source file.
+ */
+int __index_write_slice(FASTA *fa, FILE *fp, uint32_t from, uint32_t count);
+
+/**
+ * Same as fasta_open(), but if `idxFP' isn't NULL, the index is read from
+ * this stream instead of the index file and the db is never regenerated
+ * by scanning the sequence file. The stream is closed by this function.
+ */
+FASTA *__fasta_open(const char *path, FILE *idxFP, uint32_t options, atrans_t *atr);
+
+/**
+ * Decode the sequence data `raw' (starting at the record's seq_start) into
+ * dst->seq_mem, which has to be large enough to hold the sequence of the
+ * record (translated using `atr', if not NULL, and NUL terminated if the
+ * FASTA_CSTRSEQ flag is set in dst->flags). The coding segments are mapped
+ * if the FASTA_MAPCDSEG flag is set.
+ */
+int __fasta_decode(FASTA *fa, const uint8_t *raw, uint64_t rawlen, FASTA_rec_t *dst, atrans_t *atr);
+
+/**
+ * Copy the quality string `raw' of a FASTQ record (starting at the record's
+ * qual_start) without the new-lines into dst->qual_mem, which has to be
+ * able to hold dst->seq_len letters (and the terminating NUL if the
+ * FASTA_CSTRSEQ flag is set in dst->flags). `raw' may be dst->qual_mem.
+ */
+int __fastq_decode_qual(const uint8_t *raw, uint64_t rawlen, FASTA_rec_t *dst);
+
+/**
+ * File offset following the data of the record `rec', i.e. the end of
+ * the sequence, or of the quality string of a FASTQ record.
+ */
+static inline uint64_t __fasta_rec_end(const FASTA_rec_t *rec)
+{
+	return (rec->qual_rawlen > 0 ? rec->qual_start + rec->qual_rawlen : rec->seq_start + rec->seq_rawlen);
+}
+
+#endif /* FASTA_IMPL_H */
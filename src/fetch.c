@@ -0,0 +1,320 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#define _DEFAULT_SOURCE
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "helpers.h"
+#include "fasta.h"
+#include "fasta_impl.h"
+#include "trans.h"
+#include "metrics.h"
+
+typedef struct {
+	uint64_t start; /* seq_start of the record */
+	uint32_t recno;
+	uint32_t req;   /* index of the request */
+} fetch_ent_t;
+
+static int fetch_entcmp(const void *a, const void *b)
+{
+	const fetch_ent_t *x = a, *y = b;
+
+	if (x->start != y->start)
+		return (x->start > y->start) - (x->start < y->start);
+
+	return (x->req > y->req) - (x->req < y->req);
+}
+
+static int fetch_pread(FASTA *fa, int fd, uint8_t *buf, uint64_t len, uint64_t off)
+{
+	ssize_t r;
+
+	while (len > 0) {
+		r = pread(fd, buf, len, off);
+
+		metrics_add(fa->fa_metrics, syscalls, 1);
+
+		if (r <= 0)
+			return (-1);
+
+		metrics_add(fa->fa_metrics, bytes_read, r);
+
+		buf += r;
+		off += r;
+		len -= r;
+	}
+
+	return (0);
+}
+
+/*
+ * Read the records `ent[0]', ..., `ent[n - 1]', sorted by their position
+ * in the file, and call `func' for each one of them with the `req' value.
+ */
+static int fetch_run(FASTA *fa, const fetch_ent_t *ent, uint32_t n, uint32_t flags,
+		     int (*func)(FASTA_rec_t *, uint32_t, void *), void *funcarg)
+{
+	uint8_t     *block = NULL, *seq = NULL, *qual = NULL;
+	size_t       block_size = 0, seq_size = 0, qual_size = 0;
+	uint32_t     i, j, k;
+	FASTA_rec_t  rec;
+	atrans_t    *atr = fa->fa_atr;
+	int          fd, r = 0;
+
+	fd = open(fa->fa_path, O_RDONLY);
+	metrics_add(fa->fa_metrics, syscalls, 1);
+
+	if (fd < 0)
+		return (-1);
+
+	rec.cdseg = NULL;
+
+	for (i = 0; i < n && r == 0; i = j) {
+		uint64_t b, e, start;
+
+		/*
+		 * Merge the reads of the following records while the gaps are
+		 * small enough and the block doesn't grow too large
+		 */
+		b = ent[i].start;
+		e = __fasta_rec_end(fa->fa_record + ent[i].recno);
+
+		for (j = i + 1; j < n; ++j) {
+			uint64_t end = __fasta_rec_end(fa->fa_record + ent[j].recno);
+
+			start = ent[j].start;
+
+			if (start > e + FASTA_FETCH_GAP || end - b > FASTA_FETCH_BLOCK)
+				break;
+
+			if (end > e)
+				e = end;
+		}
+
+		if (e - b > block_size) {
+			uint8_t *tmp = realloc_array(block, uint8_t, e - b);
+
+			if (tmp == NULL) {
+				r = -1;
+				break;
+			}
+
+			block      = tmp;
+			block_size = e - b;
+			metrics_add(fa->fa_metrics, allocs, 1);
+		}
+
+		if (fetch_pread(fa, fd, block, e - b, b) != 0) {
+			r = -1;
+			break;
+		}
+
+		for (k = i; k < j && r == 0; ++k) {
+			size_t   need;
+			uint64_t t;
+
+			/*
+			 * The same record requested more than once is decoded once
+			 */
+			if (k == i || ent[k].recno != ent[k - 1].recno) {
+				memcpy(&rec, fa->fa_record + ent[k].recno, sizeof(FASTA_rec_t));
+				rec.flags = FASTA_REC_MAGICFL | (flags & (FASTA_CSTRSEQ|FASTA_MAPCDSEG));
+
+				need = atr != NULL ? atrans_s2d_size(atr, rec.seq_len) : rec.seq_len;
+				need += 1;
+
+				if (need > seq_size) {
+					uint8_t *tmp = realloc_array(seq, uint8_t, need);
+
+					if (tmp == NULL) {
+						r = -1;
+						break;
+					}
+
+					seq      = tmp;
+					seq_size = need;
+					metrics_add(fa->fa_metrics, allocs, 1);
+				}
+
+				if (atr != NULL)
+					memset(seq, 0, need);
+
+				rec.seq_mem = seq;
+				t = metrics_start(fa->fa_metrics);
+
+				if (__fasta_decode(fa, block + (ent[k].start - b), rec.seq_rawlen, &rec, atr) != 0) {
+					dP("Failed to decode record #%u\n", ent[k].recno);
+					r = -1;
+					break;
+				}
+
+				/*
+				 * The quality string of a FASTQ record follows the sequence
+				 */
+				if (rec.qual_rawlen > 0) {
+					if (rec.seq_len + 1 > qual_size) {
+						uint8_t *tmp = realloc_array(qual, uint8_t, rec.seq_len + 1);
+
+						if (tmp == NULL) {
+							r = -1;
+							break;
+						}
+
+						qual      = tmp;
+						qual_size = rec.seq_len + 1;
+						metrics_add(fa->fa_metrics, allocs, 1);
+					}
+
+					rec.qual_mem = qual;
+
+					if (__fastq_decode_qual(block + (rec.qual_start - b), rec.qual_rawlen, &rec) != 0) {
+						dP("Failed to decode the quality string of record #%u\n", ent[k].recno);
+						r = -1;
+						break;
+					}
+				}
+
+				metrics_phase(fa->fa_metrics, FASTA_PHASE_DECODE, t);
+				metrics_add(fa->fa_metrics, records, 1);
+			}
+
+			r = func(&rec, ent[k].req, funcarg);
+
+			if (k + 1 == j || ent[k + 1].recno != ent[k].recno) {
+				free(rec.cdseg);
+				rec.cdseg       = NULL;
+				rec.cdseg_count = 0;
+			}
+		}
+
+		if (r != 0 && rec.cdseg != NULL)
+			free(rec.cdseg);
+	}
+
+	close(fd);
+	free(block);
+	free(seq);
+	free(qual);
+
+	return (r);
+}
+
+int fasta_fetch_ids(FASTA *fa, const char * const *ids, uint32_t n, uint32_t flags,
+		    int (*func)(FASTA_rec_t *, uint32_t, void *), void *funcarg)
+{
+	fetch_ent_t *ent;
+	uint32_t     i, k, found, recno;
+	int          r;
+
+	assert(fa != NULL);
+	assert(func != NULL);
+
+	if (n == 0)
+		return (0);
+
+	ent = alloc_array(fetch_ent_t, n);
+
+	if (ent == NULL)
+		return (-1);
+
+	/*
+	 * Resolve the IDs. The unresolved ones are moved to the end.
+	 */
+	for (i = 0, found = 0, k = n; i < n; ++i) {
+		switch (fasta_lookup_id(fa, ids[i], &recno)) {
+		case 0:
+			ent[found].start = fa->fa_record[recno].seq_start;
+			ent[found].recno = recno;
+			ent[found].req   = i;
+			++found;
+			break;
+		case 1:
+			ent[--k].req = i;
+			break;
+		default:
+			free(ent);
+			return (-1);
+		}
+	}
+
+	qsort(ent, found, sizeof(fetch_ent_t), fetch_entcmp);
+
+	r = fetch_run(fa, ent, found, flags, func, funcarg);
+
+	/*
+	 * Report the IDs that weren't found, in the order of the requests
+	 */
+	for (k = n; r == 0 && k > found; --k)
+		r = func(NULL, ent[k - 1].req, funcarg);
+
+	free(ent);
+
+	return (r);
+}
+
+int fasta_fetch_filter(FASTA *fa, const FASTA_filter_t *flt, uint32_t flags,
+		       int (*func)(FASTA_rec_t *, uint32_t, void *), void *funcarg)
+{
+	fetch_ent_t *ent;
+	uint32_t    *sel, n, i;
+	int          r;
+
+	assert(fa != NULL);
+	assert(func != NULL);
+
+	if ((sel = fasta_select(fa, flt, &n)) == NULL)
+		return (-1);
+
+	if ((ent = alloc_array(fetch_ent_t, n > 0 ? n : 1)) == NULL) {
+		free(sel);
+		return (-1);
+	}
+
+	/* the records are numbered in the file order */
+	for (i = 0; i < n; ++i) {
+		ent[i].start = fa->fa_record[sel[i]].seq_start;
+		ent[i].recno = sel[i];
+		ent[i].req   = sel[i];
+	}
+
+	free(sel);
+
+	r = n > 0 ? fetch_run(fa, ent, n, flags, func, funcarg) : 0;
+	free(ent);
+
+	return (r);
+}
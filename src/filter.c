@@ -0,0 +1,162 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <assert.h>
+#include <fnmatch.h>
+
+#include "helpers.h"
+#include "fasta.h"
+#include "fasta_impl.h"
+
+#define FILTER_BLOCK  1024 /* records tested at once by the length predicate */
+#define FILTER_NARROW 8    /* a range selecting less than 1/8 of the records is looked up */
+
+/*
+ * The record table is an array of structures; the lengths are copied
+ * into a column on the first use so that the range test runs over
+ * consecutive 64-bit values.
+ */
+static const uint64_t *filter_lencol(FASTA *fa)
+{
+	uint32_t i;
+
+	if (fa->fa_seqlen != NULL)
+		return (fa->fa_seqlen);
+
+	if ((fa->fa_seqlen = alloc_array(uint64_t, fa->fa_rcount > 0 ? fa->fa_rcount : 1)) == NULL)
+		return (NULL);
+
+	for (i = 0; i < fa->fa_rcount; ++i)
+		fa->fa_seqlen[i] = fa->fa_record[i].seq_len;
+
+	return (fa->fa_seqlen);
+}
+
+static int filter_recnocmp(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static bool filter_header(const FASTA_rec_t *rec, const FASTA_filter_t *flt)
+{
+	if (flt->seqid_fmt != 0) {
+		if (rec->hdr_cnt == 0 || (unsigned)rec->hdr[0].seqid_fmt >= 32 ||
+		    !(flt->seqid_fmt & FASTA_FILTER_SEQID(rec->hdr[0].seqid_fmt)))
+			return (false);
+	}
+
+	if (flt->id_glob != NULL) {
+		if (rec->rec_id == NULL || fnmatch(flt->id_glob, rec->rec_id, 0) != 0)
+			return (false);
+	}
+
+	return (true);
+}
+
+uint32_t *fasta_select(FASTA *fa, const FASTA_filter_t *flt, uint32_t *count)
+{
+	const uint64_t *len;
+	uint32_t       *sel;
+	uint64_t        pass[FILTER_BLOCK];
+	uint64_t        min, span;
+	uint32_t        i, j, b, n, m;
+
+	assert(fa != NULL);
+	assert(flt != NULL);
+	assert(count != NULL);
+
+	*count = 0;
+
+	if ((sel = alloc_array(uint32_t, fa->fa_rcount > 0 ? fa->fa_rcount : 1)) == NULL)
+		return (NULL);
+
+	if ((len = filter_lencol(fa)) == NULL) {
+		free(sel);
+		return (NULL);
+	}
+
+	/*
+	 * len_min <= len <= len_max as a single unsigned comparison
+	 */
+	min  = flt->len_min;
+	span = (flt->len_max > 0 ? flt->len_max : UINT64_MAX) - min;
+
+	if (flt->len_max > 0 && flt->len_max < min)
+		return (sel);
+
+	/*
+	 * With the secondary indexes, a narrow length range is looked up
+	 * instead of testing all the records
+	 */
+	if (fa->fa_secidx != NULL && (flt->len_min > 0 || flt->len_max > 0)) {
+		const uint32_t *rec = fasta_index_length(fa, min, min + span, &n);
+
+		if (rec != NULL && n < fa->fa_rcount / FILTER_NARROW) {
+			memcpy(sel, rec, sizeof(uint32_t) * n);
+			qsort(sel, n, sizeof(uint32_t), filter_recnocmp);
+			goto header;
+		}
+	}
+
+	for (b = 0, n = 0; b < fa->fa_rcount; b += m) {
+		m = fa->fa_rcount - b < FILTER_BLOCK ? fa->fa_rcount - b : FILTER_BLOCK;
+
+		for (j = 0; j < m; ++j)
+			pass[j] = len[b + j] - min <= span;
+
+		for (j = 0; j < m; ++j) {
+			sel[n] = b + j;
+			n += pass[j];
+		}
+	}
+
+header:
+	/*
+	 * The header predicates are tested only on the survivors
+	 */
+	if (flt->seqid_fmt != 0 || flt->id_glob != NULL) {
+		for (i = 0, j = 0; i < n; ++i) {
+			if (filter_header(fa->fa_record + sel[i], flt))
+				sel[j++] = sel[i];
+		}
+
+		n = j;
+	}
+
+	*count = n;
+
+	return (sel);
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#include <config.h>
+#include <stdint.h>
+#include <string.h>
+#include "hash.h"
+
+#define C1 0x87c37b91114253d5ULL
+#define C2 0x4cf5ad432745937fULL
+
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static inline uint64_t fmix64(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+
+	return (k);
+}
+
+/* little endian load, independent of the host byte order */
+static inline uint64_t load64(const uint8_t *p)
+{
+	return ((uint64_t)p[0]       | (uint64_t)p[1] << 8  |
+		(uint64_t)p[2] << 16 | (uint64_t)p[3] << 24 |
+		(uint64_t)p[4] << 32 | (uint64_t)p[5] << 40 |
+		(uint64_t)p[6] << 48 | (uint64_t)p[7] << 56);
+}
+
+void hash128_init(hash128_t *h, uint64_t seed)
+{
+	h->h1     = seed;
+	h->h2     = seed;
+	h->len    = 0;
+	h->buflen = 0;
+}
+
+void hash128_block(hash128_t *h)
+{
+	uint64_t k1 = load64(h->buf);
+	uint64_t k2 = load64(h->buf + 8);
+
+	k1 *= C1; k1 = ROTL64(k1, 31); k1 *= C2; h->h1 ^= k1;
+
+	h->h1 = ROTL64(h->h1, 27); h->h1 += h->h2; h->h1 = h->h1 * 5 + 0x52dce729;
+
+	k2 *= C2; k2 = ROTL64(k2, 33); k2 *= C1; h->h2 ^= k2;
+
+	h->h2 = ROTL64(h->h2, 31); h->h2 += h->h1; h->h2 = h->h2 * 5 + 0x38495ab5;
+
+	h->len   += sizeof h->buf;
+	h->buflen = 0;
+}
+
+void hash128_final(hash128_t *h, uint64_t out[2])
+{
+	uint64_t k1 = 0, k2 = 0, h1 = h->h1, h2 = h->h2;
+	uint64_t len = h->len + h->buflen;
+	const uint8_t *tail = h->buf;
+
+	switch (h->buflen) {
+	case 15: k2 ^= (uint64_t)tail[14] << 48; /* fall through */
+	case 14: k2 ^= (uint64_t)tail[13] << 40; /* fall through */
+	case 13: k2 ^= (uint64_t)tail[12] << 32; /* fall through */
+	case 12: k2 ^= (uint64_t)tail[11] << 24; /* fall through */
+	case 11: k2 ^= (uint64_t)tail[10] << 16; /* fall through */
+	case 10: k2 ^= (uint64_t)tail[9] << 8;   /* fall through */
+	case  9: k2 ^= (uint64_t)tail[8];
+		k2 *= C2; k2 = ROTL64(k2, 33); k2 *= C1; h2 ^= k2;
+		/* fall through */
+	case  8: k1 ^= (uint64_t)tail[7] << 56;  /* fall through */
+	case  7: k1 ^= (uint64_t)tail[6] << 48;  /* fall through */
+	case  6: k1 ^= (uint64_t)tail[5] << 40;  /* fall through */
+	case  5: k1 ^= (uint64_t)tail[4] << 32;  /* fall through */
+	case  4: k1 ^= (uint64_t)tail[3] << 24;  /* fall through */
+	case  3: k1 ^= (uint64_t)tail[2] << 16;  /* fall through */
+	case  2: k1 ^= (uint64_t)tail[1] << 8;   /* fall through */
+	case  1: k1 ^= (uint64_t)tail[0];
+		k1 *= C1; k1 = ROTL64(k1, 31); k1 *= C2; h1 ^= k1;
+	}
+
+	h1 ^= len;
+	h2 ^= len;
+
+	h1 += h2;
+	h2 += h1;
+
+	h1 = fmix64(h1);
+	h2 = fmix64(h2);
+
+	h1 += h2;
+	h2 += h1;
+
+	out[0] = h1;
+	out[1] = h2;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#ifndef HASH_H
+#define HASH_H
+
+/*
+ * Streaming 128-bit MurmurHash3 (x64 variant). The input may be fed
+ * byte by byte; the result is the same as for MurmurHash3_x64_128 of
+ * the whole input.
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+	uint64_t h1, h2;
+	uint64_t len;
+	uint8_t  buf[16];
+	uint32_t buflen;
+} hash128_t;
+
+void hash128_init(hash128_t *h, uint64_t seed);
+void hash128_block(hash128_t *h);
+void hash128_final(hash128_t *h, uint64_t out[2]);
+
+static inline void hash128_byte(hash128_t *h, uint8_t b)
+{
+	h->buf[h->buflen++] = b;
+
+	if (h->buflen == sizeof h->buf)
+		hash128_block(h);
+}
+
+static inline void hash128_update(hash128_t *h, const uint8_t *p, size_t n)
+{
+	while (n-- > 0)
+		hash128_byte(h, *p++);
+}
+
+#endif /* HASH_H */
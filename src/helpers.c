@@ -25,12 +25,18 @@
  * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
  *
  */
-#define _XOPEN_SOURCE /* for fileno */
+#define _GNU_SOURCE /* for fileno, copy_file_range */
 #include <config.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <unistd.h>
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
 #include "helpers.h"
 
 uint64_t file_get_offset(FILE *fp)
@@ -42,8 +48,14 @@ int file_set_offset(FILE *fp, uint64_t offset)
 {
         if (lseek(fileno(fp), offset, SEEK_SET) == (off_t)(-1))
                 return (-1);
-        else
-                return (0);
+
+        /*
+         * The stream doesn't know about the seek, reset the
+         * (sticky) EOF indicator.
+         */
+        clearerr(fp);
+
+        return (0);
 }
 
 int file_get_stat(FILE *fp, struct stat *st)
@@ -53,3 +65,113 @@ int file_get_stat(FILE *fp, struct stat *st)
         else
                 return (0);
 }
+
+uint32_t cpu_count(void)
+{
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+        return (n > 0 ? (uint32_t)n : 1);
+}
+
+uint32_t thread_pool_run(void *(*func)(void *), void *arg, size_t size, uint32_t n)
+{
+        pthread_t *thread;
+        uint32_t   i, started;
+        int        e;
+
+        if ((thread = alloc_array(pthread_t, n)) == NULL)
+                return (0);
+
+        for (i = 0, started = 0; i < n; ++i) {
+                /* pthread_create() returns the error, errno isn't set */
+                if ((e = pthread_create(thread + i, NULL, func, (char *)arg + (size_t)i * size)) != 0) {
+                        dP("pthread_create failed: %s\n", strerror(e));
+                        break;
+                }
+
+                ++started;
+        }
+
+        for (i = 0; i < started; ++i)
+                pthread_join(thread[i], NULL);
+
+        free(thread);
+
+        return (started);
+}
+
+int file_copy_range(int in_fd, uint64_t offset, uint64_t length, int out_fd)
+{
+        uint8_t buffer[65536];
+        ssize_t r, w, n;
+
+#ifdef HAVE_COPY_FILE_RANGE
+        {
+                loff_t off = (loff_t)offset;
+
+                /*
+                 * Let the kernel do the copy (or reflink the extents).
+                 * Fall back to read/write if it's not supported for
+                 * these files.
+                 */
+                while (length > 0) {
+                        r = copy_file_range(in_fd, &off, out_fd, NULL, length, 0);
+
+                        if (r <= 0)
+                                break;
+
+                        length -= r;
+                }
+
+                if (length == 0)
+                        return (0);
+                if (r == 0 || (errno != EXDEV && errno != EINVAL && errno != ENOSYS && errno != EOPNOTSUPP && errno != EBADF))
+                        return (-1);
+
+                offset = (uint64_t)off;
+        }
+#endif
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+        {
+                off_t off = (off_t)offset;
+
+                /*
+                 * Pipes and sockets, still without copying the data
+                 * through the user space
+                 */
+                while (length > 0) {
+                        r = sendfile(out_fd, in_fd, &off, length);
+
+                        if (r <= 0)
+                                break;
+
+                        length -= r;
+                }
+
+                if (length == 0)
+                        return (0);
+                if (r == 0 || (errno != EINVAL && errno != ENOSYS && errno != EOPNOTSUPP))
+                        return (-1);
+
+                offset = (uint64_t)off;
+        }
+#endif
+        while (length > 0) {
+                r = pread(in_fd, buffer, length < sizeof buffer ? length : sizeof buffer, offset);
+
+                if (r <= 0)
+                        return (-1);
+
+                for (n = 0; n < r; n += w) {
+                        w = write(out_fd, buffer + n, r - n);
+
+                        if (w < 0)
+                                return (-1);
+                }
+
+                offset += r;
+                length -= r;
+        }
+
+        return (0);
+}
@@ -72,6 +72,26 @@ uint64_t file_get_offset(FILE *fp);
 int file_set_offset(FILE *fp, uint64_t offset);
 int file_get_stat(FILE *fp, struct stat *st);
 
+/*
+ * Append `length' bytes starting at `offset' of the input file
+ * to the output file (at its current offset).
+ */
+int file_copy_range(int in_fd, uint64_t offset, uint64_t length, int out_fd);
+
+/*
+ * Number of online processors (at least 1).
+ */
+uint32_t cpu_count(void);
+
+/*
+ * Run `func' in `n' threads, the i-th one getting `(char *)arg + i * size'
+ * as its argument, and wait for all of them to finish. If not all of the
+ * threads can be created, the running ones have to take care of the work
+ * of the missing ones. Returns the number of threads that ran, 0 if none
+ * could be created.
+ */
+uint32_t thread_pool_run(void *(*func)(void *), void *arg, size_t size, uint32_t n);
+
 /**
  * Save errno, execute the block, restore errno.
  */
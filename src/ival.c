@@ -0,0 +1,187 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "helpers.h"
+#include "fasta.h"
+#include "ival.h"
+
+const uint8_t __ival_class[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 4, 0, 4, 0, 0, 0, 4, 0, 0, 4, 0, 4, 2, 0,
+	0, 0, 4, 4, 0, 0, 4, 4, 0, 4, 0, 0, 0, 0, 0, 0,
+	0, 1, 5, 1, 5, 1, 1, 1, 5, 1, 1, 5, 1, 5, 3, 1,
+	1, 1, 5, 5, 1, 1, 5, 5, 1, 5, 1, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+void __ival_init(ival_map_t *mp, FASTA_ivals_t *dst, uint32_t classes)
+{
+	memset(dst, 0, sizeof(FASTA_ivals_t));
+	memset(mp,  0, sizeof(ival_map_t));
+
+	mp->dst     = dst;
+	mp->classes = classes & FASTA_IVAL_ALL;
+}
+
+void __ival_step(ival_map_t *mp, uint32_t cls, uint64_t pos)
+{
+	register uint32_t k, bit;
+	FASTA_ivals_t *dst = mp->dst;
+
+	for (k = 0; k < FASTA_IVAL_CLASSES; ++k) {
+		bit = 1 << k;
+
+		if ((cls & bit) && !(mp->open & bit)) {
+			/*
+			 * A new interval starts here
+			 */
+			if (dst->count[k] == mp->size[k]) {
+				FASTA_u64p *iv;
+				uint32_t size = mp->size[k] > 0 ? mp->size[k] * 2 : 16;
+
+				iv = realloc_array(dst->ival[k], FASTA_u64p, size);
+
+				if (iv == NULL) {
+					mp->fail = true;
+					continue;
+				}
+
+				dst->ival[k] = iv;
+				mp->size[k]  = size;
+			}
+
+			dst->ival[k][dst->count[k]].a = pos;
+			mp->open |= bit;
+		} else if (!(cls & bit) && (mp->open & bit)) {
+			/*
+			 * The open interval ended at the previous letter
+			 */
+			dst->ival[k][dst->count[k]++].b = pos - 1;
+			mp->open &= ~bit;
+		}
+	}
+}
+
+int __ival_finish(ival_map_t *mp, uint64_t len)
+{
+	register uint32_t k;
+	FASTA_ivals_t *dst = mp->dst;
+
+	__ival_step(mp, 0, len);
+
+	if (mp->fail) {
+		fasta_ivals_free(dst);
+		errno = ENOMEM;
+		return (-1);
+	}
+
+	for (k = 0; k < FASTA_IVAL_CLASSES; ++k) {
+		if (dst->count[k] == 0) {
+			free(dst->ival[k]);
+			dst->ival[k] = NULL;
+		} else if (dst->count[k] < mp->size[k]) {
+			FASTA_u64p *iv = realloc_array(dst->ival[k], FASTA_u64p, dst->count[k]);
+
+			if (iv != NULL)
+				dst->ival[k] = iv;
+		}
+	}
+
+	return (0);
+}
+
+int fasta_map_intervals(const FASTA_rec_t *farec, uint32_t classes, FASTA_ivals_t *dst)
+{
+	ival_map_t mp;
+	const uint8_t *seq;
+	uint64_t i, n;
+
+	assert(farec != NULL);
+	assert(dst   != NULL);
+
+	if (farec->seq_mem == NULL) {
+		errno = EINVAL;
+		return (-1);
+	}
+
+	__ival_init(&mp, dst, classes);
+
+	seq = farec->seq_mem;
+	n   = farec->seq_len;
+	i   = 0;
+
+	for (;;) {
+		/*
+		 * Skip whole blocks of letters that neither start nor finish
+		 * an interval. Most of a genome is plain uppercase sequence or
+		 * long soft-masked repeats.
+		 */
+		while (i + 8 <= n &&
+		       (((__ival_class[seq[i]]     ^ mp.open) | (__ival_class[seq[i + 1]] ^ mp.open) |
+			 (__ival_class[seq[i + 2]] ^ mp.open) | (__ival_class[seq[i + 3]] ^ mp.open) |
+			 (__ival_class[seq[i + 4]] ^ mp.open) | (__ival_class[seq[i + 5]] ^ mp.open) |
+			 (__ival_class[seq[i + 6]] ^ mp.open) | (__ival_class[seq[i + 7]] ^ mp.open)) & mp.classes) == 0)
+			i += 8;
+
+		if (i == n)
+			break;
+
+		__ival_byte(&mp, seq[i], i);
+		++i;
+	}
+
+	return __ival_finish(&mp, n);
+}
+
+void fasta_ivals_free(FASTA_ivals_t *iv)
+{
+	register uint32_t k;
+
+	assert(iv != NULL);
+
+	for (k = 0; k < FASTA_IVAL_CLASSES; ++k) {
+		free(iv->ival[k]);
+		iv->ival[k]  = NULL;
+		iv->count[k] = 0;
+	}
+}
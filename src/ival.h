@@ -0,0 +1,76 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#ifndef IVAL_H
+#define IVAL_H
+
+/*
+ * Mapping of the letter class intervals (FASTA_IVAL_*). The mapper is fed
+ * either letter by letter while scanning a file, or with whole blocks of
+ * an in-memory sequence by fasta_map_intervals().
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "fasta.h"
+
+/**
+ * Classes (FASTA_IVAL_* bits) of each byte
+ */
+extern const uint8_t __ival_class[256];
+
+typedef struct {
+	FASTA_ivals_t *dst;
+	uint32_t size[FASTA_IVAL_CLASSES]; /* allocated intervals of each class */
+	uint32_t classes; /* mapped classes */
+	uint32_t open;    /* classes with an unfinished interval */
+	bool     fail;
+} ival_map_t;
+
+void __ival_init(ival_map_t *mp, FASTA_ivals_t *dst, uint32_t classes);
+
+/**
+ * Start and finish the intervals at the position `pos' of a letter of
+ * the classes `cls'.
+ */
+void __ival_step(ival_map_t *mp, uint32_t cls, uint64_t pos);
+
+/**
+ * Finish the open intervals at the end of a sequence of `len' letters.
+ * Returns 0 on success, -1 if an allocation failed (the intervals are
+ * freed in that case).
+ */
+int __ival_finish(ival_map_t *mp, uint64_t len);
+
+static inline void __ival_byte(ival_map_t *mp, uint8_t ch, uint64_t pos)
+{
+	register uint32_t cls = __ival_class[ch] & mp->classes;
+
+	if ((cls | mp->open) != 0 && cls != mp->open)
+		__ival_step(mp, cls, pos);
+}
+
+#endif /* IVAL_H */
@@ -0,0 +1,920 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#define _DEFAULT_SOURCE
+#include <config.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "helpers.h"
+#include "fasta.h"
+#include "fasta_impl.h"
+#include "kmer.h"
+
+#define KMER_EMPTY    UINT64_MAX /* never a valid k-mer since k <= 31 */
+#define KMER_MINCAP   1024       /* minimal table capacity (entries) */
+#define KMER_INITCAP  65536      /* minimal initial table capacity (entries) */
+#define KMER_ESTCAP   (1 << 24)  /* upper limit of the estimated initial capacity */
+#define KMER_BATCH    4096       /* max. k-mers buffered per partition by a worker */
+#define KMER_MINBATCH 64         /* min. k-mers buffered per partition by a worker */
+#define KMER_BUFFERS  (1 << 22)  /* k-mers buffered by all the workers together */
+#define KMER_MERGEBUF 4096       /* entries read at once from a run while merging */
+
+#define KMER_LOADMAX(cap) (((cap) >> 2) * 3)
+
+typedef struct {
+	uint64_t kmer;
+	uint64_t count;
+} kmer_ent_t;
+
+typedef struct {
+	FILE    *fp;
+	uint64_t count; /* number of entries in the run */
+} kmer_run_t;
+
+typedef struct {
+	pthread_mutex_t lock;
+
+	kmer_ent_t *table;  /* open addressed hash table, linear probing */
+	uint64_t    cap;    /* capacity, always a power of 2 */
+	uint64_t    used;
+	uint64_t    maxcap; /* capacity limit given by the memory budget, 0 - unlimited */
+
+	kmer_run_t *run;    /* sorted runs spilled to disk */
+	size_t      run_cnt;
+
+	/*
+	 * The final lookup table is either held in memory (sorted) or,
+	 * if anything was spilled, in a single merged run (final).
+	 */
+	kmer_ent_t *sorted;
+	uint64_t    sorted_cnt;
+	kmer_run_t  final;
+
+	int error;
+} kmer_part_t;
+
+struct FASTA_kmer {
+	uint32_t k;
+	uint32_t options;
+	uint64_t mask;
+	uint8_t  code[256];
+
+	kmer_part_t *part;
+	uint32_t     part_cnt;
+	uint32_t     batch; /* k-mers buffered per partition by a worker */
+
+	pthread_mutex_t lock; /* protects the fields below while finalizing */
+	uint64_t distinct;
+	uint64_t total;
+	uint64_t hist[FASTA_KMER_HISTMAX];
+};
+
+typedef struct {
+	FASTA           *fa;
+	FASTA_kmer_t    *km;
+	pthread_mutex_t *lock; /* protects `next' */
+	uint32_t        *next; /* next record or partition to process */
+	int              error;
+} kmer_worker_t;
+
+static inline uint64_t kmer_hash(uint64_t x)
+{
+	x ^= x >> 33;
+	x *= UINT64_C(0xff51afd7ed558ccd);
+	x ^= x >> 33;
+	x *= UINT64_C(0xc4ceb9fe1a85ec53);
+	x ^= x >> 33;
+
+	return (x);
+}
+
+static inline uint32_t kmer_partition(FASTA_kmer_t *km, uint64_t kmer)
+{
+	return ((uint32_t)((kmer_hash(kmer) >> 40) % km->part_cnt));
+}
+
+static int kmer_cmp(const void *a, const void *b)
+{
+	const kmer_ent_t *ea = a, *eb = b;
+
+	return (ea->kmer < eb->kmer ? -1 : (ea->kmer > eb->kmer ? 1 : 0));
+}
+
+static kmer_ent_t *kmer_table_new(uint64_t cap)
+{
+	kmer_ent_t *table = alloc_array(kmer_ent_t, cap);
+
+	if (table != NULL)
+		memset(table, 0xff, sizeof(kmer_ent_t) * cap); /* kmer = KMER_EMPTY */
+
+	return (table);
+}
+
+/*
+ * LSD radix sort of `n' entries by the k-mer value (2k bits). Falls back
+ * to qsort() if the temporary array can't be allocated.
+ */
+static void kmer_sort(kmer_ent_t *ent, uint64_t n, uint32_t k)
+{
+	kmer_ent_t *tmp, *src, *dst, *swp;
+	uint64_t   *cnt, i, sum, c;
+	uint32_t    shift;
+
+	if (n < 256) {
+		qsort(ent, n, sizeof(kmer_ent_t), kmer_cmp);
+		return;
+	}
+
+	tmp = alloc_array(kmer_ent_t, n);
+	cnt = alloc_array(uint64_t, 1 << 16);
+
+	if (tmp == NULL || cnt == NULL) {
+		free(tmp);
+		free(cnt);
+		qsort(ent, n, sizeof(kmer_ent_t), kmer_cmp);
+		return;
+	}
+
+	src = ent;
+	dst = tmp;
+
+	for (shift = 0; shift < 2 * k; shift += 16) {
+		memset(cnt, 0, sizeof(uint64_t) * (1 << 16));
+
+		for (i = 0; i < n; ++i)
+			++cnt[(src[i].kmer >> shift) & 0xffff];
+
+		for (i = 0, sum = 0; i < (1 << 16); ++i) {
+			c      = cnt[i];
+			cnt[i] = sum;
+			sum   += c;
+		}
+
+		for (i = 0; i < n; ++i)
+			dst[cnt[(src[i].kmer >> shift) & 0xffff]++] = src[i];
+
+		swp = src;
+		src = dst;
+		dst = swp;
+	}
+
+	if (src != ent)
+		memcpy(ent, src, sizeof(kmer_ent_t) * n);
+
+	free(tmp);
+	free(cnt);
+}
+
+/*
+ * Move the used entries to the beginning of the table and sort them.
+ */
+static void kmer_table_compact(kmer_part_t *p, uint32_t k)
+{
+	register uint64_t i, n;
+
+	for (i = 0, n = 0; i < p->cap; ++i) {
+		if (p->table[i].kmer != KMER_EMPTY)
+			p->table[n++] = p->table[i];
+	}
+
+	assert(n == p->used);
+	kmer_sort(p->table, n, k);
+}
+
+/*
+ * Write the content of the table as a sorted run into a temporary file
+ * and empty the table.
+ */
+static int kmer_spill(kmer_part_t *p, uint32_t k)
+{
+	kmer_run_t run;
+
+	if (p->used == 0)
+		return (0);
+
+	kmer_table_compact(p, k);
+
+	run.fp    = tmpfile();
+	run.count = p->used;
+
+	if (run.fp == NULL) {
+		dP("Unable to create a temporary file for a k-mer run: %s\n", strerror(errno));
+		return (-1);
+	}
+
+	if (fwrite(p->table, sizeof(kmer_ent_t), p->used, run.fp) != p->used) {
+		fclose(run.fp);
+		return (-1);
+	}
+
+	p->run = realloc_array(p->run, kmer_run_t, p->run_cnt + 1);
+	p->run[p->run_cnt++] = run;
+
+	memset(p->table, 0xff, sizeof(kmer_ent_t) * p->cap);
+	p->used = 0;
+
+	return (0);
+}
+
+static int kmer_grow(kmer_part_t *p)
+{
+	kmer_ent_t *table;
+	uint64_t    cap, i, j;
+
+	cap   = p->cap << 1;
+	table = kmer_table_new(cap);
+
+	if (table == NULL)
+		return (-1);
+
+	for (i = 0; i < p->cap; ++i) {
+		if (p->table[i].kmer == KMER_EMPTY)
+			continue;
+
+		j = kmer_hash(p->table[i].kmer) & (cap - 1);
+
+		while (table[j].kmer != KMER_EMPTY)
+			j = (j + 1) & (cap - 1);
+
+		table[j] = p->table[i];
+	}
+
+	free(p->table);
+
+	p->table = table;
+	p->cap   = cap;
+
+	return (0);
+}
+
+static int kmer_insert(kmer_part_t *p, uint32_t k, const uint64_t *kmer, size_t n)
+{
+	register size_t   i;
+	register uint64_t j;
+
+	for (i = 0; i < n; ++i) {
+		if (p->used >= KMER_LOADMAX(p->cap)) {
+			if (p->maxcap == 0 || (p->cap << 1) <= p->maxcap) {
+				if (kmer_grow(p) != 0)
+					return (-1);
+			} else {
+				if (kmer_spill(p, k) != 0)
+					return (-1);
+			}
+		}
+
+		j = kmer_hash(kmer[i]) & (p->cap - 1);
+
+		while (p->table[j].kmer != kmer[i] && p->table[j].kmer != KMER_EMPTY)
+			j = (j + 1) & (p->cap - 1);
+
+		if (p->table[j].kmer == KMER_EMPTY) {
+			p->table[j].kmer  = kmer[i];
+			p->table[j].count = 1;
+			++p->used;
+		} else
+			++p->table[j].count;
+	}
+
+	return (0);
+}
+
+static int kmer_flush(FASTA_kmer_t *km, uint32_t p, const uint64_t *kmer, size_t n)
+{
+	kmer_part_t *part = km->part + p;
+	int r;
+
+	pthread_mutex_lock(&part->lock);
+
+	if (part->error == 0) {
+		if ((r = kmer_insert(part, km->k, kmer, n)) != 0)
+			part->error = r;
+	} else
+		r = part->error;
+
+	pthread_mutex_unlock(&part->lock);
+
+	return (r);
+}
+
+static void *kmer_count_worker(void *arg)
+{
+	kmer_worker_t *w  = arg;
+	FASTA_kmer_t  *km = w->km;
+	FASTA_rec_t    rec, *farec;
+	FILE          *fp;
+	uint64_t      *buffer;
+	size_t        *bufcnt;
+	uint32_t       recno, p;
+	const uint32_t shift = 2 * (km->k - 1);
+
+	buffer = alloc_array(uint64_t, (size_t)km->part_cnt * km->batch);
+	bufcnt = calloc(km->part_cnt, sizeof(size_t));
+	fp     = fopen(w->fa->fa_path, "r");
+
+	if (buffer == NULL || bufcnt == NULL || fp == NULL) {
+		w->error = -1;
+		goto finish;
+	}
+
+	setbuf(fp, NULL);
+	flockfile(fp);
+
+	for (;;) {
+		register uint64_t i, fwd, rev, l, x;
+		register uint8_t  c;
+
+		pthread_mutex_lock(w->lock);
+		recno = (*w->next)++;
+		pthread_mutex_unlock(w->lock);
+
+		if (recno >= fasta_count(w->fa))
+			break;
+
+		farec = __fasta_read_record(w->fa, fp, recno, &rec, FASTA_INMEMSEQ, NULL);
+
+		if (farec == NULL) {
+			dP("Failed to read record #%u\n", recno);
+			w->error = -1;
+			break;
+		}
+
+		for (i = 0, fwd = 0, rev = 0, l = 0; i < farec->seq_len; ++i) {
+			c = km->code[farec->seq_mem[i]];
+
+			if (c > 3) {
+				l = 0;
+				continue;
+			}
+
+			fwd = ((fwd << 2) | c) & km->mask;
+			rev = (rev >> 2) | ((uint64_t)(3 - c) << shift);
+
+			if (++l < km->k)
+				continue;
+
+			x = ((km->options & FASTA_KMER_CANONICAL) && rev < fwd) ? rev : fwd;
+			p = kmer_partition(km, x);
+
+			buffer[(size_t)p * km->batch + bufcnt[p]] = x;
+
+			if (++bufcnt[p] == km->batch) {
+				if (kmer_flush(km, p, buffer + (size_t)p * km->batch, km->batch) != 0)
+					w->error = -1;
+				bufcnt[p] = 0;
+			}
+		}
+
+		fasta_rec_free(farec);
+
+		if (w->error != 0)
+			break;
+	}
+
+	for (p = 0; p < km->part_cnt && w->error == 0; ++p) {
+		if (bufcnt[p] > 0 && kmer_flush(km, p, buffer + (size_t)p * km->batch, bufcnt[p]) != 0)
+			w->error = -1;
+	}
+
+	funlockfile(fp);
+finish:
+	if (fp != NULL)
+		fclose(fp);
+	free(buffer);
+	free(bufcnt);
+
+	return (NULL);
+}
+
+typedef struct {
+	FILE       *fp;
+	kmer_ent_t *buf;
+	size_t      n, i;
+	uint64_t    left;
+} kmer_cursor_t;
+
+static bool kmer_cursor_fill(kmer_cursor_t *c)
+{
+	if (c->i < c->n)
+		return (true);
+	if (c->left == 0)
+		return (false);
+
+	c->n = fread(c->buf, sizeof(kmer_ent_t), c->left < KMER_MERGEBUF ? c->left : KMER_MERGEBUF, c->fp);
+	c->i = 0;
+
+	if (c->n == 0) {
+		c->left = 0;
+		return (false);
+	}
+
+	c->left -= c->n;
+
+	return (true);
+}
+
+/*
+ * Merge all the sorted runs of a partition into a single run. Counts of
+ * k-mers present in more runs are summed.
+ */
+static int kmer_merge(kmer_part_t *p)
+{
+	kmer_cursor_t *cur;
+	kmer_ent_t     ent;
+	size_t         i, m;
+	int            r = 0;
+
+	cur = calloc(p->run_cnt, sizeof(kmer_cursor_t));
+	p->final.fp    = tmpfile();
+	p->final.count = 0;
+
+	if (cur == NULL || p->final.fp == NULL) {
+		free(cur);
+		return (-1);
+	}
+
+	for (i = 0; i < p->run_cnt; ++i) {
+		rewind(p->run[i].fp);
+
+		cur[i].fp   = p->run[i].fp;
+		cur[i].buf  = alloc_array(kmer_ent_t, KMER_MERGEBUF);
+		cur[i].left = p->run[i].count;
+
+		if (cur[i].buf == NULL)
+			r = -1;
+	}
+
+	while (r == 0) {
+		/*
+		 * Find the smallest k-mer among the run heads
+		 */
+		for (i = 0, m = p->run_cnt; i < p->run_cnt; ++i) {
+			if (!kmer_cursor_fill(cur + i))
+				continue;
+			if (m == p->run_cnt || cur[i].buf[cur[i].i].kmer < cur[m].buf[cur[m].i].kmer)
+				m = i;
+		}
+
+		if (m == p->run_cnt)
+			break; /* all runs exhausted */
+
+		ent.kmer  = cur[m].buf[cur[m].i].kmer;
+		ent.count = 0;
+
+		for (i = m; i < p->run_cnt; ++i) {
+			if (kmer_cursor_fill(cur + i) && cur[i].buf[cur[i].i].kmer == ent.kmer)
+				ent.count += cur[i].buf[cur[i].i++].count;
+		}
+
+		if (fwrite(&ent, sizeof ent, 1, p->final.fp) != 1)
+			r = -1;
+
+		++p->final.count;
+	}
+
+	for (i = 0; i < p->run_cnt; ++i) {
+		free(cur[i].buf);
+		fclose(p->run[i].fp);
+	}
+
+	free(cur);
+	free(p->run);
+
+	p->run     = NULL;
+	p->run_cnt = 0;
+
+	if (r == 0 && fflush(p->final.fp) != 0)
+		r = -1;
+
+	return (r);
+}
+
+static void kmer_account(const kmer_ent_t *ent, size_t n, uint64_t *hist, uint64_t *total)
+{
+	register size_t i;
+
+	for (i = 0; i < n; ++i) {
+		++hist[ent[i].count < FASTA_KMER_HISTMAX ? ent[i].count : FASTA_KMER_HISTMAX - 1];
+		*total += ent[i].count;
+	}
+}
+
+/*
+ * Turn the hash table of a partition into the final lookup table and
+ * update the histogram.
+ */
+static int kmer_finalize(FASTA_kmer_t *km, kmer_part_t *p)
+{
+	uint64_t *hist, total = 0, i;
+	uint64_t  distinct;
+
+	if (p->run_cnt == 0) {
+		kmer_table_compact(p, km->k);
+
+		p->sorted     = realloc_array(p->table, kmer_ent_t, p->used > 0 ? p->used : 1);
+		p->sorted_cnt = p->used;
+		p->table      = NULL;
+	} else {
+		if (kmer_spill(p, km->k) != 0)
+			return (-1);
+
+		free(p->table);
+		p->table = NULL;
+
+		if (kmer_merge(p) != 0)
+			return (-1);
+	}
+
+	hist = calloc(FASTA_KMER_HISTMAX, sizeof(uint64_t));
+
+	if (hist == NULL)
+		return (-1);
+
+	if (p->sorted != NULL) {
+		kmer_account(p->sorted, p->sorted_cnt, hist, &total);
+		distinct = p->sorted_cnt;
+	} else {
+		kmer_ent_t *buf = alloc_array(kmer_ent_t, KMER_MERGEBUF);
+		size_t      n;
+
+		if (buf == NULL) {
+			free(hist);
+			return (-1);
+		}
+
+		rewind(p->final.fp);
+
+		while ((n = fread(buf, sizeof(kmer_ent_t), KMER_MERGEBUF, p->final.fp)) > 0)
+			kmer_account(buf, n, hist, &total);
+
+		free(buf);
+		distinct = p->final.count;
+	}
+
+	pthread_mutex_lock(&km->lock);
+
+	for (i = 0; i < FASTA_KMER_HISTMAX; ++i)
+		km->hist[i] += hist[i];
+
+	km->distinct += distinct;
+	km->total    += total;
+
+	pthread_mutex_unlock(&km->lock);
+	free(hist);
+
+	return (0);
+}
+
+static void *kmer_finalize_worker(void *arg)
+{
+	kmer_worker_t *w = arg;
+	uint32_t p;
+
+	for (;;) {
+		pthread_mutex_lock(w->lock);
+		p = (*w->next)++;
+		pthread_mutex_unlock(w->lock);
+
+		if (p >= w->km->part_cnt)
+			break;
+
+		if (kmer_finalize(w->km, w->km->part + p) != 0)
+			w->error = -1;
+	}
+
+	return (NULL);
+}
+
+/*
+ * Run `func' in `threads' workers and wait for them to finish.
+ */
+static int kmer_run(FASTA *fa, FASTA_kmer_t *km, uint32_t threads, void *(*func)(void *))
+{
+	pthread_mutex_t lock;
+	kmer_worker_t  *worker;
+	uint32_t        next = 0, i, started;
+	int             r = 0;
+
+	if ((worker = alloc_array(kmer_worker_t, threads)) == NULL)
+		return (-1);
+
+	pthread_mutex_init(&lock, NULL);
+
+	for (i = 0; i < threads; ++i) {
+		worker[i].fa    = fa;
+		worker[i].km    = km;
+		worker[i].lock  = &lock;
+		worker[i].next  = &next;
+		worker[i].error = 0;
+	}
+
+	if ((started = thread_pool_run(func, worker, sizeof(kmer_worker_t), threads)) == 0)
+		r = -1;
+
+	for (i = 0; i < started; ++i) {
+		if (worker[i].error != 0)
+			r = -1;
+	}
+
+	pthread_mutex_destroy(&lock);
+	free(worker);
+
+	return (r);
+}
+
+FASTA_kmer_t *fasta_kmer_count(FASTA *fa, uint32_t k, uint32_t options, uint32_t threads, uint64_t membudget)
+{
+	FASTA_kmer_t *km;
+	uint64_t      estcap, cap, bufmem;
+	uint32_t      i;
+
+	assert(fa != NULL);
+
+	if (k < 1 || k > FASTA_KMER_MAXK) {
+		errno = EINVAL;
+		return (NULL);
+	}
+
+	if (threads == 0)
+		threads = cpu_count();
+
+	km = calloc(1, sizeof(FASTA_kmer_t));
+
+	if (km == NULL)
+		return (NULL);
+
+	km->k        = k;
+	km->options  = options;
+	km->mask     = (k < 32 ? (UINT64_C(1) << (2 * k)) : 0) - 1;
+	km->part_cnt = threads;
+	km->part     = calloc(km->part_cnt, sizeof(kmer_part_t));
+
+	if (km->part == NULL) {
+		free(km);
+		return (NULL);
+	}
+
+	/*
+	 * Each worker buffers k-mers for every partition, i.e. threads^2
+	 * buffers. They share a fixed total instead of growing with the
+	 * square of the thread count.
+	 */
+	km->batch = KMER_BUFFERS / ((uint64_t)threads * km->part_cnt);
+
+	if (km->batch > KMER_BATCH)
+		km->batch = KMER_BATCH;
+	if (km->batch < KMER_MINBATCH)
+		km->batch = KMER_MINBATCH;
+
+	bufmem = (uint64_t)threads * km->part_cnt * km->batch * sizeof(uint64_t);
+
+	memset(km->code, 4, sizeof km->code);
+	km->code['A'] = km->code['a'] = 0;
+	km->code['C'] = km->code['c'] = 1;
+	km->code['G'] = km->code['g'] = 2;
+	km->code['T'] = km->code['t'] = 3;
+
+	pthread_mutex_init(&km->lock, NULL);
+
+	/*
+	 * Estimate the initial table size from the number of residues so that
+	 * the tables don't have to be rehashed too many times.
+	 */
+	for (i = 0, estcap = 0; i < fasta_count(fa); ++i)
+		estcap += fa->fa_record[i].seq_len;
+
+	estcap = (estcap / km->part_cnt / 3) * 4;
+
+	for (cap = KMER_INITCAP; cap < estcap && cap < KMER_ESTCAP;)
+		cap <<= 1;
+
+	for (i = 0; i < km->part_cnt; ++i) {
+		kmer_part_t *p = km->part + i;
+
+		pthread_mutex_init(&p->lock, NULL);
+
+		if (membudget > 0) {
+			/* the worker buffers are charged to the budget too */
+			uint64_t budget = (membudget > bufmem ? membudget - bufmem : 0) / km->part_cnt;
+
+			for (p->maxcap = KMER_MINCAP; (p->maxcap << 1) * sizeof(kmer_ent_t) <= budget;)
+				p->maxcap <<= 1;
+
+			p->cap = p->maxcap < cap ? p->maxcap : cap;
+		} else
+			p->cap = cap;
+
+		if ((p->table = kmer_table_new(p->cap)) == NULL)
+			goto fail;
+	}
+
+	/*
+	 * Count the k-mers and then turn each partition into a lookup table
+	 */
+	if (kmer_run(fa, km, threads, kmer_count_worker) != 0)
+		goto fail;
+
+	for (i = 0; i < km->part_cnt; ++i) {
+		if (km->part[i].error != 0)
+			goto fail;
+	}
+
+	if (kmer_run(fa, km, threads, kmer_finalize_worker) != 0)
+		goto fail;
+
+	return (km);
+fail:
+	fasta_kmer_free(km);
+	return (NULL);
+}
+
+/*
+ * Binary search in the final run of a partition.
+ */
+static uint64_t kmer_run_lookup(kmer_run_t *run, uint64_t kmer)
+{
+	kmer_ent_t ent;
+	uint64_t   l, r, m;
+
+	l = 0;
+	r = run->count;
+
+	while (l < r) {
+		m = l + (r - l) / 2;
+
+		if (pread(fileno(run->fp), &ent, sizeof ent, (off_t)(m * sizeof ent)) != (ssize_t)sizeof ent)
+			return (0);
+
+		if (ent.kmer == kmer)
+			return (ent.count);
+		else if (ent.kmer < kmer)
+			l = m + 1;
+		else
+			r = m;
+	}
+
+	return (0);
+}
+
+uint64_t fasta_kmer_lookup(FASTA_kmer_t *km, const char *kmer)
+{
+	kmer_part_t *p;
+	kmer_ent_t   key, *ent;
+	uint64_t     fwd = 0, rev = 0;
+	uint32_t     i;
+	uint8_t      c;
+
+	assert(km != NULL);
+	assert(kmer != NULL);
+
+	for (i = 0; i < km->k; ++i) {
+		c = km->code[(uint8_t)kmer[i]];
+
+		if (c > 3)
+			return (0);
+
+		fwd = (fwd << 2) | c;
+		rev = rev | ((uint64_t)(3 - c) << (2 * i));
+	}
+
+	if ((km->options & FASTA_KMER_CANONICAL) && rev < fwd)
+		fwd = rev;
+
+	p = km->part + kmer_partition(km, fwd);
+
+	if (p->sorted != NULL) {
+		key.kmer = fwd;
+		ent = bsearch(&key, p->sorted, p->sorted_cnt, sizeof(kmer_ent_t), kmer_cmp);
+
+		return (ent != NULL ? ent->count : 0);
+	}
+
+	return (kmer_run_lookup(&p->final, fwd));
+}
+
+uint64_t fasta_kmer_distinct(FASTA_kmer_t *km)
+{
+	return (km->distinct);
+}
+
+uint64_t fasta_kmer_total(FASTA_kmer_t *km)
+{
+	return (km->total);
+}
+
+int fasta_kmer_histogram(FASTA_kmer_t *km, uint64_t *hist, size_t hist_len)
+{
+	size_t i;
+
+	if (hist_len == 0) {
+		errno = EINVAL;
+		return (-1);
+	}
+
+	memset(hist, 0, sizeof(uint64_t) * hist_len);
+
+	for (i = 0; i < FASTA_KMER_HISTMAX; ++i)
+		hist[i < hist_len ? i : hist_len - 1] += km->hist[i];
+
+	return (0);
+}
+
+static void kmer_decode(FASTA_kmer_t *km, uint64_t kmer, char *dst)
+{
+	register uint32_t i;
+
+	for (i = km->k; i > 0; --i, kmer >>= 2)
+		dst[i - 1] = "ACGT"[kmer & 3];
+
+	dst[km->k] = '\0';
+}
+
+int fasta_kmer_dump(FASTA_kmer_t *km, FILE *fp)
+{
+	char       kmer[FASTA_KMER_MAXK + 1];
+	kmer_ent_t buf[256];
+	uint32_t   p;
+	size_t     i, n;
+
+	for (p = 0; p < km->part_cnt; ++p) {
+		kmer_part_t *part = km->part + p;
+
+		if (part->sorted != NULL) {
+			for (i = 0; i < part->sorted_cnt; ++i) {
+				kmer_decode(km, part->sorted[i].kmer, kmer);
+				fprintf(fp, "%s %"PRIu64"\n", kmer, part->sorted[i].count);
+			}
+		} else {
+			rewind(part->final.fp);
+
+			while ((n = fread(buf, sizeof buf[0], sizeof buf / sizeof buf[0], part->final.fp)) > 0) {
+				for (i = 0; i < n; ++i) {
+					kmer_decode(km, buf[i].kmer, kmer);
+					fprintf(fp, "%s %"PRIu64"\n", kmer, buf[i].count);
+				}
+			}
+		}
+	}
+
+	return (ferror(fp) ? -1 : 0);
+}
+
+void fasta_kmer_free(FASTA_kmer_t *km)
+{
+	uint32_t i;
+	size_t   r;
+
+	if (km == NULL)
+		return;
+
+	for (i = 0; i < km->part_cnt; ++i) {
+		kmer_part_t *p = km->part + i;
+
+		for (r = 0; r < p->run_cnt; ++r)
+			fclose(p->run[r].fp);
+
+		if (p->final.fp != NULL)
+			fclose(p->final.fp);
+
+		free(p->run);
+		free(p->table);
+		free(p->sorted);
+		pthread_mutex_destroy(&p->lock);
+	}
+
+	pthread_mutex_destroy(&km->lock);
+	free(km->part);
+	free(km);
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#ifndef KMER_H
+#define KMER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "fasta.h"
+
+#define FASTA_KMER_MAXK      31         /**< maximal k-mer length (2 bits per base) */
+#define FASTA_KMER_CANONICAL 0x00000001 /**< Count a k-mer and its reverse complement as one */
+#define FASTA_KMER_HISTMAX   65536      /**< Number of histogram buckets kept internally */
+
+        /**
+         * Opaque k-mer counting result. It's returned by fasta_kmer_count()
+         * and has to be freed using fasta_kmer_free().
+         */
+        typedef struct FASTA_kmer FASTA_kmer_t;
+
+        /**
+         * Count all k-mers of length `k' (1 <= k <= FASTA_KMER_MAXK) in the
+         * db `fa'. Only the letters A, C, G and T (in any case) are counted,
+         * any other letter breaks the k-mer. The k-mers are partitioned by
+         * their hash value across `threads' workers (0 means one worker per
+         * online processor). If `membudget' is not 0, the in-memory tables
+         * and the k-mer buffers of the workers are limited to about
+         * `membudget' bytes in total and sorted runs are spilled to
+         * temporary files whenever the limit is reached.
+         */
+        FASTA_kmer_t *fasta_kmer_count(FASTA *fa, uint32_t k, uint32_t options, uint32_t threads, uint64_t membudget);
+
+        /**
+         * Return the count of the k-mer given as a string of `k' letters.
+         */
+        uint64_t fasta_kmer_lookup(FASTA_kmer_t *km, const char *kmer);
+
+        /**
+         * Number of distinct k-mers.
+         */
+        uint64_t fasta_kmer_distinct(FASTA_kmer_t *km);
+
+        /**
+         * Total number of k-mers counted.
+         */
+        uint64_t fasta_kmer_total(FASTA_kmer_t *km);
+
+        /**
+         * Fill `hist' with the count histogram, i.e. `hist[c]' is the number of
+         * distinct k-mers that occured exactly `c' times. The last bucket
+         * (hist[hist_len - 1]) accumulates all the higher counts as well.
+         */
+        int fasta_kmer_histogram(FASTA_kmer_t *km, uint64_t *hist, size_t hist_len);
+
+        /**
+         * Write the lookup table as "<kmer> <count>" lines into `fp'. The
+         * k-mers are sorted within each partition.
+         */
+        int fasta_kmer_dump(FASTA_kmer_t *km, FILE *fp);
+
+        /**
+         * Free the counting result and remove the temporary files.
+         */
+        void fasta_kmer_free(FASTA_kmer_t *km);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KMER_H */
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <time.h>
+#include "fasta.h"
+
+/*
+ * Helpers for updating the FASTA_metrics_t structure. All of them do
+ * nothing if `m' is NULL, i.e. if the metrics aren't collected. The
+ * counters are updated atomically since a db may be read from several
+ * threads (e.g. by fasta_kmer_count()). The I/O and allocation
+ * counters are updated next to the calls they count.
+ */
+
+#define metrics_add(m, field, n)						\
+	do {									\
+		if ((m) != NULL)						\
+			__atomic_fetch_add(&(m)->field, (n), __ATOMIC_RELAXED); \
+	} while (0)
+
+static inline uint64_t metrics_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
+}
+
+/**
+ * Start a measurement. Returns 0 if the metrics aren't collected.
+ */
+static inline uint64_t metrics_start(FASTA_metrics_t *m)
+{
+	return (m != NULL ? metrics_now() : 0);
+}
+
+/**
+ * Finish a measurement of the phase `ph' started at `start'.
+ */
+static inline void metrics_phase(FASTA_metrics_t *m, FASTA_phase_t ph, uint64_t start)
+{
+	uint64_t ns;
+
+	if (m == NULL)
+		return;
+
+	ns = metrics_now() - start;
+
+	__atomic_fetch_add(&m->phase_ns[ph], ns, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&m->phase_count[ph], 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&m->phase_hist[ph][63 - __builtin_clzll(ns | 1)], 1, __ATOMIC_RELAXED);
+}
+
+#endif /* METRICS_H */
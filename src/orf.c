@@ -0,0 +1,572 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#define _DEFAULT_SOURCE
+#include <config.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "helpers.h"
+#include "fasta.h"
+#include "fasta_impl.h"
+#include "codon.h"
+
+#define ORF_CHUNK  (192 * 8192)    /* positions scanned by one task, a multiple of 3 * 64 */
+#define ORF_BIGREC (4 * ORF_CHUNK) /* records split into chunks by fasta_find_orfs() */
+
+/*
+ * Kinds of codons marked in the bitmaps
+ */
+#define ORF_FSTOP  0
+#define ORF_FSTART 1
+#define ORF_RSTOP  2
+#define ORF_RSTART 3
+#define ORF_KINDS  4
+
+/*
+ * The codons are marked in bitmaps by their position p on the forward
+ * strand: the bit p / 3 of the bitmap of the phase p % 3. A forward frame
+ * f is the phase f, the reverse frame r is the phase (len - 3 - r) % 3
+ * read backwards.
+ */
+typedef struct {
+	const uint8_t *nt;
+	const uint8_t *seq;
+	uint64_t       len;
+	uint64_t       minlen;
+	uint32_t       options;
+	uint8_t        cls[FASTA_CODON_SPACE]; /* codon -> kinds */
+	uint64_t       words; /* words of each bitmap */
+	uint64_t      *bm[ORF_KINDS][3];
+	uint64_t      *bm_mem;
+	FASTA_orfs_t  *dst;
+} orf_map_t;
+
+typedef struct {
+	orf_map_t       *map;
+	pthread_mutex_t *lock;
+	uint64_t        *next; /* next task */
+	uint64_t         tasks;
+	int            (*func)(orf_map_t *, uint64_t);
+	int              error;
+} orf_worker_t;
+
+/*
+ * Mark the codons of the bitmap words of the chunk `task'. The words of
+ * different chunks don't overlap, so the chunks may be scanned at once.
+ */
+static int orf_fill(orf_map_t *map, uint64_t task)
+{
+	const uint8_t *nt = map->nt, *seq = map->seq;
+	uint64_t w, w_end, p, p_end;
+	uint32_t c1, c2, c3, ph, bit, k;
+
+	w     = task * (ORF_CHUNK / 192);
+	w_end = w + (ORF_CHUNK / 192);
+
+	if (w_end > map->words)
+		w_end = map->words;
+
+	for (; w < w_end; ++w) {
+		uint64_t acc[ORF_KINDS][3] = { { 0 } };
+
+		p     = w * 192;
+		p_end = p + 192 < map->len - 2 ? p + 192 : map->len - 2;
+		c2    = nt[seq[p]];
+		c3    = nt[seq[p + 1]];
+
+		for (ph = 0, bit = 0; p < p_end; ++p) {
+			uint32_t c;
+
+			c1 = c2; c2 = c3; c3 = nt[seq[p + 2]];
+			c  = map->cls[c1 * 25 + c2 * 5 + c3];
+
+			acc[ORF_FSTOP][ph]  |= (uint64_t)((c >> ORF_FSTOP)  & 1) << bit;
+			acc[ORF_FSTART][ph] |= (uint64_t)((c >> ORF_FSTART) & 1) << bit;
+			acc[ORF_RSTOP][ph]  |= (uint64_t)((c >> ORF_RSTOP)  & 1) << bit;
+			acc[ORF_RSTART][ph] |= (uint64_t)((c >> ORF_RSTART) & 1) << bit;
+
+			if (++ph == 3) {
+				ph = 0;
+				++bit;
+			}
+		}
+
+		for (k = 0; k < ORF_KINDS; ++k)
+			for (ph = 0; ph < 3; ++ph)
+				map->bm[k][ph][w] = acc[k][ph];
+	}
+
+	return (0);
+}
+
+/*
+ * The lowest set bit in [from, to), or `to' if there's none
+ */
+static uint64_t bm_next(const uint64_t *bm, uint64_t from, uint64_t to)
+{
+	uint64_t w, x;
+
+	if (from >= to)
+		return (to);
+
+	w = from >> 6;
+	x = bm[w] & (~UINT64_C(0) << (from & 63));
+
+	while (x == 0) {
+		if (++w > (to - 1) >> 6)
+			return (to);
+		x = bm[w];
+	}
+
+	from = (w << 6) + (uint64_t)__builtin_ctzll(x);
+
+	return (from < to ? from : to);
+}
+
+/*
+ * The highest set bit in [from, to), or UINT64_MAX if there's none
+ */
+static uint64_t bm_prev(const uint64_t *bm, uint64_t from, uint64_t to)
+{
+	uint64_t w, x, r;
+
+	if (from >= to)
+		return (UINT64_MAX);
+
+	w = (to - 1) >> 6;
+	x = bm[w] & (~UINT64_C(0) >> (63 - ((to - 1) & 63)));
+
+	while (x == 0) {
+		if (w-- <= from >> 6)
+			return (UINT64_MAX);
+		x = bm[w];
+	}
+
+	r = (w << 6) + 63 - (uint64_t)__builtin_clzll(x);
+
+	return (r >= from ? r : UINT64_MAX);
+}
+
+static int orf_push(FASTA_orfs_t *dst, uint32_t frame, size_t *size, uint64_t a, uint64_t b)
+{
+	if (dst->count[frame] == *size) {
+		size_t n = *size > 0 ? *size * 2 : 16;
+		FASTA_u64p *orf = realloc_array(dst->orf[frame], FASTA_u64p, n);
+
+		if (orf == NULL)
+			return (-1);
+
+		dst->orf[frame] = orf;
+		*size = n;
+	}
+
+	dst->orf[frame][dst->count[frame]].a = a;
+	dst->orf[frame][dst->count[frame]].b = b;
+	++dst->count[frame];
+
+	return (0);
+}
+
+/*
+ * Collect the ORFs of the frame `task' by jumping from a stop codon to
+ * the next one and looking for the first start codon in between.
+ */
+static int orf_extract(orf_map_t *map, uint64_t task)
+{
+	FASTA_orfs_t *dst = map->dst;
+	const uint32_t frame = (uint32_t)task;
+	const uint32_t skip  = frame % 3;
+	const bool partial = (map->options & FASTA_ORF_PARTIAL) != 0;
+	const bool nostart = (map->options & FASTA_ORF_NOSTART) != 0;
+	uint64_t m, s, st, a, b;
+	size_t size = 0, i;
+
+	if (map->len < 3 + (uint64_t)skip)
+		return (0);
+
+	m = (map->len - skip) / 3;
+
+	if (frame < 3) {
+		const uint64_t *stop  = map->bm[ORF_FSTOP][frame];
+		const uint64_t *start = map->bm[ORF_FSTART][frame];
+		uint64_t prev = 0;
+
+		while (prev < m) {
+			s = bm_next(stop, prev, m);
+
+			if (s == m && !partial)
+				break;
+
+			if (nostart || (partial && prev == 0))
+				st = prev;
+			else
+				st = bm_next(start, prev, s);
+
+			if (st < s) {
+				a = skip + 3 * st;
+				b = skip + 3 * (s == m ? m - 1 : s) + 2;
+
+				if (b - a + 1 >= map->minlen && orf_push(dst, frame, &size, a, b) != 0)
+					return (-1);
+			}
+
+			prev = s + 1;
+		}
+	} else {
+		const uint32_t ph = (uint32_t)((map->len - 3 - skip) % 3);
+		const uint64_t *stop  = map->bm[ORF_RSTOP][ph];
+		const uint64_t *start = map->bm[ORF_RSTART][ph];
+		uint64_t top = m;
+
+		/*
+		 * The codon slots are read from `top' downwards, `s' is
+		 * UINT64_MAX if there's no stop codon left
+		 */
+		while (top > 0) {
+			uint64_t from;
+
+			s    = bm_prev(stop, 0, top);
+			from = s == UINT64_MAX ? 0 : s + 1;
+
+			if (s == UINT64_MAX && !partial)
+				break;
+
+			if (nostart || (partial && top == m))
+				st = from < top ? top - 1 : UINT64_MAX;
+			else
+				st = bm_prev(start, from, top);
+
+			if (st != UINT64_MAX) {
+				a = ph + 3 * (s == UINT64_MAX ? 0 : s);
+				b = ph + 3 * st + 2;
+
+				if (b - a + 1 >= map->minlen && orf_push(dst, frame, &size, a, b) != 0)
+					return (-1);
+			}
+
+			if (s == UINT64_MAX)
+				break;
+
+			top = s;
+		}
+
+		/*
+		 * Found from the end, sort by the start position
+		 */
+		for (i = 0; i < dst->count[frame] / 2; ++i) {
+			FASTA_u64p t = dst->orf[frame][i];
+
+			dst->orf[frame][i] = dst->orf[frame][dst->count[frame] - 1 - i];
+			dst->orf[frame][dst->count[frame] - 1 - i] = t;
+		}
+	}
+
+	return (0);
+}
+
+static void *orf_worker(void *arg)
+{
+	orf_worker_t *w = arg;
+	uint64_t task;
+
+	for (;;) {
+		pthread_mutex_lock(w->lock);
+		task = (*w->next)++;
+		pthread_mutex_unlock(w->lock);
+
+		if (task >= w->tasks)
+			break;
+
+		if (w->func(w->map, task) != 0) {
+			w->error = -1;
+			break;
+		}
+	}
+
+	return (NULL);
+}
+
+/*
+ * Run the `tasks' tasks using up to `threads' workers
+ */
+static int orf_run(orf_map_t *map, uint64_t tasks, uint32_t threads, int (*func)(orf_map_t *, uint64_t))
+{
+	pthread_mutex_t lock;
+	orf_worker_t   *worker;
+	uint64_t        next = 0, i;
+	uint32_t        started;
+	int             r = 0;
+
+	if (threads > tasks)
+		threads = (uint32_t)tasks;
+
+	if (threads <= 1) {
+		for (i = 0; i < tasks; ++i)
+			if (func(map, i) != 0)
+				return (-1);
+		return (0);
+	}
+
+	if ((worker = alloc_array(orf_worker_t, threads)) == NULL)
+		return (-1);
+
+	pthread_mutex_init(&lock, NULL);
+
+	for (i = 0; i < threads; ++i) {
+		worker[i].map   = map;
+		worker[i].lock  = &lock;
+		worker[i].next  = &next;
+		worker[i].tasks = tasks;
+		worker[i].func  = func;
+		worker[i].error = 0;
+	}
+
+	if ((started = thread_pool_run(orf_worker, worker, sizeof(orf_worker_t), threads)) == 0)
+		r = -1;
+
+	for (i = 0; i < started; ++i) {
+		if (worker[i].error != 0)
+			r = -1;
+	}
+
+	pthread_mutex_destroy(&lock);
+	free(worker);
+
+	return (r);
+}
+
+int fasta_map_orfs(const FASTA_codon_t *ct, const uint8_t *seq, uint64_t len,
+		   uint64_t minlen, uint32_t options, uint32_t threads, FASTA_orfs_t *dst)
+{
+	orf_map_t map;
+	uint32_t i, k, ph;
+	int r;
+
+	assert(ct != NULL);
+	assert(dst != NULL);
+
+	memset(dst, 0, sizeof(FASTA_orfs_t));
+
+	if (len < 3)
+		return (0);
+
+	if (threads == 0)
+		threads = cpu_count();
+
+	map.nt      = ct->nt;
+	map.seq     = seq;
+	map.len     = len;
+	map.minlen  = minlen;
+	map.options = options;
+	map.dst     = dst;
+	map.words   = ((len - 3) / 3 >> 6) + 1;
+	map.bm_mem  = alloc_array(uint64_t, map.words * ORF_KINDS * 3);
+
+	if (map.bm_mem == NULL)
+		return (-1);
+
+	for (k = 0; k < ORF_KINDS; ++k)
+		for (ph = 0; ph < 3; ++ph)
+			map.bm[k][ph] = map.bm_mem + (k * 3 + ph) * map.words;
+
+	for (i = 0; i < FASTA_CODON_SPACE; ++i)
+		map.cls[i] = (ct->aa[i]    == '*') << ORF_FSTOP  | (ct->start[i]    != 0) << ORF_FSTART |
+			     (ct->aa_rc[i] == '*') << ORF_RSTOP  | (ct->start_rc[i] != 0) << ORF_RSTART;
+
+	r = orf_run(&map, (map.words + ORF_CHUNK / 192 - 1) / (ORF_CHUNK / 192), threads, orf_fill);
+
+	if (r == 0)
+		r = orf_run(&map, FASTA_FRAMES, threads, orf_extract);
+
+	free(map.bm_mem);
+
+	if (r != 0)
+		fasta_orfs_free(dst);
+
+	return (r);
+}
+
+void fasta_orfs_free(FASTA_orfs_t *orfs)
+{
+	uint32_t f;
+
+	for (f = 0; f < FASTA_FRAMES; ++f) {
+		free(orfs->orf[f]);
+		orfs->orf[f]   = NULL;
+		orfs->count[f] = 0;
+	}
+}
+
+typedef struct {
+	FASTA               *fa;
+	const FASTA_codon_t *ct;
+	uint64_t             minlen;
+	uint32_t             options;
+	uint32_t             threads; /* workers scanning the chunks of a record */
+	bool                 big;     /* process the big records */
+	FASTA_orfs_t        *result;
+	pthread_mutex_t     *lock;
+	uint32_t            *next;
+	int                  error;
+} orf_rec_worker_t;
+
+/*
+ * Find the ORFs of either the records shorter than ORF_BIGREC, one per
+ * worker, or the longer ones, by all the workers at once.
+ */
+static void *orf_rec_worker(void *arg)
+{
+	orf_rec_worker_t *w = arg;
+	FASTA_rec_t       rec, *farec;
+	FILE             *fp;
+	uint32_t          recno;
+
+	if ((fp = fopen(w->fa->fa_path, "r")) == NULL) {
+		w->error = -1;
+		return (NULL);
+	}
+
+	setbuf(fp, NULL);
+	flockfile(fp);
+
+	for (;;) {
+		if (w->lock != NULL) {
+			pthread_mutex_lock(w->lock);
+			recno = (*w->next)++;
+			pthread_mutex_unlock(w->lock);
+		} else
+			recno = (*w->next)++;
+
+		if (recno >= fasta_count(w->fa))
+			break;
+		if ((w->fa->fa_record[recno].seq_len >= ORF_BIGREC) != w->big)
+			continue;
+
+		farec = __fasta_read_record(w->fa, fp, recno, &rec, FASTA_INMEMSEQ, NULL);
+
+		if (farec == NULL) {
+			dP("Failed to read record #%u\n", recno);
+			w->error = -1;
+			break;
+		}
+
+		if (fasta_map_orfs(w->ct, farec->seq_mem, farec->seq_len, w->minlen, w->options,
+				   w->threads, w->result + recno) != 0)
+			w->error = -1;
+
+		fasta_rec_free(farec);
+
+		if (w->error != 0)
+			break;
+	}
+
+	funlockfile(fp);
+	fclose(fp);
+
+	return (NULL);
+}
+
+FASTA_orfs_t *fasta_find_orfs(FASTA *fa, const FASTA_codon_t *ct, uint64_t minlen, uint32_t options, uint32_t threads)
+{
+	FASTA_orfs_t     *result;
+	pthread_mutex_t   lock;
+	orf_rec_worker_t *worker;
+	uint32_t          next = 0, i, started;
+	int               r = 0;
+
+	assert(fa != NULL);
+	assert(ct != NULL);
+
+	if (threads == 0)
+		threads = cpu_count();
+
+	result = calloc(fasta_count(fa) > 0 ? fasta_count(fa) : 1, sizeof(FASTA_orfs_t));
+	worker = alloc_array(orf_rec_worker_t, threads);
+
+	if (result == NULL || worker == NULL) {
+		free(result);
+		free(worker);
+		return (NULL);
+	}
+
+	pthread_mutex_init(&lock, NULL);
+
+	for (i = 0; i < threads; ++i) {
+		worker[i].fa      = fa;
+		worker[i].ct      = ct;
+		worker[i].minlen  = minlen;
+		worker[i].options = options;
+		worker[i].threads = 1;
+		worker[i].big     = false;
+		worker[i].result  = result;
+		worker[i].lock    = &lock;
+		worker[i].next    = &next;
+		worker[i].error   = 0;
+	}
+
+	if ((started = thread_pool_run(orf_rec_worker, worker, sizeof(orf_rec_worker_t), threads)) == 0)
+		r = -1;
+
+	for (i = 0; i < started; ++i) {
+		if (worker[i].error != 0)
+			r = -1;
+	}
+
+	pthread_mutex_destroy(&lock);
+
+	/*
+	 * The long records, one by one, split into chunks
+	 */
+	if (r == 0) {
+		next = 0;
+		worker[0].threads = threads;
+		worker[0].big     = true;
+		worker[0].lock    = NULL;
+
+		orf_rec_worker(worker);
+
+		if (worker[0].error != 0)
+			r = -1;
+	}
+
+	free(worker);
+
+	if (r != 0) {
+		for (i = 0; i < fasta_count(fa); ++i)
+			fasta_orfs_free(result + i);
+		free(result);
+		return (NULL);
+	}
+
+	return (result);
+}
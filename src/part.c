@@ -0,0 +1,488 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#define _DEFAULT_SOURCE
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "helpers.h"
+#include "fasta.h"
+#include "fasta_impl.h"
+#include "part.h"
+
+typedef struct {
+	uint64_t len;
+	uint32_t recno;
+} part_rec_t;
+
+static int part_reccmp(const void *a, const void *b)
+{
+	const part_rec_t *x = a, *y = b;
+
+	if (x->len != y->len)
+		return (x->len < y->len ? 1 : -1);
+
+	return (x->recno > y->recno) - (x->recno < y->recno);
+}
+
+/*
+ * Min-heap of part numbers ordered by the number of residues
+ */
+static bool part_less(const FASTA_part_t *p, uint32_t a, uint32_t b)
+{
+	if (p->residues[a] != p->residues[b])
+		return (p->residues[a] < p->residues[b]);
+
+	return (a < b);
+}
+
+static void part_sift_down(const FASTA_part_t *p, uint32_t *heap, uint32_t n, uint32_t i)
+{
+	uint32_t c, t;
+
+	while ((c = 2 * i + 1) < n) {
+		if (c + 1 < n && part_less(p, heap[c + 1], heap[c]))
+			++c;
+		if (!part_less(p, heap[c], heap[i]))
+			break;
+
+		t = heap[c], heap[c] = heap[i], heap[i] = t;
+		i = c;
+	}
+}
+
+static int part_lpt(FASTA *fa, FASTA_part_t *p)
+{
+	part_rec_t *order;
+	uint32_t   *heap, i, k;
+
+	order = alloc_array(part_rec_t, p->rec_cnt > 0 ? p->rec_cnt : 1);
+	heap  = alloc_array(uint32_t, p->part_cnt);
+
+	if (order == NULL || heap == NULL) {
+		free(order);
+		free(heap);
+		return (-1);
+	}
+
+	for (i = 0; i < p->rec_cnt; ++i) {
+		order[i].len   = fa->fa_record[i].seq_len;
+		order[i].recno = i;
+	}
+
+	qsort(order, p->rec_cnt, sizeof(part_rec_t), part_reccmp);
+
+	/* all the parts are empty, i.e. already a heap */
+	for (k = 0; k < p->part_cnt; ++k)
+		heap[k] = k;
+
+	for (i = 0; i < p->rec_cnt; ++i) {
+		k = heap[0];
+
+		p->rec_part[order[i].recno] = k;
+		p->residues[k] += order[i].len;
+		p->records[k]  += 1;
+
+		part_sift_down(p, heap, p->part_cnt, 0);
+	}
+
+	free(order);
+	free(heap);
+
+	return (0);
+}
+
+static int part_contig(FASTA *fa, FASTA_part_t *p)
+{
+	uint64_t total = 0, acc = 0, bound;
+	uint32_t i, k = 0;
+
+	for (i = 0; i < p->rec_cnt; ++i)
+		total += fa->fa_record[i].seq_len;
+
+#define PART_BOUND(k) (total / p->part_cnt * ((k) + 1) + total % p->part_cnt * ((k) + 1) / p->part_cnt)
+
+	bound = PART_BOUND(0);
+
+	for (i = 0; i < p->rec_cnt; ++i) {
+		uint64_t len = fa->fa_record[i].seq_len;
+
+		/*
+		 * A record belongs to the part containing its midpoint
+		 */
+		while (k + 1 < p->part_cnt && acc + len / 2 >= bound) {
+			++k;
+			bound = PART_BOUND(k);
+		}
+
+		p->rec_part[i]  = k;
+		p->residues[k] += len;
+		p->records[k]  += 1;
+
+		acc += len;
+	}
+#undef PART_BOUND
+	return (0);
+}
+
+FASTA_part_t *fasta_partition(FASTA *fa, uint32_t parts, uint32_t flags)
+{
+	FASTA_part_t *p;
+	int r;
+
+	assert(fa != NULL);
+
+	if (parts == 0) {
+		errno = EINVAL;
+		return (NULL);
+	}
+
+	p = alloc_type(FASTA_part_t);
+
+	if (p == NULL)
+		return (NULL);
+
+	p->part_cnt = parts;
+	p->rec_cnt  = fa->fa_rcount;
+	p->rec_part = alloc_array(uint32_t, p->rec_cnt > 0 ? p->rec_cnt : 1);
+	p->residues = calloc(parts, sizeof(uint64_t));
+	p->records  = calloc(parts, sizeof(uint32_t));
+
+	if (p->rec_part == NULL || p->residues == NULL || p->records == NULL) {
+		fasta_partition_free(p);
+		return (NULL);
+	}
+
+	if (flags & FASTA_PART_CONTIG)
+		r = part_contig(fa, p);
+	else
+		r = part_lpt(fa, p);
+
+	if (r != 0) {
+		fasta_partition_free(p);
+		return (NULL);
+	}
+
+	return (p);
+}
+
+void fasta_partition_free(FASTA_part_t *part)
+{
+	if (part == NULL)
+		return;
+
+	free(part->rec_part);
+	free(part->residues);
+	free(part->records);
+	free(part);
+}
+
+int fasta_partition_write(FASTA *fa, const FASTA_part_t *part, uint32_t k, const char *path)
+{
+	FASTA_rec_t   *rec   = NULL;
+	FASTA_stats_t *stats = NULL;
+	FASTA_hash_t  *hash  = NULL;
+	FASTA_ivals_t *ivals = NULL;
+	FASTA          shard;
+	struct stat    st;
+	char          *idx_path = NULL;
+	uint64_t       filesize, out = 0, *end = NULL;
+	uint64_t       pend_start = 0, pend_len = 0;
+	uint32_t       i, n = 0;
+	bool           final_nl = true;
+	int            in_fd, out_fd = -1, r = -1;
+	uint8_t        ch;
+
+	assert(fa != NULL);
+	assert(part != NULL);
+	assert(path != NULL);
+
+	if (k >= part->part_cnt || part->rec_cnt != fa->fa_rcount) {
+		errno = EINVAL;
+		return (-1);
+	}
+
+	in_fd = open(fa->fa_path, O_RDONLY);
+
+	if (in_fd < 0)
+		return (-1);
+
+	if (fstat(in_fd, &st) != 0)
+		goto finish;
+
+	filesize = (uint64_t)st.st_size;
+
+	if (filesize > 0 && (pread(in_fd, &ch, 1, filesize - 1) != 1 || ch != '\n'))
+		final_nl = false;
+
+	rec = alloc_array(FASTA_rec_t, part->records[k] > 0 ? part->records[k] : 1);
+	end = alloc_array(uint64_t, part->records[k] > 0 ? part->records[k] : 1);
+	idx_path = alloc_array(char, strlen(path) + strlen(FASTA_INDEX_EXT) + 1);
+
+	if (rec == NULL || end == NULL || idx_path == NULL)
+		goto finish;
+
+	if (fa->fa_stats != NULL) {
+		stats = alloc_array(FASTA_stats_t, part->records[k] > 0 ? part->records[k] : 1);
+
+		if (stats == NULL)
+			goto finish;
+	}
+
+	if (fa->fa_hash != NULL) {
+		hash = alloc_array(FASTA_hash_t, part->records[k] > 0 ? part->records[k] : 1);
+
+		if (hash == NULL)
+			goto finish;
+	}
+
+	if (fa->fa_ivals != NULL) {
+		ivals = alloc_array(FASTA_ivals_t, part->records[k] > 0 ? part->records[k] : 1);
+
+		if (ivals == NULL)
+			goto finish;
+	}
+
+	strcpy(idx_path, path);
+	strcat(idx_path, FASTA_INDEX_EXT);
+
+	out_fd = open(path, O_RDWR|O_CREAT|O_TRUNC, 0666);
+
+	if (out_fd < 0)
+		goto finish;
+
+	for (i = 0; i < fa->fa_rcount; ++i) {
+		const FASTA_rec_t *src = fa->fa_record + i;
+		uint64_t b, e, delta;
+
+		if (part->rec_part[i] != k)
+			continue;
+
+		/*
+		 * The record spans from its '>' up to the '>' of the next record
+		 */
+		b = src->hdr_start - 1;
+		e = i + 1 < fa->fa_rcount ? fa->fa_record[i + 1].hdr_start - 1 : filesize;
+		delta = out - b;
+
+		memcpy(rec + n, src, sizeof(FASTA_rec_t));
+		rec[n].hdr_start += delta;
+		rec[n].seq_start += delta;
+
+		if (rec[n].qual_rawlen > 0)
+			rec[n].qual_start += delta;
+
+		if (stats != NULL)
+			memcpy(stats + n, fa->fa_stats + i, sizeof(FASTA_stats_t));
+		if (hash != NULL)
+			hash[n] = fa->fa_hash[i];
+		/*
+		 * The intervals are shared with `fa', only the array is freed
+		 */
+		if (ivals != NULL)
+			ivals[n] = fa->fa_ivals[i];
+
+		/*
+		 * Coalesce adjacent records into a single copy
+		 */
+		if (pend_len > 0 && pend_start + pend_len != b) {
+			if (file_copy_range(in_fd, pend_start, pend_len, out_fd) != 0)
+				goto finish;
+			pend_len = 0;
+		}
+
+		if (pend_len == 0)
+			pend_start = b;
+
+		pend_len += e - b;
+		out      += e - b;
+
+		/*
+		 * The last record of the source file doesn't have to end with
+		 * a new-line, which is needed if another record follows it.
+		 */
+		if (e == filesize && !final_nl && n + 1 < part->records[k]) {
+			if (file_copy_range(in_fd, pend_start, pend_len, out_fd) != 0 ||
+			    write(out_fd, "\n", 1) != 1)
+				goto finish;
+
+			pend_len = 0;
+			++out;
+		}
+
+		end[n++] = out;
+	}
+
+	if (pend_len > 0 && file_copy_range(in_fd, pend_start, pend_len, out_fd) != 0)
+		goto finish;
+
+	/*
+	 * The raw length of a record followed by another one includes the
+	 * '>' character of the next record. The sequences of FASTQ records
+	 * are followed by the quality strings instead.
+	 */
+	if (!(fa->fa_options & FASTA_FASTQ)) {
+		for (i = 0; i < n; ++i)
+			rec[i].seq_rawlen = end[i] - rec[i].seq_start + (i + 1 < n ? 1 : 0);
+	}
+
+	memset(&shard, 0, sizeof shard);
+
+	shard.fa_record  = rec;
+	shard.fa_rcount  = n;
+	shard.fa_stats   = stats;
+	shard.fa_hash    = hash;
+	shard.fa_ivals   = ivals;
+	shard.fa_options = fa->fa_options & (FASTA_HASHFOLD|FASTA_FASTQ);
+	shard.fa_seqFP   = fdopen(out_fd, "r+");
+
+	if (shard.fa_seqFP == NULL)
+		goto finish;
+
+	out_fd = -1;
+	r = __index_write(&shard, idx_path);
+
+	if (fclose(shard.fa_seqFP) != 0)
+		r = -1;
+finish:
+	errno_protect {
+		if (out_fd >= 0)
+			close(out_fd);
+		close(in_fd);
+
+		free(rec);
+		free(end);
+		free(stats);
+		free(hash);
+		free(ivals);
+		free(idx_path);
+	}
+
+	return (r);
+}
+
+int fasta_splits(FASTA *fa, uint32_t n, FASTA_split_t **splits)
+{
+	FASTA_part_t  *part;
+	FASTA_split_t *sp;
+	struct stat    st;
+	FILE          *fp;
+	uint32_t       i, k;
+
+	assert(fa != NULL);
+	assert(splits != NULL);
+
+	if (stat(fa->fa_path, &st) != 0)
+		return (-1);
+
+	part = fasta_partition(fa, n, FASTA_PART_CONTIG);
+
+	if (part == NULL)
+		return (-1);
+
+	sp = calloc(n, sizeof(FASTA_split_t));
+
+	if (sp == NULL) {
+		fasta_partition_free(part);
+		return (-1);
+	}
+
+	for (k = 0, i = 0; k < n; ++k) {
+		sp[k].first    = i;
+		sp[k].count    = part->records[k];
+		sp[k].residues = part->residues[k];
+
+		if (sp[k].count > 0) {
+			sp[k].start = fa->fa_record[i].hdr_start - 1;
+			i += sp[k].count;
+			sp[k].end   = i < fa->fa_rcount ? fa->fa_record[i].hdr_start - 1 : (uint64_t)st.st_size;
+		} else
+			sp[k].start = sp[k].end = k > 0 ? sp[k - 1].end : 0;
+
+		fp = open_memstream(&sp[k].index, &sp[k].index_len);
+
+		if (fp == NULL)
+			goto fail;
+
+		if (__index_write_slice(fa, fp, sp[k].first, sp[k].count) != 0) {
+			fclose(fp);
+			goto fail;
+		}
+
+		if (fclose(fp) != 0)
+			goto fail;
+	}
+
+	fasta_partition_free(part);
+	*splits = sp;
+
+	return (0);
+fail:
+	errno_protect {
+		fasta_partition_free(part);
+		fasta_splits_free(sp, n);
+	}
+
+	return (-1);
+}
+
+void fasta_splits_free(FASTA_split_t *splits, uint32_t n)
+{
+	uint32_t k;
+
+	if (splits == NULL)
+		return;
+
+	for (k = 0; k < n; ++k)
+		free(splits[k].index);
+
+	free(splits);
+}
+
+FASTA *fasta_open_split(const char *path, const char *index, size_t index_len, uint32_t options, atrans_t *atr)
+{
+	FILE *fp;
+
+	assert(path != NULL);
+	assert(index != NULL);
+
+	fp = fmemopen((void *)index, index_len, "r");
+
+	if (fp == NULL)
+		return (NULL);
+
+	return __fasta_open(path, fp, options, atr);
+}
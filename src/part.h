@@ -0,0 +1,113 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#ifndef PART_H
+#define PART_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "fasta.h"
+
+#define FASTA_PART_LPT    0x00000000 /**< Longest processing time first, the order of the records isn't kept */
+#define FASTA_PART_CONTIG 0x00000001 /**< Split the db into contiguous ranges of records */
+
+        /**
+         * Assignment of the records of a db to parts with roughly equal
+         * number of residues.
+         */
+        typedef struct {
+                uint32_t  part_cnt;
+                uint32_t  rec_cnt;
+                uint32_t *rec_part; /**< part of each record */
+                uint64_t *residues; /**< number of residues in each part */
+                uint32_t *records;  /**< number of records in each part */
+        } FASTA_part_t;
+
+        /**
+         * Partition the records of `fa' into `parts' parts, balancing the
+         * sum of the sequence lengths. Only the metadata of the records is
+         * used. With FASTA_PART_LPT, the records are assigned in the order
+         * of decreasing length to the part with the lowest number of
+         * residues. With FASTA_PART_CONTIG, each part is a contiguous range
+         * of records.
+         */
+        FASTA_part_t *fasta_partition(FASTA *fa, uint32_t parts, uint32_t flags);
+
+        /**
+         * Write the part `k' into the file `path' and its index into
+         * `path'.index. The records are block copied from the source file
+         * in their original order and the index is computed from the
+         * source index, i.e. nothing is parsed again. The index includes
+         * the statistics if they were loaded into `fa'.
+         */
+        int fasta_partition_write(FASTA *fa, const FASTA_part_t *part, uint32_t k, const char *path);
+
+        void fasta_partition_free(FASTA_part_t *part);
+
+        /**
+         * A record aligned byte range of the source file
+         */
+        typedef struct {
+                uint64_t  start;     /**< offset of the '>' of the first record */
+                uint64_t  end;       /**< offset following the last record */
+                uint32_t  first;     /**< number of the first record */
+                uint32_t  count;     /**< number of records */
+                uint64_t  residues;  /**< number of residues */
+                char     *index;     /**< index of the records in the range (text) */
+                size_t    index_len;
+        } FASTA_split_t;
+
+        /**
+         * Split the db into `n' contiguous ranges of records with roughly
+         * equal number of residues. Each split carries a slice of the index
+         * that can be passed (e.g. stored in a file) to a process which then
+         * opens only this range using fasta_open_split(). The array of
+         * splits is stored into `splits' and has to be freed using
+         * fasta_splits_free(). Returns 0 on success, -1 on error.
+         */
+        int fasta_splits(FASTA *fa, uint32_t n, FASTA_split_t **splits);
+
+        void fasta_splits_free(FASTA_split_t *splits, uint32_t n);
+
+        /**
+         * Open the records of a split of the file `path' using the index
+         * slice `index' of the length `index_len'. Only the headers of the
+         * records in the split are read from the sequence file. The record
+         * numbers start at 0. Fails if the slice doesn't match the file;
+         * the file is never scanned. The index options are ignored.
+         */
+        FASTA *fasta_open_split(const char *path, const char *index, size_t index_len, uint32_t options, atrans_t *atr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PART_H */
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#define _DEFAULT_SOURCE
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include "helpers.h"
+#include "scan.h"
+
+int scan_init(scanbuf_t *sb, int fd, size_t size)
+{
+	sb->fd   = fd;
+	sb->buf  = alloc_array(uint8_t, size);
+	sb->size = size;
+	sb->len  = 0;
+	sb->pos  = 0;
+	sb->off  = 0;
+
+	sb->nreads = 0;
+	sb->nbytes = 0;
+	sb->nhits  = 0;
+
+	return (sb->buf != NULL ? 0 : -1);
+}
+
+void scan_free(scanbuf_t *sb)
+{
+	free(sb->buf);
+	sb->buf = NULL;
+}
+
+ssize_t scan_fill(scanbuf_t *sb)
+{
+	ssize_t r;
+
+	if (sb->pos < sb->len)
+		return (sb->len - sb->pos);
+
+	sb->off += sb->len;
+	sb->len  = 0;
+	sb->pos  = 0;
+
+	do {
+		r = pread(sb->fd, sb->buf, sb->size, (off_t)sb->off);
+	} while (r < 0 && errno == EINTR);
+
+	if (r < 0) {
+		dP("pread(%d, %zu, %"PRIu64") failed: %s\n", sb->fd, sb->size, sb->off, strerror(errno));
+		return (-1);
+	}
+
+	sb->len = (size_t)r;
+
+	++sb->nreads;
+	sb->nbytes += (uint64_t)r;
+
+	return (r);
+}
+
+void scan_seek(scanbuf_t *sb, uint64_t off)
+{
+	if (off >= sb->off && off < sb->off + sb->len) {
+		sb->pos = (size_t)(off - sb->off);
+		++sb->nhits;
+	} else {
+		sb->off = off;
+		sb->len = 0;
+		sb->pos = 0;
+	}
+}
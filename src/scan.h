@@ -0,0 +1,103 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * Buffered sequential reader used for scanning the sequence file. The data
+ * are read using pread(2) so neither the file offset of the descriptor nor
+ * the state of any stdio stream using it is affected.
+ */
+typedef struct {
+        int      fd;
+        uint8_t *buf;
+        size_t   size; /* capacity of the buffer */
+        size_t   len;  /* number of valid bytes in the buffer */
+        size_t   pos;  /* position of the next byte in the buffer */
+        uint64_t off;  /* file offset of buf[0] */
+
+        uint64_t nreads; /* number of pread calls */
+        uint64_t nbytes; /* number of bytes read */
+        uint64_t nhits;  /* number of seeks within the buffer */
+} scanbuf_t;
+
+/**
+ * Initialize the reader for the descriptor `fd' at offset 0.
+ */
+int scan_init(scanbuf_t *sb, int fd, size_t size);
+
+/**
+ * Free the buffer.
+ */
+void scan_free(scanbuf_t *sb);
+
+/**
+ * Read the next block of data into the buffer, if the current one was
+ * consumed. Returns the number of unconsumed bytes in the buffer, 0 on
+ * EOF and -1 on error.
+ */
+ssize_t scan_fill(scanbuf_t *sb);
+
+/**
+ * Move the reader to the file offset `off'. No data are read if the
+ * offset falls into the current buffer.
+ */
+void scan_seek(scanbuf_t *sb, uint64_t off);
+
+/**
+ * Return the next byte or EOF.
+ */
+static inline int scan_getc(scanbuf_t *sb)
+{
+        if (sb->pos < sb->len || scan_fill(sb) > 0)
+                return (sb->buf[sb->pos++]);
+        return (EOF);
+}
+
+/**
+ * Push back the last byte returned by scan_getc().
+ */
+static inline void scan_ungetc(scanbuf_t *sb)
+{
+        --sb->pos;
+}
+
+/**
+ * File offset of the next byte.
+ */
+static inline uint64_t scan_tell(scanbuf_t *sb)
+{
+        return (sb->off + sb->pos);
+}
+
+#endif /* SCAN_H */
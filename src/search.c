@@ -0,0 +1,482 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#define _DEFAULT_SOURCE
+#include <config.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "helpers.h"
+#include "fasta.h"
+#include "fasta_impl.h"
+#include "scan.h"
+#include "search.h"
+
+#define SEARCH_CODES 5    /* A, C, G, T/U and any other sequence letter */
+#define SEARCH_OTHER 4
+#define SEARCH_SKIP  0xff /* not a sequence letter, e.g. a new-line */
+
+#define SEARCH_REVERSE 0x80000000 /* strand bit of an automaton id */
+
+/*
+ * Several patterns are packed into the bits of one word and matched at
+ * once by the Shift-And algorithm. A carry out of the last bit of a
+ * pattern into the first bit of the next one is harmless, since the first
+ * bits are set on each step anyway.
+ */
+typedef struct {
+	uint64_t mask[SEARCH_CODES]; /* bits of the pattern letters matching each code */
+	uint64_t first;              /* first bits of the patterns */
+	uint64_t last;               /* last bits of the patterns */
+	uint32_t id[64];             /* pattern (and strand) ending at each last bit */
+} search_word_t;
+
+struct FASTA_search {
+	uint32_t       options;
+	uint32_t       count; /* patterns */
+	uint32_t      *len;   /* pattern lengths */
+	search_word_t *word;
+	uint32_t       words;
+	uint8_t        code[256]; /* byte -> code or SEARCH_SKIP */
+};
+
+typedef struct {
+	FASTA_hit_t *hit;
+	size_t       count;
+	size_t       size;
+} search_hits_t;
+
+/*
+ * Nucleotides (A = 1, C = 2, G = 4, T = 8) matched by the IUPAC codes
+ */
+static uint8_t iupac_set(int ch)
+{
+	switch (ch) {
+	case 'A': case 'a': return 0x1;
+	case 'C': case 'c': return 0x2;
+	case 'G': case 'g': return 0x4;
+	case 'T': case 't':
+	case 'U': case 'u': return 0x8;
+	case 'R': case 'r': return 0x1|0x4;
+	case 'Y': case 'y': return 0x2|0x8;
+	case 'S': case 's': return 0x2|0x4;
+	case 'W': case 'w': return 0x1|0x8;
+	case 'K': case 'k': return 0x4|0x8;
+	case 'M': case 'm': return 0x1|0x2;
+	case 'B': case 'b': return 0x2|0x4|0x8;
+	case 'D': case 'd': return 0x1|0x4|0x8;
+	case 'H': case 'h': return 0x1|0x2|0x8;
+	case 'V': case 'v': return 0x1|0x2|0x4;
+	case 'N': case 'n': return 0x1|0x2|0x4|0x8;
+	}
+
+	return (0);
+}
+
+/*
+ * The set of the complementary nucleotides
+ */
+static uint8_t iupac_comp(uint8_t set)
+{
+	return ((set & 0x1) << 3 | (set & 0x8) >> 3 | (set & 0x2) << 1 | (set & 0x4) >> 1);
+}
+
+/*
+ * Add the pattern given by the nucleotide sets `set' to the automaton,
+ * starting a new word if it doesn't fit into the last one.
+ */
+static int search_add(FASTA_search_t *srch, const uint8_t *set, uint32_t len, uint32_t id, uint32_t *used)
+{
+	search_word_t *w;
+	uint32_t i, c;
+
+	if (srch->words == 0 || *used + len > 64) {
+		w = realloc_array(srch->word, search_word_t, srch->words + 1);
+
+		if (w == NULL)
+			return (-1);
+
+		srch->word = w;
+		memset(srch->word + srch->words, 0, sizeof(search_word_t));
+		++srch->words;
+		*used = 0;
+	}
+
+	w = srch->word + srch->words - 1;
+
+	for (i = 0; i < len; ++i) {
+		for (c = 0; c < 4; ++c) {
+			if (set[i] & (1 << c))
+				w->mask[c] |= UINT64_C(1) << (*used + i);
+		}
+
+		if (set[i] == 0xf)
+			w->mask[SEARCH_OTHER] |= UINT64_C(1) << (*used + i);
+	}
+
+	w->first |= UINT64_C(1) << *used;
+	w->last  |= UINT64_C(1) << (*used + len - 1);
+	w->id[*used + len - 1] = id;
+	*used += len;
+
+	return (0);
+}
+
+FASTA_search_t *fasta_search_new(const char **patterns, uint32_t count, uint32_t options)
+{
+	FASTA_search_t *srch;
+	uint8_t  set[FASTA_SEARCH_MAXLEN], rc[FASTA_SEARCH_MAXLEN];
+	uint32_t i, k, len, used = 0;
+	int ch;
+
+	srch = calloc(1, sizeof(FASTA_search_t));
+
+	if (srch == NULL)
+		return (NULL);
+
+	srch->options = options;
+	srch->count   = count;
+	srch->len     = alloc_array(uint32_t, count > 0 ? count : 1);
+
+	if (srch->len == NULL)
+		goto fail;
+
+	for (ch = 0; ch < 256; ++ch) {
+		if (!(__SQ_mask[ch / 32] & (UINT32_C(1) << (ch % 32))))
+			srch->code[ch] = SEARCH_SKIP;
+		else {
+			switch (iupac_set(ch)) {
+			case 0x1: srch->code[ch] = 0; break;
+			case 0x2: srch->code[ch] = 1; break;
+			case 0x4: srch->code[ch] = 2; break;
+			case 0x8: srch->code[ch] = 3; break;
+			default:
+				srch->code[ch] = SEARCH_OTHER;
+			}
+		}
+	}
+
+	for (i = 0; i < count; ++i) {
+		len = (uint32_t)strlen(patterns[i]);
+
+		if (len == 0 || len > FASTA_SEARCH_MAXLEN) {
+			errno = EINVAL;
+			goto fail;
+		}
+
+		for (k = 0; k < len; ++k) {
+			if ((set[k] = iupac_set((uint8_t)patterns[i][k])) == 0) {
+				errno = EINVAL;
+				goto fail;
+			}
+			rc[len - 1 - k] = iupac_comp(set[k]);
+		}
+
+		srch->len[i] = len;
+
+		if (search_add(srch, set, len, i, &used) != 0)
+			goto fail;
+
+		if ((options & FASTA_SEARCH_REVCOMP) && memcmp(set, rc, len) != 0) {
+			if (search_add(srch, rc, len, i | SEARCH_REVERSE, &used) != 0)
+				goto fail;
+		}
+	}
+
+	return (srch);
+fail:
+	fasta_search_free(srch);
+	return (NULL);
+}
+
+void fasta_search_free(FASTA_search_t *srch)
+{
+	if (srch == NULL)
+		return;
+
+	free(srch->word);
+	free(srch->len);
+	free(srch);
+}
+
+static int search_push(search_hits_t *hits, uint32_t recno, uint32_t id, uint64_t end, uint32_t len)
+{
+	FASTA_hit_t *h;
+
+	if (hits->count == hits->size) {
+		size_t n = hits->size > 0 ? hits->size * 2 : 64;
+
+		if ((h = realloc_array(hits->hit, FASTA_hit_t, n)) == NULL)
+			return (-1);
+
+		hits->hit  = h;
+		hits->size = n;
+	}
+
+	h = hits->hit + hits->count++;
+	h->recno   = recno;
+	h->pattern = id & ~SEARCH_REVERSE;
+	h->strand  = (id & SEARCH_REVERSE) ? 1 : 0;
+	h->pos     = end + 1 - len;
+
+	return (0);
+}
+
+/*
+ * Feed the `n' bytes at `buf' into the automaton. `state' holds a word
+ * of active states for each word of the patterns and `*pos' counts the
+ * sequence letters.
+ */
+static int search_block(const FASTA_search_t *srch, uint64_t *state, uint64_t *pos,
+			const uint8_t *buf, size_t n, uint32_t recno, search_hits_t *hits)
+{
+	const search_word_t *w;
+	uint64_t d, m;
+	uint32_t k, b;
+	size_t i;
+
+	for (i = 0; i < n; ++i) {
+		uint8_t c = srch->code[buf[i]];
+
+		if (c == SEARCH_SKIP)
+			continue;
+
+		for (k = 0, w = srch->word; k < srch->words; ++k, ++w) {
+			d = state[k] = ((state[k] << 1) | w->first) & w->mask[c];
+
+			for (m = d & w->last; m != 0; m &= m - 1) {
+				b = (uint32_t)__builtin_ctzll(m);
+
+				if (search_push(hits, recno, w->id[b], *pos, srch->len[w->id[b] & ~SEARCH_REVERSE]) != 0)
+					return (-1);
+			}
+		}
+
+		++*pos;
+	}
+
+	return (0);
+}
+
+static int hit_cmp(const void *a, const void *b)
+{
+	const FASTA_hit_t *x = a, *y = b;
+
+	if (x->recno != y->recno)
+		return (x->recno < y->recno ? -1 : 1);
+	if (x->pos != y->pos)
+		return (x->pos < y->pos ? -1 : 1);
+	if (x->strand != y->strand)
+		return (x->strand < y->strand ? -1 : 1);
+	if (x->pattern != y->pattern)
+		return (x->pattern < y->pattern ? -1 : 1);
+
+	return (0);
+}
+
+static FASTA_hit_t *search_result(search_hits_t *hits, size_t *count)
+{
+	if (hits->hit == NULL && (hits->hit = alloc_array(FASTA_hit_t, 1)) == NULL)
+		return (NULL);
+
+	qsort(hits->hit, hits->count, sizeof(FASTA_hit_t), hit_cmp);
+	*count = hits->count;
+
+	return (hits->hit);
+}
+
+FASTA_hit_t *fasta_search_seq(const FASTA_search_t *srch, const uint8_t *seq, uint64_t len, size_t *count)
+{
+	search_hits_t hits = { NULL, 0, 0 };
+	uint64_t *state, pos = 0;
+
+	assert(srch != NULL);
+	assert(count != NULL);
+
+	state = calloc(srch->words > 0 ? srch->words : 1, sizeof(uint64_t));
+
+	if (state == NULL)
+		return (NULL);
+
+	if (search_block(srch, state, &pos, seq, (size_t)len, 0, &hits) != 0) {
+		free(state);
+		free(hits.hit);
+		return (NULL);
+	}
+
+	free(state);
+
+	return (search_result(&hits, count));
+}
+
+typedef struct {
+	FASTA                *fa;
+	const FASTA_search_t *srch;
+	search_hits_t         hits;
+	pthread_mutex_t      *lock;
+	uint32_t             *next;
+	int                   error;
+} search_worker_t;
+
+/*
+ * Scan the raw sequence data of the records taken from the shared counter,
+ * the letters are fed into the automaton straight from the read buffer.
+ */
+static void *search_worker(void *arg)
+{
+	search_worker_t      *w    = arg;
+	const FASTA_search_t *srch = w->srch;
+	const FASTA_rec_t    *rec;
+	scanbuf_t             sb;
+	uint64_t             *state, pos, left;
+	uint32_t              recno;
+	size_t                n;
+	int                   fd;
+
+	state = alloc_array(uint64_t, srch->words > 0 ? srch->words : 1);
+	fd    = open(w->fa->fa_path, O_RDONLY);
+
+	if (state == NULL || fd < 0 || scan_init(&sb, fd, FASTA_SCANBUFFER_SIZE) != 0) {
+		w->error = -1;
+		goto finish;
+	}
+
+	for (;;) {
+		pthread_mutex_lock(w->lock);
+		recno = (*w->next)++;
+		pthread_mutex_unlock(w->lock);
+
+		if (recno >= fasta_count(w->fa))
+			break;
+
+		rec = w->fa->fa_record + recno;
+
+		memset(state, 0, sizeof(uint64_t) * srch->words);
+		scan_seek(&sb, rec->seq_start);
+
+		for (pos = 0, left = rec->seq_rawlen; left > 0; left -= n) {
+			ssize_t r = scan_fill(&sb);
+
+			if (r <= 0) {
+				dP("Failed to read the sequence of record #%u\n", recno);
+				w->error = -1;
+				break;
+			}
+
+			n = (uint64_t)r < left ? (size_t)r : (size_t)left;
+
+			if (search_block(srch, state, &pos, sb.buf + sb.pos, n, recno, &w->hits) != 0) {
+				w->error = -1;
+				break;
+			}
+
+			sb.pos += n;
+		}
+
+		if (w->error != 0)
+			break;
+	}
+
+	scan_free(&sb);
+finish:
+	if (fd >= 0)
+		close(fd);
+	free(state);
+
+	return (NULL);
+}
+
+FASTA_hit_t *fasta_search(FASTA *fa, const FASTA_search_t *srch, uint32_t threads, size_t *count)
+{
+	search_hits_t    hits = { NULL, 0, 0 };
+	pthread_mutex_t  lock;
+	search_worker_t *worker;
+	uint32_t         next = 0, i, started;
+	int              r = 0;
+
+	assert(fa != NULL);
+	assert(srch != NULL);
+	assert(count != NULL);
+
+	if (threads == 0)
+		threads = cpu_count();
+	if (threads > fasta_count(fa))
+		threads = fasta_count(fa) > 0 ? fasta_count(fa) : 1;
+
+	if ((worker = calloc(threads, sizeof(search_worker_t))) == NULL)
+		return (NULL);
+
+	pthread_mutex_init(&lock, NULL);
+
+	for (i = 0; i < threads; ++i) {
+		worker[i].fa   = fa;
+		worker[i].srch = srch;
+		worker[i].lock = &lock;
+		worker[i].next = &next;
+	}
+
+	if ((started = thread_pool_run(search_worker, worker, sizeof(search_worker_t), threads)) == 0)
+		r = -1;
+
+	/*
+	 * Collect the hits of all the workers
+	 */
+	for (i = 0; i < started; ++i) {
+		if (worker[i].error != 0)
+			r = -1;
+
+		if (r == 0 && worker[i].hits.count > 0) {
+			FASTA_hit_t *h = realloc_array(hits.hit, FASTA_hit_t, hits.count + worker[i].hits.count);
+
+			if (h != NULL) {
+				memcpy(h + hits.count, worker[i].hits.hit, sizeof(FASTA_hit_t) * worker[i].hits.count);
+				hits.hit    = h;
+				hits.count += worker[i].hits.count;
+			} else
+				r = -1;
+		}
+
+		free(worker[i].hits.hit);
+	}
+
+	pthread_mutex_destroy(&lock);
+	free(worker);
+
+	if (r != 0) {
+		free(hits.hit);
+		return (NULL);
+	}
+
+	return (search_result(&hits, count));
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "fasta.h"
+
+#define FASTA_SEARCH_MAXLEN  64         /**< maximal pattern length */
+#define FASTA_SEARCH_REVCOMP 0x00000001 /**< Search for the reverse complements of the patterns as well */
+
+        /**
+         * Compiled set of patterns. It's created by fasta_search_new() and
+         * may be used by several threads at once.
+         */
+        typedef struct FASTA_search FASTA_search_t;
+
+        /**
+         * A pattern occurrence
+         */
+        typedef struct {
+                uint32_t recno;   /**< record number */
+                uint32_t pattern; /**< index of the pattern */
+                uint64_t pos;     /**< position of the first letter of the occurrence */
+                uint32_t strand;  /**< 0 - the pattern, 1 - its reverse complement */
+        } FASTA_hit_t;
+
+        /**
+         * Compile `count' patterns of 1 to FASTA_SEARCH_MAXLEN nucleotides
+         * given as IUPAC codes (ACGTU, RYSWKM, BDHV and N, in any case).
+         * The letters of the sequences are compared case-insensitively, a
+         * letter other than A, C, G, T and U matches only N. A palindromic
+         * pattern is reported on the forward strand only. Returns NULL and
+         * sets errno to EINVAL if a pattern isn't valid.
+         */
+        FASTA_search_t *fasta_search_new(const char **patterns, uint32_t count, uint32_t options);
+
+        /**
+         * Free the compiled patterns.
+         */
+        void fasta_search_free(FASTA_search_t *srch);
+
+        /**
+         * Find all the occurrences of the patterns in the `len' letters at
+         * `seq'. Returns an array of `*count' hits sorted by the position
+         * (with `recno' set to 0), which has to be freed by the caller.
+         */
+        FASTA_hit_t *fasta_search_seq(const FASTA_search_t *srch, const uint8_t *seq, uint64_t len, size_t *count);
+
+        /**
+         * Find all the occurrences of the patterns in the records of the db
+         * `fa'. The records are scanned straight from the sequence file by
+         * up to `threads' workers (0 means one worker per online
+         * processor). Returns an array of `*count' hits sorted by the record
+         * number and the position, which has to be freed by the caller.
+         */
+        FASTA_hit_t *fasta_search(FASTA *fa, const FASTA_search_t *srch, uint32_t threads, size_t *count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SEARCH_H */
@@ -0,0 +1,621 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#define _DEFAULT_SOURCE
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <ctype.h>
+#include <errno.h>
+#include <assert.h>
+#include <sys/stat.h>
+
+#include "helpers.h"
+#include "fasta.h"
+#include "fasta_impl.h"
+
+#ifndef PATH_MAX
+# define PATH_MAX 4096
+#endif
+
+/*
+ * Secondary indexes of the record table: the record numbers sorted by the
+ * sequence length and inverted lists of the records by the SeqID format
+ * and by the database of the first header. The lists are stored in a file
+ * next to the index:
+ *
+ *   ;filesize=<size of the sequence file>
+ *   ;rcount=<number of records>
+ *   ;lastsum=<checksum of the last record>
+ *   L <count> <recno>...         records sorted by (seq_len, recno)
+ *   F <format> <count> <recno>...  records with the SeqID format, one line per format
+ *   D <database> <count> <recno>... records from the database, sorted by the key
+ */
+#define SECIDX_FORMATS (SEQID_LOCAL + 1)
+
+struct fasta_secidx {
+	uint32_t  count;   /* number of records */
+	uint32_t *bylen;   /* record numbers sorted by (seq_len, recno) */
+	uint32_t  fmt_off[SECIDX_FORMATS + 1]; /* fmt_rec[fmt_off[f] .. fmt_off[f + 1]) are the records of the format f */
+	uint32_t *fmt_rec;
+	char    **db_key;  /* sorted database keys */
+	uint32_t *db_off;  /* db_rec[db_off[i] .. db_off[i + 1]) are the records of db_key[i] */
+	uint32_t *db_rec;
+	uint32_t  db_cnt;
+};
+
+typedef struct {
+	uint64_t len;
+	uint32_t recno;
+} secidx_len_t;
+
+typedef struct {
+	const char *key;
+	uint32_t    recno;
+} secidx_key_t;
+
+static int secidx_lencmp(const void *a, const void *b)
+{
+	const secidx_len_t *x = a, *y = b;
+
+	if (x->len != y->len)
+		return (x->len > y->len) - (x->len < y->len);
+
+	return (x->recno > y->recno) - (x->recno < y->recno);
+}
+
+static int secidx_keycmp(const void *a, const void *b)
+{
+	const secidx_key_t *x = a, *y = b;
+	int r = strcmp(x->key, y->key);
+
+	if (r != 0)
+		return (r);
+
+	return (x->recno > y->recno) - (x->recno < y->recno);
+}
+
+static SeqID_fmt_t secidx_fmt(const FASTA_rec_t *rec)
+{
+	if (rec->hdr_cnt == 0 || (unsigned)rec->hdr[0].seqid_fmt >= SECIDX_FORMATS)
+		return (SEQID_EMPTY);
+
+	return (rec->hdr[0].seqid_fmt);
+}
+
+/*
+ * The database part of the SeqID of the first header, if the format has
+ * one. Keys containing white space aren't indexed.
+ */
+static const char *secidx_dbkey(const FASTA_rec_t *rec)
+{
+	const char *key, *p;
+
+	switch (secidx_fmt(rec)) {
+	case SEQID_GNL:
+		key = rec->hdr[0].seqid.gnl.database;
+		break;
+	case SEQID_PATENTS:
+		key = rec->hdr[0].seqid.patents.country;
+		break;
+	default:
+		return (NULL);
+	}
+
+	if (key == NULL || *key == '\0')
+		return (NULL);
+
+	for (p = key; *p != '\0'; ++p)
+		if (isspace((unsigned char)*p))
+			return (NULL);
+
+	return (key);
+}
+
+static void secidx_free(struct fasta_secidx *si)
+{
+	uint32_t i;
+
+	if (si == NULL)
+		return;
+
+	for (i = 0; i < si->db_cnt; ++i)
+		free(si->db_key[i]);
+
+	free(si->db_key);
+	free(si->db_off);
+	free(si->db_rec);
+	free(si->fmt_rec);
+	free(si->bylen);
+	free(si);
+}
+
+static struct fasta_secidx *secidx_alloc(uint32_t count, uint32_t db_cnt, uint32_t db_recs)
+{
+	struct fasta_secidx *si = alloc_type(struct fasta_secidx);
+
+	if (si == NULL)
+		return (NULL);
+
+	memset(si, 0, sizeof *si);
+
+	si->count   = count;
+	si->bylen   = alloc_array(uint32_t, count > 0 ? count : 1);
+	si->fmt_rec = alloc_array(uint32_t, count > 0 ? count : 1);
+	si->db_key  = alloc_array(char *, db_cnt > 0 ? db_cnt : 1);
+	si->db_off  = alloc_array(uint32_t, db_cnt + 1);
+	si->db_rec  = alloc_array(uint32_t, db_recs > 0 ? db_recs : 1);
+
+	if (si->bylen == NULL || si->fmt_rec == NULL || si->db_key == NULL || si->db_off == NULL || si->db_rec == NULL) {
+		secidx_free(si);
+		return (NULL);
+	}
+
+	si->db_off[0] = 0;
+
+	return (si);
+}
+
+static struct fasta_secidx *secidx_build(FASTA *fa)
+{
+	struct fasta_secidx *si = NULL;
+	secidx_len_t *len;
+	secidx_key_t *key;
+	uint32_t      i, k, n, keys, f;
+
+	len = alloc_array(secidx_len_t, fa->fa_rcount > 0 ? fa->fa_rcount : 1);
+	key = alloc_array(secidx_key_t, fa->fa_rcount > 0 ? fa->fa_rcount : 1);
+
+	if (len == NULL || key == NULL)
+		goto finish;
+
+	for (i = 0, n = 0; i < fa->fa_rcount; ++i) {
+		len[i].len   = fa->fa_record[i].seq_len;
+		len[i].recno = i;
+
+		if ((key[n].key = secidx_dbkey(fa->fa_record + i)) != NULL)
+			key[n++].recno = i;
+	}
+
+	qsort(len, fa->fa_rcount, sizeof(secidx_len_t), secidx_lencmp);
+	qsort(key, n, sizeof(secidx_key_t), secidx_keycmp);
+
+	for (i = 0, keys = 0; i < n; ++i)
+		if (i == 0 || strcmp(key[i].key, key[i - 1].key) != 0)
+			++keys;
+
+	if ((si = secidx_alloc(fa->fa_rcount, keys, n)) == NULL)
+		goto finish;
+
+	for (i = 0; i < fa->fa_rcount; ++i)
+		si->bylen[i] = len[i].recno;
+
+	/*
+	 * Counting sort by the format keeps the file order in each list
+	 */
+	memset(si->fmt_off, 0, sizeof si->fmt_off);
+
+	for (i = 0; i < fa->fa_rcount; ++i)
+		++si->fmt_off[secidx_fmt(fa->fa_record + i) + 1];
+
+	for (f = 0; f < SECIDX_FORMATS; ++f)
+		si->fmt_off[f + 1] += si->fmt_off[f];
+
+	for (i = 0; i < fa->fa_rcount; ++i) {
+		f = secidx_fmt(fa->fa_record + i);
+		si->fmt_rec[si->fmt_off[f]++] = i;
+	}
+
+	for (f = SECIDX_FORMATS; f > 0; --f)
+		si->fmt_off[f] = si->fmt_off[f - 1];
+
+	si->fmt_off[0] = 0;
+
+	for (i = 0, k = 0; i < n; ++i) {
+		if (i == 0 || strcmp(key[i].key, key[i - 1].key) != 0) {
+			if ((si->db_key[k] = strdup(key[i].key)) == NULL) {
+				secidx_free(si);
+				si = NULL;
+				goto finish;
+			}
+
+			si->db_off[k]     = i;
+			si->db_off[k + 1] = i;
+			si->db_cnt        = ++k;
+		}
+
+		si->db_rec[i] = key[i].recno;
+		++si->db_off[k];
+	}
+finish:
+	free(len);
+	free(key);
+
+	return (si);
+}
+
+static void secidx_write_list(FILE *fp, const uint32_t *rec, uint32_t count)
+{
+	uint32_t i;
+
+	fprintf(fp, " %"PRIu32, count);
+
+	for (i = 0; i < count; ++i)
+		fprintf(fp, " %"PRIu32, rec[i]);
+
+	fputc('\n', fp);
+}
+
+static int secidx_write(const struct fasta_secidx *si, const char *path, uint64_t filesize, uint32_t lastsum)
+{
+	FILE    *fp;
+	uint32_t f, i;
+
+	if ((fp = fopen(path, "w")) == NULL) {
+		dP("Unable to open \"%s\" for writing\n", path);
+		return (-1);
+	}
+
+	fprintf(fp,
+		";filesize=%020"PRIu64"\n"
+		";rcount=%010u\n"
+		";lastsum=0x%08x\n",
+		filesize, si->count, lastsum);
+
+	fputc('L', fp);
+	secidx_write_list(fp, si->bylen, si->count);
+
+	for (f = 0; f < SECIDX_FORMATS; ++f) {
+		if (si->fmt_off[f + 1] == si->fmt_off[f])
+			continue;
+
+		fprintf(fp, "F %u", f);
+		secidx_write_list(fp, si->fmt_rec + si->fmt_off[f], si->fmt_off[f + 1] - si->fmt_off[f]);
+	}
+
+	for (i = 0; i < si->db_cnt; ++i) {
+		fprintf(fp, "D %s", si->db_key[i]);
+		secidx_write_list(fp, si->db_rec + si->db_off[i], si->db_off[i + 1] - si->db_off[i]);
+	}
+
+	if (fclose(fp) != 0) {
+		remove(path);
+		return (-1);
+	}
+
+	return (0);
+}
+
+/*
+ * Read `count' record numbers, which have to be in ascending order if
+ * `sorted' is true
+ */
+static int secidx_read_list(FILE *fp, uint32_t *rec, uint32_t count, uint32_t rcount, bool sorted)
+{
+	uint32_t i;
+
+	for (i = 0; i < count; ++i) {
+		if (fscanf(fp, "%"SCNu32, rec + i) != 1 || rec[i] >= rcount)
+			return (-1);
+		if (sorted && i > 0 && rec[i] <= rec[i - 1])
+			return (-1);
+	}
+
+	return (0);
+}
+
+/*
+ * Load the lists written by secidx_write(). Each list is checked against
+ * the record table in linear time, so a stale or damaged file is never
+ * used.
+ */
+static struct fasta_secidx *secidx_read(FASTA *fa, const char *path, uint64_t filesize, uint32_t lastsum)
+{
+	struct fasta_secidx *si = NULL;
+	FILE     *fp;
+	char      buffer[2048 + 1];
+	uint8_t  *seen = NULL;
+	uint64_t  h_filesize = 0;
+	uint32_t  h_rcount = 0, h_lastsum = 0, count, f, i, n, keyed, cap = 0;
+	int       ch, fields = 0;
+
+	if ((fp = fopen(path, "r")) == NULL)
+		return (NULL);
+
+	while ((ch = getc(fp)) == ';') {
+		if (fgets(buffer, sizeof buffer, fp) == NULL)
+			break;
+
+		if (sscanf(buffer, "filesize=%"SCNu64, &h_filesize) == 1 ||
+		    sscanf(buffer, "rcount=%"SCNu32, &h_rcount) == 1 ||
+		    sscanf(buffer, "lastsum=0x%"SCNx32, &h_lastsum) == 1)
+			++fields;
+	}
+
+	if (fields != 3 || h_filesize != filesize || h_rcount != fa->fa_rcount || h_lastsum != lastsum) {
+		dP("Stale secondary index: %s\n", path);
+		fclose(fp);
+		return (NULL);
+	}
+
+	for (i = 0, keyed = 0; i < fa->fa_rcount; ++i)
+		if (secidx_dbkey(fa->fa_record + i) != NULL)
+			++keyed;
+
+	si   = secidx_alloc(fa->fa_rcount, 0, keyed);
+	seen = alloc_array(uint8_t, fa->fa_rcount > 0 ? fa->fa_rcount : 1);
+
+	if (si == NULL || seen == NULL || ch != 'L')
+		goto fail;
+
+	/*
+	 * A permutation of the records sorted by the length
+	 */
+	if (fscanf(fp, "%"SCNu32, &count) != 1 || count != fa->fa_rcount ||
+	    secidx_read_list(fp, si->bylen, count, fa->fa_rcount, false) != 0)
+		goto fail;
+
+	memset(seen, 0, fa->fa_rcount);
+
+	for (i = 0; i < count; ++i) {
+		if (seen[si->bylen[i]]++ != 0)
+			goto fail;
+
+		if (i > 0 && fa->fa_record[si->bylen[i - 1]].seq_len > fa->fa_record[si->bylen[i]].seq_len)
+			goto fail;
+	}
+
+	/*
+	 * The format lists, in the order of the formats
+	 */
+	memset(si->fmt_off, 0, sizeof si->fmt_off);
+
+	for (f = 0, n = 0; fscanf(fp, " F %"SCNu32" %"SCNu32, &i, &count) == 2; f = i + 1) {
+		if (i < f || i >= SECIDX_FORMATS || count > fa->fa_rcount - n ||
+		    secidx_read_list(fp, si->fmt_rec + n, count, fa->fa_rcount, true) != 0)
+			goto fail;
+
+		for (; f <= i; ++f)
+			si->fmt_off[f] = n;
+
+		for (n += count; count > 0; --count)
+			if (secidx_fmt(fa->fa_record + si->fmt_rec[n - count]) != i)
+				goto fail;
+	}
+
+	if (n != fa->fa_rcount)
+		goto fail;
+
+	for (; f <= SECIDX_FORMATS; ++f)
+		si->fmt_off[f] = n;
+
+	/*
+	 * The database lists, sorted by the key
+	 */
+	for (n = 0; fscanf(fp, " D %2048s %"SCNu32, buffer, &count) == 2; ) {
+		if (count > keyed - n || (si->db_cnt > 0 && strcmp(si->db_key[si->db_cnt - 1], buffer) >= 0) ||
+		    secidx_read_list(fp, si->db_rec + n, count, fa->fa_rcount, true) != 0)
+			goto fail;
+
+		for (i = n; i < n + count; ++i) {
+			const char *key = secidx_dbkey(fa->fa_record + si->db_rec[i]);
+
+			if (key == NULL || strcmp(key, buffer) != 0)
+				goto fail;
+		}
+
+		if (si->db_cnt == cap) {
+			char    **k = realloc_array(si->db_key, char *, cap * 2 + 1);
+			uint32_t *o;
+
+			if (k == NULL)
+				goto fail;
+
+			si->db_key = k;
+
+			if ((o = realloc_array(si->db_off, uint32_t, cap * 2 + 2)) == NULL)
+				goto fail;
+
+			si->db_off = o;
+			cap        = cap * 2 + 1;
+		}
+
+		if ((si->db_key[si->db_cnt] = strdup(buffer)) == NULL)
+			goto fail;
+
+		n += count;
+		si->db_off[++si->db_cnt] = n;
+	}
+
+	if (n != keyed || (ch = getc(fp)) != EOF)
+		goto fail;
+
+	free(seen);
+	fclose(fp);
+
+	return (si);
+fail:
+	dP("Invalid secondary index: %s\n", path);
+	free(seen);
+	fclose(fp);
+	secidx_free(si);
+
+	return (NULL);
+}
+
+int __secidx_open(FASTA *fa, uint32_t options)
+{
+	char        path[PATH_MAX + 1];
+	struct stat st;
+	uint32_t    lastsum;
+
+	assert(fa != NULL);
+	assert(fa->fa_seqFP != NULL);
+
+	if (fa->fa_secidx != NULL)
+		return (0);
+
+	if (snprintf(path, sizeof path, "%s%s", fa->fa_path, FASTA_SECIDX_EXT) >= (int)sizeof path)
+		return (-1);
+
+	if (file_get_stat(fa->fa_seqFP, &st) != 0 || __index_lastsum(fa, st.st_size, &lastsum) != 0)
+		return (-1);
+
+	if (options & FASTA_USEINDEX)
+		fa->fa_secidx = secidx_read(fa, path, st.st_size, lastsum);
+
+	if (fa->fa_secidx != NULL)
+		return (0);
+
+	if ((fa->fa_secidx = secidx_build(fa)) == NULL)
+		return (-1);
+
+	if ((options & FASTA_USEINDEX) && (options & FASTA_GENINDEX))
+		secidx_write(fa->fa_secidx, path, st.st_size, lastsum);
+
+	return (0);
+}
+
+void __secidx_free(FASTA *fa)
+{
+	secidx_free(fa->fa_secidx);
+	fa->fa_secidx = NULL;
+}
+
+/*
+ * Without FASTA_SECIDX, the lists are built in memory on the first query
+ */
+static const struct fasta_secidx *secidx_get(FASTA *fa)
+{
+	if (fa->fa_secidx == NULL)
+		fa->fa_secidx = secidx_build(fa);
+
+	return (fa->fa_secidx);
+}
+
+const uint32_t *fasta_index_length(FASTA *fa, uint64_t min, uint64_t max, uint32_t *count)
+{
+	const struct fasta_secidx *si;
+	uint32_t a, b, l, r, m;
+
+	assert(fa != NULL);
+	assert(count != NULL);
+
+	*count = 0;
+
+	if ((si = secidx_get(fa)) == NULL)
+		return (NULL);
+
+	/*
+	 * [a, b) are the records with min <= seq_len <= max
+	 */
+	for (l = 0, r = si->count; l < r; ) {
+		m = l + (r - l) / 2;
+
+		if (fa->fa_record[si->bylen[m]].seq_len < min)
+			l = m + 1;
+		else
+			r = m;
+	}
+
+	a = l;
+
+	for (r = si->count; l < r; ) {
+		m = l + (r - l) / 2;
+
+		if (fa->fa_record[si->bylen[m]].seq_len <= max)
+			l = m + 1;
+		else
+			r = m;
+	}
+
+	b = l;
+
+	*count = b - a;
+
+	return (si->bylen + a);
+}
+
+const uint32_t *fasta_index_seqid(FASTA *fa, SeqID_fmt_t fmt, uint32_t *count)
+{
+	const struct fasta_secidx *si;
+
+	assert(fa != NULL);
+	assert(count != NULL);
+
+	*count = 0;
+
+	if ((unsigned)fmt >= SECIDX_FORMATS) {
+		errno = EINVAL;
+		return (NULL);
+	}
+
+	if ((si = secidx_get(fa)) == NULL)
+		return (NULL);
+
+	*count = si->fmt_off[fmt + 1] - si->fmt_off[fmt];
+
+	return (si->fmt_rec + si->fmt_off[fmt]);
+}
+
+const uint32_t *fasta_index_database(FASTA *fa, const char *db, uint32_t *count)
+{
+	const struct fasta_secidx *si;
+	uint32_t l, r, m;
+	int      c;
+
+	assert(fa != NULL);
+	assert(db != NULL);
+	assert(count != NULL);
+
+	*count = 0;
+
+	if ((si = secidx_get(fa)) == NULL)
+		return (NULL);
+
+	for (l = 0, r = si->db_cnt; l < r; ) {
+		m = l + (r - l) / 2;
+		c = strcmp(si->db_key[m], db);
+
+		if (c == 0) {
+			*count = si->db_off[m + 1] - si->db_off[m];
+			return (si->db_rec + si->db_off[m]);
+		}
+
+		if (c < 0)
+			l = m + 1;
+		else
+			r = m;
+	}
+
+	return (si->db_rec);
+}
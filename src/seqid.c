@@ -29,581 +29,349 @@
 #include <config.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 #include <ctype.h>
 #include <assert.h>
 #include "helpers.h"
 #include "seqid.h"
 
+/*
+ * Maximal number of '|' separated fields used by any of the supported
+ * formats (gi|number|db|accession|locus).
+ */
+#define SEQID_MAXBARS 4
+
 /**
- * Determine wheter a given string contains only whitespace
- * characters.
+ * Positions of the separators in a SeqID string.
  */
-static bool wspacep(char *s)
-{
-	while(*s != '\0')
-		if (!isspace(*s++))
-			return (false);
-	return (true);
-}
+typedef struct {
+	char    *str;
+	size_t   len;
+	uint32_t nbar;                   /* number of recorded '|' characters */
+	size_t   bar[SEQID_MAXBARS];     /* positions of the first SEQID_MAXBARS '|' characters */
+	size_t   spc[SEQID_MAXBARS + 1]; /* spc[0] - first ' ', spc[k] - first ' ' after bar[k-1]; `len' if none */
+} SeqID_tok_t;
 
 /*
- * Format specific parsers called by the main parsing routine follow.
+ * Test whether any byte of a 64-bit word is equal to `c'
  */
+#define SWAR_ONES  0x0101010101010101ULL
+#define SWAR_HIGHS 0x8080808080808080ULL
 
-static SeqID_fmt_t SeqID_gi_parse(char *buffer, size_t buflen, SeqID_t *dst)
+static inline uint64_t swar_hasbyte(uint64_t w, uint8_t c)
 {
-	char *gi_number, *db, *accession, *locus, *rest;
-	size_t gi_number_len, db_len, accession_len, locus_len;
-
-        (void)buflen;
-
-	gi_number = strsep(&buffer, "|");
-
-	if (gi_number != NULL) {
-		dP("gi_number=\"%s\"\n", gi_number);
-
-		gi_number_len = strlen(gi_number);
-		db = strsep(&buffer, "|");
-
-		if (db != NULL) {
-			dP("db=\"%s\"\n", db);
-
-			db_len = strlen(db);
-			accession = strsep(&buffer, "|");
-
-			if (accession != NULL) {
-				dP("accession=\"%s\"\n", accession);
-
-				accession_len = strlen(accession);
-				locus = strsep(&buffer, " ");
-
-				if (locus != NULL) {
-					dP("locus=\"%s\"\n", locus);
-
-					locus_len = strlen(locus);
-					rest      = buffer;
-
-					dP("rest=\"%s\"\n", rest);
-
-					if (strcmp("gb", db) == 0) {
-						dst->genbank.id        = gi_number;
-						dst->genbank.gi_number = gi_number;
-						dst->genbank.accession = accession;
-						dst->genbank.locus     = locus;
-						dst->genbank.rest      = rest;
-
-						return (SEQID_GENBANK);
-					}
-
-					if (strcmp("emb", db) == 0) {
-						dst->embl.id        = gi_number;
-						dst->embl.gi_number = gi_number;
-						dst->embl.accession = accession;
-						dst->embl.locus     = locus;
-						dst->embl.rest      = rest;
-
-						return (SEQID_EMBL);
-					}
-
-					if (strcmp("dbj", db) == 0) {
-						dst->ddbj.id        = gi_number;
-						dst->ddbj.gi_number = gi_number;
-						dst->ddbj.accession = accession;
-						dst->ddbj.locus     = locus;
-						dst->ddbj.rest      = rest;
-
-						return (SEQID_DDBJ);
-					}
-
-					/* XXX: what is |ref| ?
-					if (strcmp("ref", db) == 0) {
-						dst->ddbj.gi_number = gi_number;
-						dst->ddbj.accession = accession;
-						dst->ddbj.locus     = locus;
-						dst->ddbj.rest      = rest;
-
-						return (SEQID_DDBJ);
-					}
-					*/
-
-					locus[locus_len] = ' ';
-				}
-				accession[accession_len] = '|';
-			}
-			db[db_len] = '|';
-		}
-		gi_number[gi_number_len] = '|';
-	}
-
-	return (SEQID_UNKNOWN);
+	w ^= SWAR_ONES * c;
+	return ((w - SWAR_ONES) & ~w & SWAR_HIGHS);
 }
 
-static SeqID_fmt_t SeqID_pir_parse(char *buffer, size_t buflen, SeqID_t *dst)
+/**
+ * Find the separators in one pass over the string. The string isn't
+ * modified. Blocks of 8 bytes that contain neither '|' nor ' ' are
+ * skipped using word sized operations.
+ */
+static void SeqID_tokenize(SeqID_tok_t *t, char *str, size_t len)
 {
-	char *empty, *entry, *rest;
-	size_t empty_len;
-
-        (void)buflen;
-
-	empty = strsep(&buffer, "|");
+	size_t   i, e;
+	uint32_t k, pending;
+	uint64_t w;
 
-	if (empty != NULL) {
-		dP("empty=\"%s\"\n", empty);
+	t->str  = str;
+	t->len  = len;
+	t->nbar = 0;
 
-		empty_len = strlen(empty);
-		entry = strsep(&buffer, " ");
+	for (k = 0; k <= SEQID_MAXBARS; ++k)
+		t->spc[k] = len;
 
-		if (entry != NULL) {
-			rest = buffer;
+	pending = 0; /* lowest index of spc[] that wasn't found yet */
+	i = 0;
 
-			dP("entry=\"%s\"\n", entry);
-			dP("rest=\"%s\"\n", rest);
+	while (i < len) {
+		while (i + sizeof w <= len) {
+			memcpy(&w, str + i, sizeof w);
 
-			dst->nbrfpir.id    = entry;
-			dst->nbrfpir.entry = entry;
-			dst->nbrfpir.rest  = rest;
+			if (swar_hasbyte(w, '|') | swar_hasbyte(w, ' '))
+				break;
 
-			return (SEQID_NBRFPIR);
+			i += sizeof w;
 		}
 
-		empty[empty_len] = '|';
-	}
-
-	return (SEQID_UNKNOWN);
-}
-
-static SeqID_fmt_t SeqID_prf_parse(char *buffer, size_t buflen, SeqID_t *dst)
-{
-	char *empty, *name, *rest;
-	size_t empty_len;
-
-        (void)buflen;
-
-	empty = strsep(&buffer, "|");
-
-	if (empty != NULL) {
-		dP("empty=\"%s\"\n", empty);
-
-		empty_len = strlen(empty);
-		name = strsep(&buffer, " ");
-
-		if (name != NULL) {
-			rest = buffer;
-
-			dP("name=\"%s\"\n", name);
-			dP("rest=\"%s\"\n", rest);
-
-			dst->prf.id   = name;
-			dst->prf.name = name;
-			dst->prf.rest = rest;
+		for (e = (i + sizeof w <= len ? i + sizeof w : len); i < e; ++i) {
+			switch (str[i]) {
+			case '|':
+				if (t->nbar < SEQID_MAXBARS)
+					t->bar[t->nbar++] = i;
+				break;
+			case ' ':
+				for (; pending <= t->nbar; ++pending)
+					t->spc[pending] = i;
 
-			return (SEQID_PRF);
+				if (pending > SEQID_MAXBARS)
+					return;
+				break;
+			}
 		}
-
-		empty[empty_len] = '|';
 	}
 
-	return (SEQID_UNKNOWN);
+	return;
 }
 
-static SeqID_fmt_t SeqID_sp_parse(char *buffer, size_t buflen, SeqID_t *dst)
+/**
+ * Terminate a field at position `end' and return a pointer to its start
+ */
+static inline char *SeqID_field(SeqID_tok_t *t, size_t start, size_t end)
 {
-	char *accession, *name, *rest;
-	size_t accession_len;
-
-        (void)buflen;
-
-	accession = strsep(&buffer, "|");
-
-	if (accession != NULL) {
-		dP("accession=\"%s\"\n", accession);
-
-		accession_len = strlen(accession);
-		name = strsep(&buffer, " ");
-
-		if (name != NULL) {
-			rest = buffer;
-
-			dP("name=\"%s\"\n", name);
-			dP("rest=\"%s\"\n", rest);
-
-			dst->swissprot.id        = accession;
-			dst->swissprot.accession = accession;
-			dst->swissprot.name      = name;
-			dst->swissprot.rest      = rest;
+	if (end < t->len)
+		t->str[end] = '\0';
 
-			return (SEQID_SWISSPROT);
-		}
-
-		accession[accession_len] = '|';
-	}
-
-	return (SEQID_UNKNOWN);
+	return (t->str + start);
 }
 
-static SeqID_fmt_t SeqID_pdb1_parse(char *buffer, size_t buflen, SeqID_t *dst)
+/**
+ * Pointer to the rest of the string following the space at `spc', NULL
+ * if there's no space.
+ */
+static inline char *SeqID_rest(SeqID_tok_t *t, size_t spc)
 {
-	char *entry, *chain, *rest;
-	size_t entry_len;
-
-        (void)buflen;
-
-	entry = strsep(&buffer, "|");
-
-	if (entry != NULL) {
-		dP("entry=\"%s\"\n", entry);
-
-		entry_len = strlen(entry);
-		chain = strsep(&buffer, " ");
-
-		if (chain != NULL) {
-			rest = buffer;
-
-			dP("chain=\"%s\"\n", chain);
-			dP("rest=\"%s\"\n", rest);
-
-			dst->pdb1.id    = entry;
-			dst->pdb1.entry = entry;
-			dst->pdb1.chain = chain;
-			dst->pdb1.rest  = rest;
-
-			return (SEQID_PDB1);
-		}
-
-		entry[entry_len] = '|';
-	}
-
-	return (SEQID_UNKNOWN);
+	return (spc < t->len ? t->str + spc + 1 : NULL);
 }
 
-static SeqID_fmt_t SeqID_pdb2_parse(char *buffer, size_t buflen, char *ftok, size_t tlen, SeqID_t *dst)
-{
-	char *entry, *pdbid, *chain, *sequence, *rest;
-	size_t entry_len, pdbid_len, chain_len;
-
-        (void)tlen;
-        (void)buflen;
-
-	entry = strsep(&ftok, ":");
-
-	if (entry != NULL) {
-		dP("entry=\"%s\"\n", entry);
-
-		entry_len = strlen(entry);
-		pdbid = strsep(&buffer, "|");
-
-		if (pdbid != NULL) {
-			dP("pdbid=\"%s\"\n", pdbid);
-
-			pdbid_len = strlen(pdbid);
-			chain = strsep(&buffer, "|");
-
-			if (chain != NULL) {
-				dP("chain=\"%s\"\n", chain);
-
-				chain_len = strlen(chain);
-				sequence = strsep(&buffer, " ");
-
-				if (sequence != NULL) {
-					rest = buffer;
-
-					dP("sequence=\"%s\"\n", sequence);
-					dP("rest=\"%s\"\n", rest);
-
-					dst->pdb2.id       = pdbid;
-					dst->pdb2.entry    = entry;
-					dst->pdb2.chain    = chain;
-					dst->pdb2.pdbid    = pdbid;
-					dst->pdb2.sequence = sequence;
-					dst->pdb2.rest     = rest;
-
-					return (SEQID_PDB2);
-				}
-
-				chain[chain_len] = '|';
-			}
-			pdbid[pdbid_len] = '|';
-		}
-		entry[entry_len] = ':';
-	}
-
-	return (SEQID_UNKNOWN);
-}
-
-static SeqID_fmt_t SeqID_pat_parse(char *buffer, size_t buflen, SeqID_t *dst)
-{
-	char *country, *number, *rest;
-	size_t country_len;
-
-        (void)buflen;
-
-	country = strsep(&buffer, "|");
-
-	if (country != NULL) {
-		dP("country=\"%s\"\n", country);
-
-		country_len = strlen(country);
-		number = strsep(&buffer, " ");
-
-		if (number != NULL) {
-			rest = buffer;
-
-			dP("number=\"%s\"\n", number);
-			dP("rest=\"%s\"\n", rest);
-
-			dst->patents.id      = number;
-			dst->patents.country = country;
-			dst->patents.number  = number;
-			dst->patents.rest    = rest;
-
-			return (SEQID_PATENTS);
-		}
-
-		country[country_len] = '|';
-	}
-
-	return (SEQID_UNKNOWN);
-}
+/**
+ * Pack the characters of a format prefix into an integer
+ */
+#define SEQID_KEY(a, b, c) (((uint32_t)(a) << 16) | ((uint32_t)(b) << 8) | (uint32_t)(c))
 
-static SeqID_fmt_t SeqID_bbs_parse(char *buffer, size_t buflen, SeqID_t *dst)
+/*
+ * This is the main parsing routine. The positions of the '|' and ' '
+ * separators are found first, then the first field of the SeqID string
+ * determines the format. The buffer is modified only if the string was
+ * recognized: the fields of the SeqID are terminated in place and the
+ * pointers stored in `dst' point into the buffer.
+ */
+SeqID_fmt_t SeqID_parse(char *buffer, size_t buflen, SeqID_t *dst)
 {
-	char *number, *rest;
+	SeqID_tok_t t;
+	size_t   plen, *b, *s;
+	uint32_t key;
+	char    *colon;
 
-        (void)buflen;
-
-	number = strsep(&buffer, " ");
-
-	if (number != NULL) {
-		rest = buffer;
-
-		dP("number=\"%s\"\n", number);
-		dP("rest=\"%s\"\n", rest);
-
-		dst->bbs.id     = number;
-		dst->bbs.number = number;
-		dst->bbs.rest   = rest;
+        if (buffer == NULL || dst == SEQID_ERROR)
+                return (SEQID_ERROR);
+        if (buflen == 0)
+                return (SEQID_EMPTY);
 
-		return (SEQID_BBS);
+	SeqID_tokenize(&t, buffer, buflen);
+
+	b = t.bar;
+	s = t.spc;
+
+	/*
+	 * All the supported formats have at least two fields
+	 */
+	if (t.nbar == 0)
+		goto unknown;
+
+	/*
+	 * The prefix may be followed only by whitespace characters
+	 */
+	for (plen = b[0]; plen > 0 && isspace((unsigned char)buffer[plen - 1]); --plen);
+
+	switch (plen) {
+	case 2:
+		key = SEQID_KEY(buffer[0], buffer[1], 0);
+		break;
+	case 3:
+		key = SEQID_KEY(buffer[0], buffer[1], buffer[2]);
+		break;
+	default:
+		key = 0;
 	}
 
-	return (SEQID_UNKNOWN);
-}
-
-static SeqID_fmt_t SeqID_gnl_parse(char *buffer, size_t buflen, SeqID_t *dst)
-{
-	char *database, *identifier, *rest;
-	size_t database_len;
-
-        (void)buflen;
-
-	database = strsep(&buffer, "|");
+	dP("prefix=\"%.*s\", nbar=%u\n", (int)plen, buffer, t.nbar);
 
-	if (database != NULL) {
-		dP("database=\"%s\"\n", database);
-
-		database_len = strlen(database);
-		identifier = strsep(&buffer, " ");
+	switch (key) {
+	case SEQID_KEY('g', 'i', 0):
+		/* gi  - (GenBank|EMBL|DDJB) */
+		if (t.nbar < 4)
+			break;
+		else {
+			SeqID_genbank_t *g;
+			SeqID_fmt_t      fmt;
+			const char      *db  = buffer + b[1] + 1;
+			size_t           dbl = b[2] - b[1] - 1;
+
+			/*
+			 * The EMBL and DDBJ structures have the same layout
+			 */
+			if (dbl == 2 && memcmp(db, "gb", 2) == 0) {
+				g   = &dst->genbank;
+				fmt = SEQID_GENBANK;
+			} else if (dbl == 3 && memcmp(db, "emb", 3) == 0) {
+				g   = (SeqID_genbank_t *)&dst->embl;
+				fmt = SEQID_EMBL;
+			} else if (dbl == 3 && memcmp(db, "dbj", 3) == 0) {
+				g   = (SeqID_genbank_t *)&dst->ddbj;
+				fmt = SEQID_DDBJ;
+			} else
+				break;
 
-		if (identifier != NULL) {
-			rest = buffer;
+			buffer[b[0]] = '\0';
 
-			dP("identifier=\"%s\"\n", identifier);
-			dP("rest=\"%s\"\n", rest);
+			g->gi_number = SeqID_field(&t, b[0] + 1, b[1]);
+			g->accession = SeqID_field(&t, b[2] + 1, b[3]);
+			g->locus     = SeqID_field(&t, b[3] + 1, s[4]);
+			g->rest      = SeqID_rest(&t, s[4]);
+			g->id        = g->gi_number;
 
-			dst->gnl.id         = identifier;
-			dst->gnl.database   = database;
-			dst->gnl.identifier = identifier;
-			dst->gnl.rest       = rest;
+			buffer[b[2]] = '\0';
 
-			return (SEQID_GNL);
+			return (fmt);
 		}
+	case SEQID_KEY('g', 'n', 'l'):
+		/* gnl - General database identifier */
+		if (t.nbar < 2)
+			break;
 
-		database[database_len] = '|';
-	}
-
-	return (SEQID_UNKNOWN);
-}
-
-static SeqID_fmt_t SeqID_ref_parse(char *buffer, size_t buflen, SeqID_t *dst)
-{
-	char *accession, *locus, *rest;
-	size_t accession_len;
+		buffer[b[0]] = '\0';
 
-        (void)buflen;
+		dst->gnl.database   = SeqID_field(&t, b[0] + 1, b[1]);
+		dst->gnl.identifier = SeqID_field(&t, b[1] + 1, s[2]);
+		dst->gnl.rest       = SeqID_rest(&t, s[2]);
+		dst->gnl.id         = dst->gnl.identifier;
 
-	accession = strsep(&buffer, "|");
+		return (SEQID_GNL);
+	case SEQID_KEY('b', 'b', 's'):
+		/* bbs - GenInfo Backbone Id */
+		buffer[b[0]] = '\0';
 
-	if (accession != NULL) {
-		dP("accession=\"%s\"\n", accession);
+		dst->bbs.number = SeqID_field(&t, b[0] + 1, s[1]);
+		dst->bbs.rest   = SeqID_rest(&t, s[1]);
+		dst->bbs.id     = dst->bbs.number;
 
-		accession_len = strlen(accession);
-		locus = strsep(&buffer, " ");
+		return (SEQID_BBS);
+	case SEQID_KEY('l', 'c', 'l'):
+		/* lcl - Local sequence identifier */
+		buffer[b[0]] = '\0';
 
-		if (locus != NULL) {
-			rest = buffer;
+		dst->local.identifier = SeqID_field(&t, b[0] + 1, s[1]);
+		dst->local.rest       = SeqID_rest(&t, s[1]);
+		dst->local.id         = dst->local.identifier;
 
-			dP("locus=\"%s\"\n", locus);
-			dP("rest=\"%s\"\n", rest);
+		return (SEQID_LOCAL);
+	case SEQID_KEY('p', 'd', 'b'):
+		/* pdb - Brookhaven Protein Data bank */
+		if (t.nbar < 2)
+			break;
 
-			dst->ncbiref.id        = accession;
-			dst->ncbiref.accession = accession;
-			dst->ncbiref.locus     = locus;
-			dst->ncbiref.rest      = rest;
+		buffer[b[0]] = '\0';
 
-			return (SEQID_NCBIREF);
-		}
+		dst->pdb1.entry = SeqID_field(&t, b[0] + 1, b[1]);
+		dst->pdb1.chain = SeqID_field(&t, b[1] + 1, s[2]);
+		dst->pdb1.rest  = SeqID_rest(&t, s[2]);
+		dst->pdb1.id    = dst->pdb1.entry;
 
-		accession[accession_len] = '|';
-	}
+		return (SEQID_PDB1);
+	case SEQID_KEY('p', 'a', 't'):
+		/* pat - Patents */
+		if (t.nbar < 2)
+			break;
 
-	return (SEQID_UNKNOWN);
-}
+		buffer[b[0]] = '\0';
 
-static SeqID_fmt_t SeqID_lcl_parse(char *buffer, size_t buflen, SeqID_t *dst)
-{
-	char *identifier, *rest;
+		dst->patents.country = SeqID_field(&t, b[0] + 1, b[1]);
+		dst->patents.number  = SeqID_field(&t, b[1] + 1, s[2]);
+		dst->patents.rest    = SeqID_rest(&t, s[2]);
+		dst->patents.id      = dst->patents.number;
 
-        (void)buflen;
+		return (SEQID_PATENTS);
+	case SEQID_KEY('p', 'i', 'r'):
+		/* pir - NBRF PIR */
+		if (t.nbar < 2)
+			break;
 
-	identifier = strsep(&buffer, " ");
+		buffer[b[0]] = '\0';
+		buffer[b[1]] = '\0';
 
-	if (identifier != NULL) {
-		rest = buffer;
+		dst->nbrfpir.entry = SeqID_field(&t, b[1] + 1, s[2]);
+		dst->nbrfpir.rest  = SeqID_rest(&t, s[2]);
+		dst->nbrfpir.id    = dst->nbrfpir.entry;
 
-		dP("identifier=\"%s\"\n", identifier);
-		dP("rest=\"%s\"\n", rest);
+		return (SEQID_NBRFPIR);
+	case SEQID_KEY('p', 'r', 'f'):
+		/* prf - Protein Research Foundation */
+		if (t.nbar < 2)
+			break;
 
-		dst->local.id         = identifier;
-		dst->local.identifier = identifier;
-		dst->local.rest       = rest;
+		buffer[b[0]] = '\0';
+		buffer[b[1]] = '\0';
 
-		return (SEQID_LOCAL);
-	}
+		dst->prf.name = SeqID_field(&t, b[1] + 1, s[2]);
+		dst->prf.rest = SeqID_rest(&t, s[2]);
+		dst->prf.id   = dst->prf.name;
 
-	return (SEQID_UNKNOWN);
-}
+		return (SEQID_PRF);
+	case SEQID_KEY('r', 'e', 'f'):
+		/* ref - NCBI reference sequence */
+		if (t.nbar < 2)
+			break;
 
-/*
- * This is the main parsing routine. Using the first field of a SeqID string
- * determines which of the format specific parsers should be called to do the
- * rest of the job. The buffer is modified during the executing but all
- * modifications are undone before the function returns.
- */
-SeqID_fmt_t SeqID_parse(char *buffer, size_t buflen, SeqID_t *dst)
-{
-	char  *btok;
-	size_t tlen;
-	SeqID_fmt_t fmt = SEQID_UNKNOWN;
-	char *orig = buffer;
+		buffer[b[0]] = '\0';
 
-        if (buffer == NULL || dst == SEQID_ERROR)
-                return (SEQID_ERROR);
-        if (buflen == 0)
-                return (SEQID_EMPTY);
+		dst->ncbiref.accession = SeqID_field(&t, b[0] + 1, b[1]);
+		dst->ncbiref.locus     = SeqID_field(&t, b[1] + 1, s[2]);
+		dst->ncbiref.rest      = SeqID_rest(&t, s[2]);
+		dst->ncbiref.id        = dst->ncbiref.accession;
 
-	btok = strsep(&buffer, "|");
+		return (SEQID_NCBIREF);
+	case SEQID_KEY('s', 'p', 0):
+		/* sp - SWISS-PROT */
+		if (t.nbar < 2)
+			break;
 
-	if (btok != NULL) {
-		dP("btok=\"%s\"\n", btok);
+		buffer[b[0]] = '\0';
 
-		tlen = strlen(btok);
+		dst->swissprot.accession = SeqID_field(&t, b[0] + 1, b[1]);
+		dst->swissprot.name      = SeqID_field(&t, b[1] + 1, s[2]);
+		dst->swissprot.rest      = SeqID_rest(&t, s[2]);
+		dst->swissprot.id        = dst->swissprot.accession;
 
-		switch (btok[0]) {
+		return (SEQID_SWISSPROT);
+	default:
+		/*
+		 * The entry:chain format is tried only if the first field doesn't
+		 * start with a character used by any of the prefixes above.
+		 */
+		switch (buffer[0]) {
 		case 'b':
-			/* bbs - GenInfo Backbone Id */
-			if (tlen >= 3) {
-				if (btok[1] == 'b' && btok[2] == 's' && wspacep(btok + 3))
-					fmt = SeqID_bbs_parse(buffer, buflen - tlen, dst);
-			}
-			break;
 		case 'g':
-			switch (btok[1]) {
-			case 'i':
-				/* gi  - (GenBank|EMBL|DDJB) */
-				if (wspacep(btok + 2))
-					fmt = SeqID_gi_parse(buffer, buflen - tlen, dst);
-				break;
-			case 'n':
-				/* gnl - General database identifier */
-				if (tlen >= 3) {
-					if (btok[2] == 'l' && wspacep(btok + 3))
-						fmt = SeqID_gnl_parse(buffer, buflen - tlen, dst);
-				}
-				break;
-			}
-			break;
 		case 'l':
-			/* lcl - Local sequence identifier */
-			if (tlen >= 3) {
-				if (btok[1] == 'c' && btok[2] == 'l' && wspacep(btok + 3))
-					fmt = SeqID_lcl_parse(buffer, buflen - tlen, dst);
-			}
-			break;
 		case 'p':
-			if (tlen >= 3) {
-				switch (btok[1]) {
-				case 'd':
-					/* pdb - Brookhaven Protein Data bank */
-					if (btok[2] == 'b' && wspacep(btok + 3))
-						fmt = SeqID_pdb1_parse(buffer, buflen - tlen, dst);
-					break;
-				case 'a':
-					/* pat - Patents */
-					if (btok[2] == 't' && wspacep(btok + 3))
-						fmt = SeqID_pat_parse(buffer, buflen - tlen, dst);
-					break;
-				case 'i':
-					/* pir - NBRF PIR */
-					if (btok[2] == 'r' && wspacep(btok + 3))
-						fmt = SeqID_pir_parse(buffer, buflen - tlen, dst);
-					break;
-				case 'r':
-					/* prf - Protein Research Foundation */
-					if (btok[2] == 'f' && wspacep(btok + 3))
-						fmt = SeqID_prf_parse(buffer, buflen - tlen, dst);
-					break;
-				}
-			}
-			break;
 		case 'r':
-			/* ref - NCBI reference sequence */
-			if (tlen >= 3) {
-				if (btok[1] == 'e' && btok[2] == 'f' && wspacep(btok + 3))
-					fmt = SeqID_ref_parse(buffer, buflen - tlen, dst);
-			}
-			break;
 		case 's':
-			/* sp - SWISS-PROT */
-			if (tlen >= 2) {
-				if (btok[1] == 'p' && wspacep(btok + 2))
-					fmt = SeqID_sp_parse(buffer, buflen - tlen, dst);
-			}
 			break;
 		default:
-			if (strchr(btok, ':') != NULL) {
-				/* entry:chain - Brookhaven Protein Data Bank */
-				fmt = SeqID_pdb2_parse(buffer, buflen - tlen, btok, tlen, dst);
-			}
+			/* entry:chain - Brookhaven Protein Data Bank */
+			if (t.nbar < 3)
+				break;
+			if ((colon = memchr(buffer, ':', b[0])) == NULL)
+				break;
 
-			/* unknown */
-		}
+			buffer[b[0]] = '\0';
 
-		if (fmt != SEQID_UNKNOWN)
-			return (fmt);
+			dst->pdb2.entry    = SeqID_field(&t, 0, (size_t)(colon - buffer));
+			dst->pdb2.pdbid    = SeqID_field(&t, b[0] + 1, b[1]);
+			dst->pdb2.chain    = SeqID_field(&t, b[1] + 1, b[2]);
+			dst->pdb2.sequence = SeqID_field(&t, b[2] + 1, s[3]);
+			dst->pdb2.rest     = SeqID_rest(&t, s[3]);
+			dst->pdb2.id       = dst->pdb2.pdbid;
 
-		if (buffer != NULL)
-			btok[tlen] = '|'; /* undo strsep */
+			return (SEQID_PDB2);
+		}
 	}
-
-	dst->unknown.id = orig;
-	orig = strchr(orig, ' ');
-
-	if (orig != NULL) {
-		*orig = '\0';
-		dst->unknown.rest = ++orig;
-	} else
-		dst->unknown.rest = NULL;
+unknown:
+	/* unknown */
+	dst->unknown.id   = SeqID_field(&t, 0, s[0]);
+	dst->unknown.rest = SeqID_rest(&t, s[0]);
 
 	return (SEQID_UNKNOWN);
 }
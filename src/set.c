@@ -0,0 +1,729 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#define _DEFAULT_SOURCE
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <assert.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "helpers.h"
+#include "fasta.h"
+#include "fasta_impl.h"
+#include "set.h"
+
+typedef struct {
+	char     *path;
+	FASTA    *fa;    /* NULL until the shard is accessed */
+	uint32_t  first; /* global number of the first record */
+	uint32_t  count;
+	uint64_t  used;  /* LRU stamp of the open sequence file */
+} set_shard_t;
+
+typedef struct {
+	const char *id;
+	uint32_t    recno;
+} set_id_t;
+
+struct FASTA_set {
+	set_shard_t *shard;
+	uint32_t     shard_cnt;
+	uint32_t     rcount;
+	uint32_t     rindex;
+
+	uint32_t     options;
+	atrans_t    *atr;
+
+	uint32_t     maxopen; /* limit of open sequence files */
+	uint32_t     nopen;
+	uint64_t     tick;
+
+	set_id_t    *ids;     /* merged ID index, sorted by (id, recno) */
+	uint32_t     ids_cnt;
+};
+
+typedef struct {
+	FASTA_set_t     *set;
+	pthread_mutex_t *lock; /* protects `next' */
+	uint32_t        *next;
+	void         * (*func)(FASTA_rec_t *, void *);
+	void            *funcarg;
+	void           **result;
+	int              error;
+} set_worker_t;
+
+static const char *set_fasta_ext[] = {
+	".fa", ".fasta", ".fna", ".faa", ".ffn", ".frn", ".fas", NULL
+};
+
+/*
+ * Get the record count of the shard from the header of its index, if the
+ * index is up-to-date. Returns 0 on success, 1 if the count has to be
+ * determined by opening the shard.
+ */
+static int set_index_count(const char *path, uint32_t *count)
+{
+	char        buffer[256], *idx_path;
+	struct stat st;
+	FILE       *fp;
+	uint64_t    filesize = UINT64_MAX;
+	bool        have_rcount = false;
+
+	if (stat(path, &st) != 0)
+		return (1);
+
+	idx_path = alloc_array(char, strlen(path) + strlen(FASTA_INDEX_EXT) + 1);
+
+	if (idx_path == NULL)
+		return (1);
+
+	strcpy(idx_path, path);
+	strcat(idx_path, FASTA_INDEX_EXT);
+
+	fp = fopen(idx_path, "r");
+	free(idx_path);
+
+	if (fp == NULL)
+		return (1);
+
+	while (fgets(buffer, sizeof buffer, fp) != NULL && buffer[0] == ';') {
+		if (strncmp(buffer, ";filesize=", 10) == 0)
+			filesize = strtoull(buffer + 10, NULL, 10);
+		else if (strncmp(buffer, ";rcount=", 8) == 0) {
+			*count = strtoul(buffer + 8, NULL, 10);
+			have_rcount = true;
+		}
+	}
+
+	fclose(fp);
+
+	if (!have_rcount || filesize != (uint64_t)st.st_size)
+		return (1);
+
+	return (0);
+}
+
+/*
+ * Close the least recently used sequence files until a new one may be
+ * opened without exceeding the limit.
+ */
+static void set_reserve_fd(FASTA_set_t *set)
+{
+	uint32_t i, lru;
+
+	while (set->nopen >= set->maxopen) {
+		for (i = 0, lru = UINT32_MAX; i < set->shard_cnt; ++i) {
+			if (set->shard[i].fa == NULL || set->shard[i].fa->fa_seqFP == NULL)
+				continue;
+			if (lru == UINT32_MAX || set->shard[i].used < set->shard[lru].used)
+				lru = i;
+		}
+
+		if (lru == UINT32_MAX) {
+			set->nopen = 0;
+			break;
+		}
+
+		dP("Closing the sequence file of shard #%u\n", lru);
+
+		fclose(set->shard[lru].fa->fa_seqFP);
+		set->shard[lru].fa->fa_seqFP = NULL;
+		--set->nopen;
+	}
+}
+
+static void set_release_fds(FASTA_set_t *set)
+{
+	uint32_t i;
+
+	for (i = 0; i < set->shard_cnt; ++i) {
+		if (set->shard[i].fa != NULL && set->shard[i].fa->fa_seqFP != NULL) {
+			fclose(set->shard[i].fa->fa_seqFP);
+			set->shard[i].fa->fa_seqFP = NULL;
+		}
+	}
+
+	set->nopen = 0;
+}
+
+/*
+ * Open the shard `s' if it isn't open yet. The files of the shard are
+ * closed afterwards; the sequence file is reopened by fasta_read() and
+ * kept open from then on.
+ */
+static FASTA *set_load(FASTA_set_t *set, uint32_t s)
+{
+	set_shard_t *shard = set->shard + s;
+	FASTA       *fa;
+
+	if (shard->fa != NULL)
+		return (shard->fa);
+
+	fa = fasta_open(shard->path, set->options & ~FASTA_KEEPOPEN, set->atr);
+
+	if (fa == NULL) {
+		dP("Can't open shard #%u: %s\n", s, shard->path);
+		return (NULL);
+	}
+
+	if (fasta_count(fa) != shard->count) {
+		dP("Shard #%u changed: %u != %u records\n", s, fasta_count(fa), shard->count);
+		fasta_close(fa);
+		errno = ESTALE;
+		return (NULL);
+	}
+
+	fa->fa_options |= FASTA_KEEPOPEN;
+	shard->fa = fa;
+
+	return (fa);
+}
+
+/*
+ * Return the index of the shard containing the global record `recno'.
+ */
+static uint32_t set_find(FASTA_set_t *set, uint32_t recno)
+{
+	uint32_t l = 0, h = set->shard_cnt;
+
+	assert(recno < set->rcount);
+
+	while (h - l > 1) {
+		uint32_t m = l + (h - l) / 2;
+
+		if (set->shard[m].first <= recno)
+			l = m;
+		else
+			h = m;
+	}
+
+	/* skip empty shards */
+	while (set->shard[l].count == 0)
+		++l;
+
+	return (l);
+}
+
+FASTA_set_t *fasta_open_set(const char * const *paths, uint32_t count, uint32_t options, atrans_t *atr, uint32_t maxopen)
+{
+	FASTA_set_t *set;
+	uint32_t     i;
+	uint64_t     total = 0;
+
+	if (paths == NULL || count == 0 || (options & FASTA_WRITE)) {
+		errno = EINVAL;
+		return (NULL);
+	}
+
+	set = alloc_type(FASTA_set_t);
+
+	if (set == NULL)
+		return (NULL);
+
+	memset(set, 0, sizeof(FASTA_set_t));
+
+	set->shard   = calloc(count, sizeof(set_shard_t));
+	set->options = options;
+	set->atr     = atr;
+	set->maxopen = maxopen > 0 ? maxopen : FASTA_SET_MAXOPEN;
+
+	if (set->shard == NULL)
+		goto fail;
+
+	for (i = 0; i < count; ++i) {
+		set_shard_t *shard = set->shard + i;
+
+		shard->path = strdup(paths[i]);
+
+		if (shard->path == NULL)
+			goto fail;
+
+		++set->shard_cnt;
+
+		if (!(options & FASTA_USEINDEX) || set_index_count(shard->path, &shard->count) != 0) {
+			/*
+			 * No usable index, the shard has to be scanned now. Keep it
+			 * open since the scan can't be done for free again.
+			 */
+			shard->fa = fasta_open(shard->path, options & ~FASTA_KEEPOPEN, atr);
+
+			if (shard->fa == NULL) {
+				dP("Can't open shard #%u: %s\n", i, shard->path);
+				goto fail;
+			}
+
+			shard->fa->fa_options |= FASTA_KEEPOPEN;
+			shard->count = fasta_count(shard->fa);
+		}
+
+		shard->first = (uint32_t)total;
+		total       += shard->count;
+
+		if (total > UINT32_MAX) {
+			errno = EOVERFLOW;
+			goto fail;
+		}
+	}
+
+	set->rcount = (uint32_t)total;
+
+	return (set);
+fail:
+	fasta_set_close(set);
+	return (NULL);
+}
+
+static int set_namecmp(const void *a, const void *b)
+{
+	return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+static bool set_isfasta(const char *name)
+{
+	const char *ext = strrchr(name, '.');
+	uint32_t    i;
+
+	if (ext == NULL || name[0] == '.')
+		return (false);
+
+	for (i = 0; set_fasta_ext[i] != NULL; ++i)
+		if (strcmp(ext, set_fasta_ext[i]) == 0)
+			return (true);
+
+	return (false);
+}
+
+FASTA_set_t *fasta_open_setdir(const char *dirpath, uint32_t options, atrans_t *atr, uint32_t maxopen)
+{
+	FASTA_set_t   *set = NULL;
+	DIR           *dir;
+	struct dirent *de;
+	char         **path = NULL, **tmp;
+	uint32_t       path_cnt = 0, i;
+	struct stat    st;
+
+	dir = opendir(dirpath);
+
+	if (dir == NULL)
+		return (NULL);
+
+	while ((de = readdir(dir)) != NULL) {
+		if (!set_isfasta(de->d_name))
+			continue;
+
+		tmp = realloc_array(path, char *, path_cnt + 1);
+
+		if (tmp == NULL)
+			goto finish;
+
+		path = tmp;
+		path[path_cnt] = alloc_array(char, strlen(dirpath) + strlen(de->d_name) + 2);
+
+		if (path[path_cnt] == NULL)
+			goto finish;
+
+		sprintf(path[path_cnt], "%s/%s", dirpath, de->d_name);
+
+		if (stat(path[path_cnt], &st) != 0 || !S_ISREG(st.st_mode)) {
+			free(path[path_cnt]);
+			continue;
+		}
+
+		++path_cnt;
+	}
+
+	if (path_cnt == 0) {
+		errno = ENOENT;
+		goto finish;
+	}
+
+	qsort(path, path_cnt, sizeof(char *), set_namecmp);
+	set = fasta_open_set((const char * const *)path, path_cnt, options, atr, maxopen);
+finish:
+	closedir(dir);
+
+	for (i = 0; i < path_cnt; ++i)
+		free(path[i]);
+	free(path);
+
+	return (set);
+}
+
+uint32_t fasta_set_count(FASTA_set_t *set)
+{
+	return (set->rcount);
+}
+
+uint32_t fasta_set_shards(FASTA_set_t *set)
+{
+	return (set->shard_cnt);
+}
+
+FASTA *fasta_set_shard(FASTA_set_t *set, uint32_t recno, uint32_t *local)
+{
+	uint32_t s;
+	FASTA   *fa;
+
+	if (recno >= set->rcount) {
+		errno = ERANGE;
+		return (NULL);
+	}
+
+	s  = set_find(set, recno);
+	fa = set_load(set, s);
+
+	if (fa != NULL && local != NULL)
+		*local = recno - set->shard[s].first;
+
+	return (fa);
+}
+
+FASTA_rec_t *fasta_set_read(FASTA_set_t *set, FASTA_rec_t *dst, uint32_t flags, atrans_t *atr)
+{
+	FASTA_rec_t *farec;
+	FASTA       *fa;
+	uint32_t     s;
+
+	assert(set != NULL);
+
+	if (set->rindex >= set->rcount)
+		return (NULL);
+
+	s  = set_find(set, set->rindex);
+	fa = set_load(set, s);
+
+	if (fa == NULL)
+		return (NULL);
+
+	if (fa->fa_seqFP == NULL) {
+		set_reserve_fd(set);
+		++set->nopen;
+	}
+
+	set->shard[s].used = ++set->tick;
+
+	fasta_seeko(fa, set->rindex - set->shard[s].first, SEEK_SET);
+	farec = fasta_read(fa, dst, (flags & ~FASTA_RAWREC) | FASTA_KEEPOPEN, atr);
+
+	if (fa->fa_seqFP == NULL)
+		--set->nopen; /* failed to reopen */
+
+	if (farec != NULL && (flags & FASTA_INMEMSEQ))
+		++set->rindex;
+
+	return (farec);
+}
+
+int fasta_set_seeko(FASTA_set_t *set, off_t off, int whence)
+{
+	off_t newpos;
+
+	assert(set != NULL);
+
+	switch (whence) {
+	case SEEK_SET:
+		newpos = off;
+		break;
+	case SEEK_CUR:
+		newpos = off + set->rindex;
+		break;
+	case SEEK_END:
+		newpos = set->rcount - off - 1;
+		break;
+	default:
+		errno = EINVAL;
+		return (-1);
+	}
+
+	if (newpos < 0 || newpos >= set->rcount) {
+		errno = ERANGE;
+		return (-1);
+	}
+
+	set->rindex = (uint32_t) newpos;
+
+	return (0);
+}
+
+int fasta_set_rewind(FASTA_set_t *set)
+{
+	set->rindex = 0;
+	return (0);
+}
+
+static int set_idcmp(const void *a, const void *b)
+{
+	const set_id_t *x = a, *y = b;
+	int r = strcmp(x->id, y->id);
+
+	if (r != 0)
+		return (r);
+
+	return (x->recno > y->recno) - (x->recno < y->recno);
+}
+
+/*
+ * Build the merged ID index. The IDs aren't copied; they point into the
+ * header arenas of the shards, which stay loaded until the set is closed.
+ */
+static int set_build_ids(FASTA_set_t *set)
+{
+	uint32_t s, i, n = 0;
+
+	set->ids = alloc_array(set_id_t, set->rcount > 0 ? set->rcount : 1);
+
+	if (set->ids == NULL)
+		return (-1);
+
+	for (s = 0; s < set->shard_cnt; ++s) {
+		FASTA *fa = set_load(set, s);
+
+		if (fa == NULL) {
+			free(set->ids);
+			set->ids = NULL;
+			return (-1);
+		}
+
+		for (i = 0; i < fa->fa_rcount; ++i) {
+			const FASTA_rec_t *rec = fa->fa_record + i;
+
+			if (rec->hdr_cnt == 0 || rec->hdr[0].seqid_fmt == SEQID_EMPTY
+			    || rec->rec_id == NULL)
+				continue;
+
+			set->ids[n].id    = rec->rec_id;
+			set->ids[n].recno = set->shard[s].first + i;
+			++n;
+		}
+	}
+
+	qsort(set->ids, n, sizeof(set_id_t), set_idcmp);
+	set->ids_cnt = n;
+
+	return (0);
+}
+
+int fasta_set_lookup_id(FASTA_set_t *set, const char *id, uint32_t *recno)
+{
+	uint32_t l, h;
+
+	assert(set != NULL);
+	assert(id != NULL);
+
+	if (set->ids == NULL && set_build_ids(set) != 0)
+		return (-1);
+
+	/* lower bound */
+	for (l = 0, h = set->ids_cnt; l < h;) {
+		uint32_t m = l + (h - l) / 2;
+
+		if (strcmp(set->ids[m].id, id) < 0)
+			l = m + 1;
+		else
+			h = m;
+	}
+
+	if (l == set->ids_cnt || strcmp(set->ids[l].id, id) != 0)
+		return (1);
+
+	if (recno != NULL)
+		*recno = set->ids[l].recno;
+
+	return (0);
+}
+
+static void *set_apply_worker(void *arg)
+{
+	set_worker_t *w   = arg;
+	FASTA_set_t  *set = w->set;
+	FASTA_rec_t  *farec;
+	FASTA        *fa;
+	FILE         *fp;
+	uint32_t      s, i;
+
+	for (;;) {
+		pthread_mutex_lock(w->lock);
+		s = (*w->next)++;
+		pthread_mutex_unlock(w->lock);
+
+		if (s >= set->shard_cnt)
+			break;
+		if (set->shard[s].count == 0)
+			continue;
+
+		/* each shard is taken by exactly one worker */
+		fa = set_load(set, s);
+
+		if (fa == NULL) {
+			w->error = -1;
+			break;
+		}
+
+		fp = fopen(fa->fa_path, "r");
+
+		if (fp == NULL) {
+			w->error = -1;
+			break;
+		}
+
+		setbuf(fp, NULL);
+		flockfile(fp);
+
+		for (i = 0; i < fa->fa_rcount; ++i) {
+			farec = __fasta_read_record(fa, fp, i, NULL, FASTA_INMEMSEQ|FASTA_CSTRSEQ, fa->fa_atr);
+
+			if (farec == NULL) {
+				dP("Failed to read record #%u of shard #%u\n", i, s);
+				w->error = -1;
+				break;
+			}
+
+			w->result[set->shard[s].first + i] = w->func(farec, w->funcarg);
+			fasta_rec_free(farec);
+		}
+
+		funlockfile(fp);
+		fclose(fp);
+
+		if (w->error != 0)
+			break;
+	}
+
+	return (NULL);
+}
+
+static int set_apply_parallel(FASTA_set_t *set, void * (*func)(FASTA_rec_t *, void *), void *funcarg, void **result)
+{
+	pthread_mutex_t lock;
+	set_worker_t   *worker;
+	uint32_t        threads, next = 0, i, started;
+	int             r = 0;
+
+	threads = cpu_count();
+
+	if (threads > set->shard_cnt)
+		threads = set->shard_cnt;
+	if (threads > set->maxopen)
+		threads = set->maxopen;
+
+	/* the workers use their own descriptors */
+	set_release_fds(set);
+
+	if ((worker = alloc_array(set_worker_t, threads)) == NULL)
+		return (-1);
+
+	pthread_mutex_init(&lock, NULL);
+
+	for (i = 0; i < threads; ++i) {
+		worker[i].set     = set;
+		worker[i].lock    = &lock;
+		worker[i].next    = &next;
+		worker[i].func    = func;
+		worker[i].funcarg = funcarg;
+		worker[i].result  = result;
+		worker[i].error   = 0;
+	}
+
+	if ((started = thread_pool_run(set_apply_worker, worker, sizeof(set_worker_t), threads)) == 0)
+		r = -1;
+
+	for (i = 0; i < started; ++i) {
+		if (worker[i].error != 0)
+			r = -1;
+	}
+
+	pthread_mutex_destroy(&lock);
+	free(worker);
+
+	return (r);
+}
+
+void *fasta_set_apply(FASTA_set_t *set, void * (*func)(FASTA_rec_t *, void *), uint32_t options, void *funcarg)
+{
+	void        **result;
+	uint32_t      i;
+	FASTA_rec_t  *farec;
+
+	if (set->rcount == 0 || fasta_set_rewind(set) != 0)
+		return (NULL);
+
+	result = (void **) alloc_array(void *, set->rcount);
+
+	if (result == NULL)
+		return (NULL);
+
+	if ((options & FASTA_PARALLEL) && set->shard_cnt > 1) {
+		if (set_apply_parallel(set, func, funcarg, result) != 0) {
+			free(result);
+			return (NULL);
+		}
+
+		return (result);
+	}
+
+	for (i = 0; i < set->rcount; ++i) {
+		farec     = fasta_set_read(set, NULL, FASTA_INMEMSEQ|FASTA_CSTRSEQ, NULL);
+		if (farec == NULL) {
+			free(result);
+			return (NULL);
+		}
+
+		result[i] = func(farec, funcarg);
+		fasta_rec_free(farec);
+	}
+
+	return (result);
+}
+
+void fasta_set_close(FASTA_set_t *set)
+{
+	uint32_t i;
+
+	if (set == NULL)
+		return;
+
+	if (set->shard != NULL) {
+		for (i = 0; i < set->shard_cnt; ++i) {
+			if (set->shard[i].fa != NULL)
+				fasta_close(set->shard[i].fa);
+			free(set->shard[i].path);
+		}
+		free(set->shard);
+	}
+
+	free(set->ids);
+	free(set);
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2011 Daniel Kopecek. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are
+ * permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice, this list of
+ *       conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright notice, this list
+ *       of conditions and the following disclaimer in the documentation and/or other materials
+ *       provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY Daniel Kopecek ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL Daniel Kopecek OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ *
+ * Author: Daniel Kopecek <xkopecek@fi.muni.cz>
+ *
+ */
+#ifndef SET_H
+#define SET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "fasta.h"
+
+#define FASTA_SET_MAXOPEN 64 /**< default number of shards whose sequence file is kept open */
+
+        /**
+         * Opaque handle of a logical db consisting of several FASTA files
+         * (shards). The records of all the shards are numbered globally in
+         * the order of the shards.
+         */
+        typedef struct FASTA_set FASTA_set_t;
+
+        /**
+         * Open a set of FASTA files. Only the record counts are determined
+         * here, using the index header if there's an up-to-date index. The
+         * shards are opened using fasta_open(path, options, atr) when
+         * they're accessed for the first time and stay open until the set
+         * is closed. At most `maxopen' sequence files (0 means
+         * FASTA_SET_MAXOPEN) are kept open at the same time, the least
+         * recently used ones are closed when the limit is reached.
+         */
+        FASTA_set_t *fasta_open_set(const char * const *paths, uint32_t count, uint32_t options, atrans_t *atr, uint32_t maxopen);
+
+        /**
+         * Same as fasta_open_set() for all the FASTA files (*.fa, *.fasta,
+         * *.fna, *.faa, *.ffn, *.frn, *.fas) in the directory `dirpath',
+         * in the order of their names.
+         */
+        FASTA_set_t *fasta_open_setdir(const char *dirpath, uint32_t options, atrans_t *atr, uint32_t maxopen);
+
+        /**
+         * Return the total number of records.
+         */
+        uint32_t fasta_set_count(FASTA_set_t *set);
+
+        /**
+         * Return the number of shards.
+         */
+        uint32_t fasta_set_shards(FASTA_set_t *set);
+
+        /**
+         * Return the handle of the shard containing the record `recno' and
+         * store the number of the record within the shard into `local'.
+         */
+        FASTA *fasta_set_shard(FASTA_set_t *set, uint32_t recno, uint32_t *local);
+
+        /**
+         * Same as fasta_read() using the global record numbering. The
+         * FASTA_RAWREC flag isn't supported.
+         */
+        FASTA_rec_t *fasta_set_read(FASTA_set_t *set, FASTA_rec_t *dst, uint32_t flags, atrans_t *atr);
+
+        /**
+         * Same as fasta_seeko() using the global record numbering.
+         */
+        int fasta_set_seeko(FASTA_set_t *set, off_t off, int whence);
+
+        /**
+         * Set the position to the first record of the first shard.
+         */
+        int fasta_set_rewind(FASTA_set_t *set);
+
+        /**
+         * Find the record with the ID `id' and store its global number into
+         * `recno'. The index of the IDs of all the records is built on the
+         * first call, which requires opening all the shards. If there are
+         * more records with the same ID, the lowest number is returned.
+         * Returns 0 on success, 1 if the ID wasn't found and -1 on error.
+         */
+        int fasta_set_lookup_id(FASTA_set_t *set, const char *id, uint32_t *recno);
+
+        /**
+         * Same as fasta_apply() for all the records of the set. If the
+         * FASTA_PARALLEL option is used, the shards are processed in
+         * parallel, each worker reading whole shards using its own file
+         * descriptor. The returned array is indexed by the global record
+         * number.
+         */
+        void *fasta_set_apply(FASTA_set_t *set, void * (*func)(FASTA_rec_t *, void *), uint32_t options, void *funcarg);
+
+        /**
+         * Close all the shards and free the set.
+         */
+        void fasta_set_close(FASTA_set_t *set);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SET_H */
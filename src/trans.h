@@ -63,7 +63,7 @@ extern "C" {
          */
         static inline size_t atrans_s2d_size(atrans_t *atr, size_t size)
         {
-                register size_t dst_bw;
+                size_t dst_bw;
 
                 assert(atr != NULL);
 
@@ -77,7 +77,7 @@ extern "C" {
          */
         static inline size_t atrans_d2s_size(atrans_t *atr, size_t size)
         {
-                register size_t src_bw;
+                size_t src_bw;
 
                 assert(atr != NULL);
 
@@ -91,7 +91,7 @@ extern "C" {
          */
         static inline void atrans_letter_s2d(atrans_t *atr, uint8_t letter, uint32_t i, uint8_t *dst)
         {
-                register uint32_t di;
+                uint32_t di;
 
                 assert(atr != NULL);
                 assert(dst != NULL);
@@ -107,7 +107,7 @@ extern "C" {
          */
         static inline void atrans_letter_d2s(atrans_t *atr, uint8_t letter, uint32_t i, uint8_t *dst)
         {
-                register uint32_t di;
+                uint32_t di;
 
                 assert(atr != NULL);
                 assert(dst != NULL);
@@ -0,0 +1,44 @@
+#!/bin/sh
+
+for file in ${srcdir}/data/*.fa; do
+    localname="T10-$(basename "${file}")"
+    cp "${file}" "${localname}"
+
+    #
+    # length, GC, N, lowercase and the longest N-run for each record
+    #
+    awk '
+function flush(   s, i, c, r) {
+    if (!have) return
+    n = gc = nn = lo = run = maxrun = 0
+    for (i = 1; i <= length(seq); i++) {
+        c = substr(seq, i, 1)
+        n++
+        if (c ~ /[a-z]/) lo++
+        c = toupper(c)
+        if (c == "G" || c == "C") gc++
+        if (c == "N") { nn++; if (++run > maxrun) maxrun = run } else run = 0
+    }
+    print n, gc, nn, lo, maxrun
+    seq = ""
+}
+/^[ ]*>/ { flush(); have = 1; next }
+{ gsub(/[ \r]/, ""); seq = seq $0 }
+END { flush() }' "${localname}" > T10-awk.out
+
+    ./stats "${localname}"     > T10-scan.out  || exit 1
+    ./stats "${localname}" idx > T10-gen.out   || exit 1
+    ./stats "${localname}" idx > T10-index.out || exit 1
+
+    for out in T10-scan.out T10-gen.out T10-index.out; do
+        if ! cmp -s T10-awk.out "${out}"; then
+            echo "Statistics differ: ${file} (${out})"
+            exit 1
+        fi
+    done
+
+    rm -f "${localname}" "${localname}.index"
+done
+
+rm -f T10-awk.out T10-scan.out T10-gen.out T10-index.out
+exit 0
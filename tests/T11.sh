@@ -0,0 +1,80 @@
+#!/bin/sh
+
+#
+# Parse SeqID strings of all the supported formats
+#
+./seqid > T11.out <<EOF
+gi|12345|gb|AAB12345.1|LOCUS1 some description here
+gi|12345|emb|CAA12345.1|LOC2
+gi|12345|dbj|BAA00001.1| description
+gi|12345|ref|NP_000001.1| not supported
+gi|12345|gb|AAB12345.1
+gi |99|gb|X|Y z
+pir||A12345 cytochrome c
+prf||0806162C protein
+sp|P12345|NAME_HUMAN Some protein OS=Homo sapiens
+sp|P12345
+pdb|1ABC|A chain A, structure
+pat|US|RE33188 patent sequence
+bbs|123456 backbone
+bbs|123456
+gnl|taxon|9606 Homo sapiens
+ref|NC_000001.11|CHR1 chromosome 1
+lcl|contig0001 assembled contig
+lcl|contig0001
+1ABC:A|PDBID|CHAIN|SEQUENCE trailing text
+1ABC:A|PDBID|CHAIN
+xyz:1|a|b|c
+just an identifier
+identifier_without_space
+gx|something here
+lcl
+|bar at the start
+ leading space|x
+sp |P1|N rest
+gi|1|gb|ACC|loc|with|bars and spaces
+tr|A0A000|A0A000_9BACT a very long description line that is longer than a few machine words and contains | bars | and spaces
+EOF
+
+[ $? -eq 0 ] || exit 1
+
+cat > T11-expected.out <<"EOF"
+genbank [12345] [12345] [AAB12345.1] [LOCUS1] [some description here]
+embl [12345] [12345] [CAA12345.1] [LOC2] [(null)]
+ddbj [12345] [12345] [BAA00001.1] [] [description]
+unknown [gi|12345|ref|NP_000001.1|] [not supported]
+unknown [gi|12345|gb|AAB12345.1] [(null)]
+genbank [99] [99] [X] [Y] [z]
+pir [A12345] [A12345] [cytochrome c]
+prf [0806162C] [0806162C] [protein]
+sp [P12345] [P12345] [NAME_HUMAN] [Some protein OS=Homo sapiens]
+unknown [sp|P12345] [(null)]
+pdb1 [1ABC] [1ABC] [A] [chain A, structure]
+pat [RE33188] [US] [RE33188] [patent sequence]
+bbs [123456] [123456] [backbone]
+bbs [123456] [123456] [(null)]
+gnl [9606] [taxon] [9606] [Homo sapiens]
+ref [NC_000001.11] [NC_000001.11] [CHR1] [chromosome 1]
+lcl [contig0001] [contig0001] [assembled contig]
+lcl [contig0001] [contig0001] [(null)]
+pdb2 [PDBID] [1ABC] [PDBID] [CHAIN] [SEQUENCE] [trailing text]
+unknown [1ABC:A|PDBID|CHAIN] [(null)]
+pdb2 [a] [xyz] [a] [b] [c] [(null)]
+unknown [just] [an identifier]
+unknown [identifier_without_space] [(null)]
+unknown [gx|something] [here]
+unknown [lcl] [(null)]
+unknown [|bar] [at the start]
+unknown [] [leading space|x]
+sp [P1] [P1] [N] [rest]
+genbank [1] [1] [ACC] [loc|with|bars] [and spaces]
+unknown [tr|A0A000|A0A000_9BACT] [a very long description line that is longer than a few machine words and contains | bars | and spaces]
+EOF
+
+if ! cmp -s T11-expected.out T11.out; then
+    diff -u T11-expected.out T11.out
+    exit 1
+fi
+
+rm -f T11.out T11-expected.out
+exit 0
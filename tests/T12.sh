@@ -0,0 +1,80 @@
+#!/bin/sh
+
+#
+# Append records to an indexed file and update the index incrementally.
+# The index has to be the same as a regenerated one.
+#
+for name in simple multi multi2 bug0 bug1 reads; do
+    case "${name}" in
+        reads) file="T12-reads.fq"; more="${file}"
+               { cat "${srcdir}/data/${name}.fq"; echo; } > "${file}";;
+        *)     file="${srcdir}/data/${name}.fa"; more="${srcdir}/data/multi.fa";;
+    esac
+
+    cp "${file}" T12.fa
+    rm -f T12.fa.index
+
+    #
+    # Index with statistics. The incrementally updated index keeps them
+    # even if they weren't requested, a regenerated one wouldn't.
+    #
+    ./stats T12.fa idx > /dev/null || exit 1
+    cat "${more}" >> T12.fa
+    ./T5_idx_count T12.fa upd > T12-upd.out || exit 1
+
+    if ! grep -q '^;stats=1$' T12.fa.index; then
+        echo "Index regenerated instead of updated: ${file}"
+        exit 1
+    fi
+
+    cp T12.fa T12-full.fa
+    rm -f T12-full.fa.index
+    ./stats T12-full.fa idx > /dev/null || exit 1
+    ./T5_idx_count T12-full.fa > T12-full.out || exit 1
+
+    if ! cmp -s T12-upd.out T12-full.out || ! cmp -s T12.fa.index T12-full.fa.index; then
+        echo "Updated and regenerated index differ: ${file}"
+        exit 1
+    fi
+
+    #
+    # The statistics of the first record aren't rewritten by an update, a
+    # modified copy of them has to survive it
+    #
+    if [ "${name}" = reads ]; then
+        cp "${file}" T12.fa
+        rm -f T12.fa.index
+        ./stats T12.fa idx > /dev/null || exit 1
+        awk '!d && sub(/^S [0-9]+/, "S 777") { d = 1 } 1' T12.fa.index > T12-mod.index
+        mv T12-mod.index T12.fa.index
+        cat "${more}" >> T12.fa
+        ./T5_idx_count T12.fa upd > T12-upd.out || exit 1
+
+        if ! grep -q '^S 777 ' T12.fa.index; then
+            echo "Index regenerated instead of updated: ${file}"
+            exit 1
+        fi
+
+        continue
+    fi
+
+    #
+    # Extending the last record isn't an append, the index has to be
+    # regenerated (with the statistics of the original index).
+    #
+    printf 'ACGT\n' >> T12.fa
+    ./T5_idx_count T12.fa upd > T12-upd.out || exit 1
+
+    cp T12.fa T12-full.fa
+    rm -f T12-full.fa.index
+    ./stats T12-full.fa idx > /dev/null || exit 1
+    ./T5_idx_count T12-full.fa > T12-full.out || exit 1
+
+    if ! cmp -s T12-upd.out T12-full.out || ! cmp -s T12.fa.index T12-full.fa.index; then
+        echo "Index not regenerated after a modification: ${file}"
+        exit 1
+    fi
+done
+
+rm -f T12-reads.fq T12.fa T12.fa.index T12-full.fa T12-full.fa.index T12-upd.out T12-full.out
+exit 0
@@ -0,0 +1,14 @@
+#!/bin/sh
+
+for file in ${srcdir}/data/*.fa; do
+    ./metrics "${file}" > T13.out
+
+    if [ $? -ne 0 ]; then
+        cat T13.out
+        echo "Inconsistent metrics: ${file}"
+        exit 1
+    fi
+done
+
+rm -f T13.out
+exit 0
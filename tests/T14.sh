@@ -0,0 +1,25 @@
+#!/bin/sh
+
+#
+# Open the test files as one set and compare it with the individual files,
+# once with enough descriptors and once with a single one.
+#
+rm -rf T14.d
+mkdir T14.d || exit 1
+
+for name in simple multi multi2 bug0 bug1; do
+    cp "${srcdir}/data/${name}.fa" T14.d/
+done
+
+for maxopen in 0 1; do
+    ./set ${maxopen} T14.d T14.d/*.fa > T14.out
+
+    if [ $? -ne 0 ]; then
+        cat T14.out
+        echo "Set and files differ (maxopen=${maxopen})"
+        exit 1
+    fi
+done
+
+rm -rf T14.d T14.out
+exit 0
@@ -0,0 +1,50 @@
+#!/bin/sh
+
+#
+# Split the test files into parts and check that the parts contain all the
+# records and that their indexes match the regenerated ones.
+#
+printf '>NONL_1\nACGTACGT\nACG\n>NONL_2\nTTTTGGGG\nCC' > T15-nonl.fa
+
+for file in ${srcdir}/data/simple.fa ${srcdir}/data/multi.fa ${srcdir}/data/multi2.fa \
+            ${srcdir}/data/bug0.fa ${srcdir}/data/bug1.fa T15-nonl.fa
+do
+    cp "${file}" T15.fa
+    rm -f T15.fa.index
+    ./stats T15.fa | sort > T15-orig.out || exit 1
+
+    for mode in "" "-c"; do
+        for parts in 1 2 3 7; do
+            rm -f T15.*.fa T15.*.fa.index
+            ../tools/fastasplit ${mode} -s -o T15 ${parts} T15.fa > /dev/null || exit 1
+            : > T15-parts.out
+
+            for part in T15.*.fa; do
+                # more parts than records
+                [ -s "${part}" ] || continue
+
+                ./stats "${part}" >> T15-parts.out || exit 1
+
+                cp "${part}" T15-re.fa
+                rm -f T15-re.fa.index
+                ./stats T15-re.fa idx > /dev/null || exit 1
+
+                if ! cmp -s "${part}.index" T15-re.fa.index; then
+                    echo "Index of ${part} differs from the regenerated one: ${file} (${mode} ${parts})"
+                    exit 1
+                fi
+            done
+
+            sort T15-parts.out > T15-sorted.out
+
+            if ! cmp -s T15-orig.out T15-sorted.out; then
+                echo "Parts don't contain the original records: ${file} (${mode} ${parts})"
+                exit 1
+            fi
+        done
+    done
+done
+
+rm -f T15.fa T15.fa.index T15-nonl.fa T15.*.fa T15.*.fa.index T15-re.fa T15-re.fa.index \
+      T15-orig.out T15-parts.out T15-sorted.out
+exit 0
@@ -0,0 +1,24 @@
+#!/bin/sh
+
+#
+# Content hashes and duplicate detection, computed and loaded from the
+# index. The index is written next to the file, so use a copy.
+#
+cp "${srcdir}/data/dups.fa" T18.fa || exit 1
+rm -f T18.fa.index
+
+./dups T18.fa > T18.out
+
+if [ $? -ne 0 ]; then
+    cat T18.out
+    echo "Duplicate detection failed"
+    exit 1
+fi
+
+if ! grep -q '^;hash=1$' T18.fa.index || [ $(grep -c '^H ' T18.fa.index) -ne 6 ]; then
+    echo "The index doesn't contain the hashes"
+    exit 1
+fi
+
+rm -f T18.fa T18.fa.index T18.out
+exit 0
@@ -0,0 +1,29 @@
+#!/bin/sh
+
+#
+# Letter class intervals (soft-masking, gaps, IUPAC codes), mapped while
+# scanning and loaded from the index. The indexes are written next to the
+# files, so use copies.
+#
+rm -rf T19.d
+mkdir T19.d || exit 1
+
+for name in simple multi multi2 bug0 bug1 masked; do
+    cp "${srcdir}/data/${name}.fa" T19.d/
+
+    ./ivals T19.d/${name}.fa > T19.out
+
+    if [ $? -ne 0 ]; then
+        cat T19.out
+        echo "Intervals differ: ${name}.fa"
+        exit 1
+    fi
+
+    if ! grep -q '^;ivals=1$' T19.d/${name}.fa.index; then
+        echo "The index doesn't contain the intervals: ${name}.fa"
+        exit 1
+    fi
+done
+
+rm -rf T19.d T19.out
+exit 0
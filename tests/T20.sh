@@ -0,0 +1,37 @@
+#!/bin/sh
+
+#
+# FASTQ records read without an index, with an index and by ID. The index
+# is written next to the file, so use a copy.
+#
+cp "${srcdir}/data/reads.fq" T20.fq || exit 1
+rm -f T20.fq.index
+
+./fastq T20.fq > T20.out
+
+if [ $? -ne 0 ]; then
+    cat T20.out
+    echo "Failed to read the FASTQ file"
+    exit 1
+fi
+
+for i in 1 2 3; do
+    cat "${srcdir}/data/reads-correct"
+done > T20.correct
+
+# fasta_fetch_ids() delivers the records in file order, i.e. the same one
+cat "${srcdir}/data/reads-correct" >> T20.correct
+
+if ! cmp -s T20.out T20.correct; then
+    diff -u T20.correct T20.out
+    echo "FASTQ records differ"
+    exit 1
+fi
+
+if ! grep -q '^;fastq=1$' T20.fq.index; then
+    echo "The index isn't marked as a FASTQ index"
+    exit 1
+fi
+
+rm -f T20.fq T20.fq.index T20.out T20.correct
+exit 0
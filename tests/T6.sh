@@ -37,6 +37,13 @@ for((l=$SEQ_LEN_START; l<=$SEQ_LEN_STOP; l++)); do
 		ls -l $FP_path $SQ_A_path $SQ_B_path
 		exit 1
 	    fi
+
+	    if ! cmp -s <(./fastacat $SQ_A_path) <(./fastaexp $SQ_A_path); then
+		echo "fasta_export_fd() output differs from fasta_read()!"
+		echo "Keeping generated files for debugging purposes"
+		ls -l $FP_path $SQ_A_path $SQ_B_path
+		exit 1
+	    fi
 	done
     done
 done
@@ -1,7 +1,7 @@
 #!/bin/sh
 
 for file in ${srcdir}/data/*.fa; do
-    localname="$(basename "T7-${file}")"
+    localname="T7-$(basename "${file}")"
     cp "${file}"  "${localname}"
     ./T4_idx_read "${localname}"
 
@@ -0,0 +1,57 @@
+#!/bin/sh
+
+#
+# Compare the k-mer counts with counts computed by awk
+#
+for file in ${srcdir}/data/*.fa; do
+    ./kmer_count "${file}" 5 3 0 | sort > T9-kmer.out || exit 1
+
+    awk -v k=5 '
+function flush(   s, n, i, m) {
+    s = toupper(seq); n = length(s)
+    for (i = 1; i + k - 1 <= n; i++) {
+        m = substr(s, i, k)
+        if (m !~ /[^ACGT]/)
+            c[m]++
+    }
+    seq = ""
+}
+/^[ ]*>/ { flush(); next }
+{ gsub(/[ \r]/, ""); seq = seq $0 }
+END { flush(); for (m in c) print m, c[m] }' "${file}" | sort > T9-awk.out
+
+    if ! cmp -s T9-kmer.out T9-awk.out; then
+        echo "k-mer counts differ: ${file}"
+        exit 1
+    fi
+done
+
+#
+# Force spilling to disk and compare the result with an in-memory run
+#
+./fastagen 9 0 4 100000 5000 60 0 > T9-seq.fa 2> /dev/null
+./kmer_count T9-seq.fa 13 2 0     | sort > T9-mem.out  || exit 1
+./kmer_count T9-seq.fa 13 2 32768 | sort > T9-disk.out || exit 1
+
+if ! cmp -s T9-mem.out T9-disk.out; then
+    echo "k-mer counts differ when spilling to disk"
+    exit 1
+fi
+
+#
+# Canonical counting: a k-mer and its reverse complement are one entry
+# holding the combined count (AAAC/GTTT, AACGTT is its own reverse
+# complement)
+#
+printf '>a\nAAAC\n>b\nGTTT\n>c\nAACGTT\n' > T9-canon.fa
+printf 'AAA 2\nAAC 4\nACG 2\n' > T9-canon.exp
+./kmer_count T9-canon.fa 3 1 0 canonical | sort > T9-canon.out || exit 1
+
+if ! cmp -s T9-canon.out T9-canon.exp; then
+    echo "canonical k-mer counts differ"
+    cat T9-canon.out
+    exit 1
+fi
+
+rm -f T9-kmer.out T9-awk.out T9-seq.fa T9-mem.out T9-disk.out T9-canon.fa T9-canon.exp T9-canon.out
+exit 0
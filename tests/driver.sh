@@ -0,0 +1,8 @@
+#!/bin/sh
+
+#
+# Run a self-checking test program on all the test files. The programs
+# compare the results with the records read one by one and print the
+# first difference found.
+#
+exec "$@" ${srcdir}/data/*.fa ${srcdir}/data/reads.fq
@@ -0,0 +1,139 @@
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fasta.h>
+#include <libgen.h>
+
+#define SKEW_PATH  "apply-skew.fa"
+#define SKEW_LARGE 2000000
+#define SKEW_SMALL 20000
+
+static uint32_t calls;
+
+/*
+ * FNV-1a hash of the sequence and its length
+ */
+static void *digest(FASTA_rec_t *farec, void *arg)
+{
+	uint64_t *h = malloc(sizeof(uint64_t));
+	uint64_t  i;
+
+	(void)arg;
+
+	*h = 14695981039346656037ULL ^ farec->seq_len;
+
+	for (i = 0; i < farec->seq_len; ++i)
+		*h = (*h ^ farec->seq_mem[i]) * 1099511628211ULL;
+
+	__atomic_fetch_add(&calls, 1, __ATOMIC_RELAXED);
+
+	return (h);
+}
+
+static int check(const char *path)
+{
+	FASTA    *fa;
+	uint64_t **res_s, **res_p;
+	uint32_t  i, n;
+	int       r = 0;
+
+	if ((fa = fasta_open(path, FASTA_READ, NULL)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", path);
+		return (-1);
+	}
+
+	n     = fasta_count(fa);
+	calls = 0;
+	res_s = fasta_apply(fa, digest, 0, NULL);
+	res_p = fasta_apply(fa, digest, FASTA_PARALLEL, NULL);
+
+	if (n > 0 && (res_s == NULL || res_p == NULL)) {
+		printf("%s: fasta_apply => NULL\n", path);
+		r = -1;
+	} else if (calls != 2 * n) {
+		printf("%s: %u calls for %u records\n", path, calls, n);
+		r = -1;
+	}
+
+	for (i = 0; r == 0 && i < n; ++i) {
+		if (*res_s[i] != *res_p[i]) {
+			printf("%s: record #%u: sequential and parallel apply differ\n", path, i);
+			r = -1;
+		}
+	}
+
+	for (i = 0; i < n; ++i) {
+		if (res_s != NULL)
+			free(res_s[i]);
+		if (res_p != NULL)
+			free(res_p[i]);
+	}
+
+	free(res_s);
+	free(res_p);
+	fasta_close(fa);
+
+	return (r);
+}
+
+/*
+ * One large record among lots of tiny ones
+ */
+static int skew_write(const char *path)
+{
+	static const char nt[] = "ACGT";
+	FILE     *fp;
+	uint32_t  i, j, k;
+
+	if ((fp = fopen(path, "w")) == NULL)
+		return (-1);
+
+	for (i = 0; i < SKEW_SMALL; ++i) {
+		if (i == SKEW_SMALL / 3) {
+			fprintf(fp, ">large\n");
+
+			for (j = 0; j < SKEW_LARGE; ++j)
+				fprintf(fp, "%c%s", nt[(j * 7 + j / 13) % 4], (j + 1) % 60 == 0 || j + 1 == SKEW_LARGE ? "\n" : "");
+		}
+
+		fprintf(fp, ">small_%u\n", i);
+
+		for (k = 0; k < 1 + i % 50; ++k)
+			fputc(nt[(i + k) % 4], fp);
+
+		fputc('\n', fp);
+	}
+
+	return (fclose(fp));
+}
+
+/*
+ * Compare the results of the sequential and the parallel fasta_apply()
+ * on the given files and on a generated file with a skewed distribution
+ * of the sequence lengths.
+ */
+int main(int argc, char *argv[])
+{
+	int i, r;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <fasta-file> ...\n", basename(argv[0]));
+		return (1);
+	}
+
+	for (i = 1; i < argc; ++i)
+		if (check(argv[i]) != 0)
+			return (2);
+
+	if (skew_write(SKEW_PATH) != 0) {
+		printf("can't write %s\n", SKEW_PATH);
+		return (3);
+	}
+
+	r = check(SKEW_PATH);
+	remove(SKEW_PATH);
+
+	return (r == 0 ? 0 : 4);
+}
@@ -0,0 +1,198 @@
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fasta.h>
+#include <codon.h>
+#include <libgen.h>
+
+/*
+ * Translate `seq' and compare the result with `expect'
+ */
+static int check_known(const FASTA_codon_t *ct, const char *seq, uint32_t frame, const char *expect)
+{
+	uint8_t dst[64];
+	size_t n;
+
+	n = fasta_translate(ct, (const uint8_t *)seq, strlen(seq), frame, dst);
+
+	if (n != strlen(expect) || memcmp(dst, expect, n) != 0) {
+		printf("code %u, frame %u: %s => %.*s, expected %s\n",
+		       ct->code, frame, seq, (int)(n == (size_t)-1 ? 0 : n), dst, expect);
+		return (-1);
+	}
+
+	return (0);
+}
+
+static uint8_t complement(uint8_t ch)
+{
+	switch (ch) {
+	case 'A': return 'T';
+	case 'a': return 't';
+	case 'C': return 'G';
+	case 'c': return 'g';
+	case 'G': return 'C';
+	case 'g': return 'c';
+	case 'T': case 'U': return 'A';
+	case 't': case 'u': return 'a';
+	}
+
+	return ('N');
+}
+
+/*
+ * The reverse frames have to match the forward ones of the reverse
+ * complement and the six-frame translation the single frame ones.
+ */
+static int check_frames(const FASTA_codon_t *ct, const uint8_t *seq, size_t len)
+{
+	uint8_t *rc, *buf, *six[FASTA_FRAMES];
+	size_t count[FASTA_FRAMES], n, m, i;
+	uint32_t f;
+	int r = 0;
+
+	rc  = malloc(len + 1);
+	buf = malloc(2 * (FASTA_TRANSLATE_SIZE(len) + 1));
+
+	for (i = 0; i < len; ++i)
+		rc[i] = complement(seq[len - 1 - i]);
+
+	for (f = 0; f < FASTA_FRAMES; ++f)
+		six[f] = malloc(FASTA_TRANSLATE_SIZE(len) + 1);
+
+	fasta_translate6(ct, seq, len, six, count);
+
+	for (f = 0; r == 0 && f < FASTA_FRAMES; ++f) {
+		uint8_t *a = buf, *b = buf + FASTA_TRANSLATE_SIZE(len) + 1;
+
+		n = fasta_translate(ct, seq, len, f, a);
+		m = fasta_translate(ct, f < 3 ? seq : rc, len, f % 3, b);
+
+		if (n != m || memcmp(a, b, n) != 0) {
+			printf("length %zu, frame %u: reverse complement translation differs\n", len, f);
+			r = -1;
+		} else if (count[f] != n || memcmp(six[f], a, n) != 0) {
+			printf("length %zu, frame %u: six-frame translation differs\n", len, f);
+			r = -1;
+		}
+	}
+
+	for (f = 0; f < FASTA_FRAMES; ++f)
+		free(six[f]);
+	free(buf);
+	free(rc);
+
+	return (r);
+}
+
+static int check_db(const FASTA_codon_t *ct, const char *path)
+{
+	FASTA *fa;
+	FASTA_rec_t *farec;
+	FASTA_CDS_t cds;
+	uint8_t *a, *b;
+	int r = 0;
+
+	if ((fa = fasta_open(path, FASTA_READ, NULL)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", path);
+		return (-1);
+	}
+
+	while (r == 0 && (farec = fasta_read(fa, NULL, FASTA_INMEMSEQ|FASTA_MAPCDSEG, NULL)) != NULL) {
+		r = check_frames(ct, farec->seq_mem, farec->seq_len);
+
+		a = malloc(FASTA_TRANSLATE_SIZE(farec->seq_len) + 1);
+		b = malloc(FASTA_TRANSLATE_SIZE(farec->seq_len) + 1);
+
+		if (r == 0 && (fasta_translate_rec(ct, farec, 1, a) != fasta_translate(ct, farec->seq_mem, farec->seq_len, 1, b) ||
+			       memcmp(a, b, FASTA_TRANSLATE_SIZE(farec->seq_len - 1)) != 0))
+		{
+			printf("%s: fasta_translate_rec differs\n", path);
+			r = -1;
+		}
+
+		while (r == 0 && fasta_read_CDS(fa, farec, &cds, 0) != NULL) {
+			size_t n = fasta_translate_CDS(ct, &cds, 4, a);
+
+			if (n != fasta_translate(ct, cds.seg_mem, cds.seg_len, 4, b) || memcmp(a, b, n) != 0) {
+				printf("%s: fasta_translate_CDS differs\n", path);
+				r = -1;
+			}
+		}
+
+		free(a);
+		free(b);
+		fasta_rec_free(farec);
+	}
+
+	fasta_close(fa);
+
+	return (r);
+}
+
+/*
+ * Check the genetic codes, the translation of ambiguous codons and the
+ * consistency of the single frame, reverse complement and six-frame
+ * translations of random sequences and the records of the given files.
+ */
+int main(int argc, char *argv[])
+{
+	static const char *sample = "ATGGCCATTGTAATGGGCCGCTGAAAGGGTGCCCGATAG";
+	FASTA_codon_t *std, *mito;
+	uint8_t seq[64], dst[8];
+	size_t len, i;
+	int r = 0;
+
+	if ((std = fasta_codon_new(1)) == NULL || (mito = fasta_codon_new(2)) == NULL) {
+		printf("fasta_codon_new => NULL\n");
+		return (1);
+	}
+
+	if (fasta_codon_new(7) != NULL || errno != ENOENT ||
+	    fasta_translate(std, seq, 3, FASTA_FRAMES, dst) != (size_t)-1 || errno != EINVAL)
+	{
+		printf("invalid code or frame accepted\n");
+		return (2);
+	}
+
+	if (check_known(std,  sample, 0, "MAIVMGR*KGAR*") != 0 ||
+	    check_known(mito, sample, 0, "MAIVMGRWKGAR*") != 0 ||
+	    check_known(std,  sample, 1, "WPL*WAAERVPD") != 0 ||
+	    check_known(mito, "AGAATAAGG", 0, "*M*") != 0 ||
+	    check_known(std,  "AGAATAAGG", 0, "RIR") != 0 ||
+	    check_known(std,  "gcuGCNGGNNNNTTNCTNTAN", 0, "AAGXXLX") != 0 ||
+	    check_known(std,  "CATTTT", 3, "KM") != 0 ||
+	    check_known(std,  "CATTTTGG", 5, "KM") != 0)
+		r = 3;
+
+	if (r == 0 && (!std->start[fasta_codon_index(std, (const uint8_t *)"ATG")] ||
+		       std->start[fasta_codon_index(std, (const uint8_t *)"ATA")] ||
+		       !mito->start[fasta_codon_index(mito, (const uint8_t *)"ATA")] ||
+		       !std->start_rc[fasta_codon_index(std, (const uint8_t *)"CAT")]))
+	{
+		printf("start codons not marked\n");
+		r = 4;
+	}
+
+	srand(42);
+
+	for (len = 0; r == 0 && len < sizeof seq; ++len) {
+		for (i = 0; i < len; ++i)
+			seq[i] = "ACGTNacgtR"[rand() % 10];
+
+		if (check_frames(std, seq, len) != 0)
+			r = 5;
+	}
+
+	for (i = 1; r == 0 && i < (size_t)argc; ++i)
+		if (check_db(std, argv[i]) != 0)
+			r = 6;
+
+	fasta_codon_free(std);
+	fasta_codon_free(mito);
+
+	return (r);
+}
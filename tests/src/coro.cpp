@@ -0,0 +1,175 @@
+#include <config.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fasta.hpp>
+
+/*
+ * Compare the records streamed through the generator and the pipeline
+ * stages with the ones read using the C interface.
+ */
+static int check(const char *path, atrans_t *tr)
+{
+	std::vector<std::string> seqs, quals;
+	FASTA *fa;
+	FASTA_rec_t *farec;
+	std::size_t n, longer = 0, min = 0;
+
+	if ((fa = fasta_open(path, FASTA_READ, NULL)) == NULL) {
+		std::printf("fasta_open(%s) => NULL\n", path);
+		return (-1);
+	}
+
+	while ((farec = fasta_read(fa, NULL, FASTA_INMEMSEQ, NULL)) != NULL) {
+		seqs.emplace_back(reinterpret_cast<const char *>(farec->seq_mem), farec->seq_len);
+		quals.emplace_back(farec->qual_mem != NULL ? reinterpret_cast<const char *>(farec->qual_mem) : "",
+				   farec->qual_mem != NULL ? farec->seq_len : 0);
+		fasta_rec_free(farec);
+	}
+
+	fasta_close(fa);
+
+	if (!seqs.empty())
+		min = seqs[seqs.size() / 2].size();
+
+	for (const std::string &s : seqs)
+		if (s.size() > min)
+			++longer;
+
+	fasta::Database db(path);
+
+	/*
+	 * Plain stream, twice, with and without prefetching
+	 */
+	for (std::uint32_t prefetch = 0; prefetch < 2; ++prefetch) {
+		n = 0;
+
+		for (fasta::Record &rec : fasta::stream(db, FASTA_INMEMSEQ, nullptr, prefetch * 8)) {
+			if (n >= seqs.size() || rec.sequence() != seqs[n] || rec.quality() != quals[n]) {
+				std::printf("%s: streamed record #%zu differs\n", path, n);
+				return (-1);
+			}
+			++n;
+		}
+
+		if (n != seqs.size()) {
+			std::printf("%s: streamed %zu records out of %zu\n", path, n, seqs.size());
+			return (-1);
+		}
+	}
+
+	/*
+	 * filter
+	 */
+	n = 0;
+
+	for (fasta::Record &rec : fasta::filter(fasta::stream(db), [min](const fasta::Record &r) { return (r.length() > min); })) {
+		if (rec.length() <= min) {
+			std::printf("%s: filtered record of length %zu passed\n", path, rec.length());
+			return (-1);
+		}
+		++n;
+	}
+
+	if (n != longer) {
+		std::printf("%s: %zu records passed the filter, expected %zu\n", path, n, longer);
+		return (-1);
+	}
+
+	/*
+	 * translate
+	 */
+	n = 0;
+
+	for (const fasta::Translated &t : fasta::translate(fasta::stream(db), tr)) {
+		const std::string &s = seqs[n];
+
+		if (t.sequence.size() != s.size()) {
+			std::printf("%s: record #%zu: translated length %zu, expected %zu\n", path, n, t.sequence.size(), s.size());
+			return (-1);
+		}
+
+		for (std::size_t i = 0; i < s.size(); ++i) {
+			if (t.sequence[i] != tr->tr_letter_s2d[static_cast<std::uint8_t>(s[i])]) {
+				std::printf("%s: record #%zu: letter #%zu translated wrong\n", path, n, i);
+				return (-1);
+			}
+		}
+
+		if (t.record.sequence() != s) {
+			std::printf("%s: record #%zu: translated record differs\n", path, n);
+			return (-1);
+		}
+
+		++n;
+	}
+
+	if (n != seqs.size()) {
+		std::printf("%s: translated %zu records out of %zu\n", path, n, seqs.size());
+		return (-1);
+	}
+
+	/*
+	 * batch
+	 */
+	n = 0;
+
+	for (std::span<fasta::Record> b : fasta::batch(fasta::stream(db), 3)) {
+		if (b.empty() || b.size() > 3) {
+			std::printf("%s: batch of %zu records\n", path, b.size());
+			return (-1);
+		}
+
+		for (fasta::Record &rec : b) {
+			if (rec.sequence() != seqs[n]) {
+				std::printf("%s: batched record #%zu differs\n", path, n);
+				return (-1);
+			}
+			++n;
+		}
+	}
+
+	if (n != seqs.size()) {
+		std::printf("%s: batched %zu records out of %zu\n", path, n, seqs.size());
+		return (-1);
+	}
+
+	/*
+	 * Leaving the loop early destroys the coroutine and its record
+	 */
+	n = 0;
+
+	for (fasta::Record &rec : fasta::stream(db)) {
+		(void)rec;
+		if (++n == 1)
+			break;
+	}
+
+	return (0);
+}
+
+int main(int argc, char *argv[])
+{
+	atrans_t *tr;
+	int r = 0;
+
+	tr = atrans_new(8, 8, 0, 0);
+
+	tr->tr_letter_s2d['A'] = '1';
+	tr->tr_letter_s2d['a'] = '1';
+	tr->tr_letter_s2d['T'] = '2';
+	tr->tr_letter_s2d['t'] = '2';
+	tr->tr_letter_s2d['C'] = '3';
+	tr->tr_letter_s2d['c'] = '3';
+	tr->tr_letter_s2d['G'] = '4';
+	tr->tr_letter_s2d['g'] = '4';
+
+	for (int i = 1; r == 0 && i < argc; ++i)
+		if (check(argv[i], tr) != 0)
+			r = 2;
+
+	atrans_free(tr);
+
+	return (r);
+}
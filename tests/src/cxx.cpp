@@ -0,0 +1,237 @@
+#include <config.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fasta.hpp>
+#if __cplusplus >= 202002L
+# include <ranges>
+
+static_assert(std::ranges::input_range<fasta::Database::Range>);
+#endif
+
+/*
+ * Compare the records returned by the C++ interface with the ones read
+ * using the C interface.
+ */
+static int check(const char *path)
+{
+	std::vector<std::string> seqs, quals, ids;
+	FASTA *fa;
+	FASTA_rec_t *farec;
+
+	if ((fa = fasta_open(path, FASTA_READ, NULL)) == NULL) {
+		std::printf("fasta_open(%s) => NULL\n", path);
+		return (-1);
+	}
+
+	while ((farec = fasta_read(fa, NULL, FASTA_INMEMSEQ, NULL)) != NULL) {
+		seqs.emplace_back(reinterpret_cast<const char *>(farec->seq_mem), farec->seq_len);
+		quals.emplace_back(farec->qual_mem != NULL ? reinterpret_cast<const char *>(farec->qual_mem) : "",
+				   farec->qual_mem != NULL ? farec->seq_len : 0);
+		ids.emplace_back(farec->rec_id != NULL ? farec->rec_id : "");
+		fasta_rec_free(farec);
+	}
+
+	fasta_close(fa);
+
+	fasta::Database db(path);
+	std::size_t n = 0;
+
+	if (db.size() != seqs.size()) {
+		std::printf("%s: size() => %u, expected %zu\n", path, db.size(), seqs.size());
+		return (-1);
+	}
+
+	/*
+	 * Range-for, twice, the iteration restarts from the first record
+	 */
+	for (int pass = 0; pass < 2; ++pass) {
+		n = 0;
+
+		for (const fasta::Record &rec : db) {
+			if (n >= seqs.size() || rec.sequence() != seqs[n] || rec.quality() != quals[n] || rec.id() != ids[n]) {
+				std::printf("%s: record #%zu differs\n", path, n);
+				return (-1);
+			}
+
+			if (rec.header().empty() || rec.length() != seqs[n].size()) {
+				std::printf("%s: record #%zu: wrong header or length\n", path, n);
+				return (-1);
+			}
+
+			++n;
+		}
+
+		if (n != seqs.size()) {
+			std::printf("%s: iterated over %zu records out of %zu\n", path, n, seqs.size());
+			return (-1);
+		}
+	}
+
+	/*
+	 * Only the metadata, without the sequences
+	 */
+	n = 0;
+
+	for (const fasta::Record &rec : db.records(0)) {
+		if (!rec.sequence().empty() || rec.id() != ids[n]) {
+			std::printf("%s: record #%zu: sequence read without FASTA_INMEMSEQ\n", path, n);
+			return (-1);
+		}
+		++n;
+	}
+
+	if (n != seqs.size()) {
+		std::printf("%s: iterated over %zu metadata records out of %zu\n", path, n, seqs.size());
+		return (-1);
+	}
+
+	/*
+	 * Random access and moves of records and databases
+	 */
+	fasta::Record rec;
+	fasta::Database moved(std::move(db));
+
+	if (db || !moved) {
+		std::printf("%s: database not moved\n", path);
+		return (-1);
+	}
+
+	for (std::size_t i = seqs.size(); i > 0; --i) {
+		if (!moved.read(static_cast<std::uint32_t>(i - 1), rec) || rec.sequence() != seqs[i - 1]) {
+			std::printf("%s: read(%zu) failed\n", path, i - 1);
+			return (-1);
+		}
+	}
+
+	fasta::Record other(std::move(rec));
+
+	if (rec || !other || other.sequence() != seqs[0]) {
+		std::printf("%s: record not moved\n", path);
+		return (-1);
+	}
+
+	return (0);
+}
+
+/*
+ * Once the buffer of a record fits the largest record of the db, reading
+ * the records into it doesn't allocate memory.
+ */
+static int check_reuse(const char *path)
+{
+	fasta::Database db(path, FASTA_READ | FASTA_METRICS);
+	fasta::Record rec;
+	FASTA_metrics_t m;
+	std::uint64_t allocs = 0;
+	std::uint32_t n = 0;
+
+	for (int pass = 0; pass < 3; ++pass) {
+		db.rewind();
+
+		while (db.read(rec))
+			++n;
+
+		if (fasta_get_metrics(db.get(), &m) != 0) {
+			std::printf("%s: fasta_get_metrics => -1\n", path);
+			return (-1);
+		}
+
+		if (pass > 0 && m.allocs != allocs) {
+			std::printf("%s: pass %d: %llu allocations\n", path, pass,
+				    static_cast<unsigned long long>(m.allocs - allocs));
+			return (-1);
+		}
+
+		allocs = m.allocs;
+	}
+
+	if (n != 3 * db.size() || m.records != n) {
+		std::printf("%s: read %u records, %llu counted\n", path, n, static_cast<unsigned long long>(m.records));
+		return (-1);
+	}
+
+	return (0);
+}
+
+/*
+ * The headers are returned exactly as they appear on the header line,
+ * including the SeqID field separators and the description.
+ */
+static int check_headers(std::uint32_t options)
+{
+	static const char *path = "cxx-headers.fa";
+	static const std::vector<std::vector<std::string>> expect = {
+		{ "plain header" },
+		{ "gi|123|gb|ABC.1|LOC desc", "lcl|foo bar" },
+		{ "sp|P12345|PROT_HUMAN Some protein", "gnl|db|x1", "ref|NM_000001.1|" },
+		{ "1ABC:A|PDBID|CHAIN|SEQUENCE a b", "gi|7|emb|CAA1|LOC", "pir||ENTRY x" },
+		{ "prf||NAME", "pat|US|123 x  y", "bbs|55", " leading space", "pdb|1ABC|A" }
+	};
+	std::FILE *fp;
+	std::size_t n = 0;
+
+	if ((fp = std::fopen(path, "w")) == nullptr)
+		return (-1);
+
+	for (const auto &hdrs : expect) {
+		for (std::size_t i = 0; i < hdrs.size(); ++i)
+			std::fprintf(fp, "%s%s", i == 0 ? ">" : "\001", hdrs[i].c_str());
+		std::fprintf(fp, "\nACGT\n");
+	}
+
+	std::fclose(fp);
+
+	fasta::Database db(path, FASTA_READ | options);
+
+	for (const fasta::Record &rec : db) {
+		if (n >= expect.size() || rec.header_count() != expect[n].size()) {
+			std::printf("%s: record #%zu: wrong header count\n", path, n);
+			return (-1);
+		}
+
+		for (std::size_t i = 0; i < expect[n].size(); ++i) {
+			if (rec.header(i) != expect[n][i]) {
+				std::printf("%s: record #%zu: header(%zu) => \"%.*s\", expected \"%s\"\n", path, n, i,
+					    static_cast<int>(rec.header(i).size()), rec.header(i).data(), expect[n][i].c_str());
+				return (-1);
+			}
+		}
+
+		if (!rec.header(expect[n].size()).empty()) {
+			std::printf("%s: record #%zu: header past the last one\n", path, n);
+			return (-1);
+		}
+
+		++n;
+	}
+
+	return (n == expect.size() ? 0 : -1);
+}
+
+int main(int argc, char *argv[])
+{
+	try {
+		fasta::Database db("/nonexistent/file.fa");
+
+		std::printf("no exception thrown for a nonexistent file\n");
+		return (2);
+	} catch (const std::system_error &) {
+	}
+
+	for (int i = 1; i < argc; ++i)
+		if (check(argv[i]) != 0 || check_reuse(argv[i]) != 0)
+			return (3);
+
+	if (check_headers(0) != 0 ||
+	    check_headers(FASTA_USEINDEX | FASTA_GENINDEX) != 0 ||
+	    check_headers(FASTA_USEINDEX | FASTA_CHKINDEX) != 0)
+		return (4);
+
+	std::remove("cxx-headers.fa");
+	std::remove("cxx-headers.fa" FASTA_INDEX_EXT);
+
+	return (0);
+}
@@ -0,0 +1,235 @@
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <ctype.h>
+#include <fasta.h>
+
+#define DECODE_PATH    "decode.fa"
+#define DECODE_RECORDS 60
+
+static const char letters[] = "ACGTNacgtn-";
+
+static char    *expect[DECODE_RECORDS];
+static uint32_t expect_len[DECODE_RECORDS];
+
+/*
+ * Write records whose lines are of equal length (even records) or of
+ * varying length (odd records), with runs of upper and lower case letters.
+ */
+static int write_db(const char *path)
+{
+	FILE *fp;
+	uint32_t i, j, k, w;
+
+	if ((fp = fopen(path, "w")) == NULL)
+		return (-1);
+
+	for (i = 0; i < DECODE_RECORDS; ++i) {
+		expect_len[i] = (i * 53) % 700 + 1;
+		expect[i]     = malloc(expect_len[i] + 1);
+
+		for (j = 0; j < expect_len[i]; ++j)
+			expect[i][j] = letters[((j / (1 + i % 9)) * 7 + i) % (sizeof letters - 1)];
+
+		expect[i][j] = '\0';
+
+		fprintf(fp, ">dec_%u\n", i);
+
+		for (j = 0, k = 0; j < expect_len[i]; j += w, ++k) {
+			w = i % 2 == 0 ? 10 + i % 50 : 1 + (k * 13 + i) % 70;
+
+			if (w > expect_len[i] - j)
+				w = expect_len[i] - j;
+
+			fprintf(fp, "%.*s\n", (int)w, expect[i] + j);
+		}
+	}
+
+	return (fclose(fp));
+}
+
+static int check_rec(FASTA *fa, const FASTA_rec_t *farec, uint32_t recno, atrans_t *tr, uint32_t flags, const char *what)
+{
+	const char *seq = expect[recno];
+	uint32_t i, a, n = 0;
+
+	if (farec->seq_len != expect_len[recno]) {
+		printf("%s: record #%u: length %"PRIu64", expected %u\n", what, recno, farec->seq_len, expect_len[recno]);
+		return (-1);
+	}
+
+	for (i = 0; i < expect_len[recno]; ++i) {
+		uint8_t ch = tr != NULL ? tr->tr_letter_s2d[(uint8_t)seq[i]] : (uint8_t)seq[i];
+
+		if (farec->seq_mem[i] != ch) {
+			printf("%s: record #%u: letter #%u is '%c', expected '%c'\n", what, recno, i, farec->seq_mem[i], ch);
+			return (-1);
+		}
+	}
+
+	if (!(flags & FASTA_MAPCDSEG)) {
+		if (farec->cdseg_count != 0) {
+			printf("%s: record #%u: coding segments mapped without FASTA_MAPCDSEG\n", what, recno);
+			return (-1);
+		}
+		return (0);
+	}
+
+	/*
+	 * The coding segments are the runs of coding letters
+	 */
+	for (i = 0; i < expect_len[recno]; ) {
+		uint8_t ch = (uint8_t)seq[i];
+
+		if (!(fa->fa_CDSmask[ch / 32] & (1U << (ch % 32)))) {
+			++i;
+			continue;
+		}
+
+		for (a = i; i < expect_len[recno] && (fa->fa_CDSmask[(uint8_t)seq[i] / 32] & (1U << ((uint8_t)seq[i] % 32))); ++i);
+
+		if (n >= farec->cdseg_count || farec->cdseg[n].a != a || farec->cdseg[n].b != i - 1) {
+			printf("%s: record #%u: coding segment [%u, %u] not found\n", what, recno, a, i - 1);
+			return (-1);
+		}
+
+		++n;
+	}
+
+	if (n != farec->cdseg_count) {
+		printf("%s: record #%u: %zu coding segments, expected %u\n", what, recno, farec->cdseg_count, n);
+		return (-1);
+	}
+
+	return (0);
+}
+
+typedef struct {
+	FASTA    *fa;
+	atrans_t *tr;
+	uint32_t  flags;
+} fetch_t;
+
+static int check_fetched(FASTA_rec_t *farec, uint32_t index, void *arg)
+{
+	fetch_t *f = arg;
+
+	if (farec == NULL) {
+		printf("fetch: request %u: not found\n", index);
+		return (-1);
+	}
+
+	return (check_rec(f->fa, farec, index, f->tr, f->flags, "fetch"));
+}
+
+/*
+ * Read all the records using the given translation table and flags,
+ * with fasta_read(), with fasta_read_buf() into the same record and
+ * with fasta_fetch_ids().
+ */
+static int check(atrans_t *tr, uint32_t flags, uint32_t *uniform)
+{
+	FASTA *fa;
+	FASTA_rec_t *farec, rec;
+	fetch_t f;
+	uint8_t *buf = NULL;
+	size_t size = 0;
+	char ids[DECODE_RECORDS][16];
+	const char *idp[DECODE_RECORDS];
+	uint32_t recno = 0;
+	int r = 0;
+
+	if ((fa = fasta_open(DECODE_PATH, FASTA_READ, tr)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", DECODE_PATH);
+		return (-1);
+	}
+
+	while (r == 0 && (farec = fasta_read(fa, NULL, FASTA_INMEMSEQ|flags, NULL)) != NULL) {
+		if (farec->seq_linew != 0)
+			++*uniform;
+
+		r = check_rec(fa, farec, recno++, tr, flags, "read");
+		fasta_rec_free(farec);
+	}
+
+	if (r == 0 && recno != DECODE_RECORDS) {
+		printf("read %u records out of %u\n", recno, DECODE_RECORDS);
+		r = -1;
+	}
+
+	memset(&rec, 0, sizeof rec);
+	fasta_rewind(fa);
+
+	for (recno = 0; r == 0 && (r = fasta_read_buf(fa, &rec, &buf, &size, flags, NULL)) == 0; )
+		r = check_rec(fa, &rec, recno++, tr, flags, "read_buf");
+
+	if (r == 1)
+		r = recno == DECODE_RECORDS ? 0 : -1;
+
+	fasta_rec_free(&rec);
+	free(buf);
+
+	for (recno = 0; recno < DECODE_RECORDS; ++recno) {
+		snprintf(ids[recno], sizeof ids[recno], "dec_%u", recno);
+		idp[recno] = ids[recno];
+	}
+
+	f.fa    = fa;
+	f.tr    = tr;
+	f.flags = flags;
+
+	if (r == 0)
+		r = fasta_fetch_ids(fa, idp, DECODE_RECORDS, flags, check_fetched, &f);
+
+	fasta_close(fa);
+
+	return (r);
+}
+
+/*
+ * Decode records with equal and varying line lengths, with and without
+ * translation and coding segment mapping, and compare the result with
+ * the letters written.
+ */
+int main(int argc, char *argv[])
+{
+	atrans_t *tr;
+	uint32_t i, uniform = 0;
+	int r = 0;
+
+	(void)argc;
+	(void)argv;
+
+	if (write_db(DECODE_PATH) != 0) {
+		printf("can't write %s\n", DECODE_PATH);
+		return (2);
+	}
+
+	tr = atrans_new(8, 8, 0, 0);
+
+	for (i = 1; i < 256; ++i)
+		tr->tr_letter_s2d[i] = isalpha(i) ? i ^ 0x20 : i;
+
+	r |= check(NULL, 0, &uniform);
+	r |= check(NULL, FASTA_MAPCDSEG, &uniform);
+	r |= check(tr, 0, &uniform);
+	r |= check(tr, FASTA_MAPCDSEG, &uniform);
+
+	if (r == 0 && (uniform == 0 || uniform == 4 * DECODE_RECORDS)) {
+		printf("%u records with equal line lengths out of %u\n", uniform, 4 * DECODE_RECORDS);
+		r = -1;
+	}
+
+	atrans_free(tr);
+
+	for (i = 0; i < DECODE_RECORDS; ++i)
+		free(expect[i]);
+
+	remove(DECODE_PATH);
+	remove(DECODE_PATH FASTA_INDEX_EXT);
+
+	return (r == 0 ? 0 : 3);
+}
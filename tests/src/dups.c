@@ -0,0 +1,143 @@
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fasta.h>
+#include <libgen.h>
+
+#define RECORDS 6
+
+/*
+ * Expected groups of tests/data/dups.fa, with and without case folding
+ */
+static const uint32_t expect_plain[RECORDS] = { 0, 0, 2, 3, 0, 5 };
+static const uint32_t expect_fold[RECORDS]  = { 0, 0, 0, 3, 0, 0 };
+
+static int check_groups(FASTA *fa, const uint32_t *expect, const char *what)
+{
+	uint32_t *dup, unique, i, n = 0;
+
+	if (fasta_count(fa) != RECORDS) {
+		printf("%s: %u records, expected %u\n", what, fasta_count(fa), RECORDS);
+		return (-1);
+	}
+
+	if ((dup = fasta_duplicates(fa, &unique)) == NULL) {
+		printf("%s: fasta_duplicates => NULL\n", what);
+		return (-1);
+	}
+
+	for (i = 0; i < RECORDS; ++i) {
+		const FASTA_hash_t *a = fasta_hash(fa, i);
+		const FASTA_hash_t *b = fasta_hash(fa, expect[i]);
+
+		if (dup[i] != expect[i]) {
+			printf("%s: record #%u grouped with #%u, expected #%u\n", what, i, dup[i], expect[i]);
+			free(dup);
+			return (-1);
+		}
+
+		if (memcmp(a, b, sizeof *a) != 0) {
+			printf("%s: hashes of #%u and #%u differ\n", what, i, expect[i]);
+			free(dup);
+			return (-1);
+		}
+
+		if (expect[i] == i)
+			++n;
+	}
+
+	free(dup);
+
+	if (unique != n) {
+		printf("%s: %u unique sequences, expected %u\n", what, unique, n);
+		return (-1);
+	}
+
+	return (0);
+}
+
+static int check_open(const char *path, int options, const uint32_t *expect, FASTA_hash_t *hash, const char *what)
+{
+	FASTA *fa;
+	uint32_t i;
+	int r;
+
+	if ((fa = fasta_open(path, FASTA_READ|FASTA_USEINDEX|FASTA_CHKINDEX|options, NULL)) == NULL) {
+		printf("%s: fasta_open(%s) => NULL\n", what, path);
+		return (-1);
+	}
+
+	r = check_groups(fa, expect, what);
+
+	/*
+	 * The hashes have to be the same whether they were computed or
+	 * loaded from the index
+	 */
+	for (i = 0; r == 0 && i < RECORDS; ++i) {
+		if (options & FASTA_GENINDEX)
+			hash[i] = *fasta_hash(fa, i);
+		else if (memcmp(fasta_hash(fa, i), hash + i, sizeof hash[i]) != 0) {
+			printf("%s: hash of #%u differs from the computed one\n", what, i);
+			r = -1;
+		}
+	}
+
+	fasta_close(fa);
+
+	return (r);
+}
+
+/*
+ * Check the content hashes and the grouping of identical sequences,
+ * both when computed and when loaded from the index.
+ */
+int main(int argc, char *argv[])
+{
+	FASTA *fa;
+	FASTA_hash_t plain[RECORDS], fold[RECORDS];
+	uint32_t unique;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <fasta-file>\n", basename(argv[0]));
+		return (1);
+	}
+
+	if ((fa = fasta_open(argv[1], FASTA_READ, NULL)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", argv[1]);
+		return (2);
+	}
+
+	if (fasta_hash(fa, 0) != NULL || errno != ENOENT ||
+	    fasta_duplicates(fa, &unique) != NULL || errno != ENOENT)
+	{
+		printf("hashes available without FASTA_HASH\n");
+		return (3);
+	}
+
+	fasta_close(fa);
+
+	if (check_open(argv[1], FASTA_HASH|FASTA_GENINDEX, expect_plain, plain, "plain") != 0 ||
+	    check_open(argv[1], FASTA_HASH, expect_plain, plain, "plain, index") != 0)
+		return (4);
+
+	if (check_open(argv[1], FASTA_HASHFOLD|FASTA_GENINDEX, expect_fold, fold, "fold") != 0 ||
+	    check_open(argv[1], FASTA_HASHFOLD, expect_fold, fold, "fold, index") != 0)
+		return (5);
+
+	if (memcmp(plain + 2, fold + 2, sizeof plain[2]) == 0) {
+		printf("folded and plain hashes of a lower case sequence are equal\n");
+		return (6);
+	}
+
+	/*
+	 * An index with folded hashes doesn't satisfy a request for the
+	 * plain ones, it has to be regenerated
+	 */
+	if (check_open(argv[1], FASTA_HASH|FASTA_GENINDEX, expect_plain, plain, "plain, regen") != 0)
+		return (7);
+
+	return (0);
+}
@@ -0,0 +1,259 @@
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <fasta.h>
+#include <libgen.h>
+
+#define MAXOUT  262144
+#define THREADS 4
+#define ROUNDS  50
+
+/*
+ * Export the record into a temporary file (or a pipe) and read the
+ * result back into `dst'.
+ */
+static ssize_t export(FASTA *fa, uint32_t recno, uint32_t flags, uint32_t width, int use_pipe, char *dst)
+{
+	ssize_t n = 0, r;
+	int fd[2];
+	FILE *fp = NULL;
+
+	if (use_pipe) {
+		if (pipe(fd) != 0)
+			return (-1);
+	} else {
+		if ((fp = tmpfile()) == NULL)
+			return (-1);
+		fd[0] = fd[1] = fileno(fp);
+	}
+
+	if (fasta_export_fd(fa, recno, fd[1], flags, width) != 0) {
+		n = -1;
+		goto finish;
+	}
+
+	if (use_pipe)
+		close(fd[1]);
+	else
+		lseek(fd[0], 0, SEEK_SET);
+
+	while ((r = read(fd[0], dst + n, MAXOUT - n)) > 0)
+		n += r;
+finish:
+	if (use_pipe)
+		close(fd[0]);
+	else
+		fclose(fp);
+
+	return (n);
+}
+
+/*
+ * The expected output: the header, the letters of the sequence wrapped in
+ * lines of `width' letters and the new-line at the end. The letters are
+ * taken from the file, as fasta_read() ignores a last line without a
+ * new-line.
+ */
+static size_t expect(FASTA *fa, uint32_t recno, uint32_t flags, uint32_t width, char *dst)
+{
+	const FASTA_rec_t *rec = fa->fa_record + recno;
+	FILE *fp = fopen(fa->fa_path, "r");
+	size_t n = 0, i = 0;
+	int ch;
+
+	if (flags & FASTA_EXPORT_HEADER) {
+		dst[n++] = '>';
+		fseek(fp, (long)rec->hdr_start, SEEK_SET);
+		n += fread(dst + n, 1, rec->hdr_len, fp);
+	}
+
+	fseek(fp, (long)rec->seq_start, SEEK_SET);
+
+	while (i < rec->seq_len && (ch = fgetc(fp)) != EOF) {
+		if (isspace(ch))
+			continue;
+
+		dst[n++] = (char)ch;
+
+		if (width > 0 && ++i % width == 0)
+			dst[n++] = '\n';
+		else if (width == 0)
+			++i;
+	}
+
+	fclose(fp);
+
+	if (rec->seq_len > 0 && (width > 0 || (flags & FASTA_EXPORT_HEADER)) && rec->seq_len % (width > 0 ? width : rec->seq_len + 1) != 0)
+		dst[n++] = '\n';
+
+	return (n);
+}
+
+static int check(const char *path)
+{
+	static const uint32_t widths[] = { 0, 1, 7, 60, 61, 1000000 };
+	static char out[MAXOUT], exp[MAXOUT];
+	FASTA *fa;
+	FASTA_rec_t *farec;
+	uint32_t recno, w, flags;
+	ssize_t n;
+	size_t e;
+	int p;
+
+	if ((fa = fasta_open(path, FASTA_READ, NULL)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", path);
+		return (-1);
+	}
+
+	for (recno = 0; (farec = fasta_read(fa, NULL, FASTA_INMEMSEQ, NULL)) != NULL; ++recno) {
+		for (w = 0; w < sizeof widths / sizeof widths[0] + 1; ++w) {
+			for (flags = 0; flags <= FASTA_EXPORT_HEADER; ++flags) {
+				for (p = 0; p < 2; ++p) {
+					uint32_t width;
+
+					if (w < sizeof widths / sizeof widths[0])
+						width = widths[w];
+					else
+						width = farec->seq_linew;
+
+					n = export(fa, recno, flags, width, p, out);
+					e = expect(fa, recno, flags, width, exp);
+
+					if (n < 0 || (size_t)n != e || memcmp(out, exp, e) != 0) {
+						printf("%s: record #%u, width %u, flags %u%s: output differs (%zd vs. %zu bytes)\n",
+						       path, recno, width, flags, p ? ", pipe" : "", n, e);
+						fasta_rec_free(farec);
+						fasta_close(fa);
+						return (-1);
+					}
+				}
+			}
+		}
+
+		/*
+		 * The source lines are kept, i.e. a record with lines of equal
+		 * width is exported with that width
+		 */
+		if (farec->seq_linew > 0) {
+			n = export(fa, recno, FASTA_EXPORT_KEEPWRAP, 0, 0, out);
+			e = expect(fa, recno, 0, farec->seq_lastw > 0 || farec->seq_lines > 1 ? farec->seq_linew : 0, exp);
+
+			if (farec->seq_lines == 1 && farec->seq_len > 0)
+				exp[e++] = '\n';
+
+			if (n < 0 || (size_t)n != e || memcmp(out, exp, e) != 0) {
+				printf("%s: record #%u: the source lines weren't kept\n", path, recno);
+				fasta_rec_free(farec);
+				fasta_close(fa);
+				return (-1);
+			}
+		}
+
+		fasta_rec_free(farec);
+	}
+
+	if (fasta_export_fd(fa, recno, STDOUT_FILENO, 0, 0) == 0 || errno != ERANGE) {
+		printf("%s: nonexistent record exported\n", path);
+		fasta_close(fa);
+		return (-1);
+	}
+
+	fasta_close(fa);
+
+	return (0);
+}
+
+typedef struct {
+	FASTA   *fa;
+	uint32_t width;
+	int      error;
+} worker_t;
+
+static void *export_worker(void *arg)
+{
+	worker_t *w = arg;
+	char *out = malloc(MAXOUT), *exp = malloc(MAXOUT);
+	uint32_t recno, i;
+	ssize_t n;
+	size_t e;
+
+	for (recno = 0; recno < fasta_count(w->fa) && w->error == 0; ++recno) {
+		e = expect(w->fa, recno, FASTA_EXPORT_HEADER, w->width, exp);
+
+		for (i = 0; i < ROUNDS && w->error == 0; ++i) {
+			n = export(w->fa, recno, FASTA_EXPORT_HEADER, w->width, 1, out);
+
+			if (n < 0 || (size_t)n != e || memcmp(out, exp, e) != 0)
+				w->error = -1;
+		}
+	}
+
+	free(out);
+	free(exp);
+
+	return (NULL);
+}
+
+/*
+ * Export all the records of one db by several threads at once, each with
+ * a different line width, i.e. through the buffers of the calls
+ */
+static int check_threads(const char *path)
+{
+	pthread_t thread[THREADS];
+	worker_t  worker[THREADS];
+	FASTA    *fa;
+	int i, r = 0;
+
+	if ((fa = fasta_open(path, FASTA_READ|FASTA_KEEPOPEN, NULL)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", path);
+		return (-1);
+	}
+
+	for (i = 0; i < THREADS; ++i) {
+		worker[i].fa    = fa;
+		worker[i].width = 3 + i;
+		worker[i].error = 0;
+
+		if (pthread_create(thread + i, NULL, export_worker, worker + i) != 0) {
+			printf("pthread_create failed\n");
+			r = -1;
+			break;
+		}
+	}
+
+	while (i-- > 0) {
+		pthread_join(thread[i], NULL);
+
+		if (worker[i].error != 0) {
+			printf("%s: thread %d: output differs\n", path, i);
+			r = -1;
+		}
+	}
+
+	fasta_close(fa);
+
+	return (r);
+}
+
+/*
+ * Export the records with different line widths, with and without the
+ * headers, into regular files and pipes and compare the results with the
+ * sequences read into memory.
+ */
+int main(int argc, char *argv[])
+{
+	int i;
+
+	for (i = 1; i < argc; ++i)
+		if (check(argv[i]) != 0 || check_threads(argv[i]) != 0)
+			return (2);
+
+	return (0);
+}
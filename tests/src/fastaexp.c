@@ -0,0 +1,42 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fasta.h>
+#include <libgen.h>
+
+int main(int argc, char *argv[])
+{
+	FASTA *fa;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <fasta-file> [<seq #>]\n", basename(argv[0]));
+		return (1);
+	}
+
+	fa = fasta_open(argv[1], FASTA_READ|FASTA_ONDEMSEQ, NULL);
+
+	if (fa == NULL) {
+		fprintf(stderr, "fasta_open(%s) => NULL\n", argv[1]);
+		return (2);
+	}
+
+	if (argc > 2) {
+		if (fasta_export_fd(fa, atoi(argv[2]), STDOUT_FILENO, 0, 0) != 0) {
+			fprintf(stderr, "fasta_export_fd(%s) != 0\n", argv[2]);
+			return (3);
+		}
+	} else {
+		uint32_t i;
+
+		for (i = 0; i < fasta_count(fa); ++i) {
+			if (fasta_export_fd(fa, i, STDOUT_FILENO, 0, 0) != 0) {
+				fprintf(stderr, "fasta_export_fd(%u) != 0\n", i);
+				return (4);
+			}
+		}
+	}
+
+	fasta_close(fa);
+
+	return(0);
+}
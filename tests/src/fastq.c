@@ -0,0 +1,101 @@
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fasta.h>
+#include <libgen.h>
+
+static int print_rec(FASTA_rec_t *farec, uint32_t index, void *arg)
+{
+	(void)arg;
+
+	if (farec == NULL) {
+		printf("request %u: not found\n", index);
+		return (-1);
+	}
+
+	printf("%s\t%s\t%s\n", farec->rec_id, farec->seq_mem, farec->qual_mem);
+	return (0);
+}
+
+static int read_all(const char *path, uint32_t options)
+{
+	FASTA *fa;
+	FASTA_rec_t *farec;
+	uint32_t n = 0;
+
+	if ((fa = fasta_open(path, options, NULL)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", path);
+		return (-1);
+	}
+
+	if (!(fa->fa_options & FASTA_FASTQ)) {
+		printf("FASTQ format not detected\n");
+		fasta_close(fa);
+		return (-1);
+	}
+
+	while ((farec = fasta_read(fa, NULL, FASTA_INMEMSEQ|FASTA_CSTRSEQ, NULL)) != NULL) {
+		if (farec->qual_mem == NULL || strlen((char *)farec->qual_mem) != farec->seq_len) {
+			printf("record #%u: quality string missing or of wrong length\n", n);
+			fasta_rec_free(farec);
+			fasta_close(fa);
+			return (-1);
+		}
+
+		print_rec(farec, n++, NULL);
+		fasta_rec_free(farec);
+	}
+
+	if (n != fasta_count(fa)) {
+		printf("read %u records out of %u\n", n, fasta_count(fa));
+		fasta_close(fa);
+		return (-1);
+	}
+
+	fasta_close(fa);
+
+	return (0);
+}
+
+/*
+ * Print the ID, sequence and quality string of each record of a FASTQ file
+ * read without an index, with a newly generated index, with an existing
+ * index and using fasta_fetch_ids(). All four listings have to be equal.
+ */
+int main(int argc, char *argv[])
+{
+	FASTA *fa;
+	const char **ids;
+	uint32_t i, n;
+	int r;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <fastq-file>\n", basename(argv[0]));
+		return (1);
+	}
+
+	if (read_all(argv[1], FASTA_READ) != 0 ||
+	    read_all(argv[1], FASTA_READ|FASTA_USEINDEX|FASTA_GENINDEX) != 0 ||
+	    read_all(argv[1], FASTA_READ|FASTA_USEINDEX|FASTA_CHKINDEX) != 0)
+		return (2);
+
+	if ((fa = fasta_open(argv[1], FASTA_READ|FASTA_USEINDEX|FASTA_CHKINDEX, NULL)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", argv[1]);
+		return (3);
+	}
+
+	n   = fasta_count(fa);
+	ids = malloc(sizeof(char *) * n);
+
+	for (i = 0; i < n; ++i)
+		ids[i] = fa->fa_record[i].rec_id;
+
+	r = fasta_fetch_ids(fa, ids, n, FASTA_CSTRSEQ, print_rec, NULL);
+
+	free(ids);
+	fasta_close(fa);
+
+	return (r == 0 ? 0 : 4);
+}
@@ -0,0 +1,165 @@
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fasta.h>
+#include <libgen.h>
+
+typedef struct {
+	FASTA    *fa;
+	uint32_t *recno;     /* expected record of each request, UINT32_MAX if none */
+	uint32_t *delivered;
+	uint64_t  last;      /* seq_start of the previously delivered record */
+	uint32_t  calls;
+	uint32_t  stop;      /* stop after this number of calls */
+} check_t;
+
+static int check(FASTA_rec_t *farec, uint32_t index, void *arg)
+{
+	check_t *c = arg;
+	FASTA_rec_t *r;
+	uint32_t s;
+
+	++c->delivered[index];
+
+	if (++c->calls == c->stop)
+		return (7);
+
+	if (farec == NULL) {
+		if (c->recno[index] != UINT32_MAX) {
+			printf("request %u: record #%u not delivered\n", index, c->recno[index]);
+			return (-1);
+		}
+		return (0);
+	}
+
+	if (c->recno[index] == UINT32_MAX || farec->seq_start < c->last) {
+		printf("request %u: unexpected record\n", index);
+		return (-1);
+	}
+
+	c->last = farec->seq_start;
+
+	fasta_seeko(c->fa, c->recno[index], SEEK_SET);
+	r = fasta_read(c->fa, NULL, FASTA_INMEMSEQ|FASTA_CSTRSEQ|FASTA_MAPCDSEG, NULL);
+
+	if (r == NULL || r->seq_len != farec->seq_len || strcmp((char *)r->seq_mem, (char *)farec->seq_mem) != 0 ||
+	    r->cdseg_count != farec->cdseg_count || strcmp(r->rec_id, farec->rec_id) != 0)
+	{
+		printf("request %u: record #%u differs\n", index, c->recno[index]);
+		return (-1);
+	}
+
+	for (s = 0; s < r->cdseg_count; ++s) {
+		if (r->cdseg[s].a != farec->cdseg[s].a || r->cdseg[s].b != farec->cdseg[s].b) {
+			printf("request %u: coding segment #%u differs\n", index, s);
+			return (-1);
+		}
+	}
+
+	fasta_rec_free(r);
+
+	return (0);
+}
+
+/*
+ * Fetch all the records in the reverse order along with a duplicate and
+ * a non-existent ID and compare them with the records read one by one.
+ */
+static int fetch_db(const char *path)
+{
+	FASTA *fa;
+	const char **ids;
+	check_t c;
+	uint32_t i, n = 0;
+	int r;
+
+	if ((fa = fasta_open(path, FASTA_READ|FASTA_ONDEMSEQ, NULL)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", path);
+		return (2);
+	}
+
+	ids     = malloc(sizeof(char *) * (fasta_count(fa) + 2));
+	c.recno = malloc(sizeof(uint32_t) * (fasta_count(fa) + 2));
+
+	for (i = fasta_count(fa); i > 0; --i) {
+		if (fa->fa_record[i - 1].hdr_cnt == 0)
+			continue;
+
+		ids[n] = fa->fa_record[i - 1].rec_id;
+
+		if (fasta_lookup_id(fa, ids[n], c.recno + n) != 0 ||
+		    strcmp(fa->fa_record[c.recno[n]].rec_id, ids[n]) != 0 || c.recno[n] > i - 1)
+		{
+			printf("fasta_lookup_id(%s) failed\n", ids[n]);
+			return (3);
+		}
+
+		++n;
+	}
+
+	if (n > 0) {
+		ids[n]     = ids[0];
+		c.recno[n] = c.recno[0];
+		++n;
+	}
+
+	ids[n]     = "no such id";
+	c.recno[n] = UINT32_MAX;
+	++n;
+
+	c.fa        = fa;
+	c.delivered = calloc(n, sizeof(uint32_t));
+	c.last      = 0;
+	c.calls     = 0;
+	c.stop      = 0;
+
+	if ((r = fasta_fetch_ids(fa, ids, n, FASTA_CSTRSEQ|FASTA_MAPCDSEG, check, &c)) != 0) {
+		printf("fasta_fetch_ids => %d\n", r);
+		return (4);
+	}
+
+	for (i = 0; i < n; ++i) {
+		if (c.delivered[i] != 1) {
+			printf("request %u delivered %u times\n", i, c.delivered[i]);
+			return (5);
+		}
+	}
+
+	/*
+	 * Stop at the second call
+	 */
+	c.last  = 0;
+	c.calls = 0;
+	c.stop  = 2;
+
+	if ((r = fasta_fetch_ids(fa, ids, n, FASTA_CSTRSEQ|FASTA_MAPCDSEG, check, &c)) != 7 || c.calls != 2) {
+		printf("fasta_fetch_ids didn't stop: %d, %u calls\n", r, c.calls);
+		return (6);
+	}
+
+	printf("%s: %u requests\n", path, n);
+
+	free(ids);
+	free(c.recno);
+	free(c.delivered);
+	fasta_close(fa);
+
+	return (0);
+}
+
+int main(int argc, char *argv[])
+{
+	int i, r = 0;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <fasta-file> ...\n", basename(argv[0]));
+		return (1);
+	}
+
+	for (i = 1; r == 0 && i < argc; ++i)
+		r = fetch_db(argv[i]);
+
+	return (r);
+}
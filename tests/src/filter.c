@@ -0,0 +1,212 @@
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <fnmatch.h>
+#include <fasta.h>
+#include <libgen.h>
+
+#define FILTER_PATH    "filter.fa"
+#define FILTER_RECORDS 400
+
+static const char *headers[] = {
+	"sp|P%05u|PROT_%u", "ref|NM_%06u.%u|", "lcl|seq_%u_%u", "gnl|db|id%u_%u", "plain_%u_%u some description"
+};
+
+static int write_db(const char *path)
+{
+	FILE *fp;
+	uint32_t i, j, len;
+
+	if ((fp = fopen(path, "w")) == NULL)
+		return (-1);
+
+	for (i = 0; i < FILTER_RECORDS; ++i) {
+		fputc('>', fp);
+		fprintf(fp, headers[i % 5], i, i % 7);
+		fputc('\n', fp);
+
+		/* mostly short sequences, every 10th one longer */
+		len = i % 10 == 0 ? 5000 + i : 20 + i % 90;
+
+		for (j = 0; j < len; ++j)
+			fprintf(fp, "%c%s", "ACGT"[(i + j * 3) % 4], (j + 1) % 70 == 0 || j + 1 == len ? "\n" : "");
+	}
+
+	return (fclose(fp));
+}
+
+/*
+ * The filter evaluated record by record
+ */
+static int naive(const FASTA_rec_t *rec, const FASTA_filter_t *flt)
+{
+	if (rec->seq_len < flt->len_min || (flt->len_max > 0 && rec->seq_len > flt->len_max))
+		return (0);
+	if (flt->seqid_fmt != 0 && (rec->hdr_cnt == 0 || !(flt->seqid_fmt & FASTA_FILTER_SEQID(rec->hdr[0].seqid_fmt))))
+		return (0);
+	if (flt->id_glob != NULL && (rec->rec_id == NULL || fnmatch(flt->id_glob, rec->rec_id, 0) != 0))
+		return (0);
+
+	return (1);
+}
+
+typedef struct {
+	char    **seq;  /* sequences read by fasta_read() */
+	uint32_t *sel;
+	uint32_t  n;
+	uint32_t  next;
+} fetch_t;
+
+static int fetched(FASTA_rec_t *farec, uint32_t recno, void *arg)
+{
+	fetch_t *f = arg;
+
+	if (f->next >= f->n || f->sel[f->next] != recno) {
+		printf("record #%u fetched out of order or not selected\n", recno);
+		return (-1);
+	}
+
+	if (strcmp((char *)farec->seq_mem, f->seq[recno]) != 0) {
+		printf("record #%u: fetched sequence differs\n", recno);
+		return (-1);
+	}
+
+	++f->next;
+
+	return (0);
+}
+
+static int check(FASTA *fa, char **seq, const FASTA_filter_t *flt, const char *what)
+{
+	FASTA_metrics_t m0, m1;
+	fetch_t   f;
+	uint32_t  i, n, k;
+
+	if ((f.sel = fasta_select(fa, flt, &n)) == NULL) {
+		printf("%s: fasta_select => NULL\n", what);
+		return (-1);
+	}
+
+	for (i = 0, k = 0; i < fasta_count(fa); ++i) {
+		if (!naive(fa->fa_record + i, flt))
+			continue;
+
+		if (k >= n || f.sel[k] != i) {
+			printf("%s: record #%u not selected\n", what, i);
+			free(f.sel);
+			return (-1);
+		}
+
+		++k;
+	}
+
+	if (k != n) {
+		printf("%s: %u records selected, expected %u\n", what, n, k);
+		free(f.sel);
+		return (-1);
+	}
+
+	f.seq  = seq;
+	f.n    = n;
+	f.next = 0;
+
+	fasta_get_metrics(fa, &m0);
+
+	if (fasta_fetch_filter(fa, flt, FASTA_CSTRSEQ, fetched, &f) != 0 || f.next != n) {
+		printf("%s: fasta_fetch_filter failed\n", what);
+		free(f.sel);
+		return (-1);
+	}
+
+	fasta_get_metrics(fa, &m1);
+	free(f.sel);
+
+	/*
+	 * Only the selected records are decoded
+	 */
+	if (n == 0 ? m1.bytes_read != m0.bytes_read : m1.records - m0.records != n) {
+		printf("%s: %"PRIu64" records read, %u selected\n", what, m1.records - m0.records, n);
+		return (-1);
+	}
+
+	return (0);
+}
+
+/*
+ * Compare the records selected by fasta_select() with a record by record
+ * evaluation of the filters and check that fasta_fetch_filter() reads only
+ * the selected records.
+ */
+int main(int argc, char *argv[])
+{
+	FASTA_filter_t flt;
+	FASTA       *fa;
+	FASTA_rec_t *farec;
+	char       **seq;
+	uint32_t     i, n;
+	int          r = 0;
+
+	(void)argc;
+	(void)argv;
+
+	if (write_db(FILTER_PATH) != 0) {
+		printf("can't write %s\n", FILTER_PATH);
+		return (2);
+	}
+
+	if ((fa = fasta_open(FILTER_PATH, FASTA_READ|FASTA_METRICS, NULL)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", FILTER_PATH);
+		remove(FILTER_PATH);
+		return (3);
+	}
+
+	n   = fasta_count(fa);
+	seq = calloc(n, sizeof(char *));
+
+	for (i = 0; (farec = fasta_read(fa, NULL, FASTA_INMEMSEQ|FASTA_CSTRSEQ, NULL)) != NULL; ++i) {
+		seq[i] = malloc(farec->seq_len + 1);
+		memcpy(seq[i], farec->seq_mem, farec->seq_len + 1);
+		fasta_rec_free(farec);
+	}
+
+	memset(&flt, 0, sizeof flt);
+	r |= check(fa, seq, &flt, "all");
+
+	flt.len_min = 5000;
+	r |= check(fa, seq, &flt, "long");
+
+	flt.len_min = 30;
+	flt.len_max = 60;
+	r |= check(fa, seq, &flt, "30-60");
+
+	flt.len_min = 61;
+	flt.len_max = 60;
+	r |= check(fa, seq, &flt, "empty range");
+
+	memset(&flt, 0, sizeof flt);
+	flt.seqid_fmt = FASTA_FILTER_SEQID(SEQID_SWISSPROT)|FASTA_FILTER_SEQID(SEQID_LOCAL);
+	r |= check(fa, seq, &flt, "swissprot, local");
+
+	flt.len_max = 50;
+	r |= check(fa, seq, &flt, "swissprot, local, short");
+
+	memset(&flt, 0, sizeof flt);
+	flt.id_glob = "*_3";
+	r |= check(fa, seq, &flt, "glob");
+
+	flt.len_min = 5100;
+	flt.seqid_fmt = FASTA_FILTER_SEQID(SEQID_NCBIREF);
+	r |= check(fa, seq, &flt, "glob, long, refseq");
+
+	for (i = 0; i < n; ++i)
+		free(seq[i]);
+
+	free(seq);
+	fasta_close(fa);
+	remove(FILTER_PATH);
+
+	return (r == 0 ? 0 : 4);
+}
@@ -1,20 +1,25 @@
 #include <config.h>
 #include <stdio.h>
+#include <string.h>
 #include <fasta.h>
 #include <libgen.h>
 
 int main(int argc, char *argv[])
 {
 	FASTA *fa;
+	uint32_t options;
 
-	if (argc != 2) {
-		fprintf(stderr, "Usage: %s <fasta-file>\n", basename(argv[0]));
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "Usage: %s <fasta-file> [upd]\n", basename(argv[0]));
 		return (1);
 	}
 
-	fa = fasta_open(argv[1],
-			FASTA_READ|FASTA_ONDEMSEQ|
-			FASTA_USEINDEX|FASTA_GENINDEX|FASTA_CHKINDEX, NULL);
+	options = FASTA_READ|FASTA_ONDEMSEQ|FASTA_USEINDEX|FASTA_GENINDEX|FASTA_CHKINDEX;
+
+	if (argc == 3 && strcmp(argv[2], "upd") == 0)
+		options |= FASTA_UPDINDEX;
+
+	fa = fasta_open(argv[1], options, NULL);
 
 	if (fa != NULL) {
 		printf("Total records: %u\n", fasta_count(fa));
@@ -0,0 +1,150 @@
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fasta.h>
+#include <libgen.h>
+
+static int inclass(uint32_t k, uint8_t ch)
+{
+	switch (1 << k) {
+	case FASTA_IVAL_LOWER:
+		return (islower(ch));
+	case FASTA_IVAL_GAP:
+		return (ch == 'N' || ch == 'n' || ch == '-');
+	case FASTA_IVAL_IUPAC:
+		return (ch != 0 && strchr("BDHKMRSVWYbdhkmrsvwy", ch) != NULL);
+	}
+
+	return (0);
+}
+
+/*
+ * Compare the intervals of the class `k' with the ones found by a
+ * letter by letter walk through the sequence.
+ */
+static int check_class(const FASTA_rec_t *farec, const FASTA_ivals_t *iv, uint32_t k, const char *what, uint32_t recno)
+{
+	uint64_t i, a;
+	uint32_t n = 0;
+
+	for (i = 0; i < farec->seq_len; ) {
+		if (!inclass(k, farec->seq_mem[i])) {
+			++i;
+			continue;
+		}
+
+		for (a = i; i < farec->seq_len && inclass(k, farec->seq_mem[i]); ++i);
+
+		if (n >= iv->count[k] || iv->ival[k][n].a != a || iv->ival[k][n].b != i - 1) {
+			printf("%s: record #%u, class %u: interval [%"PRIu64", %"PRIu64"] not found\n",
+			       what, recno, k, a, i - 1);
+			return (-1);
+		}
+
+		++n;
+	}
+
+	if (n != iv->count[k]) {
+		printf("%s: record #%u, class %u: %u intervals, expected %u\n", what, recno, k, iv->count[k], n);
+		return (-1);
+	}
+
+	return (0);
+}
+
+static int check_db(const char *path, uint32_t options, const char *what)
+{
+	FASTA *fa;
+	FASTA_rec_t *farec;
+	FASTA_ivals_t iv;
+	uint32_t recno = 0, k;
+	int r = 0;
+
+	if ((fa = fasta_open(path, FASTA_READ|FASTA_USEINDEX|FASTA_CHKINDEX|FASTA_IVALS|options, NULL)) == NULL) {
+		printf("%s: fasta_open(%s) => NULL\n", what, path);
+		return (-1);
+	}
+
+	while (r == 0 && (farec = fasta_read(fa, NULL, FASTA_INMEMSEQ, NULL)) != NULL) {
+		const FASTA_ivals_t *cached = fasta_intervals(fa, recno);
+
+		if (cached == NULL) {
+			printf("%s: fasta_intervals(%u) => NULL\n", what, recno);
+			r = -1;
+		}
+
+		for (k = 0; r == 0 && k < FASTA_IVAL_CLASSES; ++k)
+			r = check_class(farec, cached, k, what, recno);
+
+		/*
+		 * Map all the classes at once and each one of them separately
+		 */
+		if (r == 0 && fasta_map_intervals(farec, FASTA_IVAL_ALL, &iv) == 0) {
+			for (k = 0; r == 0 && k < FASTA_IVAL_CLASSES; ++k)
+				r = check_class(farec, &iv, k, "fasta_map_intervals", recno);
+			fasta_ivals_free(&iv);
+		} else
+			r = -1;
+
+		for (k = 0; r == 0 && k < FASTA_IVAL_CLASSES; ++k) {
+			if (fasta_map_intervals(farec, 1 << k, &iv) != 0)
+				r = -1;
+			else {
+				r = check_class(farec, &iv, k, "fasta_map_intervals, single class", recno);
+
+				if (r == 0 && iv.count[(k + 1) % FASTA_IVAL_CLASSES] != 0) {
+					printf("record #%u: unrequested class mapped\n", recno);
+					r = -1;
+				}
+
+				fasta_ivals_free(&iv);
+			}
+		}
+
+		fasta_rec_free(farec);
+		++recno;
+	}
+
+	fasta_close(fa);
+
+	return (r);
+}
+
+/*
+ * Check the intervals mapped while scanning the file, loaded from the
+ * index and mapped from the sequences in memory.
+ */
+int main(int argc, char *argv[])
+{
+	FASTA *fa;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <fasta-file>\n", basename(argv[0]));
+		return (1);
+	}
+
+	if ((fa = fasta_open(argv[1], FASTA_READ, NULL)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", argv[1]);
+		return (2);
+	}
+
+	if (fasta_intervals(fa, 0) != NULL || errno != ENOENT) {
+		printf("intervals available without FASTA_IVALS\n");
+		return (3);
+	}
+
+	fasta_close(fa);
+
+	if (check_db(argv[1], FASTA_GENINDEX, "scan") != 0)
+		return (4);
+
+	if (check_db(argv[1], 0, "index") != 0)
+		return (5);
+
+	return (0);
+}
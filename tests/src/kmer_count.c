@@ -0,0 +1,91 @@
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <fasta.h>
+#include <kmer.h>
+#include <libgen.h>
+
+int main(int argc, char *argv[])
+{
+	FASTA        *fa;
+	FASTA_kmer_t *km;
+	FILE         *fp;
+	char          kmer[FASTA_KMER_MAXK + 1], rc[FASTA_KMER_MAXK + 1];
+	uint64_t      count, total, distinct;
+	uint32_t      options = 0;
+	size_t        i, k;
+
+	if (argc != 5 && !(argc == 6 && strcmp(argv[5], "canonical") == 0)) {
+		fprintf(stderr, "Usage: %s <fasta-file> <k> <threads> <membudget> [canonical]\n", basename(argv[0]));
+		return (1);
+	}
+
+	if (argc == 6)
+		options |= FASTA_KMER_CANONICAL;
+
+	fa = fasta_open(argv[1], FASTA_READ|FASTA_ONDEMSEQ, NULL);
+
+	if (fa == NULL) {
+		fprintf(stderr, "fasta_open(%s) => NULL\n", argv[1]);
+		return (2);
+	}
+
+	km = fasta_kmer_count(fa, atoi(argv[2]), options, atoi(argv[3]), strtoull(argv[4], NULL, 10));
+
+	if (km == NULL) {
+		fprintf(stderr, "fasta_kmer_count => NULL\n");
+		return (3);
+	}
+
+	/*
+	 * Dump the table and verify that each k-mer can be looked up
+	 */
+	fp = tmpfile();
+
+	if (fp == NULL || fasta_kmer_dump(km, fp) != 0)
+		return (4);
+
+	rewind(fp);
+	total    = 0;
+	distinct = 0;
+
+	while (fscanf(fp, "%31s %"SCNu64, kmer, &count) == 2) {
+		if (fasta_kmer_lookup(km, kmer) != count) {
+			fprintf(stderr, "lookup(%s) != %"PRIu64"\n", kmer, count);
+			return (5);
+		}
+
+		/*
+		 * The reverse complement of a canonical k-mer has the same count
+		 */
+		if (options & FASTA_KMER_CANONICAL) {
+			for (k = strlen(kmer), i = 0; i < k; ++i)
+				rc[k - 1 - i] = "TGCA"[strchr("ACGT", kmer[i]) - "ACGT"];
+
+			rc[k] = '\0';
+
+			if (fasta_kmer_lookup(km, rc) != count) {
+				fprintf(stderr, "lookup(%s) != lookup(%s)\n", rc, kmer);
+				return (5);
+			}
+		}
+
+		printf("%s %"PRIu64"\n", kmer, count);
+
+		total += count;
+		++distinct;
+	}
+
+	if (total != fasta_kmer_total(km) || distinct != fasta_kmer_distinct(km)) {
+		fprintf(stderr, "total/distinct mismatch\n");
+		return (6);
+	}
+
+	fclose(fp);
+	fasta_kmer_free(km);
+	fasta_close(fa);
+
+	return (0);
+}
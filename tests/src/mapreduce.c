@@ -0,0 +1,132 @@
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fasta.h>
+#include <libgen.h>
+
+typedef struct {
+	uint64_t records;
+	uint64_t letters;
+	uint64_t hist[65];   /* log2 of the sequence lengths */
+	uint64_t count[256]; /* letter counts, only with the sequences */
+} summary_t;
+
+static void init(void *acc)
+{
+	memset(acc, 0, sizeof(summary_t));
+}
+
+static void add(summary_t *s, const FASTA_rec_t *farec, int seq)
+{
+	uint64_t i;
+
+	s->records += 1;
+	s->letters += farec->seq_len;
+	s->hist[farec->seq_len > 0 ? 64 - __builtin_clzll(farec->seq_len) : 0] += 1;
+
+	if (seq)
+		for (i = 0; i < farec->seq_len; ++i)
+			s->count[farec->seq_mem[i]] += 1;
+}
+
+static int map(void *acc, FASTA_rec_t *farec, void *arg)
+{
+	add(acc, farec, arg != NULL);
+	return (0);
+}
+
+static int map_fail(void *acc, FASTA_rec_t *farec, void *arg)
+{
+	(void)acc;
+	(void)arg;
+
+	return (farec->seq_len > 0 ? -1 : 0);
+}
+
+static void combine(void *dst, const void *src)
+{
+	summary_t *d = dst;
+	const summary_t *s = src;
+	size_t i;
+
+	d->records += s->records;
+	d->letters += s->letters;
+
+	for (i = 0; i < 65; ++i)
+		d->hist[i] += s->hist[i];
+	for (i = 0; i < 256; ++i)
+		d->count[i] += s->count[i];
+}
+
+static int check(const char *path)
+{
+	static const uint32_t options[] = { 0, FASTA_PARALLEL, FASTA_INMEMSEQ, FASTA_INMEMSEQ|FASTA_PARALLEL };
+	summary_t expect_meta, expect_seq, got;
+	FASTA *fa;
+	FASTA_rec_t *farec;
+	size_t i;
+	int dummy;
+
+	if ((fa = fasta_open(path, FASTA_READ, NULL)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", path);
+		return (-1);
+	}
+
+	init(&expect_meta);
+	init(&expect_seq);
+
+	while ((farec = fasta_read(fa, NULL, FASTA_INMEMSEQ, NULL)) != NULL) {
+		add(&expect_meta, fa->fa_record + expect_meta.records, 0);
+		add(&expect_seq, farec, 1);
+		fasta_rec_free(farec);
+	}
+
+	for (i = 0; i < sizeof options / sizeof options[0]; ++i) {
+		int seq = (options[i] & FASTA_INMEMSEQ) != 0;
+
+		if (fasta_mapreduce(fa, &got, sizeof got, init, map, combine, options[i], seq ? &dummy : NULL) != 0) {
+			printf("%s: fasta_mapreduce(options=%#x) failed\n", path, options[i]);
+			fasta_close(fa);
+			return (-1);
+		}
+
+		if (memcmp(&got, seq ? &expect_seq : &expect_meta, sizeof got) != 0) {
+			printf("%s: fasta_mapreduce(options=%#x): wrong summary\n", path, options[i]);
+			fasta_close(fa);
+			return (-1);
+		}
+	}
+
+	if (expect_meta.letters > 0 && fasta_mapreduce(fa, &got, sizeof got, init, map_fail, combine, FASTA_PARALLEL, NULL) == 0) {
+		printf("%s: the failure of map wasn't reported\n", path);
+		fasta_close(fa);
+		return (-1);
+	}
+
+	fasta_close(fa);
+
+	return (0);
+}
+
+/*
+ * Compare database-wide summaries computed by fasta_mapreduce(), with and
+ * without the sequences and in parallel, with the ones computed from the
+ * records read by fasta_read().
+ */
+int main(int argc, char *argv[])
+{
+	int i;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <fasta-file> ...\n", basename(argv[0]));
+		return (1);
+	}
+
+	for (i = 1; i < argc; ++i)
+		if (check(argv[i]) != 0)
+			return (2);
+
+	return (0);
+}
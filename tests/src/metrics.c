@@ -0,0 +1,103 @@
+#include <config.h>
+#include <stdio.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <fasta.h>
+#include <libgen.h>
+
+/*
+ * Check the consistency of the runtime metrics after reading all the
+ * records of a db.
+ */
+int main(int argc, char *argv[])
+{
+	FASTA *fa;
+	FASTA_rec_t *farec;
+	FASTA_metrics_t m;
+	uint32_t n, p, b;
+	uint64_t sum;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <fasta-file>\n", basename(argv[0]));
+		return (1);
+	}
+
+	/*
+	 * The metrics aren't collected by default
+	 */
+	if ((fa = fasta_open(argv[1], FASTA_READ|FASTA_ONDEMSEQ, NULL)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", argv[1]);
+		return (2);
+	}
+
+	if (fasta_get_metrics(fa, &m) == 0 || errno != ENOENT) {
+		printf("fasta_get_metrics: metrics available without FASTA_METRICS\n");
+		return (3);
+	}
+
+	fasta_close(fa);
+
+	if ((fa = fasta_open(argv[1], FASTA_READ|FASTA_ONDEMSEQ|FASTA_METRICS|FASTA_NASEQ, NULL)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", argv[1]);
+		return (2);
+	}
+
+	n = 0;
+
+	while ((farec = fasta_read(fa, NULL, FASTA_INMEMSEQ|FASTA_MAPCDSEG, NULL)) != NULL) {
+		fasta_rec_free(farec);
+		++n;
+	}
+
+	if (fasta_get_metrics(fa, &m) != 0) {
+		printf("fasta_get_metrics => -1\n");
+		return (4);
+	}
+
+	if (n != fasta_count(fa) || m.records != n) {
+		printf("records: read=%u, count=%u, metrics=%"PRIu64"\n", n, fasta_count(fa), m.records);
+		return (5);
+	}
+
+	if (m.phase_count[FASTA_PHASE_OPEN] != 1 ||
+	    m.phase_count[FASTA_PHASE_SCAN] != 1 ||
+	    m.phase_count[FASTA_PHASE_INDEX] != 0 ||
+	    m.phase_count[FASTA_PHASE_HEADER] != n ||
+	    m.phase_count[FASTA_PHASE_READ] != n ||
+	    m.phase_count[FASTA_PHASE_DECODE] != n)
+	{
+		printf("unexpected phase counts\n");
+		return (6);
+	}
+
+	for (p = 0; p < FASTA_PHASE_COUNT; ++p) {
+		for (b = 0, sum = 0; b < FASTA_METRICS_BUCKETS; ++b)
+			sum += m.phase_hist[p][b];
+
+		if (sum != m.phase_count[p]) {
+			printf("%s: histogram sum %"PRIu64" != %"PRIu64"\n",
+			       fasta_metrics_phase_name(p), sum, m.phase_count[p]);
+			return (7);
+		}
+	}
+
+	if (m.phase_ns[FASTA_PHASE_OPEN] < m.phase_ns[FASTA_PHASE_SCAN]) {
+		printf("scan time exceeds open time\n");
+		return (8);
+	}
+
+	if (m.syscalls == 0 || m.bytes_read == 0 || m.allocs == 0) {
+		printf("I/O or allocation counters not updated\n");
+		return (9);
+	}
+
+	for (p = 0; p < FASTA_PHASE_COUNT; ++p)
+		printf("%s %"PRIu64"\n", fasta_metrics_phase_name(p), m.phase_count[p]);
+
+	printf("records %"PRIu64"\n", m.records);
+	printf("cdsegs %"PRIu64"\n", m.cdsegs);
+
+	fasta_close(fa);
+
+	return (0);
+}
@@ -0,0 +1,227 @@
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <fasta.h>
+#include <codon.h>
+#include <libgen.h>
+
+/*
+ * Codon by codon ORF search in the frame `frame', in the reading order.
+ * The ORFs of the reverse frames are stored from the last one.
+ */
+static size_t naive_frame(const FASTA_codon_t *ct, const uint8_t *seq, uint64_t len, uint32_t frame,
+			  uint64_t minlen, uint32_t options, FASTA_u64p *dst)
+{
+	uint64_t skip = frame % 3, m, k, lo, open = UINT64_MAX, begin = 0, a, b;
+	size_t n = 0;
+
+	if (len < 3 + skip)
+		return (0);
+
+	m = (len - skip) / 3;
+
+	for (k = 0; k < m; ++k) {
+		uint32_t x;
+		int stop, start;
+
+		lo    = frame < 3 ? skip + 3 * k : len - skip - 3 * (k + 1);
+		x     = fasta_codon_index(ct, seq + lo);
+		stop  = (frame < 3 ? ct->aa[x] : ct->aa_rc[x]) == '*';
+		start = (frame < 3 ? ct->start[x] : ct->start_rc[x]) != 0;
+
+		if (stop) {
+			if (open != UINT64_MAX) {
+				a = frame < 3 ? skip + 3 * open : lo;
+				b = frame < 3 ? lo + 2 : len - skip - 3 * open - 1;
+
+				if (b - a + 1 >= minlen) {
+					dst[n].a = a;
+					dst[n].b = b;
+					++n;
+				}
+			}
+
+			open  = UINT64_MAX;
+			begin = k + 1;
+		} else if (open == UINT64_MAX &&
+			   (start || ((options & FASTA_ORF_NOSTART) && k == begin) ||
+			    ((options & FASTA_ORF_PARTIAL) && k == 0)))
+			open = k;
+	}
+
+	if ((options & FASTA_ORF_PARTIAL) && open != UINT64_MAX) {
+		a = frame < 3 ? skip + 3 * open : len - skip - 3 * m;
+		b = frame < 3 ? skip + 3 * m - 1 : len - skip - 3 * open - 1;
+
+		if (b - a + 1 >= minlen) {
+			dst[n].a = a;
+			dst[n].b = b;
+			++n;
+		}
+	}
+
+	if (frame >= 3) {
+		for (k = 0; k < n / 2; ++k) {
+			FASTA_u64p t = dst[k];
+			dst[k] = dst[n - 1 - k];
+			dst[n - 1 - k] = t;
+		}
+	}
+
+	return (n);
+}
+
+static int compare(const FASTA_codon_t *ct, const uint8_t *seq, uint64_t len, uint64_t minlen,
+		   uint32_t options, const FASTA_orfs_t *orfs, const char *what)
+{
+	FASTA_u64p *expect;
+	uint32_t f;
+	size_t n, i;
+
+	expect = malloc(sizeof(FASTA_u64p) * (len / 3 + 1));
+
+	for (f = 0; f < FASTA_FRAMES; ++f) {
+		n = naive_frame(ct, seq, len, f, minlen, options, expect);
+
+		if (n != orfs->count[f]) {
+			printf("%s: length %"PRIu64", options %u, frame %u: %zu ORFs, expected %zu\n",
+			       what, len, options, f, orfs->count[f], n);
+			free(expect);
+			return (-1);
+		}
+
+		for (i = 0; i < n; ++i) {
+			if (orfs->orf[f][i].a != expect[i].a || orfs->orf[f][i].b != expect[i].b) {
+				printf("%s: length %"PRIu64", options %u, frame %u: ORF #%zu is [%"PRIu64", %"PRIu64"], expected [%"PRIu64", %"PRIu64"]\n",
+				       what, len, options, f, i, orfs->orf[f][i].a, orfs->orf[f][i].b, expect[i].a, expect[i].b);
+				free(expect);
+				return (-1);
+			}
+		}
+	}
+
+	free(expect);
+
+	return (0);
+}
+
+static int check_seq(const FASTA_codon_t *ct, const uint8_t *seq, uint64_t len, uint64_t minlen, uint32_t threads)
+{
+	FASTA_orfs_t orfs;
+	uint32_t options;
+	int r = 0;
+
+	for (options = 0; r == 0 && options < 4; ++options) {
+		if (fasta_map_orfs(ct, seq, len, minlen, options, threads, &orfs) != 0) {
+			printf("fasta_map_orfs failed\n");
+			return (-1);
+		}
+
+		r = compare(ct, seq, len, minlen, options, &orfs, "fasta_map_orfs");
+		fasta_orfs_free(&orfs);
+	}
+
+	return (r);
+}
+
+static int check_db(const FASTA_codon_t *ct, const char *path)
+{
+	FASTA *fa;
+	FASTA_rec_t *farec;
+	FASTA_orfs_t *orfs;
+	uint32_t i;
+	int r = 0;
+
+	if ((fa = fasta_open(path, FASTA_READ, NULL)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", path);
+		return (-1);
+	}
+
+	if ((orfs = fasta_find_orfs(fa, ct, 30, 0, 3)) == NULL) {
+		printf("%s: fasta_find_orfs => NULL\n", path);
+		fasta_close(fa);
+		return (-1);
+	}
+
+	for (i = 0; (farec = fasta_read(fa, NULL, FASTA_INMEMSEQ, NULL)) != NULL; ++i) {
+		if (r == 0)
+			r = compare(ct, farec->seq_mem, farec->seq_len, 30, 0, orfs + i, path);
+		fasta_rec_free(farec);
+	}
+
+	for (i = 0; i < fasta_count(fa); ++i)
+		fasta_orfs_free(orfs + i);
+
+	free(orfs);
+	fasta_close(fa);
+
+	return (r);
+}
+
+/*
+ * Compare the ORFs found using the stop and start codon bitmaps with the
+ * ones found by a codon by codon walk through each frame.
+ */
+int main(int argc, char *argv[])
+{
+	static const char *sample = "CCATGAAATAGCTACATTTTTTT";
+	FASTA_codon_t *ct;
+	FASTA_orfs_t orfs;
+	uint8_t *seq;
+	uint64_t len, i;
+	int r = 0;
+
+	if ((ct = fasta_codon_new(11)) == NULL) {
+		printf("fasta_codon_new => NULL\n");
+		return (1);
+	}
+
+	/*
+	 * ATGAAATAG on the forward strand and ATGTAG on the reverse one
+	 */
+	if (fasta_map_orfs(ct, (const uint8_t *)sample, strlen(sample), 1, 0, 1, &orfs) != 0 ||
+	    orfs.count[2] != 1 || orfs.orf[2][0].a != 2 || orfs.orf[2][0].b != 10 ||
+	    orfs.count[3] != 1 || orfs.orf[3][0].a != 11 || orfs.orf[3][0].b != 16)
+	{
+		printf("sample ORFs not found\n");
+		return (2);
+	}
+
+	fasta_orfs_free(&orfs);
+
+	srand(7);
+
+	for (len = 0; r == 0 && len < 400; ++len) {
+		seq = malloc(len + 1);
+
+		for (i = 0; i < len; ++i)
+			seq[i] = "ACGTacgtN"[rand() % 9];
+
+		r = check_seq(ct, seq, len, 3 * (len % 5), 1);
+		free(seq);
+	}
+
+	/*
+	 * A sequence long enough to be split into chunks
+	 */
+	if (r == 0) {
+		len = 5000017;
+		seq = malloc(len);
+
+		for (i = 0; i < len; ++i)
+			seq[i] = "ACGT"[rand() % 4];
+
+		r = check_seq(ct, seq, len, 60, 4);
+		free(seq);
+	}
+
+	for (i = 1; r == 0 && i < (uint64_t)argc; ++i)
+		r = check_db(ct, argv[i]);
+
+	fasta_codon_free(ct);
+
+	return (r == 0 ? 0 : 3);
+}
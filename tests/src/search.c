@@ -0,0 +1,246 @@
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fasta.h>
+#include <search.h>
+#include <libgen.h>
+
+static const char *patterns[] = {
+	"ACGT", "GATTACA", "NNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNNN",
+	"RYRYRY", "aaaaaaaaaaaa", "CCNGG", "TTAGGG", "GCWGC", "BDHV", "A",
+	"AGATCGGAAGAGCACACGTCTGAACTCCAGTCA", "CTGTCTCTTATACACATCT", "KMKMKMKMSW",
+};
+
+#define PATTERNS (sizeof patterns / sizeof patterns[0])
+
+/*
+ * Nucleotides matched by an IUPAC code
+ */
+static const char *expand(int ch)
+{
+	switch (toupper(ch)) {
+	case 'A': return "A";
+	case 'C': return "C";
+	case 'G': return "G";
+	case 'T': case 'U': return "TU";
+	case 'R': return "AG";
+	case 'Y': return "CTU";
+	case 'S': return "CG";
+	case 'W': return "ATU";
+	case 'K': return "GTU";
+	case 'M': return "AC";
+	case 'B': return "CGTU";
+	case 'D': return "AGTU";
+	case 'H': return "ACTU";
+	case 'V': return "ACG";
+	}
+
+	return (NULL);
+}
+
+static int comp(int ch)
+{
+	switch (toupper(ch)) {
+	case 'A': return 'T';
+	case 'C': return 'G';
+	case 'G': return 'C';
+	case 'T': case 'U': return 'A';
+	case 'R': return 'Y';
+	case 'Y': return 'R';
+	case 'K': return 'M';
+	case 'M': return 'K';
+	case 'B': return 'V';
+	case 'V': return 'B';
+	case 'D': return 'H';
+	case 'H': return 'D';
+	}
+
+	return (toupper(ch));
+}
+
+static int naive_match(const char *pat, size_t len, const uint8_t *seq)
+{
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		const char *e = expand(pat[i]);
+
+		if (toupper(pat[i]) == 'N')
+			continue;
+		if (strchr(e, toupper(seq[i])) == NULL)
+			return (0);
+	}
+
+	return (1);
+}
+
+/*
+ * Append the hits found by trying each pattern and its reverse complement
+ * at each position.
+ */
+static size_t naive(const uint8_t *seq, uint64_t len, uint32_t recno, FASTA_hit_t *dst)
+{
+	char rc[FASTA_SEARCH_MAXLEN + 1];
+	uint64_t pos;
+	size_t n = 0, plen;
+	uint32_t p, i;
+
+	for (pos = 0; pos < len; ++pos) {
+		for (p = 0; p < PATTERNS; ++p) {
+			plen = strlen(patterns[p]);
+
+			if (pos + plen > len)
+				continue;
+
+			for (i = 0; i < plen; ++i)
+				rc[plen - 1 - i] = (char)comp(patterns[p][i]);
+
+			if (naive_match(patterns[p], plen, seq + pos)) {
+				dst[n].recno = recno; dst[n].pattern = p; dst[n].pos = pos; dst[n].strand = 0; ++n;
+			}
+
+			if (strncasecmp(rc, patterns[p], plen) != 0 && naive_match(rc, plen, seq + pos)) {
+				dst[n].recno = recno; dst[n].pattern = p; dst[n].pos = pos; dst[n].strand = 1; ++n;
+			}
+		}
+	}
+
+	return (n);
+}
+
+static int hit_cmp(const void *a, const void *b)
+{
+	const FASTA_hit_t *x = a, *y = b;
+
+	if (x->recno != y->recno)
+		return (x->recno < y->recno ? -1 : 1);
+	if (x->pos != y->pos)
+		return (x->pos < y->pos ? -1 : 1);
+	if (x->strand != y->strand)
+		return (x->strand < y->strand ? -1 : 1);
+	if (x->pattern != y->pattern)
+		return (x->pattern < y->pattern ? -1 : 1);
+	return (0);
+}
+
+static int compare(const FASTA_hit_t *hit, size_t count, FASTA_hit_t *expect, size_t n, const char *what)
+{
+	size_t i;
+
+	qsort(expect, n, sizeof(FASTA_hit_t), hit_cmp);
+
+	if (count != n) {
+		printf("%s: %zu hits, expected %zu\n", what, count, n);
+		return (-1);
+	}
+
+	for (i = 0; i < n; ++i) {
+		if (hit_cmp(hit + i, expect + i) != 0) {
+			printf("%s: hit #%zu: record %u, pattern %u, pos %"PRIu64", strand %u; expected record %u, pattern %u, pos %"PRIu64", strand %u\n",
+			       what, i, hit[i].recno, hit[i].pattern, hit[i].pos, hit[i].strand,
+			       expect[i].recno, expect[i].pattern, expect[i].pos, expect[i].strand);
+			return (-1);
+		}
+	}
+
+	return (0);
+}
+
+static int check_db(const FASTA_search_t *srch, const char *path, uint32_t threads)
+{
+	FASTA *fa;
+	FASTA_rec_t *farec;
+	FASTA_hit_t *hit, *expect = NULL;
+	size_t count, n = 0;
+	uint32_t recno;
+	int r;
+
+	if ((fa = fasta_open(path, FASTA_READ, NULL)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", path);
+		return (-1);
+	}
+
+	for (recno = 0; (farec = fasta_read(fa, NULL, FASTA_INMEMSEQ, NULL)) != NULL; ++recno) {
+		expect = realloc(expect, sizeof(FASTA_hit_t) * (n + farec->seq_len * PATTERNS * 2 + 1));
+		n += naive(farec->seq_mem, farec->seq_len, recno, expect + n);
+		fasta_rec_free(farec);
+	}
+
+	if ((hit = fasta_search(fa, srch, threads, &count)) == NULL) {
+		printf("%s: fasta_search => NULL\n", path);
+		r = -1;
+	} else
+		r = compare(hit, count, expect, n, path);
+
+	free(hit);
+	free(expect);
+	fasta_close(fa);
+
+	return (r);
+}
+
+/*
+ * Compare the hits of the packed Shift-And automata with the ones found
+ * by trying each pattern at each position, both in memory and when
+ * scanning the sequence files.
+ */
+int main(int argc, char *argv[])
+{
+	static const char *invalid[] = { "ACGX" };
+	FASTA_search_t *srch;
+	FASTA_hit_t *hit, *expect;
+	uint8_t seq[2048];
+	size_t count, n, len, i;
+	int r = 0;
+
+	if (fasta_search_new(invalid, 1, 0) != NULL || errno != EINVAL) {
+		printf("invalid pattern accepted\n");
+		return (1);
+	}
+
+	if ((srch = fasta_search_new(patterns, PATTERNS, FASTA_SEARCH_REVCOMP)) == NULL) {
+		printf("fasta_search_new => NULL\n");
+		return (2);
+	}
+
+	expect = malloc(sizeof(FASTA_hit_t) * sizeof seq * PATTERNS * 2);
+	srand(3);
+
+	for (len = 0; r == 0 && len < sizeof seq; len += 1 + len / 4) {
+		for (i = 0; i < len; ++i)
+			seq[i] = "ACGTacgtNACGTR"[rand() % 14];
+
+		/* plant an adapter */
+		if (len > 100)
+			memcpy(seq + len / 2, patterns[10], strlen(patterns[10]));
+
+		if ((hit = fasta_search_seq(srch, seq, len, &count)) == NULL) {
+			printf("fasta_search_seq => NULL\n");
+			r = 3;
+			break;
+		}
+
+		n = naive(seq, len, 0, expect);
+
+		if (compare(hit, count, expect, n, "fasta_search_seq") != 0)
+			r = 4;
+
+		free(hit);
+	}
+
+	free(expect);
+
+	for (i = 1; r == 0 && i < (size_t)argc; ++i) {
+		if (check_db(srch, argv[i], 1) != 0 || check_db(srch, argv[i], 3) != 0)
+			r = 5;
+	}
+
+	fasta_search_free(srch);
+
+	return (r);
+}
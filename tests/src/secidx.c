@@ -0,0 +1,248 @@
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fasta.h>
+
+#define SECIDX_PATH    "secidx.fa"
+#define SECIDX_RECORDS 300
+
+static const char *headers[] = {
+	"gnl|FOO|id%u_%u", "gnl|BAR|id%u_%u", "sp|P%05u|PROT_%u", "pat|US|RE%05u|%u", "lcl|seq_%u_%u", "gnl|FOO|x%u_%u"
+};
+
+static int write_db(const char *path, uint32_t records, const char *mode)
+{
+	FILE *fp;
+	uint32_t i, j, len;
+
+	if ((fp = fopen(path, mode)) == NULL)
+		return (-1);
+
+	for (i = 0; i < records; ++i) {
+		fputc('>', fp);
+		fprintf(fp, headers[i % 6], i, i % 5);
+		fputc('\n', fp);
+
+		len = (i * 37) % 500 + (i % 7 == 0 ? 2000 : 1);
+
+		for (j = 0; j < len; ++j)
+			fprintf(fp, "%c%s", "ACGT"[(i + j) % 4], (j + 1) % 60 == 0 || j + 1 == len ? "\n" : "");
+	}
+
+	return (fclose(fp));
+}
+
+static const char *dbkey(const FASTA_rec_t *rec)
+{
+	if (rec->hdr_cnt == 0)
+		return (NULL);
+
+	switch (rec->hdr[0].seqid_fmt) {
+	case SEQID_GNL:
+		return (rec->hdr[0].seqid.gnl.database);
+	case SEQID_PATENTS:
+		return (rec->hdr[0].seqid.patents.country);
+	default:
+		return (NULL);
+	}
+}
+
+static int check_length(FASTA *fa, uint64_t min, uint64_t max, const char *what)
+{
+	const uint32_t *rec;
+	uint32_t i, n, count = 0;
+
+	if ((rec = fasta_index_length(fa, min, max, &n)) == NULL) {
+		printf("%s: fasta_index_length => NULL\n", what);
+		return (-1);
+	}
+
+	for (i = 0; i < n; ++i) {
+		uint64_t len = fa->fa_record[rec[i]].seq_len;
+
+		if (len < min || len > max || (i > 0 && len < fa->fa_record[rec[i - 1]].seq_len)) {
+			printf("%s: [%llu, %llu]: record #%u out of range or order\n", what,
+			       (unsigned long long)min, (unsigned long long)max, rec[i]);
+			return (-1);
+		}
+	}
+
+	for (i = 0; i < fasta_count(fa); ++i)
+		if (fa->fa_record[i].seq_len >= min && fa->fa_record[i].seq_len <= max)
+			++count;
+
+	if (count != n) {
+		printf("%s: [%llu, %llu]: %u records, expected %u\n", what,
+		       (unsigned long long)min, (unsigned long long)max, n, count);
+		return (-1);
+	}
+
+	return (0);
+}
+
+static int check_list(FASTA *fa, const uint32_t *rec, uint32_t n, SeqID_fmt_t fmt, const char *db, const char *what)
+{
+	uint32_t i, k;
+
+	if (rec == NULL) {
+		printf("%s: lookup => NULL\n", what);
+		return (-1);
+	}
+
+	for (i = 0, k = 0; i < fasta_count(fa); ++i) {
+		const FASTA_rec_t *r = fa->fa_record + i;
+
+		if (db != NULL ? dbkey(r) == NULL || strcmp(dbkey(r), db) != 0 : r->hdr[0].seqid_fmt != fmt)
+			continue;
+
+		if (k >= n || rec[k] != i) {
+			printf("%s: record #%u missing\n", what, i);
+			return (-1);
+		}
+
+		++k;
+	}
+
+	if (k != n) {
+		printf("%s: %u records, expected %u\n", what, n, k);
+		return (-1);
+	}
+
+	return (0);
+}
+
+static int check(const char *path, uint32_t options, const char *what)
+{
+	static const SeqID_fmt_t fmts[] = { SEQID_GNL, SEQID_SWISSPROT, SEQID_PATENTS, SEQID_LOCAL, SEQID_GENBANK };
+	static const char *dbs[] = { "FOO", "BAR", "US", "NONE" };
+	FASTA_filter_t flt;
+	FASTA *fa;
+	const uint32_t *rec;
+	uint32_t *sel, i, n, k;
+	int r = 0;
+
+	if ((fa = fasta_open(path, FASTA_READ|options, NULL)) == NULL) {
+		printf("%s: fasta_open(%s) => NULL\n", what, path);
+		return (-1);
+	}
+
+	r |= check_length(fa, 0, UINT64_MAX, what);
+	r |= check_length(fa, 100, 200, what);
+	r |= check_length(fa, 2000, 2000, what);
+	r |= check_length(fa, 3000, 4000, what);
+	r |= check_length(fa, 300, 100, what);
+
+	for (i = 0; i < sizeof fmts / sizeof fmts[0]; ++i) {
+		rec = fasta_index_seqid(fa, fmts[i], &n);
+		r |= check_list(fa, rec, n, fmts[i], NULL, what);
+	}
+
+	for (i = 0; i < sizeof dbs / sizeof dbs[0]; ++i) {
+		rec = fasta_index_database(fa, dbs[i], &n);
+		r |= check_list(fa, rec, n, 0, dbs[i], what);
+	}
+
+	/*
+	 * A narrow length range of fasta_select() is looked up
+	 */
+	memset(&flt, 0, sizeof flt);
+	flt.len_min = 2010;
+	flt.len_max = 2100;
+
+	if ((sel = fasta_select(fa, &flt, &n)) == NULL) {
+		printf("%s: fasta_select => NULL\n", what);
+		r = -1;
+	} else {
+		for (i = 0, k = 0; i < fasta_count(fa); ++i) {
+			if (fa->fa_record[i].seq_len < flt.len_min || fa->fa_record[i].seq_len > flt.len_max)
+				continue;
+			if (k >= n || sel[k++] != i) {
+				printf("%s: fasta_select: record #%u not selected\n", what, i);
+				r = -1;
+				break;
+			}
+		}
+
+		if (r == 0 && k != n) {
+			printf("%s: fasta_select: %u records, expected %u\n", what, n, k);
+			r = -1;
+		}
+
+		free(sel);
+	}
+
+	fasta_close(fa);
+
+	return (r);
+}
+
+/*
+ * Query the secondary indexes built in memory, saved with the index,
+ * loaded from it, and rebuilt after the file was damaged or the sequence
+ * file was changed.
+ */
+int main(int argc, char *argv[])
+{
+	const char *sindex = SECIDX_PATH FASTA_SECIDX_EXT;
+	FILE *fp;
+	int r = 0;
+
+	(void)argc;
+	(void)argv;
+
+	if (write_db(SECIDX_PATH, SECIDX_RECORDS, "w") != 0) {
+		printf("can't write %s\n", SECIDX_PATH);
+		return (2);
+	}
+
+	remove(SECIDX_PATH FASTA_INDEX_EXT);
+	remove(sindex);
+
+	r |= check(SECIDX_PATH, 0, "in memory");
+	r |= check(SECIDX_PATH, FASTA_SECIDX, "built");
+
+	if (access(sindex, F_OK) == 0) {
+		printf("secondary index saved without FASTA_GENINDEX\n");
+		r = -1;
+	}
+
+	r |= check(SECIDX_PATH, FASTA_SECIDX|FASTA_USEINDEX|FASTA_CHKINDEX|FASTA_GENINDEX, "saved");
+
+	if (access(sindex, F_OK) != 0) {
+		printf("secondary index not saved\n");
+		r = -1;
+	}
+
+	r |= check(SECIDX_PATH, FASTA_SECIDX|FASTA_USEINDEX|FASTA_CHKINDEX, "loaded");
+
+	/*
+	 * Damaged lists are detected and the indexes rebuilt
+	 */
+	if ((fp = fopen(sindex, "r+")) != NULL) {
+		fseek(fp, -8, SEEK_END);
+		fputs("7 7 7 7\n", fp);
+		fclose(fp);
+	}
+
+	r |= check(SECIDX_PATH, FASTA_SECIDX|FASTA_USEINDEX|FASTA_CHKINDEX, "damaged");
+
+	/*
+	 * The saved indexes don't match a changed sequence file
+	 */
+	if (write_db(SECIDX_PATH, 20, "a") != 0) {
+		printf("can't append to %s\n", SECIDX_PATH);
+		r = -1;
+	}
+
+	r |= check(SECIDX_PATH, FASTA_SECIDX|FASTA_USEINDEX|FASTA_CHKINDEX|FASTA_GENINDEX, "stale");
+	r |= check(SECIDX_PATH, FASTA_SECIDX|FASTA_USEINDEX|FASTA_CHKINDEX, "reloaded");
+
+	remove(SECIDX_PATH);
+	remove(SECIDX_PATH FASTA_INDEX_EXT);
+	remove(sindex);
+
+	return (r == 0 ? 0 : 3);
+}
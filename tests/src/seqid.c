@@ -0,0 +1,86 @@
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <seqid.h>
+
+#define S(s) ((s) != NULL ? (s) : "(null)")
+
+/*
+ * Parse SeqID strings read from the standard input, one per line, and
+ * print the recognized fields.
+ */
+int main(void)
+{
+	char    line[4096];
+	size_t  len;
+	SeqID_t seqid;
+
+	while (fgets(line, sizeof line, stdin) != NULL) {
+		len = strlen(line);
+
+		if (len > 0 && line[len - 1] == '\n')
+			line[--len] = '\0';
+
+		switch (SeqID_parse(line, len, &seqid)) {
+		case SEQID_ERROR:
+			printf("error\n");
+			return (1);
+		case SEQID_EMPTY:
+			printf("empty\n");
+			break;
+		case SEQID_UNKNOWN:
+			printf("unknown [%s] [%s]\n", S(seqid.unknown.id), S(seqid.unknown.rest));
+			break;
+		case SEQID_GENBANK:
+			printf("genbank [%s] [%s] [%s] [%s] [%s]\n", S(seqid.genbank.id), S(seqid.genbank.gi_number),
+			       S(seqid.genbank.accession), S(seqid.genbank.locus), S(seqid.genbank.rest));
+			break;
+		case SEQID_EMBL:
+			printf("embl [%s] [%s] [%s] [%s] [%s]\n", S(seqid.embl.id), S(seqid.embl.gi_number),
+			       S(seqid.embl.accession), S(seqid.embl.locus), S(seqid.embl.rest));
+			break;
+		case SEQID_DDBJ:
+			printf("ddbj [%s] [%s] [%s] [%s] [%s]\n", S(seqid.ddbj.id), S(seqid.ddbj.gi_number),
+			       S(seqid.ddbj.accession), S(seqid.ddbj.locus), S(seqid.ddbj.rest));
+			break;
+		case SEQID_NBRFPIR:
+			printf("pir [%s] [%s] [%s]\n", S(seqid.nbrfpir.id), S(seqid.nbrfpir.entry), S(seqid.nbrfpir.rest));
+			break;
+		case SEQID_PRF:
+			printf("prf [%s] [%s] [%s]\n", S(seqid.prf.id), S(seqid.prf.name), S(seqid.prf.rest));
+			break;
+		case SEQID_SWISSPROT:
+			printf("sp [%s] [%s] [%s] [%s]\n", S(seqid.swissprot.id), S(seqid.swissprot.accession),
+			       S(seqid.swissprot.name), S(seqid.swissprot.rest));
+			break;
+		case SEQID_PDB1:
+			printf("pdb1 [%s] [%s] [%s] [%s]\n", S(seqid.pdb1.id), S(seqid.pdb1.entry),
+			       S(seqid.pdb1.chain), S(seqid.pdb1.rest));
+			break;
+		case SEQID_PDB2:
+			printf("pdb2 [%s] [%s] [%s] [%s] [%s] [%s]\n", S(seqid.pdb2.id), S(seqid.pdb2.entry),
+			       S(seqid.pdb2.pdbid), S(seqid.pdb2.chain), S(seqid.pdb2.sequence), S(seqid.pdb2.rest));
+			break;
+		case SEQID_PATENTS:
+			printf("pat [%s] [%s] [%s] [%s]\n", S(seqid.patents.id), S(seqid.patents.country),
+			       S(seqid.patents.number), S(seqid.patents.rest));
+			break;
+		case SEQID_BBS:
+			printf("bbs [%s] [%s] [%s]\n", S(seqid.bbs.id), S(seqid.bbs.number), S(seqid.bbs.rest));
+			break;
+		case SEQID_GNL:
+			printf("gnl [%s] [%s] [%s] [%s]\n", S(seqid.gnl.id), S(seqid.gnl.database),
+			       S(seqid.gnl.identifier), S(seqid.gnl.rest));
+			break;
+		case SEQID_NCBIREF:
+			printf("ref [%s] [%s] [%s] [%s]\n", S(seqid.ncbiref.id), S(seqid.ncbiref.accession),
+			       S(seqid.ncbiref.locus), S(seqid.ncbiref.rest));
+			break;
+		case SEQID_LOCAL:
+			printf("lcl [%s] [%s] [%s]\n", S(seqid.local.id), S(seqid.local.identifier), S(seqid.local.rest));
+			break;
+		}
+	}
+
+	return (0);
+}
@@ -0,0 +1,139 @@
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fasta.h>
+#include <set.h>
+#include <libgen.h>
+
+static void *seqlen(FASTA_rec_t *farec, void *arg)
+{
+	(void)arg;
+	return ((void *)(uintptr_t)farec->seq_len);
+}
+
+/*
+ * Compare a set of FASTA files with the individual files: the global
+ * numbering, the records, the ID lookups and the (parallel) apply.
+ */
+int main(int argc, char *argv[])
+{
+	FASTA_set_t *set, *dset;
+	FASTA *fa, *sfa;
+	FASTA_rec_t *r1, *r2;
+	uint32_t maxopen, total, recno, i, j;
+	void **res_s, **res_p;
+	int k;
+
+	if (argc < 4) {
+		fprintf(stderr, "Usage: %s <maxopen> <dir> <fasta-file>...\n", basename(argv[0]));
+		return (1);
+	}
+
+	maxopen = strtoul(argv[1], NULL, 10);
+
+	/*
+	 * Make sure there are up-to-date indexes, the set is then opened
+	 * without touching the shards.
+	 */
+	for (k = 3, total = 0; k < argc; ++k) {
+		if ((fa = fasta_open(argv[k], FASTA_READ|FASTA_USEINDEX|FASTA_GENINDEX|FASTA_CHKINDEX, NULL)) == NULL) {
+			printf("fasta_open(%s) => NULL\n", argv[k]);
+			return (2);
+		}
+
+		total += fasta_count(fa);
+		fasta_close(fa);
+	}
+
+	set  = fasta_open_set((const char * const *)(argv + 3), argc - 3, FASTA_READ|FASTA_USEINDEX|FASTA_CHKINDEX|FASTA_ONDEMSEQ, NULL, maxopen);
+	dset = fasta_open_setdir(argv[2], FASTA_READ|FASTA_ONDEMSEQ, NULL, maxopen);
+
+	if (set == NULL || dset == NULL) {
+		printf("fasta_open_set => NULL\n");
+		return (3);
+	}
+
+	if (fasta_set_count(set) != total || fasta_set_count(dset) != total ||
+	    fasta_set_shards(set) != (uint32_t)(argc - 3) || fasta_set_shards(dset) != (uint32_t)(argc - 3))
+	{
+		printf("count: %u, set=%u, dir=%u\n", total, fasta_set_count(set), fasta_set_count(dset));
+		return (4);
+	}
+
+	/*
+	 * Sequential read, interleaved with reads from the directory set
+	 */
+	for (k = 3, recno = 0; k < argc; ++k) {
+		if ((fa = fasta_open(argv[k], FASTA_READ|FASTA_ONDEMSEQ, NULL)) == NULL)
+			return (2);
+
+		for (i = 0; i < fasta_count(fa); ++i, ++recno) {
+			r1 = fasta_read(fa, NULL, FASTA_INMEMSEQ, NULL);
+			r2 = fasta_set_read(set, NULL, FASTA_INMEMSEQ, NULL);
+
+			if (r1 == NULL || r2 == NULL || r1->seq_len != r2->seq_len ||
+			    memcmp(r1->seq_mem, r2->seq_mem, r1->seq_len) != 0)
+			{
+				printf("%s: record #%u (#%u) differs\n", argv[k], i, recno);
+				return (5);
+			}
+
+			fasta_rec_free(r2);
+			fasta_set_seeko(dset, recno, SEEK_SET);
+
+			if ((r2 = fasta_set_read(dset, NULL, FASTA_INMEMSEQ, NULL)) == NULL ||
+			    r2->seq_len != r1->seq_len)
+			{
+				printf("%s: record #%u (#%u) differs in the directory set\n", argv[k], i, recno);
+				return (6);
+			}
+
+			/*
+			 * The first record with the same ID
+			 */
+			if (r1->rec_id != NULL && r1->hdr[0].seqid_fmt != SEQID_EMPTY) {
+				if (fasta_set_lookup_id(set, r1->rec_id, &j) != 0 || j > recno ||
+				    (sfa = fasta_set_shard(set, j, &j)) == NULL ||
+				    strcmp(sfa->fa_record[j].rec_id, r1->rec_id) != 0)
+				{
+					printf("%s: lookup of \"%s\" failed\n", argv[k], r1->rec_id);
+					return (7);
+				}
+			}
+
+			fasta_rec_free(r1);
+			fasta_rec_free(r2);
+		}
+
+		fasta_close(fa);
+	}
+
+	if (fasta_set_read(set, NULL, FASTA_INMEMSEQ, NULL) != NULL) {
+		printf("read past the last record\n");
+		return (8);
+	}
+
+	if (fasta_set_lookup_id(set, "no such id", &j) != 1) {
+		printf("lookup of a non-existent ID succeeded\n");
+		return (9);
+	}
+
+	res_s = fasta_set_apply(set, seqlen, 0, NULL);
+	res_p = fasta_set_apply(dset, seqlen, FASTA_PARALLEL, NULL);
+
+	if (res_s == NULL || res_p == NULL || memcmp(res_s, res_p, total * sizeof(void *)) != 0) {
+		printf("sequential and parallel apply differ\n");
+		return (10);
+	}
+
+	free(res_s);
+	free(res_p);
+	fasta_set_close(set);
+	fasta_set_close(dset);
+
+	printf("%u records in %d files\n", total, argc - 3);
+
+	return (0);
+}
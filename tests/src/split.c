@@ -0,0 +1,121 @@
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fasta.h>
+#include <part.h>
+#include <libgen.h>
+
+/*
+ * Split a db into `n' parts and compare the records of the opened splits
+ * with the records of the whole db. The slices must not be accepted with
+ * the file `other'.
+ */
+static int check(const char *path, uint32_t n, const char *other)
+{
+	FASTA *fa, *sfa;
+	FASTA_split_t *sp;
+	FASTA_rec_t *r1, *r2;
+	uint32_t k, i, total = 0;
+	uint64_t residues = 0;
+
+	printf("%s: %u splits\n", path, n);
+
+	if ((fa = fasta_open(path, FASTA_READ|FASTA_ONDEMSEQ|FASTA_STATS, NULL)) == NULL) {
+		printf("fasta_open(%s) => NULL\n", path);
+		return (2);
+	}
+
+	if (fasta_splits(fa, n, &sp) != 0) {
+		printf("fasta_splits(%u) => -1\n", n);
+		return (3);
+	}
+
+	for (k = 0; k < n; ++k) {
+		printf("%u: %"PRIu64"-%"PRIu64" #%u+%u %"PRIu64"\n",
+		       k, sp[k].start, sp[k].end, sp[k].first, sp[k].count, sp[k].residues);
+
+		if (sp[k].first != total || (k > 0 && sp[k].start != sp[k - 1].end)) {
+			printf("split %u isn't contiguous\n", k);
+			return (4);
+		}
+
+		total    += sp[k].count;
+		residues += sp[k].residues;
+
+		if (sp[k].count == 0)
+			continue;
+
+		if ((sfa = fasta_open_split(path, sp[k].index, sp[k].index_len, FASTA_READ|FASTA_ONDEMSEQ|FASTA_STATS, NULL)) == NULL) {
+			printf("fasta_open_split(%u) => NULL\n", k);
+			return (5);
+		}
+
+		if (fasta_count(sfa) != sp[k].count) {
+			printf("split %u: %u != %u records\n", k, fasta_count(sfa), sp[k].count);
+			return (6);
+		}
+
+		fasta_seeko(fa, sp[k].first, SEEK_SET);
+
+		for (i = 0; i < sp[k].count; ++i) {
+			r1 = fasta_read(fa, NULL, FASTA_INMEMSEQ, NULL);
+			r2 = fasta_read(sfa, NULL, FASTA_INMEMSEQ, NULL);
+
+			if (r1 == NULL || r2 == NULL || r1->seq_len != r2->seq_len ||
+			    memcmp(r1->seq_mem, r2->seq_mem, r1->seq_len) != 0 ||
+			    (r1->rec_id != NULL && strcmp(r1->rec_id, r2->rec_id) != 0) ||
+			    memcmp(fasta_stats(fa, sp[k].first + i), fasta_stats(sfa, i), sizeof(FASTA_stats_t)) != 0)
+			{
+				printf("split %u: record #%u differs\n", k, i);
+				return (7);
+			}
+
+			fasta_rec_free(r1);
+			fasta_rec_free(r2);
+		}
+
+		fasta_close(sfa);
+
+		/*
+		 * A slice of another file must not be accepted
+		 */
+		if ((sfa = fasta_open_split(other, sp[k].index, sp[k].index_len, FASTA_READ|FASTA_ONDEMSEQ, NULL)) != NULL) {
+			printf("split %u: opened with another file\n", k);
+			return (8);
+		}
+	}
+
+	for (i = 0; i < fasta_count(fa); ++i)
+		residues -= fa->fa_record[i].seq_len;
+
+	if (total != fasta_count(fa) || residues != 0) {
+		printf("splits contain %u of %u records\n", total, fasta_count(fa));
+		return (9);
+	}
+
+	fasta_splits_free(sp, n);
+	fasta_close(fa);
+
+	return (0);
+}
+
+int main(int argc, char *argv[])
+{
+	static const uint32_t n[] = { 1, 2, 3, 5 };
+	size_t i, j;
+	int r = 0;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <fasta-file> ...\n", basename(argv[0]));
+		return (1);
+	}
+
+	for (i = 1; r == 0 && i < (size_t)argc; ++i)
+		for (j = 0; r == 0 && j < sizeof n / sizeof n[0]; ++j)
+			r = check(argv[i], n[j], argv[0]);
+
+	return (r);
+}
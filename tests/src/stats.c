@@ -0,0 +1,55 @@
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fasta.h>
+#include <libgen.h>
+
+int main(int argc, char *argv[])
+{
+	FASTA *fa;
+	const FASTA_stats_t *st;
+	uint32_t options, i, l;
+	uint64_t sum;
+
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "Usage: %s <fasta-file> [idx]\n", basename(argv[0]));
+		return (1);
+	}
+
+	options = FASTA_READ|FASTA_ONDEMSEQ|FASTA_STATS;
+
+	if (argc == 3 && strcmp(argv[2], "idx") == 0)
+		options |= FASTA_USEINDEX|FASTA_GENINDEX|FASTA_CHKINDEX;
+
+	fa = fasta_open(argv[1], options, NULL);
+
+	if (fa == NULL) {
+		printf("fasta_open(%s) => NULL\n", argv[1]);
+		return (2);
+	}
+
+	for (i = 0; i < fasta_count(fa); ++i) {
+		st = fasta_stats(fa, i);
+
+		if (st == NULL) {
+			printf("fasta_stats(%u) => NULL\n", i);
+			return (3);
+		}
+
+		for (l = 0, sum = st->gap; l < 26; ++l)
+			sum += st->residue[l];
+
+		if (sum != fa->fa_record[i].seq_len) {
+			printf("#%u: residue sum %"PRIu64" != %"PRIu64"\n", i, sum, fa->fa_record[i].seq_len);
+			return (4);
+		}
+
+		printf("%"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64" %"PRIu64"\n",
+		       fa->fa_record[i].seq_len, st->gc, st->n, st->lower, st->n_run);
+	}
+
+	fasta_close(fa);
+
+	return (0);
+}
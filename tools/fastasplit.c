@@ -0,0 +1,100 @@
+#define _DEFAULT_SOURCE
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <fasta.h>
+#include <part.h>
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [-c] [-s] [-o <prefix>] <parts> <fasta-file>\n"
+		"\n"
+		"Split a FASTA file into parts with roughly equal number of residues.\n"
+		"The parts are written into <prefix>.<k>.fa (.fq for FASTQ files) along\n"
+		"with their indexes.\n"
+		"\n"
+		"  -c           keep the order of the records (contiguous parts)\n"
+		"  -s           include the composition statistics in the indexes\n"
+		"  -o <prefix>  output prefix (default: the input path without extension)\n",
+		name);
+}
+
+int main(int argc, char *argv[])
+{
+	FASTA        *fa;
+	FASTA_part_t *part;
+	char         *prefix = NULL, *path, *dot;
+	uint32_t      parts, flags = FASTA_PART_LPT, options, k;
+	int           opt, r = 0;
+
+	options = FASTA_READ|FASTA_ONDEMSEQ|FASTA_USEINDEX|FASTA_GENINDEX|FASTA_CHKINDEX;
+
+	while ((opt = getopt(argc, argv, "cso:h")) != -1) {
+		switch (opt) {
+		case 'c':
+			flags |= FASTA_PART_CONTIG;
+			break;
+		case 's':
+			options |= FASTA_STATS;
+			break;
+		case 'o':
+			prefix = strdup(optarg);
+			break;
+		default:
+			usage(basename(argv[0]));
+			return (opt == 'h' ? 0 : 1);
+		}
+	}
+
+	if (argc - optind != 2 || (parts = strtoul(argv[optind], NULL, 10)) == 0) {
+		usage(basename(argv[0]));
+		return (1);
+	}
+
+	if ((fa = fasta_open(argv[optind + 1], options, NULL)) == NULL) {
+		fprintf(stderr, "Can't open %s: %s\n", argv[optind + 1], strerror(errno));
+		return (2);
+	}
+
+	if ((part = fasta_partition(fa, parts, flags)) == NULL) {
+		fprintf(stderr, "Failed to partition %s: %s\n", argv[optind + 1], strerror(errno));
+		fasta_close(fa);
+		return (3);
+	}
+
+	if (prefix == NULL) {
+		prefix = strdup(argv[optind + 1]);
+		dot    = strrchr(prefix, '.');
+
+		if (dot != NULL && strchr(dot, '/') == NULL && dot != prefix)
+			*dot = '\0';
+	}
+
+	path = malloc(strlen(prefix) + 16);
+
+	for (k = 0; k < parts; ++k) {
+		sprintf(path, "%s.%"PRIu32"%s", prefix, k, fa->fa_options & FASTA_FASTQ ? ".fq" : ".fa");
+
+		if (fasta_partition_write(fa, part, k, path) != 0) {
+			fprintf(stderr, "Failed to write %s: %s\n", path, strerror(errno));
+			r = 4;
+			break;
+		}
+
+		printf("%s\t%"PRIu32"\t%"PRIu64"\n", path, part->records[k], part->residues[k]);
+	}
+
+	free(path);
+	free(prefix);
+	fasta_partition_free(part);
+	fasta_close(fa);
+
+	return (r);
+}